@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "dtlsServer.hpp"
+#include "dtlsSynthClient.hpp"
+#include "mbuf.hpp"
+#include "measure.hpp"
+
+using namespace std;
+
+using Clients = std::vector<std::unique_ptr<DtlsSynthClient>>;
+
+// Ports of the established clients, the handshake clients use the ports below
+static constexpr uint16_t echoPort = 40000;
+static constexpr uint16_t handshakePort = 20000;
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0]
+				  << " [EAL options --] <sync|async> [rounds] [established connections] "
+					 "[concurrent handshakes] [workers]"
+				  << std::endl;
+		std::cout << "sync: handshakes run on the core, between the records" << std::endl;
+		std::cout << "async: handshakes run on worker threads" << std::endl;
+		std::cout << "Every round, the established connections echo a record, while new "
+					 "connections do full handshakes in the same batch"
+				  << std::endl;
+		std::cout << "Needs server-cert.pem and server-key.pem in the working directory"
+				  << std::endl;
+		std::cout << "Output: mode,rounds,established connections,concurrent handshakes,"
+					 "workers,mean us per batch,p99 us per batch,max us per batch,handshakes/s"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"dtlsAsync pool", 16383, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+	DtlsSynthClient::setMempool(mempool);
+
+	std::string mode(argv[1]);
+	if ((mode != "sync") && (mode != "async")) {
+		std::cout << "FATAL: unknown mode " << mode << std::endl;
+		return 1;
+	}
+	uint32_t numRounds = 2000;
+	if (argc > 2) {
+		numRounds = atoi(argv[2]);
+	}
+	unsigned int numEcho = 32;
+	if (argc > 3) {
+		numEcho = atoi(argv[3]);
+	}
+	unsigned int numHandshakes = 4;
+	if (argc > 4) {
+		numHandshakes = atoi(argv[4]);
+	}
+	unsigned int numWorkers = 1;
+	if (argc > 5) {
+		numWorkers = atoi(argv[5]);
+	}
+	if (mode == "sync") {
+		numWorkers = 0;
+	}
+
+	try {
+		void *server = DtlsServer_init(mempool);
+		DtlsServer_setAsyncWorkers(server, numWorkers);
+
+		SSL_CTX *clientCtx = SSL_CTX_new(DTLS_method());
+		if (clientCtx == nullptr) {
+			std::cout << "FATAL: cannot create the SSL context of the client" << std::endl;
+			return 1;
+		}
+
+		Clients echoClients;
+		for (unsigned int i = 0; i < numEcho; i++) {
+			echoClients.emplace_back(new DtlsSynthClient(clientCtx, 0x0a000001, echoPort + i));
+			SSL_do_handshake(echoClients.back()->getSsl());
+		}
+		Clients hsClients(numHandshakes);
+		std::vector<bool> closing(numHandshakes, false);
+		auto startHandshake = [&](unsigned int i) {
+			hsClients[i].reset(new DtlsSynthClient(clientCtx, 0x0a000001, handshakePort + i));
+			SSL_do_handshake(hsClients[i]->getSsl());
+			closing[i] = false;
+		};
+
+		std::vector<mbuf *> in;
+		auto deliver = [&](std::vector<DtlsSynthClient::Datagram> datagrams) {
+			for (auto &d : datagrams) {
+				if (d.dstPort >= echoPort) {
+					echoClients.at(d.dstPort - echoPort)->receive(d.data);
+				} else if (!closing.at(d.dstPort - handshakePort)) {
+					hsClients.at(d.dstPort - handshakePort)->receive(d.data);
+				}
+			}
+		};
+
+		// Establish the echo connections first, async handshakes wait for the workers
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (std::chrono::steady_clock::now() < deadline) {
+			for (auto &c : echoClients) {
+				c->send(in);
+			}
+			deliver(DtlsSynthClient::process(server, in));
+			bool done = true;
+			for (auto &c : echoClients) {
+				SSL_do_handshake(c->getSsl());
+				done &= c->isEstablished();
+			}
+			if (done) {
+				break;
+			}
+		}
+		for (auto &c : echoClients) {
+			if (!c->isEstablished()) {
+				std::cout << "FATAL: handshake of connection " << c->getPort() << " failed"
+						  << std::endl;
+				return 1;
+			}
+		}
+
+		for (unsigned int i = 0; i < numHandshakes; i++) {
+			startHandshake(i);
+		}
+
+		// Every batch holds a record of each established connection, and the handshakes
+		std::string data(64, 'x');
+		char echo[64];
+		uint64_t bytesSent = 0;
+		uint64_t bytesEchoed = 0;
+		uint32_t handshakes = 0;
+		std::vector<double> batchTimes;
+		auto startAll = std::chrono::steady_clock::now();
+		for (uint32_t r = 0; r < numRounds; r++) {
+			for (auto &c : echoClients) {
+				SSL_write(c->getSsl(), data.data(), data.size());
+				c->send(in);
+				bytesSent += data.size();
+			}
+			for (unsigned int i = 0; i < numHandshakes; i++) {
+				hsClients[i]->send(in);
+				// The close_notify is out, the port gets a new connection
+				if (closing[i]) {
+					startHandshake(i);
+				}
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			auto datagrams = DtlsSynthClient::process(server, in);
+			batchTimes.push_back(
+				std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start)
+					.count());
+
+			deliver(datagrams);
+			for (auto &c : echoClients) {
+				int len;
+				while ((len = SSL_read(c->getSsl(), echo, sizeof(echo))) > 0) {
+					bytesEchoed += len;
+				}
+			}
+			for (unsigned int i = 0; i < numHandshakes; i++) {
+				SSL *ssl = hsClients[i]->getSsl();
+				SSL_do_handshake(ssl);
+				if (hsClients[i]->isEstablished()) {
+					handshakes++;
+					SSL_shutdown(ssl);
+					closing[i] = true;
+				}
+			}
+		}
+		double seconds =
+			std::chrono::duration<double>(std::chrono::steady_clock::now() - startAll).count();
+
+		// The established connections are never parked, their records come back right away
+		if (bytesEchoed != bytesSent) {
+			std::cout << "FATAL: echoed " << bytesEchoed << " of " << bytesSent << " bytes"
+					  << std::endl;
+			return 1;
+		}
+
+		std::vector<double> sorted(batchTimes);
+		std::sort(sorted.begin(), sorted.end());
+		double mean = 0;
+		for (double t : batchTimes) {
+			mean += t;
+		}
+		mean /= batchTimes.size();
+
+		std::cout << mode << "," << numRounds << "," << numEcho << "," << numHandshakes << ","
+				  << numWorkers << "," << mean << "," << sorted[sorted.size() * 99 / 100] << ","
+				  << sorted.back() << "," << handshakes / seconds << std::endl;
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
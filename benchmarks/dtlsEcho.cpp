@@ -0,0 +1,174 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "dtlsServer.hpp"
+#include "dtlsSynthClient.hpp"
+#include "mbuf.hpp"
+#include "mbufBio.hpp"
+#include "measure.hpp"
+
+using namespace std;
+
+using Clients = std::vector<std::unique_ptr<DtlsSynthClient>>;
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0]
+				  << " [EAL options --] <record size> [number of records per connection] "
+					 "[connections] [openssl|fast]"
+				  << std::endl;
+		std::cout << "openssl: every record goes through SSL_read() and SSL_write()" << std::endl;
+		std::cout << "fast: records are opened and sealed in place, see DtlsServer_setFastPath()"
+				  << std::endl;
+		std::cout << "Needs server-cert.pem and server-key.pem in the working directory"
+				  << std::endl;
+		std::cout << "Output: mode,record size,records,connections,cycles per packet,bytes copied "
+					 "by the BIO per packet,Mbit/s"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"dtlsEcho pool", 16383, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+	DtlsSynthClient::setMempool(mempool);
+
+	unsigned int recordSize = atoi(argv[1]);
+	if ((recordSize == 0) || (recordSize > 1024)) {
+		std::cout << "FATAL: the record size must be within 1 and 1024" << std::endl;
+		return 1;
+	}
+	uint32_t numRecords = 1000;
+	if (argc > 2) {
+		numRecords = atoi(argv[2]);
+	}
+	unsigned int numConns = 32;
+	if (argc > 3) {
+		numConns = atoi(argv[3]);
+	}
+	std::string mode("openssl");
+	if (argc > 4) {
+		mode = argv[4];
+	}
+	if ((mode != "openssl") && (mode != "fast")) {
+		std::cout << "FATAL: unknown mode " << mode << std::endl;
+		return 1;
+	}
+
+	try {
+		void *server = DtlsServer_init(mempool);
+		DtlsServer_setFastPath(server, mode == "fast");
+
+		SSL_CTX *clientCtx = SSL_CTX_new(DTLS_method());
+		if (clientCtx == nullptr) {
+			std::cout << "FATAL: cannot create the SSL context of the client" << std::endl;
+			return 1;
+		}
+
+		Clients clients;
+		for (unsigned int i = 0; i < numConns; i++) {
+			clients.emplace_back(new DtlsSynthClient(clientCtx, 0x0a000001, 40000 + i));
+			SSL_do_handshake(clients.back()->getSsl());
+		}
+
+		// The clients use consecutive ports
+		std::vector<mbuf *> in;
+		auto exchange = [&]() {
+			for (auto &c : clients) {
+				c->send(in);
+			}
+			for (auto &d : DtlsSynthClient::process(server, in)) {
+				clients.at(static_cast<uint16_t>(d.dstPort - 40000))->receive(d.data);
+			}
+		};
+
+		for (int round = 0; round < 16; round++) {
+			exchange();
+			bool done = true;
+			for (auto &c : clients) {
+				SSL_do_handshake(c->getSsl());
+				done &= c->isEstablished();
+			}
+			if (done) {
+				break;
+			}
+		}
+		for (auto &c : clients) {
+			if (!c->isEstablished()) {
+				std::cout << "FATAL: handshake of connection " << c->getPort() << " failed"
+						  << std::endl;
+				return 1;
+			}
+		}
+
+		// Only the established connections count, one batch holds a record of every client
+		std::string data(recordSize, 'x');
+		std::vector<char> echo(recordSize);
+		uint64_t pkts = 0;
+		uint64_t cycles = 0;
+		double seconds = 0;
+		MbufBio::Stats statsBefore = MbufBio::getStats();
+		for (uint32_t r = 0; r < numRecords; r++) {
+			for (auto &c : clients) {
+				SSL_write(c->getSsl(), data.data(), data.size());
+				c->send(in);
+			}
+			pkts += in.size();
+
+			auto startTime = std::chrono::steady_clock::now();
+			uint64_t start = read_rdtsc();
+			auto datagrams = DtlsSynthClient::process(server, in);
+			cycles += read_rdtsc() - start;
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime)
+						   .count();
+
+			pkts += datagrams.size();
+			for (auto &d : datagrams) {
+				clients.at(static_cast<uint16_t>(d.dstPort - 40000))->receive(d.data);
+			}
+			for (auto &c : clients) {
+				if ((SSL_read(c->getSsl(), echo.data(), echo.size()) !=
+						static_cast<int>(recordSize)) ||
+					(memcmp(data.data(), echo.data(), recordSize) != 0)) {
+					std::cout << "FATAL: echo of connection " << c->getPort() << " failed"
+							  << std::endl;
+					return 1;
+				}
+			}
+		}
+		MbufBio::Stats stats = MbufBio::getStats();
+		uint64_t bytesCopied = stats.bytesRead - statsBefore.bytesRead + stats.bytesWritten -
+			statsBefore.bytesWritten;
+
+		uint64_t payloadBits = 8ULL * recordSize * numRecords * numConns;
+		std::cout << mode << "," << recordSize << "," << numRecords << "," << numConns << ","
+				  << cycles / pkts << "," << static_cast<double>(bytesCopied) / pkts << ","
+				  << payloadBits / seconds / 1000000 << std::endl;
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
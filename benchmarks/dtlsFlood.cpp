@@ -0,0 +1,141 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "dtlsServer.hpp"
+#include "dtlsSynthClient.hpp"
+#include "mbuf.hpp"
+
+using namespace std;
+
+// Resident memory of the process in bytes
+uint64_t getRss() {
+	std::ifstream statm("/proc/self/statm");
+	uint64_t size, resident;
+	statm >> size >> resident;
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout
+			<< "Usage: " << argv[0]
+			<< " [EAL options --] <stateful|cookies> [number of ClientHellos] [ClientHellos per "
+			   "batch]"
+			<< std::endl;
+		std::cout << "Needs server-cert.pem and server-key.pem in the working directory"
+				  << std::endl;
+		std::cout << "Output: mode,ClientHellos,ClientHellos per batch,cycles per packet,bytes "
+					 "per packet,packets sent"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"dtlsFlood pool", 16383, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+	DtlsSynthClient::setMempool(mempool);
+
+	std::string mode(argv[1]);
+	bool cookies = mode == "cookies";
+	if (!cookies && (mode != "stateful")) {
+		std::cout << "FATAL: unknown mode " << mode << std::endl;
+		return 1;
+	}
+	uint32_t numHellos = 10000;
+	if (argc > 2) {
+		numHellos = atoi(argv[2]);
+	}
+	unsigned int hellosPerBatch = 32;
+	if (argc > 3) {
+		hellosPerBatch = atoi(argv[3]);
+	}
+
+	try {
+		void *server = DtlsServer_init(mempool);
+		DtlsServer_setCookies(server, cookies);
+
+		SSL_CTX *clientCtx = SSL_CTX_new(DTLS_method());
+		if (clientCtx == nullptr) {
+			std::cout << "FATAL: cannot create the SSL context of the client" << std::endl;
+			return 1;
+		}
+
+		// The flood repeats one ClientHello, every time from another address
+		std::string hello;
+		{
+			DtlsSynthClient c(clientCtx, 0x0a000001, 40000);
+			SSL_do_handshake(c.getSsl());
+			hello = c.getDatagrams().at(0);
+		}
+
+		std::vector<mbuf *> in;
+		uint64_t pktsSent = 0;
+		uint64_t cycles = 0;
+		uint64_t rssBefore = getRss();
+		for (uint32_t i = 0; i < numHellos; i++) {
+			in.push_back(DtlsSynthClient::makePkt(0x0b000000 + (i >> 16), i & 0xffff, hello));
+			if ((in.size() == hellosPerBatch) || (i + 1 == numHellos)) {
+				uint64_t start = read_rdtsc();
+				pktsSent += DtlsSynthClient::process(server, in).size();
+				cycles += read_rdtsc() - start;
+			}
+		}
+		int64_t rssGrowth = getRss() - rssBefore;
+
+		// A real client still gets through
+		DtlsSynthClient c(clientCtx, 0x0a000001, 40000);
+		SSL_do_handshake(c.getSsl());
+		for (int round = 0; (round < 16) && !c.isEstablished(); round++) {
+			c.send(in);
+			for (auto &d : DtlsSynthClient::process(server, in)) {
+				c.receive(d.data);
+			}
+			SSL_do_handshake(c.getSsl());
+		}
+
+		char data[] = "Knock knock";
+		char echo[sizeof(data)] = {0};
+		if (c.isEstablished()) {
+			SSL_write(c.getSsl(), data, sizeof(data));
+			c.send(in);
+			for (auto &d : DtlsSynthClient::process(server, in)) {
+				c.receive(d.data);
+			}
+			SSL_read(c.getSsl(), echo, sizeof(echo));
+		}
+		if (memcmp(data, echo, sizeof(data)) != 0) {
+			std::cout << "FATAL: the connection after the flood failed" << std::endl;
+			return 1;
+		}
+
+		std::cout << mode << "," << numHellos << "," << hellosPerBatch << ","
+				  << cycles / numHellos << "," << static_cast<double>(rssGrowth) / numHellos
+				  << "," << pktsSent << std::endl;
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
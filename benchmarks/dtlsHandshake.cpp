@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "dtlsServer.hpp"
+#include "dtlsSynthClient.hpp"
+#include "mbuf.hpp"
+#include "measure.hpp"
+
+using namespace std;
+
+using Clients = std::vector<std::unique_ptr<DtlsSynthClient>>;
+
+// Run the datagrams of all clients through the server, and hand out its answers
+void exchange(void *server, Clients &clients, double &seconds) {
+	std::vector<mbuf *> in;
+	for (auto &c : clients) {
+		c->send(in);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto datagrams = DtlsSynthClient::process(server, in);
+	seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// The clients of a group use consecutive ports
+	uint16_t firstPort = clients.front()->getPort();
+	for (auto &d : datagrams) {
+		clients.at(static_cast<uint16_t>(d.dstPort - firstPort))->receive(d.data);
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0]
+				  << " [EAL options --] <pooled|unpooled> [number of connections] "
+					 "[concurrent connections]"
+				  << std::endl;
+		std::cout << "Needs server-cert.pem and server-key.pem in the working directory"
+				  << std::endl;
+		std::cout << "Output: mode,connections,concurrent connections,handshakes/s,openssl "
+					 "cycles per connection,memory cycles per connection"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"dtlsHandshake pool", 16383, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+	DtlsSynthClient::setMempool(mempool);
+
+	std::string mode(argv[1]);
+	bool pooled = mode == "pooled";
+	if (!pooled && (mode != "unpooled")) {
+		std::cout << "FATAL: unknown mode " << mode << std::endl;
+		return 1;
+	}
+	uint32_t numConns = 2000;
+	if (argc > 2) {
+		numConns = atoi(argv[2]);
+	}
+	unsigned int concurrent = 32;
+	if (argc > 3) {
+		concurrent = atoi(argv[3]);
+	}
+
+	try {
+		void *server = DtlsServer_init(mempool);
+		if (!pooled) {
+			DtlsServer_setSslPoolSize(server, 0);
+		}
+
+		SSL_CTX *clientCtx = SSL_CTX_new(DTLS_method());
+		if (clientCtx == nullptr) {
+			std::cout << "FATAL: cannot create the SSL context of the client" << std::endl;
+			return 1;
+		}
+
+		// Only the time spent in the server counts
+		double seconds = 0;
+		uint64_t opensslBefore = measureData.openssl;
+		uint64_t memoryBefore = measureData.memory;
+
+		// Every connection does a handshake, echoes one message, and is shut down
+		for (uint32_t first = 0; first < numConns; first += concurrent) {
+			Clients clients;
+			for (uint32_t i = first; (i < first + concurrent) && (i < numConns); i++) {
+				clients.emplace_back(new DtlsSynthClient(clientCtx, 0x0a000001 + (i >> 16), i));
+				SSL_do_handshake(clients.back()->getSsl());
+			}
+
+			for (int round = 0; round < 16; round++) {
+				exchange(server, clients, seconds);
+				bool done = true;
+				for (auto &c : clients) {
+					SSL_do_handshake(c->getSsl());
+					done &= c->isEstablished();
+				}
+				if (done) {
+					break;
+				}
+			}
+
+			char data[] = "Knock knock";
+			for (auto &c : clients) {
+				SSL_write(c->getSsl(), data, sizeof(data));
+			}
+			exchange(server, clients, seconds);
+			for (auto &c : clients) {
+				char echo[sizeof(data)] = {0};
+				SSL_read(c->getSsl(), echo, sizeof(echo));
+				if (memcmp(data, echo, sizeof(data)) != 0) {
+					std::cout << "FATAL: connection " << c->getPort() << " failed" << std::endl;
+					return 1;
+				}
+				SSL_shutdown(c->getSsl());
+			}
+			exchange(server, clients, seconds);
+		}
+
+		std::cout << mode << "," << numConns << "," << concurrent << "," << numConns / seconds
+				  << "," << (measureData.openssl - opensslBefore) / numConns << ","
+				  << (measureData.memory - memoryBefore) / numConns << std::endl;
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
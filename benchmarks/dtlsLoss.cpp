@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "dtlsServer.hpp"
+#include "dtlsSynthClient.hpp"
+#include "mbuf.hpp"
+
+using namespace std;
+
+using Clients = std::vector<std::unique_ptr<DtlsSynthClient>>;
+
+// Ports of the clients
+static constexpr uint16_t firstPort = 10000;
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0]
+				  << " [EAL options --] <loss in percent> [connections] [idle timeout in ms] "
+					 "[give up after ms]"
+				  << std::endl;
+		std::cout << "Datagrams in both directions are lost at random. Clients, which are "
+					 "not connected in time, vanish without a word"
+				  << std::endl;
+		std::cout << "Needs server-cert.pem and server-key.pem in the working directory"
+				  << std::endl;
+		std::cout << "Output: loss,connections,idle timeout,established connections,mean ms "
+					 "per handshake,p95 ms per handshake,connections left,connections left "
+					 "after the idle timeout"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"dtlsLoss pool", 16383, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+	DtlsSynthClient::setMempool(mempool);
+
+	double loss = atof(argv[1]) / 100;
+	unsigned int numConns = 100;
+	if (argc > 2) {
+		numConns = atoi(argv[2]);
+	}
+	unsigned int idleTimeout = 2000;
+	if (argc > 3) {
+		idleTimeout = atoi(argv[3]);
+	}
+	auto giveUp = std::chrono::milliseconds(8000);
+	if (argc > 4) {
+		giveUp = std::chrono::milliseconds(atoi(argv[4]));
+	}
+
+	try {
+		void *server = DtlsServer_init(mempool);
+		DtlsServer_setIdleTimeout(server, idleTimeout);
+
+		SSL_CTX *clientCtx = SSL_CTX_new(DTLS_method());
+		if (clientCtx == nullptr) {
+			std::cout << "FATAL: cannot create the SSL context of the client" << std::endl;
+			return 1;
+		}
+
+		std::mt19937 rng(1);
+		std::bernoulli_distribution lost(loss);
+
+		Clients clients;
+		for (unsigned int i = 0; i < numConns; i++) {
+			clients.emplace_back(new DtlsSynthClient(clientCtx, 0x0a000001, firstPort + i));
+			SSL_do_handshake(clients.back()->getSsl());
+		}
+
+		// Connected clients send their close_notify once, then they are done
+		std::vector<bool> active(numConns, true);
+		std::vector<bool> closing(numConns, false);
+		std::vector<double> latencies;
+		auto start = std::chrono::steady_clock::now();
+
+		while (std::find(active.begin(), active.end(), true) != active.end()) {
+			auto now = std::chrono::steady_clock::now();
+			std::vector<mbuf *> in;
+			for (unsigned int i = 0; i < numConns; i++) {
+				if (!active[i]) {
+					continue;
+				}
+				SSL *ssl = clients[i]->getSsl();
+
+				// The retransmission timer of the client
+				struct timeval tv;
+				if ((DTLSv1_get_timeout(ssl, &tv) == 1) && (tv.tv_sec == 0) &&
+					(tv.tv_usec == 0)) {
+					DTLSv1_handle_timeout(ssl);
+				}
+
+				for (auto &d : clients[i]->getDatagrams()) {
+					if (!lost(rng)) {
+						in.push_back(DtlsSynthClient::makePkt(0x0a000001, firstPort + i, d));
+					}
+				}
+				if (closing[i] || (now - start > giveUp)) {
+					active[i] = false;
+				}
+			}
+
+			for (auto &d : DtlsSynthClient::process(server, in)) {
+				unsigned int i = d.dstPort - firstPort;
+				if (active.at(i) && !lost(rng)) {
+					clients[i]->receive(d.data);
+				}
+			}
+
+			for (unsigned int i = 0; i < numConns; i++) {
+				if (!active[i] || closing[i]) {
+					continue;
+				}
+				SSL *ssl = clients[i]->getSsl();
+				SSL_do_handshake(ssl);
+				if (clients[i]->isEstablished()) {
+					latencies.push_back(std::chrono::duration<double, std::milli>(
+						std::chrono::steady_clock::now() - start)
+											.count());
+					SSL_shutdown(ssl);
+					closing[i] = true;
+				}
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		unsigned int left = DtlsServer_getConnections(server);
+
+		// Only the timeouts of the server run now
+		auto idleEnd = std::chrono::steady_clock::now() +
+			std::chrono::milliseconds(idleTimeout) + std::chrono::seconds(2);
+		while (std::chrono::steady_clock::now() < idleEnd) {
+			std::vector<mbuf *> in;
+			DtlsSynthClient::process(server, in);
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		unsigned int leftIdle = DtlsServer_getConnections(server);
+
+		std::sort(latencies.begin(), latencies.end());
+		double mean = 0;
+		for (double l : latencies) {
+			mean += l;
+		}
+		if (!latencies.empty()) {
+			mean /= latencies.size();
+		}
+		double p95 = latencies.empty() ? 0 : latencies[latencies.size() * 95 / 100];
+
+		std::cout << loss * 100 << "," << numConns << "," << idleTimeout << ","
+				  << latencies.size() << "," << mean << "," << p95 << "," << left << ","
+				  << leftIdle << std::endl;
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
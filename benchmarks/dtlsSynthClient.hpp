@@ -0,0 +1,192 @@
+#ifndef DTLSSYNTHCLIENT_HPP
+#define DTLSSYNTHCLIENT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <openssl/bio.h>
+#include <openssl/ssl.h>
+
+#include "checksum.hpp"
+#include "dtlsServer.hpp"
+#include "headers.hpp"
+#include "mbuf.hpp"
+
+/*! Synthetic DTLS client for benchmarks of the DTLS server
+ *
+ * The client runs OpenSSL with memQ BIOs, its datagrams are put into packets
+ * to the server, and the datagrams of the server are written back to it.
+ * Packets are allocated from the mempool given to setMempool().
+ */
+class DtlsSynthClient {
+public:
+	//! IP of the server (host byte order)
+	static constexpr uint32_t serverIP = 0x0a000002;
+	//! Port of the server (host byte order)
+	static constexpr uint16_t serverPort = 4433;
+
+	//! A datagram sent by the server
+	struct Datagram {
+		uint16_t dstPort;
+		std::string data;
+	};
+
+	static rte_mempool *&getMempool() {
+		static rte_mempool *mempool = nullptr;
+		return mempool;
+	}
+
+	/*! Set the mempool to allocate packets from */
+	static void setMempool(rte_mempool *mempool) { getMempool() = mempool; }
+
+	/*! Build a UDP packet to the server
+	 *
+	 * \param srcIP IP of the client (host byte order)
+	 * \param srcPort Port of the client (host byte order)
+	 * \param data The datagram
+	 * \return The packet
+	 */
+	static mbuf *makePkt(uint32_t srcIP, uint16_t srcPort, const std::string &data) {
+		mbuf *pkt = reinterpret_cast<mbuf *>(rte_pktmbuf_alloc(getMempool()));
+		if (pkt == nullptr) {
+			throw new std::runtime_error("DtlsSynthClient::makePkt() mempool is empty");
+		}
+
+		auto ethernet = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
+		memset(ethernet, 0, sizeof(Headers::Ethernet));
+		ethernet->setEthertype(Headers::Ethernet::ETHERTYPE_IPv4);
+
+		auto ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
+		memset(ipv4, 0, sizeof(Headers::IPv4));
+		ipv4->setVersion();
+		ipv4->setIHL(5);
+		ipv4->ttl = 64;
+		ipv4->setProtoUDP();
+		ipv4->setSrcIP(srcIP);
+		ipv4->setDstIP(serverIP);
+		ipv4->setPayloadLength(sizeof(Headers::Udp) + data.size());
+
+		auto udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+		udp->setSrcPort(srcPort);
+		udp->setDstPort(serverPort);
+		udp->setPayloadLength(data.size());
+		memcpy(udp->getPayload(), data.data(), data.size());
+
+		Checksum::setIPv4(ipv4);
+		Checksum::setUdp(ipv4, udp);
+		pkt->setDataLen(sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) +
+			sizeof(Headers::Udp) + data.size());
+		return pkt;
+	}
+
+	/*! Run a batch through the server (see DtlsServer_process())
+	 *
+	 * All packets are freed, in and out.
+	 *
+	 * \param server Return value of DtlsServer_init()
+	 * \param in The packets to the server, cleared afterwards
+	 * \return The datagrams the server sent
+	 */
+	static std::vector<Datagram> process(void *server, std::vector<mbuf *> &in) {
+		unsigned int sendCount;
+		unsigned int freeCount;
+		void *ba = DtlsServer_process(server, reinterpret_cast<rte_mbuf **>(in.data()),
+			in.size(), &sendCount, &freeCount);
+		in.clear();
+
+		std::vector<rte_mbuf *> sendPkts(sendCount);
+		std::vector<rte_mbuf *> freePkts(freeCount);
+		DtlsServer_getPkts(ba, sendPkts.data(), freePkts.data());
+
+		std::vector<Datagram> datagrams;
+		for (auto pkt : sendPkts) {
+			auto ethernet = reinterpret_cast<Headers::Ethernet *>(
+				reinterpret_cast<mbuf *>(pkt)->getData());
+			auto ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
+			auto udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+			datagrams.push_back({udp->getDstPort(),
+				std::string(reinterpret_cast<char *>(udp->getPayload()),
+					udp->getPayloadLength())});
+			rte_pktmbuf_free(pkt);
+		}
+		for (auto pkt : freePkts) {
+			rte_pktmbuf_free(pkt);
+		}
+		return datagrams;
+	}
+
+private:
+	SSL *ssl;
+	BIO *rbio;
+	BIO *wbio;
+	uint32_t localIP;
+	uint16_t localPort;
+
+public:
+	/*!
+	 * \param ctx SSL context of the client
+	 * \param localIP IP of the client (host byte order)
+	 * \param localPort Port of the client (host byte order)
+	 */
+	DtlsSynthClient(SSL_CTX *ctx, uint32_t localIP, uint16_t localPort)
+		: localIP(localIP), localPort(localPort) {
+		ssl = SSL_new(ctx);
+		rbio = BIO_new(BIO_s_memQ());
+		wbio = BIO_new(BIO_s_memQ());
+		if ((ssl == nullptr) || (rbio == nullptr) || (wbio == nullptr)) {
+			throw new std::runtime_error("DtlsSynthClient() cannot create SSL object");
+		}
+		SSL_set_connect_state(ssl);
+		SSL_set_bio(ssl, rbio, wbio);
+		SSL_set_mtu(ssl, 1280);
+	}
+
+	~DtlsSynthClient() { SSL_free(ssl); }
+
+	DtlsSynthClient(const DtlsSynthClient &) = delete;
+	DtlsSynthClient &operator=(const DtlsSynthClient &) = delete;
+
+	SSL *getSsl() { return ssl; }
+	uint16_t getPort() { return localPort; }
+	bool isEstablished() { return SSL_is_init_finished(ssl); }
+
+	/*! Get the datagrams the client wants to send
+	 *
+	 * \return The datagrams, without any headers
+	 */
+	std::vector<std::string> getDatagrams() {
+		std::vector<std::string> ret;
+		char buf[2048];
+		while (BIO_eof(wbio) == false) {
+			int len = BIO_read(wbio, buf, sizeof(buf));
+			if (len <= 0) {
+				break;
+			}
+			ret.emplace_back(buf, len);
+		}
+		return ret;
+	}
+
+	/*! Put the datagrams the client wants to send into packets
+	 *
+	 * \param out The packets are appended here
+	 */
+	void send(std::vector<mbuf *> &out) {
+		for (auto &d : getDatagrams()) {
+			out.push_back(makePkt(localIP, localPort, d));
+		}
+	}
+
+	/*! Give a datagram of the server to the client
+	 *
+	 * Run SSL_do_handshake(), SSL_read() or SSL_shutdown() afterwards.
+	 *
+	 * \param data The datagram
+	 */
+	void receive(const std::string &data) { BIO_write(rbio, data.data(), data.size()); }
+};
+
+#endif /* DTLSSYNTHCLIENT_HPP */
@@ -0,0 +1,21 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+# Needs server-cert.pem and server-key.pem in the working directory
+numRounds = 2000
+established = 32
+modes = ["sync", "async"]
+concurrent = [1, 4]
+workers = 2
+rerunTimes = 8
+
+print("mode,rounds,established,concurrentHandshakes,workers,meanBatchUs,p99BatchUs,maxBatchUs,handshakesPerSec")
+
+for mode in modes:
+	for c in concurrent:
+		for x in range(0,rerunTimes):
+			proc = subprocess.run(['./dtlsAsync',mode,str(numRounds),str(established),str(c),str(workers)],stdout=subprocess.PIPE)
+			print(proc.stdout.decode('utf-8'), end='')
@@ -0,0 +1,20 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+# Needs server-cert.pem and server-key.pem in the working directory
+recordSizes = [64, 512, 1024]
+numRecords = 5000
+numConns = 32
+modes = ["openssl", "fast"]
+rerunTimes = 8
+
+print("mode,recordSize,records,connections,cyclesPerPkt,bioBytesCopiedPerPkt,mbitPerSec")
+
+for mode in modes:
+	for size in recordSizes:
+		for x in range(0,rerunTimes):
+			proc = subprocess.run(['./dtlsEcho',str(size),str(numRecords),str(numConns),mode],stdout=subprocess.PIPE)
+			print(proc.stdout.decode('utf-8'), end='')
@@ -0,0 +1,19 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+# Needs server-cert.pem and server-key.pem in the working directory
+numHellos = {"stateful": 5000, "cookies": 100000}
+modes = ["stateful", "cookies"]
+batchSizes = [1, 32]
+rerunTimes = 4
+
+print("mode,hellos,batch,cyclesPerPkt,bytesPerPkt,pktsSent")
+
+for mode in modes:
+	for batch in batchSizes:
+		for x in range(0,rerunTimes):
+			proc = subprocess.run(['./dtlsFlood',mode,str(numHellos[mode]),str(batch)],stdout=subprocess.PIPE)
+			print(proc.stdout.decode('utf-8'), end='')
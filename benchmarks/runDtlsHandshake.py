@@ -0,0 +1,19 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+# Needs server-cert.pem and server-key.pem in the working directory
+numConns = 5000
+modes = ["unpooled", "pooled"]
+concurrent = [1, 32]
+rerunTimes = 8
+
+print("mode,connections,concurrent,handshakesPerSec,opensslCyclesPerConn,memoryCyclesPerConn")
+
+for mode in modes:
+	for c in concurrent:
+		for x in range(0,rerunTimes):
+			proc = subprocess.run(['./dtlsHandshake',mode,str(numConns),str(c)],stdout=subprocess.PIPE)
+			print(proc.stdout.decode('utf-8'), end='')
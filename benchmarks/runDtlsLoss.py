@@ -0,0 +1,18 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+# Needs server-cert.pem and server-key.pem in the working directory
+numConns = 200
+losses = [0, 1, 5, 10, 30]
+idleTimeout = 2000
+rerunTimes = 4
+
+print("loss,connections,idleTimeout,established,meanHandshakeMs,p95HandshakeMs,connsLeft,connsLeftAfterIdle")
+
+for loss in losses:
+	for x in range(0,rerunTimes):
+		proc = subprocess.run(['./dtlsLoss',str(loss),str(numConns),str(idleTimeout)],stdout=subprocess.PIPE)
+		print(proc.stdout.decode('utf-8'), end='')
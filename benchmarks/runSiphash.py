@@ -13,7 +13,7 @@ rerunTimes = 32
 
 #cur = step
 
-print("size,cycles")
+print("size,siphash24,siphash13,crc32c,wymix")
 
 points = [ 2**(startPow + x*((maxValPow - startPow)/steps)) for x in range(1,steps) ]
 
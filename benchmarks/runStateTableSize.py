@@ -13,10 +13,11 @@ rerunTimes = 128
 
 #cur = step
 
-print("size,rerun,setup,run")
+print("hasher,size,rerun,setup,run,probes")
 
 points = [ 2**(startPow + x*((maxValPow - startPow)/steps)) for x in range(1,steps) ]
 numMemAccesses = [ x for x in range(0,1) ]
+hashers = [ 'siphash24', 'siphash13', 'crc32c', 'wymix' ]
 
 #print(points)
 
@@ -25,14 +26,16 @@ for cur in points:
 		rerunTimes = rerunTimes - 4
 
 	for n in numMemAccesses:
+		for h in hashers:
 
-		for x in range(0,rerunTimes):
-			proc = subprocess.run(['./stateTableSize',str(cur),str(n)],stdout=subprocess.PIPE)
-			strings = proc.stdout.decode('utf-8').split('\n')
+			for x in range(0,rerunTimes):
+				proc = subprocess.run(['./stateTableSize',str(cur),str(n),h],stdout=subprocess.PIPE)
+				strings = proc.stdout.decode('utf-8').split('\n')
 
-			curSetup = int(strings[0].split(' ')[1])
-			curRun = int(strings[1].split(' ')[1])
+				curSetup = int(strings[0].split(' ')[1])
+				curRun = int(strings[1].split(' ')[1])
+				curProbes = float(strings[2].split(' ')[1])
 
-			curSetup = (curSetup * 1.0) / cur
-			curRun = (curRun * 1.0) / cur
-			print(str(cur) + ',' + str(x) + ',' + str(curSetup) + ',' + str(curRun))
+				curSetup = (curSetup * 1.0) / cur
+				curRun = (curRun * 1.0) / cur
+				print(h + ',' + str(cur) + ',' + str(x) + ',' + str(curSetup) + ',' + str(curRun) + ',' + str(curProbes))
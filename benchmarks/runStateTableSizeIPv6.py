@@ -0,0 +1,20 @@
+import subprocess
+import math
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+steps = 64
+startPow = 6
+maxValPow = 20
+rerunTimes = 8
+
+print("family,size,setup,run,keyBytes,bytesPerConn")
+
+points = [ int(2**(startPow + x*((maxValPow - startPow)/steps))) for x in range(1,steps) ]
+
+for cur in points:
+	for x in range(0,rerunTimes):
+		proc = subprocess.run(['./stateTableSizeIPv6',str(cur)],stdout=subprocess.PIPE)
+		print(proc.stdout.decode('utf-8'), end='')
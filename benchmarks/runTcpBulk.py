@@ -0,0 +1,16 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+mib = 256
+batchSizes = [1, 2, 4, 8, 16, 32, 64, 128]
+rerunTimes = 8
+
+print("mib,batch,cyclesPerByte,mibPerSec,pktsReceived,outOfOrder,synCookies")
+
+for batch in batchSizes:
+	for x in range(0,rerunTimes):
+		proc = subprocess.run(['./tcpBulk',str(mib),str(batch)],stdout=subprocess.PIPE)
+		print(proc.stdout.decode('utf-8'), end='')
@@ -0,0 +1,19 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+seconds = 10
+lanes = [1, 2, 4]
+requestSizes = [100, 1000, 10000]
+concurrent = 512
+rerunTimes = 8
+
+print("seconds,lanes,request,concurrent,connPerSec,mibPerSec,completed,failed,unfinished")
+
+for l in lanes:
+	for request in requestSizes:
+		for x in range(0,rerunTimes):
+			proc = subprocess.run(['./tcpLoadGen',str(seconds),str(l),str(request),str(concurrent)],stdout=subprocess.PIPE)
+			print(proc.stdout.decode('utf-8'), end='')
@@ -0,0 +1,24 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+mib = 16
+rtt = 1000
+algorithms = ["simple", "newreno", "cubic"]
+losses = ["0", "0.1", "0.5", "1", "2", "5"]
+reorderings = ["0", "1", "5"]
+sacks = ["0", "1"]
+options = "1"
+rerunTimes = 4
+
+print("algorithm,loss,mib,rtt,reordering,sack,options,seconds,goodput,rounds,segments,dropped,outOfOrder,stalled")
+
+for algorithm in algorithms:
+	for loss in losses:
+		for reordering in reorderings:
+			for sack in sacks:
+				for x in range(0,rerunTimes):
+					proc = subprocess.run(['./tcpLoss',algorithm,loss,str(mib),str(rtt),reordering,sack,options],stdout=subprocess.PIPE)
+					print(proc.stdout.decode('utf-8'), end='')
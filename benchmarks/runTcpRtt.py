@@ -0,0 +1,21 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+# Single connection without loss, with and without window scaling and timestamps
+mib = 64
+algorithms = ["newreno", "cubic"]
+rtts = [100, 500, 1000, 2000, 5000, 10000, 20000]
+options = ["0", "1"]
+rerunTimes = 4
+
+print("algorithm,loss,mib,rtt,reordering,sack,options,seconds,goodput,rounds,segments,dropped,outOfOrder,stalled")
+
+for algorithm in algorithms:
+	for rtt in rtts:
+		for option in options:
+			for x in range(0,rerunTimes):
+				proc = subprocess.run(['./tcpLoss',algorithm,"0",str(mib),str(rtt),"0","1",option],stdout=subprocess.PIPE)
+				print(proc.stdout.decode('utf-8'), end='')
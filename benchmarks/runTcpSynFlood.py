@@ -0,0 +1,18 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+numSyns = 1000000
+modes = ["stateful", "cookies"]
+batchSizes = [1, 8, 32, 128]
+rerunTimes = 8
+
+print("mode,syns,batch,msynPerSec,stateTableSize,synAcks")
+
+for mode in modes:
+	for batch in batchSizes:
+		for x in range(0,rerunTimes):
+			proc = subprocess.run(['./tcpSynFlood',mode,str(numSyns),str(batch)],stdout=subprocess.PIPE)
+			print(proc.stdout.decode('utf-8'), end='')
@@ -0,0 +1,18 @@
+import subprocess
+
+# XXX
+# XXX You need to adapt the below values
+# XXX
+
+mib = 256
+batchSizes = [1, 2, 4, 8, 16, 32, 64, 128]
+groModes = [0, 1]
+rerunTimes = 8
+
+print("mib,batch,gro,cyclesPerByte,mibPerSec,segments,serverPkts,acksPerSegment")
+
+for gro in groModes:
+	for batch in batchSizes:
+		for x in range(0,rerunTimes):
+			proc = subprocess.run(['./tcpUpload',str(mib),str(batch),str(gro)],stdout=subprocess.PIPE)
+			print(proc.stdout.decode('utf-8'), end='')
@@ -1,37 +1,57 @@
 #include <iostream>
 
 #include "IPv4_5TupleL2Ident.hpp"
+#include "hashers.hpp"
 #include "measure.hpp"
 #include "samplePacket.hpp"
 
-template <class Ident> uint64_t runTest(int numRuns) {
+// Keeps the compiler from optimizing the hash calls away
+volatile uint64_t sink;
+
+template <class HashPolicy> uint64_t runTest(int numRuns) {
 	if (numRuns < 1) {
 		std::cout << "numRuns needs to be bigger than 1" << std::endl;
 		std::abort();
 	}
-	typename Ident::ConnectionID c;
-	typename Ident::Hasher hasher;
+	typename IPv4_5TupleL2Ident<SamplePacket, HashPolicy>::ConnectionID c;
+	c.proto = Headers::IPv4::PROTO_UDP;
+	c.dstIP = htonl(0x0a000001);
+	c.dstPort = htons(443);
+
+	uint64_t res = 0;
 
+	// The Hasher of the identifier also takes measurements, use the policy directly
 	// uint64_t start = start_measurement();
 	uint64_t start = read_rdtsc();
 	for (int i = 0; i < numRuns; i++) {
-		hasher(c);
+		c.srcIP = i;
+		c.srcPort = i >> 7;
+
+		uint64_t words[2];
+		c.toWords(words);
+		res ^= HashPolicy::hash(words, 2);
 	}
 	// uint64_t stop = stop_measurement();
 	uint64_t stop = read_rdtsc();
 
+	sink = res;
+
 	return stop - start;
 };
 
 int main(int argc, char **argv) {
 	if (argc < 2) {
 		std::cout << "Usage: " << argv[0] << " <numRuns>" << std::endl;
+		std::cout << "Output: numRuns,siphash24,siphash13,crc32c,wymix (cycles per key)"
+				  << std::endl;
 		std::exit(0);
 	}
 
 	int numRuns = atoi(argv[1]);
 
-	std::cout << numRuns << ","
-			  << runTest<IPv4_5TupleL2Ident<SamplePacket>>(numRuns) / numRuns << std::endl;
+	std::cout << numRuns << "," << runTest<Hashers::SipHash24ZeroKey>(numRuns) / numRuns << ","
+			  << runTest<Hashers::SipHash13Keyed>(numRuns) / numRuns << ","
+			  << runTest<Hashers::Crc32c>(numRuns) / numRuns << ","
+			  << runTest<Hashers::WyMix>(numRuns) / numRuns << std::endl;
 	return 0;
 }
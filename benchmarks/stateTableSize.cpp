@@ -3,8 +3,7 @@
 #include <limits>
 #include <memory>
 
-#include "sodium.h"
-
+#include "hashers.hpp"
 #include "measure.hpp"
 #include "samplePacket.hpp"
 #include "stateMachine.hpp"
@@ -32,11 +31,8 @@ inline static uint64_t read_rdtsc() {
 
 using namespace std;
 
-class Identifier;
-using SM = StateMachine<Identifier, SamplePacket>;
-
 // This is a very elemental Identifier class
-class Identifier {
+template <class HashPolicy> class Identifier {
 public:
 	struct ConnectionID {
 		uint64_t val;
@@ -61,16 +57,7 @@ public:
 	};
 
 	struct Hasher {
-		size_t operator()(const ConnectionID &id) const {
-			uint64_t res;
-			assert(crypto_shorthash_BYTES == 8);
-			uint8_t key[crypto_shorthash_KEYBYTES];
-			memset(key, 0, crypto_shorthash_KEYBYTES);
-			crypto_shorthash(reinterpret_cast<uint8_t *>(&res),
-				reinterpret_cast<const uint8_t *>(&id.val), sizeof(id.val), key);
-
-			return res;
-		}
+		size_t operator()(const ConnectionID &id) const { return HashPolicy::hash(&id.val, 1); }
 	};
 
 	static ConnectionID identify(SamplePacket *pkt) {
@@ -91,7 +78,8 @@ SamplePacket *getPkt() {
 uint64_t numMemAccess = 0;
 
 // This is the function for state 1
-void fun1(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
+template <class SM>
+void fun1(typename SM::State &state, SamplePacket *pktIn, typename SM::FunIface &fi) {
 
 	DEBUG_ENABLED(cout << endl << "running fun1" << endl;)
 
@@ -126,7 +114,8 @@ void fun1(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
 
 // This is the function for state 2
 // Pretty much the same as state 1...
-void fun2(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
+template <class SM>
+void fun2(typename SM::State &state, SamplePacket *pktIn, typename SM::FunIface &fi) {
 	DEBUG_ENABLED(cout << endl << "running fun2" << endl;)
 
 	DEBUG_ENABLED(if (state.state != 2) { cout << "fun2: state not 2" << endl; })
@@ -143,19 +132,53 @@ void fun2(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
 	*(reinterpret_cast<uint32_t *>(pktIn->getData())) = 24;
 }
 
+/*! Calculate the average probe length of a dense_hash_map
+ *
+ * This replays the insertion of all keys, using the same probing sequence
+ * as google::dense_hash_map (triangular probing, no deletions).
+ *
+ * \param keys All keys, in the order they were inserted
+ * \param bucketCount Number of buckets of the table (rounded up to a power of two)
+ * \return Average number of probes per key
+ */
+template <class Ident>
+double avgProbeLength(
+	const std::vector<typename Ident::ConnectionID> &keys, size_t bucketCount) {
+	typename Ident::Hasher hasher;
+	size_t pow2 = 1;
+	while (pow2 < bucketCount || pow2 < keys.size()) {
+		pow2 <<= 1;
+	}
+	bucketCount = pow2;
+	std::vector<bool> used(bucketCount, false);
+	const size_t mask = bucketCount - 1;
+	uint64_t totalProbes = 0;
+
+	for (auto &k : keys) {
+		size_t bucket = hasher(k) & mask;
+		size_t numProbes = 0;
+		while (used[bucket]) {
+			numProbes++;
+			bucket = (bucket + numProbes) & mask;
+		}
+		used[bucket] = true;
+		totalProbes += numProbes + 1;
+	}
+
+	return static_cast<double>(totalProbes) / keys.size();
+}
+
 void usage(std::string progName) {
-	std::cout << "Usage: " << progName << " <Num States> <Num Mem Accesses>" << std::endl;
+	std::cout << "Usage: " << progName
+			  << " <Num States> <Num Mem Accesses> [siphash24|siphash13|crc32c|wymix]"
+			  << std::endl;
 	std::exit(0);
 }
 
-int main(int argc, char **argv) {
-
-	if (argc < 3) {
-		usage(std::string(argv[0]));
-	}
+template <class HashPolicy> int runBenchmark(unsigned int numStates) {
+	using Ident = Identifier<HashPolicy>;
+	using SM = StateMachine<Ident, SamplePacket>;
 
-	unsigned int numStates = atoi(argv[1]);
-	numMemAccess = atoi(argv[2]);
 	uint64_t startTimer, stopTimer;
 
 	uint64_t *data =
@@ -168,7 +191,7 @@ int main(int argc, char **argv) {
 
 		// All incoming connections start at state 1, and don't require preparation
 		sm.registerStartStateID(
-			1, [&data, &dataCounter](Identifier::ConnectionID cID) -> void * {
+			1, [&data, &dataCounter](typename Ident::ConnectionID cID) -> void * {
 				(void)cID;
 				void *dataRet = reinterpret_cast<void *>(data + dataCounter);
 				dataCounter += numMemAccess;
@@ -179,8 +202,8 @@ int main(int argc, char **argv) {
 		sm.registerEndStateID(3);
 
 		// Register the functions to handle packets for these states
-		sm.registerFunction(1, fun1);
-		sm.registerFunction(2, fun2);
+		sm.registerFunction(1, fun1<SM>);
+		sm.registerFunction(2, fun2<SM>);
 
 		// Setup sanity check
 		assert(sm.getStateTableSize() == 0);
@@ -213,6 +236,14 @@ int main(int argc, char **argv) {
 		stopTimer = read_rdtsc();
 		std::cout << "Run: " << measureData.denseMap - setupCost << std::endl;
 
+		// Probe lengths depend on the quality of the hash function
+		std::vector<typename Ident::ConnectionID> keys;
+		for (unsigned int i = 0; i < numStates; i++) {
+			keys.push_back(Ident::identify(pktsIn[i]));
+		}
+		std::cout << "Probes: " << avgProbeLength<Ident>(keys, sm.getStateTableBucketCount())
+				  << std::endl;
+
 		free(data);
 	} catch (exception *e) {
 		// Just catch whatever fails there may be
@@ -225,3 +256,31 @@ int main(int argc, char **argv) {
 
 	return 0;
 }
+
+int main(int argc, char **argv) {
+
+	if (argc < 3) {
+		usage(std::string(argv[0]));
+	}
+
+	unsigned int numStates = atoi(argv[1]);
+	numMemAccess = atoi(argv[2]);
+
+	std::string hasher = "siphash13";
+	if (argc > 3) {
+		hasher = argv[3];
+	}
+
+	if (hasher == "siphash24") {
+		return runBenchmark<Hashers::SipHash24ZeroKey>(numStates);
+	} else if (hasher == "siphash13") {
+		return runBenchmark<Hashers::SipHash13Keyed>(numStates);
+	} else if (hasher == "crc32c") {
+		return runBenchmark<Hashers::Crc32c>(numStates);
+	} else if (hasher == "wymix") {
+		return runBenchmark<Hashers::WyMix>(numStates);
+	}
+
+	usage(std::string(argv[0]));
+	return 1;
+}
@@ -0,0 +1,130 @@
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "IPDualStack_5TupleL2Ident.hpp"
+#include "IPv4_5TupleL2Ident.hpp"
+#include "IPv6_5TupleL2Ident.hpp"
+#include "headers.hpp"
+#include "measure.hpp"
+#include "samplePacket.hpp"
+#include "stateMachine.hpp"
+
+using namespace std;
+
+// Build one UDP packet per connection, IPv4 or IPv6
+SamplePacket *getPkt(unsigned int connNum, bool ipv6) {
+	uint16_t dataLen = 128;
+	void *data = malloc(dataLen);
+	memset(data, 0, dataLen);
+
+	auto ether = reinterpret_cast<Headers::Ethernet *>(data);
+	Headers::Udp *udp;
+
+	if (ipv6) {
+		ether->setEthertype(Headers::Ethernet::ETHERTYPE_IPv6);
+		auto ip = reinterpret_cast<Headers::IPv6 *>(ether->getPayload());
+		ip->setVersion();
+		ip->nextHeader = Headers::IPv4::PROTO_UDP;
+		ip->setPayloadLength(sizeof(Headers::Udp));
+		// 2001:db8::/32, the connection number goes into the interface ID
+		ip->srcIP[0] = 0x20;
+		ip->srcIP[1] = 0x01;
+		ip->srcIP[2] = 0x0d;
+		ip->srcIP[3] = 0xb8;
+		ip->dstIP = ip->srcIP;
+		ip->dstIP[15] = 1;
+		uint32_t num = htonl(connNum >> 8);
+		memcpy(ip->srcIP.data() + 12, &num, 4);
+		udp = reinterpret_cast<Headers::Udp *>(ip->getPayload());
+	} else {
+		ether->setEthertype(Headers::Ethernet::ETHERTYPE_IPv4);
+		auto ip = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
+		ip->setVersion();
+		ip->setIHL(5);
+		ip->setProtoUDP();
+		ip->setSrcIP(0x0a000000 + (connNum >> 8));
+		ip->setDstIP(0x0b000001);
+		udp = reinterpret_cast<Headers::Udp *>(ip->getPayload());
+	}
+
+	udp->setSrcPort(1024 + (connNum & 0xff));
+	udp->setDstPort(443);
+
+	return new SamplePacket(data, dataLen);
+}
+
+/*! Run numStates connections through a state machine and print the results
+ *
+ * Output: family,numStates,insertion cycles/conn,lookup cycles/conn,key bytes,bytes/conn
+ */
+template <class Ident> int runBenchmark(std::string family, unsigned int numStates, bool ipv6) {
+	using SM = StateMachine<Ident, SamplePacket>;
+
+	try {
+		SM sm;
+
+		sm.registerStartStateID(1, nullptr);
+		sm.registerFunction(
+			1, [](typename SM::State &, SamplePacket *, typename SM::FunIface &) {});
+
+		SamplePacket **spArray =
+			reinterpret_cast<SamplePacket **>(malloc(numStates * sizeof(void *)));
+		for (unsigned int i = 0; i < numStates; i++) {
+			spArray[i] = getPkt(i, ipv6);
+		}
+
+		BufArray<SamplePacket> pktsIn(spArray, numStates);
+
+		measureData.denseMap = 0;
+		sm.runPktBatch(pktsIn);
+		uint64_t setupCost = measureData.denseMap;
+
+		sm.runPktBatch(pktsIn);
+		uint64_t runCost = measureData.denseMap - setupCost;
+
+		assert(sm.getStateTableSize() == numStates);
+
+		// The dense_hash_map stores the key/value pairs directly in its buckets
+		size_t bucketSize = sizeof(std::pair<const typename Ident::ConnectionID,
+			typename SM::State>);
+		double bytesPerConn =
+			static_cast<double>(sm.getStateTableBucketCount() * bucketSize) / numStates;
+
+		std::cout << family << "," << numStates << "," << setupCost / numStates << ","
+				  << runCost / numStates << "," << sizeof(typename Ident::ConnectionID) << ","
+				  << bytesPerConn << std::endl;
+
+		for (unsigned int i = 0; i < numStates; i++) {
+			delete pktsIn[i];
+		}
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0] << " <Num States>" << std::endl;
+		std::cout << "Output: family,numStates,insertion cycles/conn,lookup cycles/conn,key "
+					 "bytes,bytes/conn"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	unsigned int numStates = atoi(argv[1]);
+
+	int ret = 0;
+	ret |= runBenchmark<IPv4_5TupleL2Ident<SamplePacket>>("ipv4", numStates, false);
+	ret |= runBenchmark<IPv6_5TupleL2Ident<SamplePacket>>("ipv6", numStates, true);
+	ret |= runBenchmark<IPDualStack_5TupleL2Ident<SamplePacket>>("dual-v4", numStates, false);
+	ret |= runBenchmark<IPDualStack_5TupleL2Ident<SamplePacket>>("dual-v6", numStates, true);
+	return ret;
+}
@@ -0,0 +1,172 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "mbuf.hpp"
+#include "measure.hpp"
+#include "stateMachine.hpp"
+#include "tcp.hpp"
+#include "tcpConCtlSimple.hpp"
+#include "tcpProtoJoke.hpp"
+#include "tcpSynthPeer.hpp"
+
+using namespace std;
+
+using ProtoJoke = TcpProtoJoke<TcpConCtlSimple>;
+using ServerJoke = TCP::Server<ProtoJoke, TcpConCtlSimple>;
+using SM = StateMachine<TCP::Identifier, mbuf>;
+
+uint64_t serverCycles = 0;
+
+// Run a batch through the server, the sent packets are given to the peer
+void runBatch(SM &sm, TcpSynthPeer &peer, std::vector<mbuf *> &in) {
+	mbuf **pkts = reinterpret_cast<mbuf **>(malloc(in.size() * sizeof(mbuf *)));
+	std::copy(in.begin(), in.end(), pkts);
+
+	BufArray<mbuf> pktsBA(pkts, in.size());
+	in.clear();
+
+	uint64_t start = read_rdtsc();
+	sm.runPktBatch(pktsBA);
+	serverCycles += read_rdtsc() - start;
+
+	std::vector<mbuf *> sent;
+	TcpSynthPeer::collect(pktsBA, sent);
+	for (auto pkt : sent) {
+		peer.receive(pkt);
+		TcpSynthPeer::freePkt(pkt);
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0]
+				  << " [EAL options --] <MiB to transfer> [segments per batch] [SYN cookies 0/1]"
+				  << std::endl;
+		std::cout << "Output: MiB,segments per batch,cycles/byte,MiB/s,packets received,out of "
+					 "order,SYN cookies"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	// The in-flight segments are held by the server, size the pool generously
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"tcpBulk pool", 16383, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+	TcpSynthPeer::setMempool(mempool);
+
+	uint64_t totalBytes = static_cast<uint64_t>(atoi(argv[1])) * 1024 * 1024;
+	unsigned int segsPerBatch = 32;
+	if (argc > 2) {
+		segsPerBatch = atoi(argv[2]);
+	}
+	bool synCookies = false;
+	if (argc > 3) {
+		synCookies = atoi(argv[3]) != 0;
+	}
+
+	try {
+		SM sm;
+		sm.registerGetPktCB(TcpSynthPeer::allocPkt);
+		sm.registerEndStateID(TCP::States::END);
+		sm.registerStartStateID(TCP::States::syn_ack, ServerJoke::factory);
+		if (synCookies) {
+			sm.registerPreAcceptFunction(ServerJoke::preAccept);
+		}
+		sm.registerFunction(TCP::States::syn_ack, ServerJoke::runSynAck);
+		sm.registerFunction(TCP::States::est, ServerJoke::runEst);
+		sm.registerFunction(TCP::States::fin, ServerJoke::runFin);
+		sm.registerFunction(TCP::States::ack_fin, ServerJoke::runAckFin);
+
+		TcpSynthPeer peer(0x0a000001, 0x0a000002, 40000, 7);
+
+		std::vector<mbuf *> in;
+		in.push_back(peer.makeSyn());
+		runBatch(sm, peer, in);
+		if (!peer.isEstablished()) {
+			std::cout << "FATAL: no SYN ACK received" << std::endl;
+			return 1;
+		}
+		if (sm.getStateTableSize() != (synCookies ? 0 : 1)) {
+			std::cout << "FATAL: unexpected state after the SYN" << std::endl;
+			return 1;
+		}
+
+		std::vector<uint8_t> payload(TCP::MSS);
+		for (size_t i = 0; i < payload.size(); i++) {
+			payload[i] = i;
+		}
+
+		serverCycles = 0;
+		auto startTime = std::chrono::steady_clock::now();
+
+		// The peer keeps sending data, the server echoes it back
+		uint64_t bytesSent = 0;
+		unsigned int roundsWithoutProgress = 0;
+		while (peer.getBytesReceived() < totalBytes) {
+			uint64_t received = peer.getBytesReceived();
+
+			for (unsigned int i = 0; (i < segsPerBatch) && (bytesSent < totalBytes); i++) {
+				in.push_back(peer.makeData(payload.data(), payload.size()));
+				bytesSent += payload.size();
+			}
+			if (in.empty()) {
+				// Everything was sent, only acknowledge the echoed data
+				in.push_back(peer.makeAck());
+			}
+			runBatch(sm, peer, in);
+
+			if (peer.getBytesReceived() == received) {
+				if (++roundsWithoutProgress > 16) {
+					std::cout << "FATAL: transfer stalled at " << received << " bytes"
+							  << std::endl;
+					return 1;
+				}
+			} else {
+				roundsWithoutProgress = 0;
+			}
+		}
+
+		auto stopTime = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(stopTime - startTime).count();
+		double mib = static_cast<double>(peer.getBytesReceived()) / (1024 * 1024);
+
+		// The peer closes, the server answers with its FIN, the ACK of it ends the connection
+		in.push_back(peer.makeFin());
+		runBatch(sm, peer, in);
+		in.push_back(peer.makeAck());
+		runBatch(sm, peer, in);
+		if (!peer.isFinReceived() || (sm.getStateTableSize() != 0) ||
+			(sm.getStatesClosed() != 1)) {
+			std::cout << "FATAL: the connection was not closed" << std::endl;
+			return 1;
+		}
+
+		std::cout << argv[1] << "," << segsPerBatch << ","
+				  << static_cast<double>(serverCycles) / peer.getBytesReceived() << ","
+				  << mib / seconds << "," << peer.getPktsReceived() << ","
+				  << peer.getPktsOutOfOrder() << "," << synCookies << std::endl;
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
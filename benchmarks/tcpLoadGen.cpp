@@ -0,0 +1,276 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "blockingconcurrentqueue.h"
+#include "mbuf.hpp"
+#include "stateMachine.hpp"
+#include "tcpClient.hpp"
+#include "tcpConCtlSimple.hpp"
+#include "tcpProtoJoke.hpp"
+#include "tcpServer_C.hpp"
+
+using namespace std;
+using namespace moodycamel;
+
+using ProtoJoke = TcpProtoJoke<TcpConCtlSimple>;
+using ServerJoke = TCP::ServerC<ProtoJoke, TcpConCtlSimple>;
+using SM = StateMachine<TCP::Identifier, mbuf>;
+using Pipe = BlockingConcurrentQueue<struct rte_mbuf *>;
+
+#define BATCH_SIZE 64
+
+static constexpr uint32_t serverIP = 0x0a000002;
+static constexpr uint16_t serverPort = 7;
+
+/* One lane is a connector and a reflector of the client, and a server
+ * The connector opens the connections, and sends the SYNs again on timeouts.
+ * The reflector of the client takes them over from the ConnectionPool, as soon
+ * as the SYN ACK arrives.
+ */
+struct Lane {
+	SM::ConnectionPool connPool;
+	Pipe pipeCS;
+	Pipe pipeSC;
+
+	// Connections opened by the connector, and removed by the reflector
+	atomic<uint64_t> opened;
+	atomic<uint64_t> closed;
+
+	Lane() : pipeCS(100000), pipeSC(100000), opened(0), closed(0){};
+};
+
+struct Config {
+	rte_mempool *mempool;
+	uint32_t requestLen;
+	uint64_t concurrent;
+};
+
+// Process a batch, free what has to be freed and put the rest into the pipe
+template <class Process, class GetPkts>
+void runBatch(Process process, GetPkts getPkts, void *obj, struct rte_mbuf **pkts,
+	unsigned int inCount, Pipe &out, std::vector<struct rte_mbuf *> &sbufs,
+	std::vector<struct rte_mbuf *> &fbufs) {
+	unsigned int sbc, fbc;
+	void *ba = process(obj, pkts, inCount, &sbc, &fbc);
+
+	sbufs.resize(std::max(static_cast<size_t>(sbc), sbufs.size()));
+	fbufs.resize(std::max(static_cast<size_t>(fbc), fbufs.size()));
+	getPkts(ba, sbufs.data(), fbufs.data());
+
+	for (unsigned int i = 0; i < fbc; i++) {
+		rte_pktmbuf_free(fbufs[i]);
+	}
+	out.enqueue_bulk(sbufs.data(), sbc);
+}
+
+void clientConnector(atomic<bool> *run, Lane *lane, unsigned int laneID, Config cfg) {
+	void *obj = TCP_Client_init(cfg.mempool);
+	reinterpret_cast<SM *>(obj)->setConnectionPool(&lane->connPool);
+
+	// Every lane uses its own source IP, the ports are reused after 64k connections
+	uint32_t clientIP = 0x0b000000 + (laneID << 8);
+	uint32_t port = 0;
+
+	struct rte_mbuf *sendBufs[BATCH_SIZE];
+	unsigned int sbc, fbc;
+	std::vector<struct rte_mbuf *> sbufs(BATCH_SIZE);
+	std::vector<struct rte_mbuf *> fbufs(BATCH_SIZE);
+
+	while (run->load()) {
+		// Even without packets the retransmission timers have to run
+		runBatch(TCP_Client_process, TCP_Client_getPkts, obj, nullptr, 0, lane->pipeCS, sbufs,
+			fbufs);
+
+		uint64_t open = lane->opened.load() - lane->closed.load();
+		if (open + BATCH_SIZE > cfg.concurrent) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		unsigned int sbcTotal = 0;
+		for (int i = 0; i < BATCH_SIZE; i++) {
+			struct rte_mbuf *pkt = rte_pktmbuf_alloc(cfg.mempool);
+			uint16_t srcPort = 1024 + (port++ % (65536 - 1024));
+
+			void *ba = TCP_Client_connect(obj, &pkt, 1, &sbc, &fbc, clientIP, serverIP,
+				srcPort, serverPort, cfg.requestLen, cfg.requestLen);
+			TCP_Client_getPkts(ba, &sendBufs[sbcTotal], &pkt);
+
+			sbcTotal += sbc;
+		}
+
+		lane->opened += BATCH_SIZE;
+		lane->pipeCS.enqueue_bulk(sendBufs, sbcTotal);
+	}
+
+	TCP_Client_free(obj);
+};
+
+void clientReflector(atomic<bool> *run, Lane *lane, Config cfg) {
+	void *obj = TCP_Client_init(cfg.mempool);
+	SM *sm = reinterpret_cast<SM *>(obj);
+	sm->setConnectionPool(&lane->connPool);
+
+	struct rte_mbuf *pkts[BATCH_SIZE * 2];
+	std::vector<struct rte_mbuf *> sbufs(BATCH_SIZE * 2);
+	std::vector<struct rte_mbuf *> fbufs(BATCH_SIZE * 2);
+
+	while (run->load()) {
+		size_t inCount = lane->pipeSC.try_dequeue_bulk(pkts, BATCH_SIZE * 2);
+
+		if (inCount > 0) {
+			runBatch(TCP_Client_process, TCP_Client_getPkts, obj, pkts, inCount, lane->pipeCS,
+				sbufs, fbufs);
+			lane->closed.store(sm->getStatesClosed());
+		}
+	}
+
+	TCP_Client_free(obj);
+};
+
+void serverReflector(atomic<bool> *run, Lane *lane, Config cfg) {
+	void *obj = ServerJoke::init(cfg.mempool);
+
+	struct rte_mbuf *pkts[BATCH_SIZE * 2];
+	std::vector<struct rte_mbuf *> sbufs(BATCH_SIZE * 2);
+	std::vector<struct rte_mbuf *> fbufs(BATCH_SIZE * 2);
+
+	while (run->load()) {
+		size_t inCount = lane->pipeCS.try_dequeue_bulk(pkts, BATCH_SIZE * 2);
+
+		if (inCount > 0) {
+			runBatch(ServerJoke::process, ServerJoke::getPkts, obj, pkts, inCount,
+				lane->pipeSC, sbufs, fbufs);
+		}
+	}
+
+	ServerJoke::free(obj);
+};
+
+// Free whatever is still on the way
+void drain(Pipe &pipe) {
+	struct rte_mbuf *pkts[BATCH_SIZE];
+	size_t count;
+	while ((count = pipe.try_dequeue_bulk(pkts, BATCH_SIZE)) > 0) {
+		for (size_t i = 0; i < count; i++) {
+			rte_pktmbuf_free(pkts[i]);
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0]
+				  << " [EAL options --] <seconds> [lanes] [request bytes] [connections per lane]"
+				  << std::endl;
+		std::cout << "Output: seconds,lanes,request bytes,connections per "
+					 "lane,connections/s,MiB/s,completed,failed,unfinished"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	double seconds = atof(argv[1]);
+	unsigned int numLanes = 1;
+	if (argc > 2) {
+		numLanes = atoi(argv[2]);
+	}
+	Config cfg;
+	cfg.requestLen = 100;
+	if (argc > 3) {
+		cfg.requestLen = atoi(argv[3]);
+	}
+	cfg.concurrent = 512;
+	if (argc > 4) {
+		cfg.concurrent = atoi(argv[4]);
+	}
+
+	cfg.mempool = rte_pktmbuf_pool_create(
+		"tcpLoadGen pool", 65535, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (cfg.mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+
+	std::vector<std::unique_ptr<Lane>> lanes;
+	for (unsigned int i = 0; i < numLanes; i++) {
+		lanes.emplace_back(new Lane());
+	}
+
+	atomic<bool> runConnector(true);
+	atomic<bool> runReflector(true);
+	std::vector<thread> connectors;
+	std::vector<thread> reflectors;
+
+	for (unsigned int i = 0; i < numLanes; i++) {
+		reflectors.emplace_back(serverReflector, &runReflector, lanes[i].get(), cfg);
+		reflectors.emplace_back(clientReflector, &runReflector, lanes[i].get(), cfg);
+		connectors.emplace_back(clientConnector, &runConnector, lanes[i].get(), i, cfg);
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+
+	struct TCP_Client_Stats stats;
+	TCP_Client_getStats(&stats);
+	auto stopTime = std::chrono::steady_clock::now();
+
+	runConnector.store(false);
+	for (auto &t : connectors) {
+		t.join();
+	}
+
+	// Let the open connections finish
+	auto drainStart = std::chrono::steady_clock::now();
+	uint64_t unfinished;
+	do {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		unfinished = 0;
+		for (auto &lane : lanes) {
+			unfinished += lane->opened.load() - lane->closed.load();
+		}
+	} while ((unfinished > 0) &&
+			 (std::chrono::steady_clock::now() - drainStart < std::chrono::seconds(5)));
+
+	runReflector.store(false);
+	for (auto &t : reflectors) {
+		t.join();
+	}
+	for (auto &lane : lanes) {
+		drain(lane->pipeCS);
+		drain(lane->pipeSC);
+	}
+
+	struct TCP_Client_Stats total;
+	TCP_Client_getStats(&total);
+
+	double runSeconds = std::chrono::duration<double>(stopTime - startTime).count();
+	double mib = static_cast<double>(stats.bytesSent + stats.bytesReceived) / (1024 * 1024);
+
+	std::cout << seconds << "," << numLanes << "," << cfg.requestLen << "," << cfg.concurrent
+			  << "," << stats.connectionsCompleted / runSeconds << "," << mib / runSeconds
+			  << "," << total.connectionsCompleted << "," << total.connectionsFailed << ","
+			  << unfinished << std::endl;
+
+	if ((total.connectionsCompleted == 0) || (total.connectionsFailed > 0) ||
+		(unfinished > 0)) {
+		std::cout << "FATAL: not all connections completed" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "mbuf.hpp"
+#include "stateMachine.hpp"
+#include "tcp.hpp"
+#include "tcpConCtlCubic.hpp"
+#include "tcpConCtlNewReno.hpp"
+#include "tcpConCtlSimple.hpp"
+#include "tcpProtoJoke.hpp"
+#include "tcpSynthPeer.hpp"
+
+using namespace std;
+
+using SM = StateMachine<TCP::Identifier, mbuf>;
+
+// The peer keeps at most this many bytes, which were not echoed yet
+static constexpr uint64_t maxOutstanding = 1024 * 1024;
+
+// Receive window of the peer, it is only announced in full with window scaling
+static constexpr uint32_t peerWindow = 4 * 1024 * 1024;
+
+struct Result {
+	double seconds = 0;
+	uint64_t bytes = 0;
+	uint64_t rounds = 0;
+	uint64_t segments = 0;
+	uint64_t dropped = 0;
+	uint64_t outOfOrder = 0;
+	bool stalled = false;
+};
+
+/* Delay packets with the given probability by one to three positions
+ * Every packet is delayed at most once.
+ */
+static void reorderPkts(std::vector<mbuf *> &pkts, double reorder, std::mt19937 &rng) {
+	std::bernoulli_distribution delay(reorder);
+	std::uniform_int_distribution<size_t> distance(1, 3);
+
+	for (size_t i = 0; i + 1 < pkts.size(); i++) {
+		if (delay(rng)) {
+			size_t d = std::min(distance(rng), pkts.size() - 1 - i);
+			std::rotate(pkts.begin() + i, pkts.begin() + i + 1, pkts.begin() + i + 1 + d);
+			i += d;
+		}
+	}
+}
+
+/* Echo data through the server, the segments of the server carrying data are
+ * dropped with the given probability.
+ * Every round is one RTT: The peer sends its ACKs and new data, the server
+ * answers, the answers arrive at the peer.
+ * Packets are reordered in both directions, the server has to reassemble
+ * the data of the peer.
+ */
+template <class ConCtl>
+Result run(double loss, double reorder, bool sack, bool options, uint64_t totalBytes,
+	std::chrono::microseconds rtt) {
+	using Server = TCP::Server<TcpProtoJoke<ConCtl>, ConCtl>;
+
+	SM sm;
+	sm.registerGetPktCB(TcpSynthPeer::allocPkt);
+	sm.registerEndStateID(TCP::States::END);
+	sm.registerStartStateID(TCP::States::syn_ack, Server::factory);
+	sm.registerFunction(TCP::States::syn_ack, Server::runSynAck);
+	sm.registerFunction(TCP::States::est, Server::runEst);
+	sm.registerFunction(TCP::States::fin, Server::runFin);
+	sm.registerFunction(TCP::States::ack_fin, Server::runAckFin);
+
+	TcpSynthPeer peer(0x0a000001, 0x0a000002, 40000, 7, peerWindow, sack, options);
+	std::mt19937 rng(42);
+	std::bernoulli_distribution drop(loss);
+
+	std::vector<uint8_t> payload(TCP::MSS);
+	std::vector<mbuf *> in;
+	std::vector<mbuf *> sent;
+	auto lastProgress = std::chrono::steady_clock::now();
+	Result res;
+
+	in.push_back(peer.makeSyn());
+
+	auto startTime = std::chrono::steady_clock::now();
+	while (peer.getBytesReceived() < totalBytes) {
+		auto roundStart = std::chrono::steady_clock::now();
+		uint64_t received = peer.getBytesReceived();
+
+		// The ACKs of the last round are already in, send new data
+		while ((peer.getBytesSent() < totalBytes) &&
+			   (peer.getBytesSent() - peer.getBytesReceived() < maxOutstanding)) {
+			in.push_back(peer.makeData(payload.data(), payload.size()));
+		}
+
+		// The batch may be empty, if all segments of the last round were lost
+		// It still runs the retransmission timers
+		reorderPkts(in, reorder, rng);
+		mbuf **pkts = reinterpret_cast<mbuf **>(malloc(in.size() * sizeof(mbuf *)));
+		std::copy(in.begin(), in.end(), pkts);
+		BufArray<mbuf> pktsBA(pkts, in.size());
+		in.clear();
+
+		sm.runPktBatch(pktsBA);
+		TcpSynthPeer::collect(pktsBA, sent);
+		reorderPkts(sent, reorder, rng);
+
+		for (auto pkt : sent) {
+			// The payload is always chained behind the headers
+			bool hasData = pkt->next != nullptr;
+			res.segments += hasData;
+			if (hasData && drop(rng)) {
+				res.dropped++;
+			} else if (peer.receive(pkt)) {
+				// Acknowledge every segment, as it arrives
+				in.push_back(peer.makeAck());
+			}
+			TcpSynthPeer::freePkt(pkt);
+		}
+		sent.clear();
+		res.rounds++;
+
+		if (peer.getBytesReceived() != received) {
+			lastProgress = roundStart;
+		} else if (roundStart - lastProgress > std::chrono::seconds(30)) {
+			// Even with backoff, the RTO should be way shorter
+			res.stalled = true;
+			break;
+		}
+
+		std::this_thread::sleep_until(roundStart + rtt);
+	}
+	auto stopTime = std::chrono::steady_clock::now();
+
+	res.seconds = std::chrono::duration<double>(stopTime - startTime).count();
+	res.bytes = peer.getBytesReceived();
+	res.outOfOrder = peer.getPktsOutOfOrder();
+	return res;
+}
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		std::cout << "Usage: " << argv[0]
+				  << " [EAL options --] <simple|newreno|cubic> <loss in percent> [MiB to "
+					 "transfer] [RTT in us] [reordering in percent] [SACK 0/1] [window "
+					 "scaling and timestamps 0/1]"
+				  << std::endl;
+		std::cout << "Output: algorithm,loss,MiB,RTT,reordering,SACK,options,seconds,goodput in "
+					 "MiB/s,rounds,segments,dropped,out of order,stalled"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"tcpLoss pool", 16383, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+	TcpSynthPeer::setMempool(mempool);
+
+	std::string algorithm(argv[1]);
+	double loss = atof(argv[2]) / 100;
+	unsigned int mib = 16;
+	if (argc > 3) {
+		mib = atoi(argv[3]);
+	}
+	std::chrono::microseconds rtt(1000);
+	if (argc > 4) {
+		rtt = std::chrono::microseconds(atoi(argv[4]));
+	}
+	double reorder = 0;
+	if (argc > 5) {
+		reorder = atof(argv[5]) / 100;
+	}
+	bool sack = true;
+	if (argc > 6) {
+		sack = atoi(argv[6]) != 0;
+	}
+	bool options = true;
+	if (argc > 7) {
+		options = atoi(argv[7]) != 0;
+	}
+	uint64_t totalBytes = static_cast<uint64_t>(mib) * 1024 * 1024;
+
+	Result res;
+	try {
+		if (algorithm == "simple") {
+			res = run<TcpConCtlSimple>(loss, reorder, sack, options, totalBytes, rtt);
+		} else if (algorithm == "newreno") {
+			res = run<TcpConCtlNewReno>(loss, reorder, sack, options, totalBytes, rtt);
+		} else if (algorithm == "cubic") {
+			res = run<TcpConCtlCubic>(loss, reorder, sack, options, totalBytes, rtt);
+		} else {
+			std::cout << "FATAL: unknown algorithm " << algorithm << std::endl;
+			return 1;
+		}
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	std::cout << algorithm << "," << argv[2] << "," << mib << "," << rtt.count() << ","
+			  << reorder * 100 << "," << sack << "," << options << "," << res.seconds << ","
+			  << res.bytes / (1024 * 1024 * res.seconds) << "," << res.rounds << ","
+			  << res.segments << "," << res.dropped << "," << res.outOfOrder << ","
+			  << res.stalled << std::endl;
+
+	return res.stalled ? 1 : 0;
+}
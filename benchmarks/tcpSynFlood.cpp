@@ -0,0 +1,136 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "mbuf.hpp"
+#include "stateMachine.hpp"
+#include "tcp.hpp"
+#include "tcpConCtlSimple.hpp"
+#include "tcpProtoJoke.hpp"
+#include "tcpSynthPeer.hpp"
+
+using namespace std;
+
+using ProtoJoke = TcpProtoJoke<TcpConCtlSimple>;
+using ServerJoke = TCP::Server<ProtoJoke, TcpConCtlSimple>;
+using SM = StateMachine<TCP::Identifier, mbuf>;
+
+// Run a batch through the server, count and free what it sends
+uint64_t runBatch(SM &sm, std::vector<mbuf *> &in, TcpSynthPeer *peer = nullptr) {
+	mbuf **pkts = reinterpret_cast<mbuf **>(malloc(in.size() * sizeof(mbuf *)));
+	std::copy(in.begin(), in.end(), pkts);
+
+	BufArray<mbuf> pktsBA(pkts, in.size());
+	in.clear();
+	sm.runPktBatch(pktsBA);
+
+	std::vector<mbuf *> sent;
+	TcpSynthPeer::collect(pktsBA, sent);
+	for (auto pkt : sent) {
+		if (peer != nullptr) {
+			peer->receive(pkt);
+		}
+		TcpSynthPeer::freePkt(pkt);
+	}
+	return sent.size();
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0]
+				  << " [EAL options --] <stateful|cookies> [number of SYNs] [SYNs per batch]"
+				  << std::endl;
+		std::cout << "Output: mode,SYNs,SYNs per batch,MSYN/s,state table size,SYN ACKs sent"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"tcpSynFlood pool", 16383, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+	TcpSynthPeer::setMempool(mempool);
+
+	std::string mode(argv[1]);
+	bool synCookies = mode == "cookies";
+	if (!synCookies && (mode != "stateful")) {
+		std::cout << "FATAL: unknown mode " << mode << std::endl;
+		return 1;
+	}
+	uint32_t numSyns = 100000;
+	if (argc > 2) {
+		numSyns = atoi(argv[2]);
+	}
+	unsigned int synsPerBatch = 32;
+	if (argc > 3) {
+		synsPerBatch = atoi(argv[3]);
+	}
+
+	try {
+		SM sm;
+		sm.registerGetPktCB(TcpSynthPeer::allocPkt);
+		sm.registerEndStateID(TCP::States::END);
+		sm.registerStartStateID(TCP::States::syn_ack, ServerJoke::factory);
+		if (synCookies) {
+			sm.registerPreAcceptFunction(ServerJoke::preAccept);
+		}
+		sm.registerFunction(TCP::States::syn_ack, ServerJoke::runSynAck);
+		sm.registerFunction(TCP::States::est, ServerJoke::runEst);
+		sm.registerFunction(TCP::States::fin, ServerJoke::runFin);
+		sm.registerFunction(TCP::States::ack_fin, ServerJoke::runAckFin);
+
+		// Every SYN of the flood comes from another address, none is answered
+		std::vector<mbuf *> in;
+		uint64_t synAcks = 0;
+		auto startTime = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < numSyns; i++) {
+			TcpSynthPeer spoofed(0x0b000000 + (i >> 16), 0x0a000002, i & 0xffff, 7);
+			in.push_back(spoofed.makeSyn());
+			if ((in.size() == synsPerBatch) || (i + 1 == numSyns)) {
+				synAcks += runBatch(sm, in);
+			}
+		}
+		auto stopTime = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(stopTime - startTime).count();
+		size_t tableSize = sm.getStateTableSize();
+
+		// A real client still gets through
+		TcpSynthPeer peer(0x0a000001, 0x0a000002, 40000, 7, 1024 * 1024, true, true);
+		in.push_back(peer.makeSyn());
+		runBatch(sm, in, &peer);
+		uint8_t data[] = "Knock knock";
+		in.push_back(peer.makeData(data, sizeof(data)));
+		runBatch(sm, in, &peer);
+		if (!peer.isEstablished() || !peer.isSackPermitted() || !peer.isWscaleEnabled() ||
+			!peer.isTimestampEnabled() || (peer.getBytesReceived() == 0)) {
+			std::cout << "FATAL: the connection after the flood failed" << std::endl;
+			return 1;
+		}
+
+		std::cout << mode << "," << numSyns << "," << synsPerBatch << ","
+				  << numSyns / seconds / 1000000 << "," << tableSize << "," << synAcks
+				  << std::endl;
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
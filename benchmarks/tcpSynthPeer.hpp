@@ -0,0 +1,350 @@
+#ifndef TCPSYNTHPEER_HPP
+#define TCPSYNTHPEER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "bufArray.hpp"
+#include "headers.hpp"
+#include "mbuf.hpp"
+#include "pktParser.hpp"
+#include "tcpOptions.hpp"
+#include "tcpSeq.hpp"
+
+/*! Synthetic TCP peer for benchmarks of TCP::Server
+ *
+ * The peer builds the packets of a client, and consumes the packets sent by
+ * the server. Out-of-order data is kept (only the sequence numbers, not the
+ * payload), every packet of the peer acknowledges all in-order data
+ * cumulatively.
+ * With SACK enabled, the peer offers it in its SYN, and reports the
+ * out-of-order data in SACK blocks, the most recent one first (RFC 2018).
+ * With options enabled, the peer offers window scaling and timestamps
+ * (RFC 7323), the timestamp of the last segment in order is echoed.
+ * The sequence numbers of the server must not wrap during a run.
+ *
+ * Packets are allocated from the mempool given to setMempool(), the server
+ * has to use allocPkt() as well, as it holds references to the buffers.
+ */
+class TcpSynthPeer {
+private:
+	uint32_t localIP;
+	uint32_t remoteIP;
+	uint16_t localPort;
+	uint16_t remotePort;
+	uint32_t window;
+	bool sack;
+	bool options;
+
+	uint32_t sndNxt = 1000;
+	uint32_t sndUna = 1000;
+	uint32_t rcvNxt = 0;
+
+	uint64_t bytesSent = 0;
+	uint64_t bytesReceived = 0;
+	uint64_t pktsReceived = 0;
+	uint64_t pktsOutOfOrder = 0;
+	bool established = false;
+	bool finReceived = false;
+	bool sackPermitted = false;
+
+	// Window scaling and timestamps, if the server agreed to them
+	static constexpr uint16_t mss = 1460;
+	uint8_t wscale = 0;
+	bool wscaleEnabled = false;
+	bool tsEnabled = false;
+	uint32_t tsClock = 1;
+	uint32_t tsRecent = 0;
+
+	// Segments received ahead of rcvNxt, sequence number -> length
+	std::map<uint32_t, uint16_t> outOfOrder;
+	uint32_t lastOutOfOrder = 0;
+
+	// The SACK blocks, the one holding the last segment received first
+	uint8_t getSackBlocks(TcpOptions::SackBlock *blocks) {
+		std::vector<TcpOptions::SackBlock> all;
+		for (auto &seg : outOfOrder) {
+			if (!all.empty() && TcpSeq::le(seg.first, all.back().right)) {
+				all.back().right = std::max(all.back().right, seg.first + seg.second,
+					[](uint32_t a, uint32_t b) { return TcpSeq::lt(a, b); });
+			} else {
+				all.push_back(TcpOptions::SackBlock{seg.first, seg.first + seg.second});
+			}
+		}
+
+		uint8_t num = 0;
+		for (auto &block : all) {
+			if (TcpSeq::le(block.left, lastOutOfOrder) && TcpSeq::lt(lastOutOfOrder, block.right)) {
+				blocks[num++] = block;
+			}
+		}
+		for (auto it = all.rbegin();
+			 (it != all.rend()) && (num < TcpOptions::sendSackBlocks); it++) {
+			if ((num == 0) || (blocks[0].left != it->left)) {
+				blocks[num++] = *it;
+			}
+		}
+		return num;
+	}
+
+	void advance(uint32_t end) {
+		if (TcpSeq::lt(rcvNxt, end)) {
+			bytesReceived += end - rcvNxt;
+			rcvNxt = end;
+		}
+	}
+
+	static constexpr uint16_t headersLen =
+		sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Tcp);
+
+	// Packets built by the peer are not parsed, the layout is fixed
+	static Headers::Tcp *getTcp(mbuf *pkt) {
+		return reinterpret_cast<Headers::Tcp *>(reinterpret_cast<uint8_t *>(pkt->getData()) +
+												headersLen - sizeof(Headers::Tcp));
+	}
+
+	// Build the headers, the payload goes behind the options
+	mbuf *buildPkt(uint16_t payloadLen, uint8_t *&payload, bool syn = false) {
+		mbuf *pkt = allocPkt();
+		auto ether = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
+		auto ipv4 = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
+		auto tcp = getTcp(pkt);
+
+		uint8_t *opt = reinterpret_cast<uint8_t *>(tcp->getPayload());
+		uint8_t optionsLen = 0;
+		if (syn) {
+			optionsLen += TcpOptions::writeMss(opt, mss);
+			if (sack) {
+				optionsLen += TcpOptions::writeSackPermitted(opt + optionsLen);
+			}
+			if (options) {
+				optionsLen += TcpOptions::writeWscale(opt + optionsLen, wscale);
+				optionsLen += TcpOptions::writeTimestamp(opt + optionsLen, tsClock++, 0);
+			}
+		} else {
+			if (tsEnabled) {
+				optionsLen += TcpOptions::writeTimestamp(opt + optionsLen, tsClock++, tsRecent);
+			}
+			if (sackPermitted && !outOfOrder.empty()) {
+				TcpOptions::SackBlock blocks[TcpOptions::sendSackBlocks];
+				optionsLen +=
+					TcpOptions::writeSack(opt + optionsLen, blocks, getSackBlocks(blocks));
+			}
+		}
+		payload = opt + optionsLen;
+
+		ether->setEthertype(Headers::Ethernet::ETHERTYPE_IPv4);
+		ipv4->setVersion();
+		ipv4->setIHL(5);
+		ipv4->ttl = 64;
+		ipv4->setProtoTCP();
+		ipv4->setSrcIP(localIP);
+		ipv4->setDstIP(remoteIP);
+		ipv4->setPayloadLength(sizeof(Headers::Tcp) + optionsLen + payloadLen);
+
+		tcp->setSrcPort(localPort);
+		tcp->setDstPort(remotePort);
+		tcp->setOffset((sizeof(Headers::Tcp) + optionsLen) / 4);
+		tcp->setSeq(sndNxt);
+		tcp->setAck(rcvNxt);
+		if (wscaleEnabled) {
+			tcp->setWindow(window >> wscale);
+		} else {
+			tcp->setWindow(std::min(window, static_cast<uint32_t>(0xffff)));
+		}
+
+		pkt->setDataLen(headersLen + optionsLen + payloadLen);
+		return pkt;
+	}
+
+public:
+	static rte_mempool *&getMempool() {
+		static rte_mempool *mempool = nullptr;
+		return mempool;
+	}
+
+	/*! Set the mempool to allocate packets from */
+	static void setMempool(rte_mempool *mempool) { getMempool() = mempool; }
+
+	/*! Allocate a packet buffer (usable as getPktCB of the StateMachine) */
+	static mbuf *allocPkt() {
+		mbuf *pkt = reinterpret_cast<mbuf *>(rte_pktmbuf_alloc(getMempool()));
+		if (pkt == nullptr) {
+			throw new std::runtime_error("TcpSynthPeer::allocPkt() mempool is empty");
+		}
+		return pkt;
+	}
+
+	/*! Free a packet (including the buffers chained to it) */
+	static void freePkt(mbuf *pkt) { pkt->release(); }
+
+	/*! Free all packets of a processed BufArray
+	 *
+	 * \param pkts BufArray after StateMachine::runPktBatch()
+	 * \param sent The packets marked as send are appended here, they have to
+	 * be given to receive() and freed by the caller
+	 */
+	static void collect(BufArray<mbuf> &pkts, std::vector<mbuf *> &sent) {
+		uint32_t sendCount = pkts.getSendCount();
+		uint32_t freeCount = pkts.getFreeCount();
+
+		size_t oldSize = sent.size();
+		sent.resize(oldSize + sendCount);
+		pkts.getSendBufs(sent.data() + oldSize);
+
+		std::vector<mbuf *> freeBufs(freeCount);
+		pkts.getFreeBufs(freeBufs.data());
+		for (auto pkt : freeBufs) {
+			freePkt(pkt);
+		}
+	}
+
+	/*!
+	 * \param localIP IP of the peer (host byte order)
+	 * \param remoteIP IP of the server (host byte order)
+	 * \param localPort Port of the peer (host byte order)
+	 * \param remotePort Port of the server (host byte order)
+	 * \param window Receive window announced by the peer, in bytes
+	 * \param sack Offer SACK to the server
+	 * \param options Offer window scaling and timestamps to the server
+	 */
+	TcpSynthPeer(uint32_t localIP, uint32_t remoteIP, uint16_t localPort, uint16_t remotePort,
+		uint32_t window = 0xffff, bool sack = false, bool options = false)
+		: localIP(localIP), remoteIP(remoteIP), localPort(localPort), remotePort(remotePort),
+		  window(window), sack(sack), options(options) {
+		while ((window >> wscale) > 0xffff) {
+			wscale++;
+		}
+	};
+
+	/*! Build the SYN opening the connection */
+	mbuf *makeSyn() {
+		uint8_t *payload;
+		mbuf *pkt = buildPkt(0, payload, true);
+		auto tcp = getTcp(pkt);
+		tcp->setAck(0);
+		tcp->setSynFlag();
+		sndNxt++;
+		return pkt;
+	}
+
+	/*! Build a segment carrying data
+	 *
+	 * \param data Payload
+	 * \param len Length of the payload, at most one MSS
+	 */
+	mbuf *makeData(const uint8_t *data, uint16_t len) {
+		uint8_t *payload;
+		mbuf *pkt = buildPkt(len, payload);
+		auto tcp = getTcp(pkt);
+		tcp->setAckFlag();
+		if (len > 0) {
+			memcpy(payload, data, len);
+		}
+		sndNxt += len;
+		bytesSent += len;
+		return pkt;
+	}
+
+	/*! Build a pure ACK for everything received so far */
+	mbuf *makeAck() { return makeData(nullptr, 0); }
+
+	/*! Build the FIN closing the connection, no data may follow */
+	mbuf *makeFin() {
+		mbuf *pkt = makeAck();
+		getTcp(pkt)->setFinFlag();
+		sndNxt++;
+		return pkt;
+	}
+
+	/*! Process a packet sent by the server
+	 *
+	 * The packet is not freed.
+	 *
+	 * \param pkt The packet
+	 * \return True, if the packet carried data (or a FIN), which a real
+	 * receiver would acknowledge immediately
+	 */
+	bool receive(mbuf *pkt) {
+		PktParser::Result res;
+		if (!PktParser::parse(pkt, res) || (res.proto != Headers::IPv4::PROTO_TCP)) {
+			return false;
+		}
+
+		auto ipv4 = PktParser::getIPv4(pkt);
+		auto tcp = PktParser::getTcp(pkt);
+		uint16_t len = ipv4->getPayloadLength() - tcp->getHeaderLen();
+		pktsReceived++;
+
+		TcpOptions::Parsed parsed;
+		TcpOptions::parse(tcp, parsed);
+
+		if (tcp->getAckFlag() && TcpSeq::lt(sndUna, tcp->getAck())) {
+			sndUna = tcp->getAck();
+		}
+
+		if (tcp->getSynFlag()) {
+			sackPermitted = sack && parsed.sackPermitted;
+			wscaleEnabled = options && parsed.hasWscale;
+			tsEnabled = options && parsed.hasTimestamp;
+			tsRecent = parsed.tsVal;
+
+			rcvNxt = tcp->getSeq() + 1;
+			established = true;
+			return false;
+		}
+
+		if (tsEnabled && parsed.hasTimestamp && TcpSeq::le(tcp->getSeq(), rcvNxt)) {
+			tsRecent = parsed.tsVal;
+		}
+
+		// Pure ACKs carry no data to reorder
+		if ((len == 0) && !tcp->getFinFlag()) {
+			return false;
+		}
+
+		uint32_t seq = tcp->getSeq();
+		if (seq != rcvNxt) {
+			pktsOutOfOrder++;
+			if (TcpSeq::lt(rcvNxt, seq)) {
+				uint16_t &stored = outOfOrder[seq];
+				stored = std::max(stored, len);
+				lastOutOfOrder = seq;
+			}
+			return true;
+		}
+
+		advance(seq + len);
+
+		// Fill in the segments received earlier
+		auto it = outOfOrder.begin();
+		while ((it != outOfOrder.end()) && TcpSeq::le(it->first, rcvNxt)) {
+			advance(it->first + it->second);
+			it = outOfOrder.erase(it);
+		}
+
+		if (tcp->getFinFlag() && outOfOrder.empty()) {
+			rcvNxt++;
+			finReceived = true;
+		}
+		return true;
+	}
+
+	uint64_t getBytesReceived() const { return bytesReceived; }
+	uint64_t getPktsReceived() const { return pktsReceived; }
+	uint64_t getPktsOutOfOrder() const { return pktsOutOfOrder; }
+	uint64_t getBytesSent() const { return bytesSent; }
+	bool isAllAcked() const { return sndUna == sndNxt; }
+	bool isEstablished() const { return established; }
+	bool isFinReceived() const { return finReceived; }
+	bool isSackPermitted() const { return sackPermitted; }
+	bool isWscaleEnabled() const { return wscaleEnabled; }
+	bool isTimestampEnabled() const { return tsEnabled; }
+};
+
+#endif /* TCPSYNTHPEER_HPP */
@@ -0,0 +1,181 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "mbuf.hpp"
+#include "measure.hpp"
+#include "stateMachine.hpp"
+#include "tcp.hpp"
+#include "tcpConCtlSimple.hpp"
+#include "tcpGro.hpp"
+#include "tcpSynthPeer.hpp"
+
+using namespace std;
+
+/*! Protocol consuming all data, without ever answering
+ *
+ * The server only sends ACKs then, this is the upload direction.
+ */
+template <class ConCtl> class TcpProtoSink {
+public:
+	void handlePacket(uint8_t *data, uint16_t dataLen,
+		typename TCP::Server<TcpProtoSink, ConCtl>::TcpIface &tcpIface) {
+		(void)data;
+		(void)dataLen;
+		(void)tcpIface;
+	};
+};
+
+using ProtoSink = TcpProtoSink<TcpConCtlSimple>;
+using ServerSink = TCP::Server<ProtoSink, TcpConCtlSimple>;
+using SM = StateMachine<TCP::Identifier, mbuf>;
+
+uint64_t serverCycles = 0;
+uint64_t serverPktsSent = 0;
+bool gro = false;
+
+// Run a batch through the server, the sent packets are given to the peer
+void runBatch(SM &sm, TcpSynthPeer &peer, std::vector<mbuf *> &in) {
+	// Batches without packets only run the timeouts
+	mbuf **pkts =
+		reinterpret_cast<mbuf **>(malloc(std::max<size_t>(in.size(), 1) * sizeof(mbuf *)));
+	std::copy(in.begin(), in.end(), pkts);
+
+	uint64_t start = read_rdtsc();
+	uint32_t count = gro ? TcpGro::coalesce(pkts, in.size()) : in.size();
+	BufArray<mbuf> pktsBA(pkts, count);
+	in.clear();
+
+	sm.runPktBatch(pktsBA);
+	serverCycles += read_rdtsc() - start;
+
+	std::vector<mbuf *> sent;
+	TcpSynthPeer::collect(pktsBA, sent);
+	serverPktsSent += sent.size();
+	for (auto pkt : sent) {
+		peer.receive(pkt);
+		TcpSynthPeer::freePkt(pkt);
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0]
+				  << " [EAL options --] <MiB to transfer> [segments per batch] [GRO 0/1]"
+				  << std::endl;
+		std::cout << "Output: MiB,segments per batch,GRO,cycles/byte,MiB/s,segments sent by the "
+					 "peer,packets sent by the server,ACKs per segment"
+				  << std::endl;
+		std::exit(0);
+	}
+
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		std::cout << "FATAL: cannot init EAL" << std::endl;
+		return 1;
+	}
+	argc -= ret;
+	argv += ret;
+
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"tcpUpload pool", 16383, 256, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	if (mempool == nullptr) {
+		std::cout << "FATAL: mempool creation failed" << std::endl;
+		return 1;
+	}
+	TcpSynthPeer::setMempool(mempool);
+
+	uint64_t totalBytes = static_cast<uint64_t>(atoi(argv[1])) * 1024 * 1024;
+	unsigned int segsPerBatch = 32;
+	if (argc > 2) {
+		segsPerBatch = atoi(argv[2]);
+	}
+	if (argc > 3) {
+		gro = atoi(argv[3]) != 0;
+	}
+
+	try {
+		SM sm;
+		sm.registerGetPktCB(TcpSynthPeer::allocPkt);
+		sm.registerEndStateID(TCP::States::END);
+		sm.registerStartStateID(TCP::States::syn_ack, ServerSink::factory);
+		sm.registerFunction(TCP::States::syn_ack, ServerSink::runSynAck);
+		sm.registerFunction(TCP::States::est, ServerSink::runEst);
+		sm.registerFunction(TCP::States::fin, ServerSink::runFin);
+		sm.registerFunction(TCP::States::ack_fin, ServerSink::runAckFin);
+
+		TcpSynthPeer peer(0x0a000001, 0x0a000002, 40000, 7);
+
+		std::vector<mbuf *> in;
+		in.push_back(peer.makeSyn());
+		runBatch(sm, peer, in);
+		if (!peer.isEstablished()) {
+			std::cout << "FATAL: no SYN ACK received" << std::endl;
+			return 1;
+		}
+
+		std::vector<uint8_t> payload(TCP::MSS);
+		for (size_t i = 0; i < payload.size(); i++) {
+			payload[i] = i;
+		}
+
+		serverCycles = 0;
+		serverPktsSent = 0;
+		uint64_t segments = 0;
+		auto startTime = std::chrono::steady_clock::now();
+
+		// The peer keeps sending data, the server only acknowledges it
+		while (peer.getBytesSent() < totalBytes) {
+			for (unsigned int i = 0; (i < segsPerBatch) && (peer.getBytesSent() < totalBytes);
+				 i++) {
+				in.push_back(peer.makeData(payload.data(), payload.size()));
+				segments++;
+			}
+			runBatch(sm, peer, in);
+		}
+
+		auto stopTime = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(stopTime - startTime).count();
+		double mib = static_cast<double>(peer.getBytesSent()) / (1024 * 1024);
+		uint64_t cycles = serverCycles;
+		uint64_t pktsSent = serverPktsSent;
+
+		// An odd segment at the end is acknowledged by the delayed ACK timer
+		auto waitStart = std::chrono::steady_clock::now();
+		while (!peer.isAllAcked()) {
+			if (std::chrono::steady_clock::now() - waitStart > std::chrono::seconds(1)) {
+				std::cout << "FATAL: the data was not acknowledged" << std::endl;
+				return 1;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			runBatch(sm, peer, in);
+		}
+
+		// The peer closes, the server answers with its FIN, the ACK of it ends the connection
+		in.push_back(peer.makeFin());
+		runBatch(sm, peer, in);
+		in.push_back(peer.makeAck());
+		runBatch(sm, peer, in);
+		if (!peer.isFinReceived() || (sm.getStateTableSize() != 0)) {
+			std::cout << "FATAL: the connection was not closed" << std::endl;
+			return 1;
+		}
+
+		std::cout << argv[1] << "," << segsPerBatch << "," << gro << ","
+				  << static_cast<double>(cycles) / peer.getBytesSent() << "," << mib / seconds
+				  << "," << segments << "," << pktsSent << ","
+				  << static_cast<double>(pktsSent) / segments << std::endl;
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
@@ -15,6 +15,7 @@ local RX_IP		= "192.168.0.2"
 function configure(parser)
 	parser:argument("dev", "Devices to use."):args("+"):convert(tonumber)
 	parser:option("-t --threads", "Number of threads per device."):args(1):convert(tonumber):default(1)
+	parser:flag("-c --cookies", "Send a HelloVerifyRequest, before a connection is created.")
 	return parser:parse()
 end
 
@@ -36,7 +37,7 @@ function master(args)
 
 	for i, dev in ipairs(args.dev) do
 		for i = 1, args.threads do
-			lm.startTask("reflector", dev:getRxQueue(i-1), dev:getTxQueue(i-1))
+			lm.startTask("reflector", dev:getRxQueue(i-1), dev:getTxQueue(i-1), args.cookies)
 		end
 	end
 
@@ -51,11 +52,11 @@ function master(args)
 	lm.waitForTasks()
 end
 
-function reflector(rxQ, txQ)
+function reflector(rxQ, txQ, cookies)
 	local bufs = memory.bufArray()
 
 	-- setup state machine for the hello bye protocol
-	local state = dtls.init()
+	local state = dtls.init(cookies)
 
 	while lm.running() do
 		-- receive some packets
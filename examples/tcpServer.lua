@@ -6,6 +6,7 @@ local stats  = require "stats"
 local lacp   = require "proto.lacp"
 local tcp    = require "tcpServer"
 local arp    = require "proto.arp"
+local log    = require "log"
 
 -- IP of this host
 local RX_IP		= "192.168.0.2"
@@ -13,6 +14,9 @@ local RX_IP		= "192.168.0.2"
 function configure(parser)
 	parser:argument("dev", "Devices to use."):args("+"):convert(tonumber)
 	parser:option("-t --threads", "Number of threads per device."):args(1):convert(tonumber):default(1)
+	parser:flag("-c --cookies", "Answer SYNs with SYN cookies.")
+	parser:flag("-g --gro", "Merge received segments of a connection (software GRO).")
+	parser:flag("-o --offload", "Let the NIC calculate the IPv4 and TCP checksums.")
 	return parser:parse()
 end
 
@@ -34,7 +38,8 @@ function master(args)
 
 	for i, dev in ipairs(args.dev) do
 		for i = 1, args.threads do
-			lm.startTask("reflector", dev:getRxQueue(i-1), dev:getTxQueue(i-1))
+			lm.startTask("reflector", dev:getRxQueue(i-1), dev:getTxQueue(i-1), args.cookies,
+				args.gro, args.offload)
 		end
 	end
 
@@ -49,11 +54,11 @@ function master(args)
 	lm.waitForTasks()
 end
 
-function reflector(rxQ, txQ)
+function reflector(rxQ, txQ, cookies, gro, offload)
 	local bufs = memory.bufArray()
 
-	-- setup state machine for the hello bye protocol
-	local state = tcp.init()
+	-- setup state machine for the TCP joke server
+	local state = tcp.init("Joke", cookies, gro, offload)
 
 	while lm.running() do
 		-- receive some packets
@@ -86,6 +91,10 @@ function reflector(rxQ, txQ)
 		end
 	end
 
+	local st = tcp.stats(state)
+	log:info("TCP server: %d connections open, %d opened, %d closed",
+		tonumber(st.connections), tonumber(st.connectionsOpened), tonumber(st.connectionsClosed))
+
 	tcp.free(state)
 end
 
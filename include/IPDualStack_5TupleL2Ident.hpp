@@ -0,0 +1,70 @@
+#ifndef IPDUALSTACK_5TUPLEL2IDENT_HPP
+#define IPDUALSTACK_5TUPLEL2IDENT_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "IPv6_5TupleL2Ident.hpp"
+#include "headers.hpp"
+#include "pktParser.hpp"
+
+#include "exceptions.hpp"
+
+/*! Identifier for IPv4 and IPv6 connections, based on the 5-tuple
+ *
+ * This uses the ConnectionID of IPv6_5TupleL2Ident.
+ * IPv4 addresses are stored as IPv4-mapped IPv6 addresses (::ffff:a.b.c.d),
+ * therefore both address families can share one state table.
+ *
+ * The ethertype is checked once per packet, afterwards the address is
+ * copied as a whole, there is no branch per field.
+ *
+ * \tparam Packet The packet class in use
+ * \tparam HashPolicy How to hash the 5-tuple (see hashers.hpp)
+ */
+template <class Packet, class HashPolicy = Hashers::SipHash13Keyed>
+class IPDualStack_5TupleL2Ident : public IPv6_5TupleL2Ident<Packet, HashPolicy> {
+private:
+	using Base = IPv6_5TupleL2Ident<Packet, HashPolicy>;
+
+public:
+	using ConnectionID = typename Base::ConnectionID;
+	using Hasher = typename Base::Hasher;
+
+	/*! Write an IPv4-mapped IPv6 address
+	 *
+	 * \param dst 16 bytes to write to
+	 * \param ip IPv4 address in network byte order
+	 */
+	static void setMappedIPv4(uint8_t *dst, uint32_t ip) {
+		// Bytes 0-9 are zero, 10-11 are 0xff, 12-15 hold the IPv4 address (little endian)
+		uint64_t words[2] = {0, (static_cast<uint64_t>(ip) << 32) | 0xffff0000ULL};
+		memcpy(dst, words, 16);
+	};
+
+	static ConnectionID identify(Packet *pkt) {
+		ConnectionID id;
+		PktParser::Result res;
+
+		if (!PktParser::parse(pkt, res) || !Base::setL4(id, pkt, res.proto)) {
+#ifdef DEBUG
+			std::cout << "IPDualStack_5TupleL2Ident::indentify() failed" << std::endl;
+#endif
+			throw new PacketNotIdentified();
+		}
+
+		if (res.ethertype == Headers::Ethernet::ETHERTYPE_IPv6) {
+			Headers::IPv6 *ip = PktParser::getIPv6(pkt);
+			memcpy(id.srcIP, ip->srcIP.data(), 16);
+			memcpy(id.dstIP, ip->dstIP.data(), 16);
+		} else {
+			Headers::IPv4 *ip = PktParser::getIPv4(pkt);
+			setMappedIPv4(id.srcIP, ip->srcIP);
+			setMappedIPv4(id.dstIP, ip->dstIP);
+		}
+
+		return id;
+	};
+};
+
+#endif /* IPDUALSTACK_5TUPLEL2IDENT_HPP */
@@ -9,16 +9,21 @@
 #include <stdexcept>
 #include <string>
 
-#include "sodium.h"
-
 #include "common.hpp"
+#include "hashers.hpp"
 #include "headers.hpp"
+#include "pktParser.hpp"
 
 #include "exceptions.hpp"
 
 #include "measure.hpp"
 
-template <class Packet> class IPv4_5TupleL2Ident {
+/*! Identifier for IPv4 connections, based on the 5-tuple
+ *
+ * \tparam Packet The packet class in use
+ * \tparam HashPolicy How to hash the 5-tuple (see hashers.hpp)
+ */
+template <class Packet, class HashPolicy = Hashers::SipHash13Keyed> class IPv4_5TupleL2Ident {
 public:
 	struct Hasher;
 	struct ConnectionID {
@@ -55,6 +60,16 @@ public:
 			return sstream.str();
 		}
 
+		/*! Pack the 5-tuple into two (zero padded) words for hashing
+		 *
+		 * \param words Array of two words to write to
+		 */
+		void toWords(uint64_t words[2]) const {
+			words[0] = static_cast<uint64_t>(srcIP) | (static_cast<uint64_t>(dstIP) << 32);
+			words[1] = static_cast<uint64_t>(srcPort) | (static_cast<uint64_t>(dstPort) << 16) |
+					   (static_cast<uint64_t>(proto) << 32);
+		}
+
 		ConnectionID(const ConnectionID &c)
 			: dstIP(c.dstIP), srcIP(c.srcIP), dstPort(c.dstPort), srcPort(c.srcPort),
 			  proto(c.proto){};
@@ -62,43 +77,12 @@ public:
 	};
 
 	struct Hasher {
-		// In the future, maybe we find something more random...
 		uint64_t operator()(const ConnectionID &c) const {
-			uint64_t res = 0;
-
-			/*
-			res += c.dstPort;
-			res += c.srcPort;
-			res += c.dstIP;
-			res += c.srcIP;
-			res += c.proto;
-			*/
-
 			uint64_t start = start_measurement();
 
-			struct __attribute__((packed)) {
-				uint32_t srcIP;
-				uint32_t dstIP;
-				uint16_t srcPort;
-				uint16_t dstPort;
-				uint8_t proto;
-			} hashContent;
-
-			hashContent.srcIP = c.srcIP;
-			hashContent.dstIP = c.dstIP;
-			hashContent.srcPort = c.srcPort;
-			hashContent.dstPort = c.dstPort;
-			hashContent.proto = c.proto;
-
-			if (sizeof(hashContent) != 13) {
-				throw std::runtime_error("sizeof(hashContent) != 13");
-			}
-
-			assert(crypto_shorthash_BYTES == 8);
-			uint8_t key[crypto_shorthash_KEYBYTES];
-			memset(key, 0, crypto_shorthash_KEYBYTES);
-			crypto_shorthash(reinterpret_cast<uint8_t *>(&res),
-				reinterpret_cast<const uint8_t *>(&hashContent), sizeof(hashContent), key);
+			uint64_t words[2];
+			c.toWords(words);
+			uint64_t res = HashPolicy::hash(words, 2);
 
 			DEBUG_ENABLED(std::cout << "Hasher output: " << res << std::endl;)
 
@@ -111,32 +95,26 @@ public:
 
 	static ConnectionID identify(Packet *pkt) {
 		ConnectionID id;
-		struct Headers::IPv4 *ip = reinterpret_cast<struct Headers::IPv4 *>(
-			reinterpret_cast<uint8_t *>(pkt->getData()) + 14);
-		id.dstIP = ip->dstIP;
-		id.srcIP = ip->srcIP;
-		id.proto = ip->proto;
-
-		if (id.proto == IPPROTO_UDP) {
-			struct Headers::Udp *udp =
-				reinterpret_cast<struct Headers::Udp *>(ip->getPayload());
-			id.dstPort = udp->dstPort;
-			id.srcPort = udp->srcPort;
-		} else if (id.proto == IPPROTO_TCP) {
-			struct Headers::Tcp *tcp =
-				reinterpret_cast<struct Headers::Tcp *>(ip->getPayload());
-			id.dstPort = tcp->dstPort;
-			id.srcPort = tcp->srcPort;
-		} else {
+		PktParser::Result res;
+		if (!PktParser::parse(pkt, res) ||
+			(res.ethertype != Headers::Ethernet::ETHERTYPE_IPv4) ||
+			((res.proto != IPPROTO_UDP) && (res.proto != IPPROTO_TCP))) {
 #ifdef DEBUG
 			std::cout << "IPv4_5TupleL2Ident::indentify() failed" << std::endl;
-			std::cout << "IPv4_5TupleL2Ident::indentify() id.proto="
-					  << static_cast<unsigned int>(id.proto) << std::endl;
 #endif
 			hexdump(pkt->getData(), pkt->getDataLen());
 			throw new PacketNotIdentified();
 		}
 
+		// TCP and UDP both start with the ports
+		struct Headers::IPv4 *ip = PktParser::getIPv4(pkt);
+		struct Headers::Udp *l4 = PktParser::getUdp(pkt);
+		id.dstIP = ip->dstIP;
+		id.srcIP = ip->srcIP;
+		id.proto = res.proto;
+		id.dstPort = l4->dstPort;
+		id.srcPort = l4->srcPort;
+
 		return id;
 	};
 
@@ -0,0 +1,201 @@
+#ifndef IPV4_5TUPLERSSIDENT_HPP
+#define IPV4_5TUPLERSSIDENT_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "common.hpp"
+#include "headers.hpp"
+#include "pktParser.hpp"
+#include "toeplitz.hpp"
+
+#include "exceptions.hpp"
+
+#include "measure.hpp"
+
+/*! Identifier for IPv4 connections, which reuses the RSS hash of the NIC
+ *
+ * The ConnectionID carries the Toeplitz hash of the 5-tuple, which the Hasher
+ * only mixes. If the packet provides a hash calculated by the NIC, identify()
+ * takes it from there. Otherwise it is calculated in software.
+ *
+ * For this to work, the NIC has to use the key from Toeplitz::getKey() and
+ * hash IPv4 addresses and L4 ports.
+ *
+ * Connections opened by ourselves (StateMachine::addState()) have to use
+ * the ConnectionID constructor taking the 5-tuple, or call updateHash().
+ * As usual, the 5-tuple is given from the perspective of inbound packets.
+ *
+ * Packets may expose the following function, in order to provide a NIC hash:
+ * \code{.cpp}
+ * bool getRssHash(uint32_t &hash);
+ * \endcode
+ *
+ * \tparam Packet The packet class in use
+ */
+template <class Packet> class IPv4_5TupleRssIdent {
+private:
+	// Detects, if Packet provides getRssHash()
+	template <class P, class = void> struct HasRssHash : std::false_type {};
+	template <class P>
+	struct HasRssHash<P,
+		decltype(void(std::declval<P &>().getRssHash(std::declval<uint32_t &>())))>
+		: std::true_type {};
+
+	static bool getNicHash(Packet *pkt, uint32_t &hash, std::true_type) {
+		return pkt->getRssHash(hash);
+	};
+
+	static bool getNicHash(Packet *pkt, uint32_t &hash, std::false_type) {
+		(void)pkt;
+		(void)hash;
+		return false;
+	};
+
+public:
+	struct ConnectionID {
+		uint32_t rssHash;
+		uint32_t dstIP;
+		uint32_t srcIP;
+		uint16_t dstPort;
+		uint16_t srcPort;
+		uint8_t proto;
+
+		bool operator==(const ConnectionID &c) const {
+			// The hash is checked first, it is the most likely to differ
+			if ((rssHash == c.rssHash) && (dstIP == c.dstIP) && (srcIP == c.srcIP) &&
+				(dstPort == c.dstPort) && (srcPort == c.srcPort) && (proto == c.proto)) {
+				return true;
+			} else {
+				return false;
+			}
+		};
+
+		bool operator<(const ConnectionID &c) const {
+			if (rssHash != c.rssHash) {
+				return rssHash < c.rssHash;
+			}
+			if (srcIP != c.srcIP) {
+				return srcIP < c.srcIP;
+			}
+			if (dstIP != c.dstIP) {
+				return dstIP < c.dstIP;
+			}
+			if (srcPort != c.srcPort) {
+				return srcPort < c.srcPort;
+			}
+			if (dstPort != c.dstPort) {
+				return dstPort < c.dstPort;
+			}
+			return proto < c.proto;
+		};
+
+		operator std::string() const {
+			std::stringstream sstream;
+			sstream << "DstIP: " << std::hex << ntohl(dstIP) << ", ";
+			sstream << "SrcIP: " << std::hex << ntohl(srcIP) << ", ";
+			sstream << "DstPort: " << std::dec << ntohs(dstPort) << ", ";
+			sstream << "SrcPort: " << std::dec << ntohs(srcPort) << ", ";
+			sstream << "RSS: " << std::hex << rssHash;
+			return sstream.str();
+		}
+
+		/*! Calculate the hash in software
+		 *
+		 * Call this, after the 5-tuple was changed manually.
+		 */
+		void updateHash() { rssHash = Toeplitz::hashIPv4(srcIP, dstIP, srcPort, dstPort); }
+
+		ConnectionID(const ConnectionID &c)
+			: rssHash(c.rssHash), dstIP(c.dstIP), srcIP(c.srcIP), dstPort(c.dstPort),
+			  srcPort(c.srcPort), proto(c.proto){};
+		ConnectionID() : rssHash(0), dstIP(0), srcIP(0), dstPort(0), srcPort(0), proto(0){};
+
+		/*! Create a ConnectionID for the 5-tuple, the hash is calculated in software
+		 *
+		 * Every parameter is expected in network byte order,
+		 * from the perspective of inbound packets.
+		 *
+		 * \param srcIP IP of the remote host
+		 * \param dstIP Local IP
+		 * \param srcPort Port of the remote host
+		 * \param dstPort Local port
+		 * \param proto L4 protocol
+		 */
+		ConnectionID(
+			uint32_t srcIP, uint32_t dstIP, uint16_t srcPort, uint16_t dstPort, uint8_t proto)
+			: dstIP(dstIP), srcIP(srcIP), dstPort(dstPort), srcPort(srcPort), proto(proto) {
+			updateHash();
+		};
+	};
+
+	/*! Hasher of the state table
+	 *
+	 * The NIC picks the queue with the low bits of the hash (see the RETA),
+	 * so they are the same for all connections of one core. The hash tables
+	 * pick buckets with the low bits as well, the high bits of a multiplication
+	 * are moved there.
+	 */
+	struct Hasher {
+		uint64_t operator()(const ConnectionID &c) const {
+			uint64_t h = c.rssHash * 0x9e3779b97f4a7c15ULL;
+			return (h >> 32) | (h << 32);
+		}
+	};
+
+	static ConnectionID identify(Packet *pkt) {
+		ConnectionID id;
+		PktParser::Result res;
+		if (!PktParser::parse(pkt, res) ||
+			(res.ethertype != Headers::Ethernet::ETHERTYPE_IPv4) ||
+			((res.proto != IPPROTO_UDP) && (res.proto != IPPROTO_TCP))) {
+#ifdef DEBUG
+			std::cout << "IPv4_5TupleRssIdent::indentify() failed" << std::endl;
+#endif
+			throw new PacketNotIdentified();
+		}
+
+		// TCP and UDP both start with the ports
+		struct Headers::IPv4 *ip = PktParser::getIPv4(pkt);
+		struct Headers::Udp *l4 = PktParser::getUdp(pkt);
+		id.dstIP = ip->dstIP;
+		id.srcIP = ip->srcIP;
+		id.proto = res.proto;
+		id.dstPort = l4->dstPort;
+		id.srcPort = l4->srcPort;
+
+		if (!getNicHash(pkt, id.rssHash, HasRssHash<Packet>())) {
+			uint64_t start = start_measurement();
+			id.updateHash();
+			uint64_t stop = stop_measurement();
+			measureData.siphash += stop - start;
+		} else {
+			// A mismatch means, that the NIC uses another key or other fields
+			DEBUG_ENABLED(if (id.rssHash != Toeplitz::hashIPv4(id.srcIP, id.dstIP, id.srcPort,
+										id.dstPort)) {
+				std::cout << "IPv4_5TupleRssIdent::identify() NIC hash does not match"
+						  << std::endl;
+			})
+		}
+
+		return id;
+	};
+
+	static ConnectionID getDelKey() {
+		ConnectionID id;
+		id.proto = 253;
+		return id;
+	};
+
+	static ConnectionID getEmptyKey() {
+		ConnectionID id;
+		id.proto = 254;
+		return id;
+	};
+};
+
+#endif /* IPV4_5TUPLERSSIDENT_HPP */
@@ -0,0 +1,181 @@
+#ifndef IPV4_5TUPLESYMIDENT_HPP
+#define IPV4_5TUPLESYMIDENT_HPP
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "common.hpp"
+#include "hashers.hpp"
+#include "headers.hpp"
+#include "pktParser.hpp"
+
+#include "exceptions.hpp"
+
+#include "measure.hpp"
+
+/*! Symmetric identifier for IPv4 connections, based on the 5-tuple
+ *
+ * Both directions of a flow map to the same ConnectionID, this is meant for
+ * middleboxes, which see both directions (firewalls, NAT, ...).
+ * The (IP, port) pairs are stored in canonical order, the endpoint with
+ * the lower (IP, port) is called "lo", the other one "hi".
+ *
+ * The direction of the packet is carried in the ConnectionID, but it is
+ * neither part of the comparison, nor of the hash.
+ * State functions can query it via StateMachine::FunIface::getConnectionID().
+ * In order to know which side opened the connection, save the direction
+ * of the ConnectionID given to the start state function.
+ *
+ * \tparam Packet The packet class in use
+ * \tparam HashPolicy How to hash the 5-tuple (see hashers.hpp)
+ */
+template <class Packet, class HashPolicy = Hashers::SipHash13Keyed> class IPv4_5TupleSymIdent {
+public:
+	struct ConnectionID {
+		uint32_t loIP;
+		uint32_t hiIP;
+		uint16_t loPort;
+		uint16_t hiPort;
+		uint8_t proto;
+
+		// True, if the packet was sent by the "hi" endpoint
+		bool fromHi;
+
+		bool operator==(const ConnectionID &c) const {
+			if ((loIP == c.loIP) && (hiIP == c.hiIP) && (loPort == c.loPort) &&
+				(hiPort == c.hiPort) && (proto == c.proto)) {
+				return true;
+			} else {
+				return false;
+			}
+		};
+
+		bool operator<(const ConnectionID &c) const {
+			uint64_t words[2], cWords[2];
+			toWords(words);
+			c.toWords(cWords);
+			if (words[0] != cWords[0]) {
+				return words[0] < cWords[0];
+			}
+			return words[1] < cWords[1];
+		};
+
+		operator std::string() const {
+			std::stringstream sstream;
+			sstream << "LoIP: " << std::hex << ntohl(loIP) << ", ";
+			sstream << "HiIP: " << std::hex << ntohl(hiIP) << ", ";
+			sstream << "LoPort: " << std::dec << ntohs(loPort) << ", ";
+			sstream << "HiPort: " << std::dec << ntohs(hiPort) << ", ";
+			sstream << "Direction: " << (fromHi ? "hi->lo" : "lo->hi");
+			return sstream.str();
+		}
+
+		/*! Pack the canonical 5-tuple into two (zero padded) words for hashing
+		 *
+		 * The direction is not included.
+		 *
+		 * \param words Array of two words to write to
+		 */
+		void toWords(uint64_t words[2]) const {
+			words[0] = static_cast<uint64_t>(loIP) | (static_cast<uint64_t>(hiIP) << 32);
+			words[1] = static_cast<uint64_t>(loPort) | (static_cast<uint64_t>(hiPort) << 16) |
+					   (static_cast<uint64_t>(proto) << 32);
+		}
+
+		/*! Set the 5-tuple as seen in a packet
+		 *
+		 * All parameters are expected in network byte order.
+		 *
+		 * \param srcIP Source IP of the packet
+		 * \param dstIP Destination IP of the packet
+		 * \param srcPort Source port of the packet
+		 * \param dstPort Destination port of the packet
+		 */
+		void set(uint32_t srcIP, uint32_t dstIP, uint16_t srcPort, uint16_t dstPort) {
+			// Compare in host byte order, so the "lo" endpoint is intuitive
+			uint64_t src = (static_cast<uint64_t>(ntohl(srcIP)) << 16) | ntohs(srcPort);
+			uint64_t dst = (static_cast<uint64_t>(ntohl(dstIP)) << 16) | ntohs(dstPort);
+			fromHi = src > dst;
+			if (fromHi) {
+				loIP = dstIP;
+				loPort = dstPort;
+				hiIP = srcIP;
+				hiPort = srcPort;
+			} else {
+				loIP = srcIP;
+				loPort = srcPort;
+				hiIP = dstIP;
+				hiPort = dstPort;
+			}
+		}
+
+		/*! Source IP of the packet this ID was created from */
+		uint32_t getSrcIP() const { return fromHi ? hiIP : loIP; }
+
+		/*! Destination IP of the packet this ID was created from */
+		uint32_t getDstIP() const { return fromHi ? loIP : hiIP; }
+
+		/*! Source port of the packet this ID was created from */
+		uint16_t getSrcPort() const { return fromHi ? hiPort : loPort; }
+
+		/*! Destination port of the packet this ID was created from */
+		uint16_t getDstPort() const { return fromHi ? loPort : hiPort; }
+
+		ConnectionID(const ConnectionID &c)
+			: loIP(c.loIP), hiIP(c.hiIP), loPort(c.loPort), hiPort(c.hiPort), proto(c.proto),
+			  fromHi(c.fromHi){};
+		ConnectionID() : loIP(0), hiIP(0), loPort(0), hiPort(0), proto(0), fromHi(false){};
+	};
+
+	struct Hasher {
+		uint64_t operator()(const ConnectionID &c) const {
+			uint64_t start = start_measurement();
+
+			uint64_t words[2];
+			c.toWords(words);
+			uint64_t res = HashPolicy::hash(words, 2);
+
+			uint64_t stop = stop_measurement();
+			measureData.siphash += stop - start;
+
+			return res;
+		}
+	};
+
+	static ConnectionID identify(Packet *pkt) {
+		ConnectionID id;
+		PktParser::Result res;
+		if (!PktParser::parse(pkt, res) ||
+			(res.ethertype != Headers::Ethernet::ETHERTYPE_IPv4) ||
+			((res.proto != IPPROTO_UDP) && (res.proto != IPPROTO_TCP))) {
+#ifdef DEBUG
+			std::cout << "IPv4_5TupleSymIdent::indentify() failed" << std::endl;
+#endif
+			throw new PacketNotIdentified();
+		}
+
+		// TCP and UDP both start with the ports
+		struct Headers::IPv4 *ip = PktParser::getIPv4(pkt);
+		struct Headers::Udp *l4 = PktParser::getUdp(pkt);
+		id.proto = res.proto;
+		id.set(ip->srcIP, ip->dstIP, l4->srcPort, l4->dstPort);
+
+		return id;
+	};
+
+	static ConnectionID getDelKey() {
+		ConnectionID id;
+		id.proto = 253;
+		return id;
+	};
+
+	static ConnectionID getEmptyKey() {
+		ConnectionID id;
+		id.proto = 254;
+		return id;
+	};
+};
+
+#endif /* IPV4_5TUPLESYMIDENT_HPP */
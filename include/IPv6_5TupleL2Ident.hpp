@@ -0,0 +1,173 @@
+#ifndef IPV6_5TUPLEL2IDENT_HPP
+#define IPV6_5TUPLEL2IDENT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifdef __SSE4_1__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "common.hpp"
+#include "hashers.hpp"
+#include "headers.hpp"
+#include "pktParser.hpp"
+
+#include "exceptions.hpp"
+
+#include "measure.hpp"
+
+/*! Identifier for IPv6 connections, based on the 5-tuple
+ *
+ * The key consists of 37 bytes (two addresses, two ports, protocol),
+ * which are padded to 48 bytes. This way two keys can be compared using
+ * one 256 bit and one 128 bit compare (AVX2), or three 128 bit compares (SSE).
+ * The padding is always zero.
+ *
+ * Extension headers are skipped, up to PktParser::maxIPv6ExtHeaders of them.
+ * Packets with more extension headers, ESP or non-first fragments are
+ * not identified.
+ *
+ * \tparam Packet The packet class in use
+ * \tparam HashPolicy How to hash the 5-tuple (see hashers.hpp)
+ */
+template <class Packet, class HashPolicy = Hashers::SipHash13Keyed> class IPv6_5TupleL2Ident {
+public:
+	struct alignas(16) ConnectionID {
+		uint8_t srcIP[16];
+		uint8_t dstIP[16];
+		uint16_t srcPort;
+		uint16_t dstPort;
+		uint8_t proto;
+		uint8_t padding[11];
+
+		bool operator==(const ConnectionID &c) const {
+			const uint8_t *a = reinterpret_cast<const uint8_t *>(this);
+			const uint8_t *b = reinterpret_cast<const uint8_t *>(&c);
+#if defined(__AVX2__)
+			__m256i x = _mm256_xor_si256(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b)));
+			__m128i y =
+				_mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i *>(a + 32)),
+					_mm_load_si128(reinterpret_cast<const __m128i *>(b + 32)));
+			return _mm256_testz_si256(x, x) & _mm_testz_si128(y, y);
+#elif defined(__SSE2__)
+			const __m128i *va = reinterpret_cast<const __m128i *>(a);
+			const __m128i *vb = reinterpret_cast<const __m128i *>(b);
+			__m128i x = _mm_xor_si128(_mm_load_si128(va), _mm_load_si128(vb));
+			x = _mm_or_si128(x, _mm_xor_si128(_mm_load_si128(va + 1), _mm_load_si128(vb + 1)));
+			x = _mm_or_si128(x, _mm_xor_si128(_mm_load_si128(va + 2), _mm_load_si128(vb + 2)));
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(x, _mm_setzero_si128())) == 0xffff;
+#else
+			return memcmp(a, b, sizeof(ConnectionID)) == 0;
+#endif
+		};
+
+		bool operator<(const ConnectionID &c) const {
+			return memcmp(this, &c, sizeof(ConnectionID)) < 0;
+		};
+
+		operator std::string() const {
+			std::array<uint8_t, 16> addr;
+			std::stringstream sstream;
+			memcpy(addr.data(), dstIP, 16);
+			sstream << "DstIP: " << Headers::IPv6::addrToStr(addr) << ", ";
+			memcpy(addr.data(), srcIP, 16);
+			sstream << "SrcIP: " << Headers::IPv6::addrToStr(addr) << ", ";
+			sstream << "DstPort: " << std::dec << ntohs(dstPort) << ", ";
+			sstream << "SrcPort: " << std::dec << ntohs(srcPort);
+			return sstream.str();
+		}
+
+		/*! Get the key as (zero padded) words for hashing
+		 *
+		 * \param words Array of five words to write to
+		 */
+		void toWords(uint64_t words[5]) const { memcpy(words, this, 5 * sizeof(uint64_t)); }
+
+		ConnectionID(const ConnectionID &c) { memcpy(this, &c, sizeof(ConnectionID)); };
+		ConnectionID() { memset(this, 0, sizeof(ConnectionID)); };
+
+		ConnectionID &operator=(const ConnectionID &c) {
+			memcpy(this, &c, sizeof(ConnectionID));
+			return *this;
+		};
+	};
+
+	static_assert(sizeof(ConnectionID) == 48, "IPv6 ConnectionID has to be 48 bytes");
+
+	struct Hasher {
+		uint64_t operator()(const ConnectionID &c) const {
+			uint64_t start = start_measurement();
+
+			uint64_t words[5];
+			c.toWords(words);
+			uint64_t res = HashPolicy::hash(words, 5);
+
+			uint64_t stop = stop_measurement();
+			measureData.siphash += stop - start;
+
+			return res;
+		}
+	};
+
+	/*! Fill in ports and protocol from a parsed packet
+	 *
+	 * \param id ConnectionID to fill
+	 * \param pkt Packet parsed by PktParser::parse()
+	 * \param proto L4 protocol
+	 * \return False, if the protocol is not supported
+	 */
+	static bool setL4(ConnectionID &id, Packet *pkt, uint8_t proto) {
+		if ((proto != IPPROTO_UDP) && (proto != IPPROTO_TCP)) {
+			return false;
+		}
+
+		// TCP and UDP both start with source and destination port
+		Headers::Udp *l4 = PktParser::getUdp(pkt);
+		id.proto = proto;
+		id.srcPort = l4->srcPort;
+		id.dstPort = l4->dstPort;
+		return true;
+	};
+
+	static ConnectionID identify(Packet *pkt) {
+		ConnectionID id;
+		PktParser::Result res;
+
+		if (!PktParser::parse(pkt, res) ||
+			(res.ethertype != Headers::Ethernet::ETHERTYPE_IPv6) ||
+			!setL4(id, pkt, res.proto)) {
+#ifdef DEBUG
+			std::cout << "IPv6_5TupleL2Ident::indentify() failed" << std::endl;
+#endif
+			throw new PacketNotIdentified();
+		}
+
+		Headers::IPv6 *ip = PktParser::getIPv6(pkt);
+		memcpy(id.srcIP, ip->srcIP.data(), 16);
+		memcpy(id.dstIP, ip->dstIP.data(), 16);
+
+		return id;
+	};
+
+	static ConnectionID getDelKey() {
+		ConnectionID id;
+		id.proto = 253;
+		return id;
+	};
+
+	static ConnectionID getEmptyKey() {
+		ConnectionID id;
+		id.proto = 254;
+		return id;
+	};
+};
+
+#endif /* IPV6_5TUPLEL2IDENT_HPP */
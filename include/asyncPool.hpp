@@ -0,0 +1,71 @@
+#ifndef ASYNCPOOL_HPP
+#define ASYNCPOOL_HPP
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "blockingconcurrentqueue.h"
+
+/*! Worker threads for expensive jobs, e.g. the public-key operations of handshakes
+ *
+ * A StateMachine hands the jobs of parked connections to the pool (see
+ * StateMachine::FunIface::runAsync()), the cores running packet batches keep
+ * going meanwhile. Several state machines may share one pool.
+ */
+class AsyncPool {
+public:
+	/*! This is the signature of a job */
+	using Job = std::function<void()>;
+
+private:
+	moodycamel::BlockingConcurrentQueue<Job> jobs;
+	std::vector<std::thread> workers;
+
+	void work() {
+		while (true) {
+			Job job;
+			jobs.wait_dequeue(job);
+
+			// An empty job stops the worker
+			if (!job) {
+				return;
+			}
+			job();
+		}
+	}
+
+public:
+	/*!
+	 * \param numWorkers Number of worker threads to start
+	 */
+	AsyncPool(unsigned int numWorkers) {
+		for (unsigned int i = 0; i < numWorkers; i++) {
+			workers.emplace_back(&AsyncPool::work, this);
+		}
+	};
+
+	/*! Stop the workers, after all jobs submitted so far are done */
+	~AsyncPool() {
+		for (unsigned int i = 0; i < workers.size(); i++) {
+			jobs.enqueue(Job());
+		}
+		for (auto &w : workers) {
+			w.join();
+		}
+	};
+
+	AsyncPool(const AsyncPool &) = delete;
+	AsyncPool &operator=(const AsyncPool &) = delete;
+
+	/*! Run a job on one of the workers
+	 *
+	 * \param job The job, it must not be empty
+	 */
+	void submit(Job job) { jobs.enqueue(std::move(job)); }
+
+	/*! Get the number of worker threads */
+	unsigned int getNumWorkers() const { return workers.size(); }
+};
+
+#endif /* ASYNCPOOL_HPP */
@@ -46,12 +46,17 @@ template <typename Packet> class BufArray {
 private:
 	Packet **pkts;
 	std::vector<bool> sendMask;
+	std::vector<bool> keepMask;
+	uint32_t numKept;
 	uint32_t numBufs;
 	uint32_t numSlots;
 	bool fromLua;
 
 public:
 	/*! Constructor
+	 *
+	 * An empty BufArray is fine, e.g. to run the timeouts of a StateMachine
+	 * while no packets arrive.
 	 *
 	 * \param pkts Pointer to pointers to buffers
 	 * \param numPkts Number of buffers in pkts
@@ -61,20 +66,16 @@ public:
 		this->pkts = pkts;
 		this->fromLua = fromLua;
 
-		if (numPkts == 0) {
-			std::abort();
-			throw std::runtime_error(
-				"BufArray::BufArray() Please use an array with at least one slot");
-		}
-
 		// In the beginning, the pkts** fits exactly
 		numBufs = numPkts;
 		numSlots = numPkts;
 
 		sendMask.resize(numPkts);
+		keepMask.resize(numPkts);
 		for (uint32_t i = 0; i < numPkts; i++) {
 			sendMask[i] = true;
 		}
+		numKept = 0;
 	};
 
 	~BufArray() {
@@ -111,9 +112,27 @@ public:
 	 */
 	void markSendPkt(uint32_t pktIdx) {
 		assert(pktIdx < numBufs);
+		assert(!keepMask[pktIdx]);
 		sendMask[pktIdx] = true;
 	};
 
+	/*! Mark one packet as kept
+	 *
+	 * The packet is neither sent nor freed, the caller of this function
+	 * takes over the packet (see StateMachine::FunIface::runAsync()).
+	 * This can not be undone.
+	 *
+	 * \param pktIdx Index of the packet to keep
+	 */
+	void markKeepPkt(uint32_t pktIdx) {
+		assert(pktIdx < numBufs);
+		sendMask[pktIdx] = false;
+		if (!keepMask[pktIdx]) {
+			keepMask[pktIdx] = true;
+			numKept++;
+		}
+	};
+
 	/*! Add one packet to the BufArray
 	 *
 	 * This function may allocate new memory, to fit all packets into one array
@@ -128,7 +147,7 @@ public:
 
 			// The +1 is for empty BufArrays
 			Packet **newPkts =
-				reinterpret_cast<Packet **>(malloc((sizeof(Packet *) * numSlots * 2)));
+				reinterpret_cast<Packet **>(malloc((sizeof(Packet *) * (numSlots * 2 + 1))));
 			for (uint32_t i = 0; i < numSlots; i++) {
 				newPkts[i] = pkts[i];
 			}
@@ -137,9 +156,10 @@ public:
 			if (!fromLua) {
 				free(pkts);
 			}
-			numSlots *= 2;
+			numSlots = numSlots * 2 + 1;
 
 			sendMask.resize(numSlots);
+			keepMask.resize(numSlots);
 
 			pkts = newPkts;
 
@@ -169,13 +189,19 @@ public:
 		return count;
 	};
 
+	/*! Get the number of packets marked as kept
+	 *
+	 * \return Number of packets, which are neither sent nor freed
+	 */
+	uint32_t getKeepCount() const { return numKept; };
+
 	/*! Get the number of packets currently marked as free
 	 *
 	 * \return Number of packets to be freed
 	 */
 	uint32_t getFreeCount() const {
 		uint32_t sendCount = getSendCount();
-		return numBufs - sendCount;
+		return numBufs - sendCount - numKept;
 	}
 
 	/*! Get all the packets which are to be sent
@@ -206,7 +232,7 @@ public:
 		uint32_t freeCount = getFreeCount();
 
 		while (curFreeBufs < freeCount) {
-			if (!sendMask[curPkts]) {
+			if (!sendMask[curPkts] && !keepMask[curPkts]) {
 				freeBufs[curFreeBufs++] = pkts[curPkts++];
 			} else {
 				curPkts++;
@@ -0,0 +1,227 @@
+#ifndef CHECKSUM_HPP
+#define CHECKSUM_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "headers.hpp"
+
+/*! The Internet checksum of IPv4, TCP and UDP (RFC 1071)
+ *
+ * Sums are kept in 64 bit, and only folded to 16 bit at the end.
+ * The words are added as they are in memory, in network byte order: The one's
+ * complement sum does not depend on the byte order, so the folded sum can be
+ * written to the header as it is.
+ *
+ * There are three ways to get a checksum right:
+ * - add() the bytes up, with AVX2 if the compiler may use it (-march=native)
+ * - Update a checksum for the fields rewritten in a reply (RFC 1624)
+ * - Let the NIC do it (setOffload())
+ *
+ * This header does not depend on DPDK. addChain(), setOffload() and the
+ * functions for whole packets to send are in checksumMbuf.hpp.
+ */
+namespace Checksum {
+
+/*! Add bytes to a sum
+ *
+ * \param data First byte, at an even offset into the checksummed bytes
+ * \param len Number of bytes, an odd last byte is padded with zero
+ * \param sum The sum to add to
+ * \return The new sum, use fold() or finish() on it
+ */
+inline uint64_t add(const void *data, uint32_t len, uint64_t sum = 0) {
+	const uint8_t *cur = reinterpret_cast<const uint8_t *>(data);
+
+#ifdef __AVX2__
+	// Every round adds two words to each of the eight 32 bit lanes,
+	// the lanes are added up before their sum can overflow
+	static constexpr uint32_t maxRounds = 4096;
+	const __m256i zero = _mm256_setzero_si256();
+
+	while (len >= 64) {
+		uint32_t rounds = std::min(len / 32, maxRounds);
+		__m256i acc = _mm256_setzero_si256();
+		for (uint32_t i = 0; i < rounds; i++) {
+			__m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(cur));
+			acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(words, zero));
+			acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(words, zero));
+			cur += 32;
+		}
+		len -= rounds * 32;
+
+		__m128i lanes =
+			_mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+		lanes = _mm_add_epi32(lanes, _mm_srli_si128(lanes, 8));
+		lanes = _mm_add_epi32(lanes, _mm_srli_si128(lanes, 4));
+		sum += static_cast<uint32_t>(_mm_cvtsi128_si32(lanes));
+	}
+#endif
+
+	// The carry of 64 bit words goes around (end-around carry)
+	while (len >= 8) {
+		uint64_t word;
+		memcpy(&word, cur, sizeof(word));
+		sum += word;
+		sum += sum < word;
+		cur += 8;
+		len -= 8;
+	}
+
+	uint64_t rest = 0;
+	memcpy(&rest, cur, len);
+	sum += rest;
+	sum += sum < rest;
+
+	return sum;
+}
+
+/*! Fold a sum to 16 bit
+ *
+ * \param sum The sum to fold
+ * \return One's complement sum of all words added
+ */
+inline uint16_t fold(uint64_t sum) {
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return static_cast<uint16_t>((sum & 0xffff) + (sum >> 16));
+}
+
+/*! Get the checksum of a sum, as it is written to the header */
+inline uint16_t finish(uint64_t sum) { return static_cast<uint16_t>(~fold(sum)); }
+
+/*! Get the sum of the IPv4 pseudo header of TCP and UDP
+ *
+ * \param ipv4 The IPv4 header
+ * \param l4Len Length of the L4 header and payload (host byte order)
+ * \return The sum
+ */
+inline uint64_t pseudoIPv4(const Headers::IPv4 *ipv4, uint16_t l4Len) {
+	return static_cast<uint64_t>(ipv4->srcIP) + ipv4->dstIP + htons(ipv4->proto) + htons(l4Len);
+}
+
+/*! Update a checksum for a rewritten 16 bit field (RFC 1624, equation 3)
+ *
+ * \param check The checksum as it is in the header
+ * \param oldVal The old value of the field (network byte order)
+ * \param newVal The new value of the field (network byte order)
+ * \return The new checksum
+ */
+inline uint16_t update16(uint16_t check, uint16_t oldVal, uint16_t newVal) {
+	uint64_t sum = static_cast<uint16_t>(~check);
+	sum += static_cast<uint16_t>(~oldVal);
+	sum += newVal;
+	return finish(sum);
+}
+
+/*! Update a checksum for a rewritten 32 bit field (RFC 1624)
+ *
+ * \param check The checksum as it is in the header
+ * \param oldVal The old value of the field (network byte order)
+ * \param newVal The new value of the field (network byte order)
+ * \return The new checksum
+ */
+inline uint16_t update32(uint16_t check, uint32_t oldVal, uint32_t newVal) {
+	uint64_t sum = static_cast<uint16_t>(~check);
+	sum += static_cast<uint32_t>(~oldVal);
+	sum += newVal;
+	return finish(sum);
+}
+
+/*! Update a checksum for rewritten fields (RFC 1624)
+ *
+ * Take the old bytes out with remove() before they are overwritten, and add
+ * the new ones with add(). Fields only moved to another place at an even
+ * offset, as swapped addresses and ports, do not change the checksum at all.
+ */
+class Update {
+private:
+	uint64_t sum = 0;
+
+public:
+	/*! Remove the old content of a field
+	 *
+	 * \param data First byte, at an even offset into the checksummed bytes
+	 * \param len Length of the field
+	 */
+	void remove(const void *data, uint32_t len) {
+		sum += static_cast<uint16_t>(~fold(Checksum::add(data, len)));
+	}
+
+	/*! Add the new content of a field
+	 *
+	 * \param data First byte, at an even offset into the checksummed bytes
+	 * \param len Length of the field
+	 */
+	void add(const void *data, uint32_t len) { sum = Checksum::add(data, len, sum); }
+
+	/*! Get the new checksum
+	 *
+	 * \param check The checksum as it was in the header
+	 * \return The new checksum
+	 */
+	uint16_t apply(uint16_t check) const {
+		return finish(sum + static_cast<uint16_t>(~check));
+	}
+
+	/*! Get the new checksum of UDP
+	 *
+	 * The checksum 0 means there is none, it stays that way.
+	 *
+	 * \param check The checksum as it was in the header
+	 * \return The new checksum
+	 */
+	uint16_t applyUdp(uint16_t check) const {
+		if (check == 0) {
+			return 0;
+		}
+		uint16_t ret = apply(check);
+		return ret != 0 ? ret : 0xffff;
+	}
+};
+
+/*! Fill in the IPv4 header checksum */
+inline void setIPv4(Headers::IPv4 *ipv4) {
+	ipv4->checksum = 0;
+	ipv4->checksum = finish(add(ipv4, ipv4->ihl() * 4));
+}
+
+/*! Rewrite the TTL and update the IPv4 header checksum
+ *
+ * \param ipv4 The IPv4 header, with a valid checksum
+ * \param ttl The new TTL
+ */
+inline void setTtl(Headers::IPv4 *ipv4, uint8_t ttl) {
+	// TTL and protocol share a 16 bit word of the header
+	uint16_t oldWord;
+	memcpy(&oldWord, &ipv4->ttl, sizeof(oldWord));
+	ipv4->ttl = ttl;
+	uint16_t newWord;
+	memcpy(&newWord, &ipv4->ttl, sizeof(newWord));
+	ipv4->checksum = update16(ipv4->checksum, oldWord, newWord);
+}
+
+/*! Fill in the UDP checksum of a packet in one buffer
+ *
+ * The payload follows the UDP header, its length is taken from the header.
+ *
+ * \param ipv4 The IPv4 header, holding the addresses
+ * \param udp The UDP header
+ */
+inline void setUdp(const Headers::IPv4 *ipv4, Headers::Udp *udp) {
+	uint16_t len = ntohs(udp->len);
+	udp->checksum = 0;
+	uint16_t check = finish(add(udp, len, pseudoIPv4(ipv4, len)));
+	udp->checksum = check != 0 ? check : 0xffff;
+}
+
+}; // namespace Checksum
+
+#endif /* CHECKSUM_HPP */
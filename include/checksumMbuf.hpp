@@ -0,0 +1,107 @@
+#ifndef CHECKSUMMBUF_HPP
+#define CHECKSUMMBUF_HPP
+
+#include <cstdint>
+
+#include <rte_mbuf.h>
+
+#include "checksum.hpp"
+#include "headers.hpp"
+
+/*! The checksums of whole mbufs, see checksum.hpp for the rest
+ *
+ * These need DPDK: packet chains, header lengths, and the offload flags.
+ */
+namespace Checksum {
+
+/*! Add the bytes of a packet, from offset up to the end of its chain
+ *
+ * \param pkt The packet
+ * \param offset First byte to add, in the first buffer of pkt
+ * \param sum The sum to add to
+ * \return The new sum
+ */
+inline uint64_t addChain(const struct rte_mbuf *pkt, uint16_t offset, uint64_t sum = 0) {
+	bool odd = false;
+	for (; pkt != nullptr; pkt = pkt->next) {
+		const uint8_t *data = rte_pktmbuf_mtod(pkt, const uint8_t *) + offset;
+		uint32_t len = pkt->data_len - offset;
+		offset = 0;
+
+		// Bytes at an odd position in the checksummed bytes are the upper half of a word
+		uint16_t part = fold(add(data, len));
+		if (odd) {
+			part = static_cast<uint16_t>((part >> 8) | (part << 8));
+		}
+		sum += part;
+		odd ^= len & 1;
+	}
+	return sum;
+}
+
+/*! Is the NIC filling in the checksums of the sent packets?
+ *
+ * This is a setting of the whole process, all ports have to support it.
+ */
+inline bool &offloadEnabled() {
+	static bool enabled = false;
+	return enabled;
+}
+
+/*! Let the NIC fill in the checksums of sent packets
+ *
+ * \param enable Set the offload flags, instead of calculating the checksums
+ */
+inline void setOffload(bool enable) { offloadEnabled() = enable; }
+
+/*! Fill in the IPv4 and L4 checksums of a packet to send
+ *
+ * The header lengths have to be set (see PktParser), the IPv4 header
+ * has to hold the final length.
+ * With offloading, only the sum of the pseudo header is written, and the
+ * NIC is told to do the rest.
+ *
+ * \param pkt The packet, including its chain
+ * \param udp True for UDP, TCP otherwise
+ */
+inline void setIPv4L4(struct rte_mbuf *pkt, bool udp) {
+	uint8_t *data = rte_pktmbuf_mtod(pkt, uint8_t *);
+	auto ipv4 = reinterpret_cast<Headers::IPv4 *>(data + pkt->l2_len);
+	uint16_t l4Offset = pkt->l2_len + pkt->l3_len;
+	auto udpHdr = reinterpret_cast<Headers::Udp *>(data + l4Offset);
+	auto tcpHdr = reinterpret_cast<Headers::Tcp *>(data + l4Offset);
+	uint64_t pseudo = pseudoIPv4(ipv4, ipv4->getPayloadLength());
+
+	ipv4->checksum = 0;
+	if (offloadEnabled()) {
+		pkt->ol_flags |= PKT_TX_IPV4 | PKT_TX_IP_CKSUM;
+		if (udp) {
+			pkt->ol_flags |= PKT_TX_UDP_CKSUM;
+			udpHdr->checksum = fold(pseudo);
+		} else {
+			pkt->ol_flags |= PKT_TX_TCP_CKSUM;
+			tcpHdr->checksum = fold(pseudo);
+		}
+		return;
+	}
+
+	ipv4->checksum = finish(add(ipv4, pkt->l3_len));
+	if (udp) {
+		udpHdr->checksum = 0;
+		uint16_t check = finish(addChain(pkt, l4Offset, pseudo));
+		udpHdr->checksum = check != 0 ? check : 0xffff;
+	} else {
+		tcpHdr->checksum = 0;
+		tcpHdr->checksum = finish(addChain(pkt, l4Offset, pseudo));
+	}
+}
+
+/*! Fill in the IPv4 and TCP checksums of a packet to send, see setIPv4L4() */
+inline void setIPv4Tcp(struct rte_mbuf *pkt) { setIPv4L4(pkt, false); }
+
+/*! Fill in the IPv4 and UDP checksums of a packet to send, see setIPv4L4() */
+inline void setIPv4Udp(struct rte_mbuf *pkt) { setIPv4L4(pkt, true); }
+
+}; // namespace Checksum
+
+#endif /* CHECKSUMMBUF_HPP */
@@ -0,0 +1,348 @@
+#ifndef DTLSAEAD_HPP
+#define DTLSAEAD_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/ssl.h>
+
+/*! Records of an established DTLS 1.2 connection, without the record layer of OpenSSL
+ *
+ * The keys of AES-GCM and ChaCha20-Poly1305 are derived from the master
+ * secret of the session (RFC 5246, 6.3). Records are opened and sealed in
+ * place then, the plaintext stays where the ciphertext was. Each direction
+ * keeps an EVP_CIPHER_CTX with its key, a record only sets the nonce.
+ *
+ * Only one record per datagram is supported. OpenSSL must not write any
+ * record of the connection afterwards, its sequence numbers would repeat
+ * nonces. The connection does not get any further handshakes.
+ */
+class DtlsAead {
+public:
+	//! Length of the record header
+	static constexpr uint16_t headerLen = 13;
+	//! Length of the authentication tag
+	static constexpr uint16_t tagLen = 16;
+	//! Maximum sequence number of an epoch
+	static constexpr uint64_t seqMax = (1ULL << 48) - 1;
+
+	//! Content types of records
+	static constexpr uint8_t typeAlert = 21;
+	static constexpr uint8_t typeHandshake = 22;
+	static constexpr uint8_t typeData = 23;
+
+	//! The header of a record
+	struct Header {
+		uint8_t type;
+		uint16_t epoch;
+		uint64_t seq;
+		// Length of the fragment after the header
+		uint16_t len;
+	};
+
+	/*! Parse the header of the first record of a datagram
+	 *
+	 * \param rec The datagram
+	 * \param len Length of the datagram
+	 * \param h The header is written here
+	 * \return True, if the whole record is within the datagram
+	 */
+	static bool parse(const uint8_t *rec, uint16_t len, Header &h) {
+		if (len < headerLen) {
+			return false;
+		}
+		h.type = rec[0];
+		h.epoch = (rec[3] << 8) | rec[4];
+		h.seq = 0;
+		for (int i = 5; i < 11; i++) {
+			h.seq = (h.seq << 8) | rec[i];
+		}
+		h.len = (rec[11] << 8) | rec[12];
+		return headerLen + h.len <= len;
+	}
+
+	/*! Parse the header of the last record of a datagram
+	 *
+	 * \param rec The datagram
+	 * \param len Length of the datagram
+	 * \param h The header is written here
+	 * \return True, if the datagram consists of whole records
+	 */
+	static bool parseLast(const uint8_t *rec, uint16_t len, Header &h) {
+		do {
+			if (!parse(rec, len, h)) {
+				return false;
+			}
+			rec += headerLen + h.len;
+			len -= headerLen + h.len;
+		} while (len > 0);
+		return true;
+	}
+
+private:
+	EVP_CIPHER_CTX *openCtx = nullptr;
+	EVP_CIPHER_CTX *sealCtx = nullptr;
+	uint8_t openIV[12];
+	uint8_t sealIV[12];
+	// Length of the nonce in the record, 8 for AES-GCM, 0 for ChaCha20-Poly1305
+	uint16_t explicitLen;
+
+	uint16_t openEpoch;
+	// Highest sequence number opened, and the ones before it (bit i is openTop - i)
+	uint64_t openTop;
+	uint64_t openWindow;
+
+	uint16_t sealEpoch;
+	// Sequence number of the next record to seal
+	uint64_t sealSeq;
+
+	DtlsAead() = default;
+
+	// seq points to epoch and sequence number (8 bytes), as in the header
+	void getNonce(const uint8_t *iv, const uint8_t *seq, uint8_t *nonce) {
+		if (explicitLen > 0) {
+			// RFC 5288: salt and the explicit nonce
+			memcpy(nonce, iv, 4);
+			memcpy(nonce + 4, seq, 8);
+		} else {
+			// RFC 7905: the IV, XOR the padded sequence number
+			memcpy(nonce, iv, 12);
+			for (int i = 0; i < 8; i++) {
+				nonce[4 + i] ^= seq[i];
+			}
+		}
+	}
+
+	static void getAad(const uint8_t *rec, uint16_t plainLen, uint8_t *aad) {
+		// Epoch, sequence number, type, version
+		memcpy(aad, rec + 3, 8);
+		aad[8] = rec[0];
+		aad[9] = rec[1];
+		aad[10] = rec[2];
+		aad[11] = plainLen >> 8;
+		aad[12] = plainLen & 0xff;
+	}
+
+public:
+	/*! Take the records of a connection over from OpenSSL
+	 *
+	 * \param ssl The connection, its handshake must be finished
+	 * \param lastOpened Header of the last record OpenSSL read
+	 * \param lastSealed Header of the last record OpenSSL wrote
+	 * \return The records of the connection, nullptr if the cipher is not supported
+	 */
+	static DtlsAead *create(SSL *ssl, const Header &lastOpened, const Header &lastSealed) {
+		if ((SSL_version(ssl) != DTLS1_2_VERSION) || !SSL_is_init_finished(ssl)) {
+			return nullptr;
+		}
+		const SSL_CIPHER *c = SSL_get_current_cipher(ssl);
+		if (c == nullptr) {
+			return nullptr;
+		}
+
+		const EVP_CIPHER *cipher;
+		size_t keyLen;
+		size_t ivLen;
+		uint16_t explicitLen;
+		switch (SSL_CIPHER_get_cipher_nid(c)) {
+		case NID_aes_128_gcm:
+			cipher = EVP_aes_128_gcm();
+			keyLen = 16;
+			ivLen = 4;
+			explicitLen = 8;
+			break;
+		case NID_aes_256_gcm:
+			cipher = EVP_aes_256_gcm();
+			keyLen = 32;
+			ivLen = 4;
+			explicitLen = 8;
+			break;
+		case NID_chacha20_poly1305:
+			cipher = EVP_chacha20_poly1305();
+			keyLen = 32;
+			ivLen = 12;
+			explicitLen = 0;
+			break;
+		default:
+			return nullptr;
+		}
+
+		// The key block: client key, server key, client IV, server IV (no MAC keys)
+		uint8_t master[SSL_MAX_MASTER_KEY_LENGTH];
+		size_t masterLen =
+			SSL_SESSION_get_master_key(SSL_get_session(ssl), master, sizeof(master));
+		uint8_t clientRandom[SSL3_RANDOM_SIZE];
+		uint8_t serverRandom[SSL3_RANDOM_SIZE];
+		SSL_get_client_random(ssl, clientRandom, sizeof(clientRandom));
+		SSL_get_server_random(ssl, serverRandom, sizeof(serverRandom));
+
+		static const unsigned char label[] = "key expansion";
+		uint8_t keyBlock[2 * 32 + 2 * 12];
+		size_t keyBlockLen = 2 * keyLen + 2 * ivLen;
+		EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+		bool ok = (pctx != nullptr) && (EVP_PKEY_derive_init(pctx) == 1) &&
+			(EVP_PKEY_CTX_set_tls1_prf_md(pctx, SSL_CIPHER_get_handshake_digest(c)) == 1) &&
+			(EVP_PKEY_CTX_set1_tls1_prf_secret(pctx, master, masterLen) == 1) &&
+			(EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, label, sizeof(label) - 1) == 1) &&
+			(EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, serverRandom, sizeof(serverRandom)) == 1) &&
+			(EVP_PKEY_CTX_add1_tls1_prf_seed(pctx, clientRandom, sizeof(clientRandom)) == 1) &&
+			(EVP_PKEY_derive(pctx, keyBlock, &keyBlockLen) == 1);
+		EVP_PKEY_CTX_free(pctx);
+		OPENSSL_cleanse(master, sizeof(master));
+		if (!ok) {
+			OPENSSL_cleanse(keyBlock, sizeof(keyBlock));
+			return nullptr;
+		}
+
+		const uint8_t *clientKey = keyBlock;
+		const uint8_t *serverKey = keyBlock + keyLen;
+		const uint8_t *clientIV = keyBlock + 2 * keyLen;
+		const uint8_t *serverIV = clientIV + ivLen;
+		bool server = SSL_is_server(ssl);
+
+		DtlsAead *a = new DtlsAead();
+		a->explicitLen = explicitLen;
+		memcpy(a->openIV, server ? clientIV : serverIV, ivLen);
+		memcpy(a->sealIV, server ? serverIV : clientIV, ivLen);
+		a->openCtx = EVP_CIPHER_CTX_new();
+		a->sealCtx = EVP_CIPHER_CTX_new();
+		ok = (a->openCtx != nullptr) && (a->sealCtx != nullptr) &&
+			(EVP_DecryptInit_ex(
+				 a->openCtx, cipher, nullptr, server ? clientKey : serverKey, nullptr) == 1) &&
+			(EVP_EncryptInit_ex(
+				 a->sealCtx, cipher, nullptr, server ? serverKey : clientKey, nullptr) == 1);
+		OPENSSL_cleanse(keyBlock, sizeof(keyBlock));
+		if (!ok) {
+			delete a;
+			return nullptr;
+		}
+
+		// Records OpenSSL opened before count as opened
+		a->openEpoch = lastOpened.epoch;
+		a->openTop = lastOpened.seq;
+		a->openWindow = ~0ULL;
+		a->sealEpoch = lastSealed.epoch;
+		a->sealSeq = lastSealed.seq + 1;
+		return a;
+	}
+
+	~DtlsAead() {
+		EVP_CIPHER_CTX_free(openCtx);
+		EVP_CIPHER_CTX_free(sealCtx);
+	}
+
+	DtlsAead(const DtlsAead &) = delete;
+	DtlsAead &operator=(const DtlsAead &) = delete;
+
+	/*! Get the offset of the plaintext in a record */
+	uint16_t getPlainOffset() const { return headerLen + explicitLen; }
+
+	/*! Get the length of a record without the plaintext */
+	uint16_t getOverhead() const { return headerLen + explicitLen + tagLen; }
+
+	/*! Open a record in place
+	 *
+	 * Records of an old epoch, replayed records, and records which fail to
+	 * authenticate are rejected.
+	 *
+	 * \param rec The datagram, holding exactly one record
+	 * \param len Length of the datagram
+	 * \param type The content type of the record is written here
+	 * \return Length of the plaintext at rec + getPlainOffset(), -1 if the record
+	 * 		is rejected
+	 */
+	int open(uint8_t *rec, uint16_t len, uint8_t &type) {
+		Header h;
+		if (!parse(rec, len, h) || (headerLen + h.len != len) || (h.epoch != openEpoch) ||
+			(h.len < explicitLen + tagLen)) {
+			return -1;
+		}
+
+		uint64_t diff = openTop - h.seq;
+		if ((h.seq <= openTop) && ((diff >= 64) || ((openWindow >> diff) & 1))) {
+			return -1;
+		}
+
+		uint16_t plainLen = h.len - explicitLen - tagLen;
+		uint8_t nonce[12];
+		getNonce(openIV, explicitLen > 0 ? rec + headerLen : rec + 3, nonce);
+		uint8_t aad[13];
+		getAad(rec, plainLen, aad);
+
+		uint8_t *plain = rec + headerLen + explicitLen;
+		int outLen;
+		int finalLen;
+		if ((EVP_DecryptInit_ex(openCtx, nullptr, nullptr, nullptr, nonce) != 1) ||
+			(EVP_DecryptUpdate(openCtx, nullptr, &outLen, aad, sizeof(aad)) != 1) ||
+			(EVP_DecryptUpdate(openCtx, plain, &outLen, plain, plainLen) != 1) ||
+			(EVP_CIPHER_CTX_ctrl(openCtx, EVP_CTRL_AEAD_SET_TAG, tagLen, plain + plainLen) !=
+				1) ||
+			(EVP_DecryptFinal_ex(openCtx, plain + outLen, &finalLen) != 1)) {
+			return -1;
+		}
+
+		// Only authentic records move the window
+		if (h.seq > openTop) {
+			uint64_t shift = h.seq - openTop;
+			openWindow = (shift >= 64) ? 1 : ((openWindow << shift) | 1);
+			openTop = h.seq;
+		} else {
+			openWindow |= 1ULL << diff;
+		}
+
+		type = h.type;
+		return plainLen;
+	}
+
+	/*! Seal a record in place
+	 *
+	 * \param rec The record is written here, the plaintext is at rec + getPlainOffset()
+	 * \param type The content type of the record
+	 * \param plainLen Length of the plaintext
+	 * \return Length of the record, -1 if the sequence numbers are used up
+	 */
+	int seal(uint8_t *rec, uint8_t type, uint16_t plainLen) {
+		if (sealSeq > seqMax) {
+			return -1;
+		}
+
+		uint16_t fragLen = explicitLen + plainLen + tagLen;
+		rec[0] = type;
+		rec[1] = 0xfe;
+		rec[2] = 0xfd;
+		rec[3] = sealEpoch >> 8;
+		rec[4] = sealEpoch & 0xff;
+		for (int i = 0; i < 6; i++) {
+			rec[5 + i] = (sealSeq >> (8 * (5 - i))) & 0xff;
+		}
+		rec[11] = fragLen >> 8;
+		rec[12] = fragLen & 0xff;
+		if (explicitLen > 0) {
+			memcpy(rec + headerLen, rec + 3, 8);
+		}
+
+		uint8_t nonce[12];
+		getNonce(sealIV, rec + 3, nonce);
+		uint8_t aad[13];
+		getAad(rec, plainLen, aad);
+
+		uint8_t *plain = rec + headerLen + explicitLen;
+		int outLen;
+		int finalLen;
+		if ((EVP_EncryptInit_ex(sealCtx, nullptr, nullptr, nullptr, nonce) != 1) ||
+			(EVP_EncryptUpdate(sealCtx, nullptr, &outLen, aad, sizeof(aad)) != 1) ||
+			(EVP_EncryptUpdate(sealCtx, plain, &outLen, plain, plainLen) != 1) ||
+			(EVP_EncryptFinal_ex(sealCtx, plain + outLen, &finalLen) != 1) ||
+			(EVP_CIPHER_CTX_ctrl(sealCtx, EVP_CTRL_AEAD_GET_TAG, tagLen, plain + plainLen) !=
+				1)) {
+			return -1;
+		}
+
+		sealSeq++;
+		return headerLen + fragLen;
+	}
+};
+
+#endif /* DTLSAEAD_HPP */
@@ -1,4 +1,5 @@
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <iostream>
 
@@ -40,6 +41,9 @@ struct States {
 	static constexpr StateID DELETED = 4;
 };
 
+//! Connections without packets are closed after this, handshakes retransmit instead
+static constexpr std::chrono::milliseconds idleTimeout(60000);
+
 /*! Use this to create the SSL context for creaeteStateData()
  *
  * \return SSL context suitable to create a DTLS client
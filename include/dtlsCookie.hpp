@@ -0,0 +1,143 @@
+#ifndef DTLSCOOKIE_HPP
+#define DTLSCOOKIE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+/*! Stateless cookies of the DTLS HelloVerifyRequest (RFC 6347, section 4.2.1)
+ *
+ * The server answers a ClientHello without a valid cookie with a
+ * HelloVerifyRequest, only a ClientHello returning the cookie creates a state.
+ * A cookie is 17 bytes:
+ * - Byte 0: Time counter, it advances every 64 seconds
+ * - Bytes 1-16: HMAC-SHA256 over the addresses and ports, truncated
+ *
+ * The key of the HMAC rotates with the time counter, it is derived from a
+ * random secret of the process: key = HMAC-SHA256(secret, counter).
+ * Cookies older than maxAge ticks of the time counter are rejected.
+ */
+class DtlsCookie {
+public:
+	using time_point = std::chrono::steady_clock::time_point;
+
+	//! Length of a cookie
+	static constexpr unsigned int length = 17;
+
+	//! Number of counter ticks, after which a cookie expires
+	static constexpr uint32_t maxAge = 1;
+
+	/*! The connection a cookie is made for
+	 *
+	 * All values are in host byte order.
+	 */
+	struct Peer {
+		uint32_t peerIP;
+		uint32_t localIP;
+		uint16_t peerPort;
+		uint16_t localPort;
+	};
+
+private:
+	static constexpr unsigned int keyLen = 32;
+	static constexpr unsigned int macLen = length - 1;
+
+	struct Secret {
+		uint8_t s[keyLen];
+
+		Secret() {
+			if (RAND_bytes(s, sizeof(s)) != 1) {
+				throw new std::runtime_error("DtlsCookie::Secret() RAND_bytes() failed");
+			}
+		};
+	};
+
+	// The keys of the last two counters, every core derives its own
+	struct Key {
+		uint32_t counter = 0;
+		bool valid = false;
+		uint8_t k[keyLen];
+	};
+
+	static uint32_t getCounter(time_point now) {
+		return std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch())
+				   .count() >>
+			6;
+	}
+
+	static const uint8_t *getKey(uint32_t counter) {
+		static thread_local Key keys[2];
+		Key &key = keys[counter & 1];
+		if (!key.valid || (key.counter != counter)) {
+			unsigned int len = keyLen;
+			HMAC(EVP_sha256(), getSecret().s, keyLen,
+				reinterpret_cast<const uint8_t *>(&counter), sizeof(counter), key.k, &len);
+			key.counter = counter;
+			key.valid = true;
+		}
+		return key.k;
+	}
+
+	static void mac(const Peer &peer, uint32_t counter, uint8_t *out) {
+		uint8_t words[12];
+		memcpy(words, &peer.peerIP, 4);
+		memcpy(words + 4, &peer.localIP, 4);
+		memcpy(words + 8, &peer.peerPort, 2);
+		memcpy(words + 10, &peer.localPort, 2);
+
+		uint8_t res[EVP_MAX_MD_SIZE];
+		unsigned int len = sizeof(res);
+		HMAC(EVP_sha256(), getKey(counter), keyLen, words, sizeof(words), res, &len);
+		memcpy(out, res, macLen);
+	}
+
+	static Secret &getSecret() {
+		static Secret secret;
+		return secret;
+	}
+
+public:
+	/*! Create the cookie for a ClientHello
+	 *
+	 * \param peer The connection of the ClientHello
+	 * \param cookie length bytes are written here
+	 * \param now Current time
+	 */
+	static void make(const Peer &peer, uint8_t *cookie, time_point now) {
+		uint32_t counter = getCounter(now);
+		cookie[0] = static_cast<uint8_t>(counter);
+		mac(peer, counter, cookie + 1);
+	}
+
+	/*! Check the cookie returned by a ClientHello
+	 *
+	 * \param peer The connection of the ClientHello
+	 * \param cookie The cookie of the ClientHello
+	 * \param len Length of the cookie
+	 * \param now Current time
+	 * \return True, if the cookie is valid and did not expire
+	 */
+	static bool check(const Peer &peer, const uint8_t *cookie, unsigned int len, time_point now) {
+		if (len != length) {
+			return false;
+		}
+
+		uint32_t counter = getCounter(now);
+		uint32_t age = static_cast<uint8_t>(counter - cookie[0]);
+		if (age > maxAge) {
+			return false;
+		}
+
+		uint8_t expected[macLen];
+		mac(peer, counter - age, expected);
+		return CRYPTO_memcmp(expected, cookie + 1, macLen) == 0;
+	}
+};
+
+#endif /* DTLSCOOKIE_HPP */
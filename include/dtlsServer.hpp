@@ -1,4 +1,8 @@
+#ifndef DTLSSERVER_HPP
+#define DTLSSERVER_HPP
+
 #include <array>
+#include <chrono>
 #include <cstdint>
 #include <iostream>
 
@@ -12,6 +16,9 @@
 #include <rte_mempool.h>
 
 #include "IPv4_5TupleL2Ident.hpp"
+#include "asyncPool.hpp"
+#include "dtlsAead.hpp"
+#include "dtlsCookie.hpp"
 #include "mbuf.hpp"
 #include "stateMachine.hpp"
 
@@ -21,8 +28,8 @@ namespace DTLS_Server {
 
 struct dtlsServer {
 	SSL *ssl;
-	BIO *wbio;
-	BIO *rbio;
+	// An MbufBio for both directions
+	BIO *bio;
 	uint32_t localIP;
 	uint32_t remoteIP;
 	std::array<uint8_t, 6> localMac;
@@ -30,6 +37,20 @@ struct dtlsServer {
 	uint16_t remotePort;
 	uint16_t localPort;
 
+	// DTLSv1_listen() kept the ClientHello in the SSL object, see preAccept()
+	bool helloBuffered;
+	// The cookie of the kept ClientHello is checked again, when it is processed
+	DtlsCookie::Peer cookiePeer;
+
+	// Set by the job of runHandshake() on a worker, finishHandshake() closes the connection
+	bool handshakeFailed;
+
+	// The last packet of the peer, see DtlsServer_setIdleTimeout()
+	std::chrono::steady_clock::time_point lastPkt;
+
+	// The records after the handshake, if OpenSSL handed them over, see DtlsServer_setFastPath()
+	DtlsAead *aead;
+
 	// uint16_t counter;
 };
 
@@ -43,10 +64,30 @@ struct States {
 	static constexpr StateID ESTABLISHED = 2;
 	static constexpr StateID RUN_TEARDOWN = 3;
 	static constexpr StateID DELETED = 4;
+	// The handshake ran on a worker, see DtlsServer_setAsyncWorkers()
+	static constexpr StateID FINISH_HANDSHAKE = 5;
 };
 
+//! Number of SSL objects DtlsServer_init() creates for the pool of its core
+static constexpr size_t sslPoolSize = 256;
+
 void *factory(IPv4_5TupleL2Ident<mbuf>::ConnectionID id);
 
+/*! Answer ClientHellos without a valid cookie statelessly
+ *
+ * A ClientHello without a valid cookie (see DtlsCookie) is answered with a
+ * HelloVerifyRequest in the same buffer, every other packet of an unknown
+ * connection is dropped. Only a ClientHello returning the cookie is
+ * accepted, factory() takes over the SSL object which checked it.
+ * Register it with StateMachine::registerPreAcceptFunction().
+ *
+ * \param id The connection of the packet
+ * \param pkt The packet of the unknown connection
+ * \return Whether to create a state, send the rewritten packet, or drop it
+ */
+StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>::PreAccept preAccept(
+	IPv4_5TupleL2Ident<mbuf>::ConnectionID id, mbuf *pkt);
+
 /*! Use this to create the SSL context for creaeteStateData()
  *
  * \return SSL context suitable to create a DTLS server
@@ -89,6 +130,9 @@ StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>::State createStateData(SSL_CTX *ctx
 void runHandshake(StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>::State &state, mbuf *,
 	StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>::FunIface &funIface);
 
+void finishHandshake(StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>::State &state, mbuf *,
+	StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>::FunIface &funIface);
+
 void sendData(StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>::State &state, mbuf *,
 	StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>::FunIface &funIface);
 
@@ -104,6 +148,98 @@ extern "C" {
  */
 void *DtlsServer_init(struct rte_mempool *mp);
 
+/*! Exchange cookies before a connection is created
+ *
+ * \param obj Structure returned from DtlsServer_init()
+ * \param enable Answer ClientHellos without a valid cookie statelessly
+ * 		(see DTLS_Server::preAccept())
+ */
+void DtlsServer_setCookies(void *obj, bool enable);
+
+/*! Set the size of the pool of SSL objects
+ *
+ * The SSL objects of closed connections are reset and reused, every core
+ * has a pool of its own. DtlsServer_init() fills the pool of the calling
+ * core with DTLS_Server::sslPoolSize objects.
+ *
+ * \param obj Structure returned from DtlsServer_init()
+ * \param size Number of SSL objects to keep in the pool of the calling core,
+ * 		0 creates a new SSL object for every connection
+ */
+void DtlsServer_setSslPoolSize(void *obj, unsigned int size);
+
+/*! Issue session tickets, to resume sessions without a full handshake
+ *
+ * Tickets are enabled by default, their keys rotate (see DtlsTicketKeys).
+ * Every core accepts the tickets of every other core.
+ *
+ * \param obj Structure returned from DtlsServer_init()
+ * \param enable Issue and accept session tickets for new connections
+ */
+void DtlsServer_setSessionTickets(void *obj, bool enable);
+
+/*! Set after how long connections without packets are closed
+ *
+ * The server sends a close_notify, and reuses the SSL object. Handshakes in
+ * progress retransmit their flights meanwhile (see DTLSv1_handle_timeout()),
+ * and are closed after the timeout as well. The default is 60 seconds.
+ *
+ * \param obj Structure returned from DtlsServer_init()
+ * \param timeout Timeout in milliseconds, 0 keeps idle connections forever
+ */
+void DtlsServer_setIdleTimeout(void *obj, unsigned int timeout);
+
+/*! Get the number of open connections
+ *
+ * \param obj Structure returned from DtlsServer_init()
+ * \return Number of connections in the state table
+ */
+unsigned int DtlsServer_getConnections(void *obj);
+
+/*! Set the session caches
+ *
+ * Clients without a ticket resume their session by its ID, if it is still
+ * in the cache (see SessionCache). The cache is disabled by default.
+ * Every thread running handshakes has a cache of its own, these are the
+ * cores, or the workers of DtlsServer_setAsyncWorkers().
+ *
+ * \param obj Structure returned from DtlsServer_init()
+ * \param size Maximum number of sessions in the cache, 0 disables it
+ * \param ttl Seconds after which a session is removed from the cache
+ */
+void DtlsServer_setSessionCache(void *obj, unsigned int size, unsigned int ttl);
+
+/*! Run the handshakes on worker threads
+ *
+ * A handshake costs public-key operations, which would stall all other
+ * connections of the core. With workers, the core parks the connection
+ * (see StateMachine::FunIface::runAsync()), and goes on with the others.
+ * The answer of the handshake is sent with a later batch, so keep calling
+ * DtlsServer_process(), even without incoming packets.
+ *
+ * \param obj Structure returned from DtlsServer_init()
+ * \param numWorkers Number of worker threads for this server, 0 keeps the
+ * 		handshakes on the core. Workers can only be started once.
+ */
+void DtlsServer_setAsyncWorkers(void *obj, unsigned int numWorkers);
+
+/*! Open and seal the records of established connections without OpenSSL
+ *
+ * Once a connection echoed its first record, the keys of its AES-GCM or
+ * ChaCha20-Poly1305 cipher are derived (see DtlsAead). Further records are
+ * decrypted and encrypted in place, in the packet they arrived in.
+ * Connections with other ciphers stay with OpenSSL.
+ *
+ * OpenSSL does not write to these connections anymore. The server answers
+ * a close_notify itself, and refuses renegotiations with a
+ * no_renegotiation alert. Datagrams with more than one record are dropped.
+ * The fast path is disabled by default.
+ *
+ * \param obj Structure returned from DtlsServer_init()
+ * \param enable Hand new connections over to the fast path
+ */
+void DtlsServer_setFastPath(void *obj, bool enable);
+
 /*! Get the packets from an opaque structure
  *
  * \param obj Return value of DtlsClient_connect() or DtlsClient_process()
@@ -125,7 +261,12 @@ void *DtlsServer_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCou
 
 /*! Free recources used by the state machine
  *
- * \param obj object returned by DtlsClient_init()
+ * Call it on the core, which called DtlsServer_init(). The pooled SSL objects
+ * of this core are freed with the context.
+ *
+ * \param obj object returned by DtlsServer_init()
  */
 void DtlsServer_free(void *obj);
 }
+
+#endif /* DTLSSERVER_HPP */
@@ -0,0 +1,148 @@
+#ifndef DTLSTICKETKEYS_HPP
+#define DTLSTICKETKEYS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+
+/*! Rotating keys of stateless session tickets (RFC 5077)
+ *
+ * A ticket holds the encrypted session, the client returns it to resume the
+ * session without the public-key operations of a full handshake.
+ * All cores share the keys, a ticket is valid on every core.
+ *
+ * The keys rotate with a time counter, which advances every 4096 seconds.
+ * They are derived from a random secret of the process:
+ * - name = counter | HMAC-SHA256(secret, counter | 'n'), truncated
+ * - aesKey = HMAC-SHA256(secret, counter | 'a'), truncated
+ * - hmacKey = HMAC-SHA256(secret, counter | 'h')
+ *
+ * Tickets of keys older than maxAge ticks are rejected.
+ */
+class DtlsTicketKeys {
+public:
+	using time_point = std::chrono::steady_clock::time_point;
+
+	//! Number of counter ticks, after which a key expires
+	static constexpr uint32_t maxAge = 2;
+
+	//! Length of the key name in a ticket
+	static constexpr unsigned int nameLen = 16;
+
+	//! Length of the AES-128 key
+	static constexpr unsigned int aesKeyLen = 16;
+
+	//! Length of the HMAC-SHA256 key
+	static constexpr unsigned int hmacKeyLen = 32;
+
+	//! The keys of one counter
+	struct Key {
+		uint32_t counter = 0;
+		bool valid = false;
+		uint8_t name[nameLen];
+		uint8_t aesKey[aesKeyLen];
+		uint8_t hmacKey[hmacKeyLen];
+	};
+
+private:
+	static constexpr unsigned int secretLen = 32;
+
+	struct Secret {
+		uint8_t s[secretLen];
+
+		Secret() {
+			if (RAND_bytes(s, sizeof(s)) != 1) {
+				throw new std::runtime_error("DtlsTicketKeys::Secret() RAND_bytes() failed");
+			}
+		};
+	};
+
+	static Secret &getSecret() {
+		static Secret secret;
+		return secret;
+	}
+
+	static uint32_t getCounter(time_point now) {
+		return std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch())
+				   .count() >>
+			12;
+	}
+
+	static void derive(uint32_t counter, uint8_t label, uint8_t *out) {
+		uint8_t in[sizeof(counter) + 1];
+		memcpy(in, &counter, sizeof(counter));
+		in[sizeof(counter)] = label;
+
+		unsigned int len = EVP_MAX_MD_SIZE;
+		HMAC(EVP_sha256(), getSecret().s, secretLen, in, sizeof(in), out, &len);
+	}
+
+	// The keys of the valid counters, every core derives its own
+	static const Key &getKey(uint32_t counter) {
+		static thread_local Key keys[maxAge + 1];
+		Key &key = keys[counter % (maxAge + 1)];
+		if (!key.valid || (key.counter != counter)) {
+			uint8_t res[EVP_MAX_MD_SIZE];
+
+			memcpy(key.name, &counter, sizeof(counter));
+			derive(counter, 'n', res);
+			memcpy(key.name + sizeof(counter), res, nameLen - sizeof(counter));
+
+			derive(counter, 'a', res);
+			memcpy(key.aesKey, res, aesKeyLen);
+
+			derive(counter, 'h', res);
+			memcpy(key.hmacKey, res, hmacKeyLen);
+
+			key.counter = counter;
+			key.valid = true;
+		}
+		return key;
+	}
+
+public:
+	/*! Get the keys to issue a new ticket with
+	 *
+	 * \param now Current time
+	 * \return The keys
+	 */
+	static const Key &getCurrent(time_point now) { return getKey(getCounter(now)); }
+
+	/*! Find the keys of a ticket
+	 *
+	 * \param name The key name of the ticket
+	 * \param now Current time
+	 * \return The keys, nullptr if the keys are unknown or expired
+	 */
+	static const Key *find(const uint8_t *name, time_point now) {
+		uint32_t counter;
+		memcpy(&counter, name, sizeof(counter));
+
+		uint32_t current = getCounter(now);
+		if (current - counter > maxAge) {
+			return nullptr;
+		}
+
+		const Key &key = getKey(counter);
+		if (CRYPTO_memcmp(key.name, name, nameLen) != 0) {
+			return nullptr;
+		}
+		return &key;
+	}
+
+	/*! Check if a ticket should be replaced by one with the current keys
+	 *
+	 * \param key The keys of the ticket
+	 * \param now Current time
+	 * \return True, if the keys are not the current ones
+	 */
+	static bool isOld(const Key &key, time_point now) { return key.counter != getCounter(now); }
+};
+
+#endif /* DTLSTICKETKEYS_HPP */
@@ -0,0 +1,203 @@
+#ifndef HASHERS_HPP
+#define HASHERS_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+#include "sodium.h"
+
+/*! Hash policies for connection identifiers
+ *
+ * Identifiers pack their ConnectionID into an array of 64 bit words
+ * (zero padded) and hand it to one of the policies below.
+ * Every policy has to expose the following interface:
+ * \code{.cpp}
+ * struct HashPolicy {
+ *		static uint64_t hash(const uint64_t *words, size_t numWords);
+ * };
+ * \endcode
+ *
+ * Which policy to choose depends on the environment:
+ * - SipHash13Keyed: Keyed with a random per-process key, use this for hostile traffic
+ * - Crc32c: SSE4.2 CRC32C, only use this if the peers are trusted
+ * - WyMix: Fast non-cryptographic 64 bit mixer, only for trusted peers as well
+ * - SipHash24ZeroKey: SipHash-2-4 with an all-zero key (the old default)
+ */
+namespace Hashers {
+
+/*! SipHash-2-4 using libsodium with an all-zero (public) key
+ *
+ * This is slow, and since the key is known, it is not collision resistant.
+ * It is only kept for comparison.
+ */
+struct SipHash24ZeroKey {
+	static uint64_t hash(const uint64_t *words, size_t numWords) {
+		uint64_t res = 0;
+
+		assert(crypto_shorthash_BYTES == 8);
+		static const uint8_t key[crypto_shorthash_KEYBYTES] = {0};
+		crypto_shorthash(reinterpret_cast<uint8_t *>(&res),
+			reinterpret_cast<const uint8_t *>(words), numWords * sizeof(uint64_t), key);
+
+		return res;
+	}
+};
+
+/*! SipHash-1-3 with a random key, which is generated once per process
+ *
+ * One compression round and three finalization rounds are enough for
+ * hash table usage, as long as the key stays secret.
+ */
+struct SipHash13Keyed {
+	struct Key {
+		uint64_t k0;
+		uint64_t k1;
+
+		Key() { randombytes_buf(this, sizeof(*this)); };
+	};
+
+	/*! Get the key of this process
+	 *
+	 * The key is generated on first use.
+	 *
+	 * \return The key used for every hash
+	 */
+	static Key &getKey() {
+		static Key key;
+		return key;
+	}
+
+	/*! Set the key manually
+	 *
+	 * This is only useful for reproducible runs.
+	 * It has to be called before any hash is calculated.
+	 *
+	 * \param k0 First half of the key
+	 * \param k1 Second half of the key
+	 */
+	static void setKey(uint64_t k0, uint64_t k1) {
+		getKey().k0 = k0;
+		getKey().k1 = k1;
+	}
+
+	static inline uint64_t rotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+	static inline void round(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3) {
+		v0 += v1;
+		v1 = rotl(v1, 13);
+		v1 ^= v0;
+		v0 = rotl(v0, 32);
+		v2 += v3;
+		v3 = rotl(v3, 16);
+		v3 ^= v2;
+		v0 += v3;
+		v3 = rotl(v3, 21);
+		v3 ^= v0;
+		v2 += v1;
+		v1 = rotl(v1, 17);
+		v1 ^= v2;
+		v2 = rotl(v2, 32);
+	}
+
+	static uint64_t hash(const uint64_t *words, size_t numWords) {
+		const Key &key = getKey();
+
+		uint64_t v0 = 0x736f6d6570736575ULL ^ key.k0;
+		uint64_t v1 = 0x646f72616e646f6dULL ^ key.k1;
+		uint64_t v2 = 0x6c7967656e657261ULL ^ key.k0;
+		uint64_t v3 = 0x7465646279746573ULL ^ key.k1;
+
+		for (size_t i = 0; i < numWords; i++) {
+			v3 ^= words[i];
+			round(v0, v1, v2, v3);
+			v0 ^= words[i];
+		}
+
+		// The input is always a multiple of 8 bytes -> the last block only holds the length
+		uint64_t b = static_cast<uint64_t>(numWords * sizeof(uint64_t)) << 56;
+		v3 ^= b;
+		round(v0, v1, v2, v3);
+		v0 ^= b;
+
+		v2 ^= 0xff;
+		round(v0, v1, v2, v3);
+		round(v0, v1, v2, v3);
+		round(v0, v1, v2, v3);
+
+		return v0 ^ v1 ^ v2 ^ v3;
+	}
+};
+
+/*! Hardware CRC32C (SSE4.2)
+ *
+ * One CRC chain, widened to 64 bits by a multiplication. The result holds
+ * 32 bits of entropy, but every bit of it depends on all of them.
+ * A second chain would not add any: CRC is affine, over the same words two
+ * chains only differ by a constant, and bit permutations of the words keep
+ * their parities equal.
+ * Without SSE4.2 a (slow) software CRC32C is used.
+ */
+struct Crc32c {
+	static constexpr uint32_t seed = 0x9e3779b9;
+	static constexpr uint64_t mix = 0x9e3779b97f4a7c15ULL;
+
+	static inline uint32_t crcWord(uint32_t crc, uint64_t word) {
+#ifdef __SSE4_2__
+		return static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+#else
+		for (int i = 0; i < 64; i++) {
+			uint32_t bit = (crc ^ static_cast<uint32_t>(word >> i)) & 1;
+			crc = (crc >> 1) ^ (bit ? 0x82f63b78 : 0);
+		}
+		return crc;
+#endif
+	}
+
+	static uint64_t hash(const uint64_t *words, size_t numWords) {
+		uint32_t crc = seed;
+		for (size_t i = 0; i < numWords; i++) {
+			crc = crcWord(crc, words[i]);
+		}
+
+		// Both steps are invertible, different CRCs stay different hashes
+		uint64_t h = crc * mix;
+		return h ^ (h >> 32);
+	}
+};
+
+/*! Fast non-cryptographic mixer (wyhash style)
+ *
+ * Pairs of words are multiplied into 128 bit and folded.
+ */
+struct WyMix {
+	static constexpr uint64_t secret0 = 0xa0761d6478bd642fULL;
+	static constexpr uint64_t secret1 = 0xe7037ed1a0b428dbULL;
+	static constexpr uint64_t secret2 = 0x8ebc6af09c88c6e3ULL;
+
+	static inline uint64_t mum(uint64_t a, uint64_t b) {
+		__uint128_t r = static_cast<__uint128_t>(a) * b;
+		return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+	}
+
+	static uint64_t hash(const uint64_t *words, size_t numWords) {
+		uint64_t seed = secret2 ^ (numWords * sizeof(uint64_t));
+		size_t i = 0;
+		for (; i + 1 < numWords; i += 2) {
+			seed = mum(words[i] ^ secret0 ^ seed, words[i + 1] ^ secret1);
+		}
+		if (i < numWords) {
+			seed = mum(words[i] ^ secret0 ^ seed, secret1);
+		}
+		return mum(seed ^ secret0, secret2);
+	}
+};
+
+}; // namespace Hashers
+
+#endif /* HASHERS_HPP */
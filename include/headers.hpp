@@ -176,7 +176,7 @@ struct IPv4 {
 		uint16_t *hdr_cast = reinterpret_cast<uint16_t *>(this);
 
 		this->checksum = 0;
-		for (uint8_t i = 0; i < (this->ihl() * 4); i++) {
+		for (uint8_t i = 0; i < (this->ihl() * 2); i++) {
 			result += ntohs(hdr_cast[i]);
 			if (result & (1 << 16)) {
 				result &= 0xffff;
@@ -189,6 +189,100 @@ struct IPv4 {
 
 } __attribute__((packed));
 
+/*! Representation of the IPv6 header (RFC 8200) */
+struct IPv6 {
+	uint32_t version_tc_flow; //!< Version, traffic class and flow label
+	uint16_t payload_length;  //!< Length of everything following this header
+	uint8_t nextHeader;		  //!< Next header (extension header or L4 protocol)
+	uint8_t hopLimit;		  //!< Hop limit
+	std::array<uint8_t, 16> srcIP; //!< Source address
+	std::array<uint8_t, 16> dstIP; //!< Destination address
+
+	static constexpr uint8_t EXT_HOP_BY_HOP = 0;
+	static constexpr uint8_t EXT_ROUTING = 43;
+	static constexpr uint8_t EXT_FRAGMENT = 44;
+	static constexpr uint8_t EXT_ESP = 50;
+	static constexpr uint8_t EXT_AUTH = 51;
+	static constexpr uint8_t EXT_NO_NEXT = 59;
+	static constexpr uint8_t EXT_DEST_OPTS = 60;
+
+	uint8_t version() const { return reinterpret_cast<const uint8_t *>(this)[0] >> 4; }
+
+	/*! Set the version field to 6 and clear traffic class and flow label */
+	void setVersion() { version_tc_flow = htonl(6 << 28); }
+
+	/*! Get the length of the L3-SDU
+	 * \return The length of the payload (host byte order)
+	 */
+	uint16_t getPayloadLength() const { return ntohs(payload_length); }
+
+	/*! Set the length of the L3-SDU
+	 * \param len of the payload (host byte order)
+	 */
+	void setPayloadLength(uint16_t len) { payload_length = htons(len); }
+
+	/*! Get the SDU
+	 * This may be an extension header, see nextHeader
+	 * \return Pointer to the payload
+	 */
+	void *getPayload() {
+		return reinterpret_cast<void *>(reinterpret_cast<uint8_t *>(this) + sizeof(struct IPv6));
+	}
+
+	static std::string addrToStr(const std::array<uint8_t, 16> &addr) {
+		char str[INET6_ADDRSTRLEN];
+		inet_ntop(AF_INET6, addr.data(), str, sizeof(str));
+		return std::string(str);
+	}
+
+	std::string getSrcAddr() { return addrToStr(this->srcIP); }
+
+	std::string getDstAddr() { return addrToStr(this->dstIP); }
+
+} __attribute__((packed));
+
+/*! Generic part of an IPv6 extension header
+ *
+ * Hop-by-hop, routing, fragment and destination options share this layout.
+ */
+struct IPv6Ext {
+	uint8_t nextHeader; //!< Next header
+	uint8_t hdrExtLen;  //!< Length of the header, not including the first 8 bytes
+
+	/*! Check if a next header value denotes an extension header, which can be skipped
+	 * ESP can not be skipped, it is therefore not included.
+	 * \param nh Next header value
+	 * \return True for hop-by-hop, routing, fragment, destination options and AH
+	 */
+	static bool isSkippable(uint8_t nh) {
+		return (nh == IPv6::EXT_HOP_BY_HOP) || (nh == IPv6::EXT_ROUTING) ||
+			   (nh == IPv6::EXT_FRAGMENT) || (nh == IPv6::EXT_DEST_OPTS) ||
+			   (nh == IPv6::EXT_AUTH);
+	}
+
+	/*! Get the length of this extension header
+	 * \param type The type of this header (next header field of the previous one)
+	 * \return Length in bytes
+	 */
+	uint16_t getLength(uint8_t type) const {
+		if (type == IPv6::EXT_FRAGMENT) {
+			return 8;
+		} else if (type == IPv6::EXT_AUTH) {
+			return (hdrExtLen + 2) * 4;
+		}
+		return (hdrExtLen + 1) * 8;
+	}
+
+	/*! Get the fragment offset, only valid for fragment headers
+	 * \return Fragment offset in 8 byte units
+	 */
+	uint16_t getFragmentOffset() const {
+		const uint16_t *offFlags = reinterpret_cast<const uint16_t *>(this) + 1;
+		return ntohs(*offFlags) >> 3;
+	}
+
+} __attribute__((packed));
+
 /*! Representation of the TCP header. */
 struct Tcp {
 	uint16_t srcPort;		 //!< Source port
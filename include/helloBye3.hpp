@@ -8,6 +8,7 @@
 #include "exceptions.hpp"
 #include "headers.hpp"
 #include "mbuf.hpp"
+#include "pktParser.hpp"
 #include "stateMachine.hpp"
 
 namespace HelloBye3 {
@@ -54,19 +55,15 @@ public:
 		uint64_t operator()(const ConnectionID &c) const { return c.ident; };
 	};
 	static ConnectionID identify(Packet *pkt) {
-		Headers::Ethernet *eth = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
-		if (eth->getEthertype() != Headers::Ethernet::ETHERTYPE_IPv4) {
+		PktParser::Result res;
+		if (!PktParser::parse(pkt, res) ||
+			(res.ethertype != Headers::Ethernet::ETHERTYPE_IPv4) ||
+			(res.proto != Headers::IPv4::PROTO_UDP) ||
+			(PktParser::getHeadersLen(pkt) + sizeof(struct msg) > pkt->getDataLen())) {
 			throw new PacketNotIdentified();
 		}
 
-		Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(eth->getPayload());
-		if (ipv4->proto != Headers::IPv4::PROTO_UDP) {
-			throw new PacketNotIdentified();
-		}
-
-		Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
-
-		struct msg *msg = reinterpret_cast<struct msg *>(udp->getPayload());
+		struct msg *msg = reinterpret_cast<struct msg *>(PktParser::getPayload(pkt));
 		return msg->ident;
 	};
 
@@ -9,8 +9,98 @@
 struct mbuf : public rte_mbuf {
 	void *getData() { return rte_pktmbuf_mtod(this, void *); }
 	uint16_t getDataLen() { return this->data_len; };
-	void setDataLen(uint16_t l) { this->data_len = l; };
+	void setDataLen(uint16_t l) {
+		this->data_len = l;
+		this->pkt_len = l + (this->next != nullptr ? this->next->pkt_len : 0);
+	};
 	uint16_t getBufLen() { return this->buf_len; }
+
+	/*! Take another reference to this buffer
+	 * The buffer is only freed, after every reference was released
+	 */
+	void ref() { rte_mbuf_refcnt_update(this, 1); };
+
+	/*! Release one reference to this buffer (and the ones chained to it) */
+	void release() { rte_pktmbuf_free(this); };
+
+	/*! Append a buffer to this one
+	 *
+	 * The buffer has to be a single segment, holding no other chain.
+	 * Use this to send a payload behind the headers in this buffer,
+	 * the chain takes over the reference to tail.
+	 *
+	 * \param tail The buffer to append
+	 */
+	void chain(mbuf *tail) {
+		this->next = tail;
+		this->nb_segs = 1 + tail->nb_segs;
+		this->pkt_len = this->data_len + tail->pkt_len;
+	};
+
+	/*! Release the buffers chained to this one
+	 *
+	 * Use this to reuse a received packet for headers only.
+	 */
+	void unchain() {
+		if (this->next != nullptr) {
+			rte_pktmbuf_free(this->next);
+			this->next = nullptr;
+			this->nb_segs = 1;
+			this->pkt_len = this->data_len;
+		}
+	};
+
+	/*! Detach the buffers chained to this one
+	 *
+	 * \return The first detached buffer, it heads the rest of the chain.
+	 * The caller takes over the reference to it. nullptr, if there is none.
+	 */
+	mbuf *splitNext() {
+		mbuf *rest = static_cast<mbuf *>(this->next);
+		if (rest != nullptr) {
+			rest->nb_segs = this->nb_segs - 1;
+			rest->pkt_len = this->pkt_len - this->data_len;
+			this->next = nullptr;
+			this->nb_segs = 1;
+			this->pkt_len = this->data_len;
+		}
+		return rest;
+	};
+
+	/*! Remove bytes from the front of a single buffer (as rte_pktmbuf_adj())
+	 *
+	 * \param len Number of bytes to remove, at most getDataLen()
+	 */
+	void cutFront(uint16_t len) {
+		this->data_off += len;
+		this->data_len -= len;
+		this->pkt_len -= len;
+	};
+
+	/*! Store the header lengths (see PktParser)
+	 * These are the same fields the NIC uses for TX offloading
+	 */
+	void setHeaderLens(uint16_t l2Len, uint16_t l3Len, uint16_t l4Len) {
+		this->l2_len = l2Len;
+		this->l3_len = l3Len;
+		this->l4_len = l4Len;
+	};
+	uint16_t getL2Len() { return this->l2_len; };
+	uint16_t getL3Len() { return this->l3_len; };
+	uint16_t getL4Len() { return this->l4_len; };
+
+	/*! Get the RSS hash calculated by the NIC
+	 *
+	 * \param hash The hash is written here, if it is available
+	 * \return True, if the NIC provided a hash
+	 */
+	bool getRssHash(uint32_t &hash) {
+		if (this->ol_flags & PKT_RX_RSS_HASH) {
+			hash = this->hash.rss;
+			return true;
+		}
+		return false;
+	};
 };
 
 #endif /* MBUF_HPP */
@@ -0,0 +1,218 @@
+#ifndef MBUFBIO_HPP
+#define MBUFBIO_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <openssl/bio.h>
+
+#include "headers.hpp"
+#include "mbuf.hpp"
+
+/*! A datagram BIO for OpenSSL, reading and writing packet buffers directly
+ *
+ * A queue BIO (as memQ) costs two copies per datagram and direction: one into
+ * the queue and one out of it. This BIO lets OpenSSL read the received
+ * datagram right from its packet, and writes every datagram of OpenSSL
+ * right into a packet to send. OpenSSL copies the datagrams from and to its
+ * own record buffers, these are the only copies left.
+ *
+ * Use one BIO for both directions of an SSL object, and bind the packets
+ * around every call into OpenSSL:
+ * - setInput() hands over the received datagram. It is only valid during the
+ *   current call, a datagram OpenSSL does not read until finish() is dropped
+ * - setOutput() sets, where datagrams are written to. The received packet is
+ *   reused for the first datagram, if OpenSSL read it before
+ * - finish() returns the written packets, the caller fills in their headers
+ */
+class MbufBio {
+public:
+	//! Offset of the datagrams in packets without VLAN tags and IPv4 options
+	static constexpr uint16_t defaultOffset =
+		sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Udp);
+
+	//! Get another packet to write a datagram to, the packet is sent by the caller
+	using AllocFun = mbuf *(*)(void *arg);
+
+	//! Bytes copied by the BIOs of a core
+	struct Stats {
+		uint64_t bytesRead;
+		uint64_t bytesWritten;
+	};
+
+private:
+	struct Data {
+		const uint8_t *in = nullptr;
+		int inLen = 0;
+
+		mbuf *reuse = nullptr;
+		bool reuseAllowed = false;
+		uint16_t offset = defaultOffset;
+		AllocFun alloc = nullptr;
+		void *allocArg = nullptr;
+		std::vector<mbuf *> out;
+	};
+
+	static Data *getData(BIO *bio) { return reinterpret_cast<Data *>(BIO_get_data(bio)); }
+
+	static int bioRead(BIO *bio, char *buf, int len) {
+		Data *d = getData(bio);
+		BIO_clear_retry_flags(bio);
+		if (d->inLen == 0) {
+			BIO_set_retry_read(bio);
+			return -1;
+		}
+
+		// A datagram is read at once, what does not fit is lost
+		int ret = std::min(len, d->inLen);
+		memcpy(buf, d->in, ret);
+		d->in = nullptr;
+		d->inLen = 0;
+		getStats().bytesRead += ret;
+		return ret;
+	}
+
+	static int bioWrite(BIO *bio, const char *buf, int len) {
+		Data *d = getData(bio);
+		BIO_clear_retry_flags(bio);
+
+		// Datagrams are sent without fragmentation
+		if (len > 1500 - d->offset) {
+			return -1;
+		}
+
+		// The received packet is free, once OpenSSL read it
+		mbuf *pkt = nullptr;
+		if (d->reuseAllowed && (d->inLen == 0)) {
+			pkt = d->reuse;
+		} else if (d->alloc != nullptr) {
+			pkt = d->alloc(d->allocArg);
+		}
+		// Later datagrams must not overtake the earlier ones
+		d->reuseAllowed = false;
+		if ((pkt == nullptr) || (d->offset + len > pkt->getBufLen() - pkt->data_off)) {
+			return -1;
+		}
+
+		memcpy(reinterpret_cast<uint8_t *>(pkt->getData()) + d->offset, buf, len);
+		pkt->setDataLen(d->offset + len);
+		d->out.push_back(pkt);
+		getStats().bytesWritten += len;
+		return len;
+	}
+
+	static long bioCtrl(BIO *bio, int cmd, long num, void *ptr) {
+		(void)num;
+		(void)ptr;
+		Data *d = getData(bio);
+		switch (cmd) {
+		case BIO_CTRL_PENDING:
+			return d->inLen;
+		case BIO_CTRL_EOF:
+			return d->inLen == 0;
+		case BIO_CTRL_FLUSH:
+			return 1;
+		case BIO_CTRL_RESET:
+			d->in = nullptr;
+			d->inLen = 0;
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	static int bioCreate(BIO *bio) {
+		BIO_set_data(bio, new Data());
+		BIO_set_init(bio, 1);
+		return 1;
+	}
+
+	static int bioDestroy(BIO *bio) {
+		delete getData(bio);
+		BIO_set_data(bio, nullptr);
+		return 1;
+	}
+
+	static BIO_METHOD *createMethod() {
+		BIO_METHOD *m =
+			BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK, "MoonState mbuf");
+		if (m == nullptr) {
+			throw new std::runtime_error("MbufBio::createMethod() BIO_meth_new() failed");
+		}
+		BIO_meth_set_read(m, bioRead);
+		BIO_meth_set_write(m, bioWrite);
+		BIO_meth_set_ctrl(m, bioCtrl);
+		BIO_meth_set_create(m, bioCreate);
+		BIO_meth_set_destroy(m, bioDestroy);
+		return m;
+	}
+
+public:
+	/*! Create a BIO
+	 *
+	 * \return The BIO, give it to SSL_set_bio() for both directions
+	 */
+	static BIO *create() {
+		// All cores share the method
+		static BIO_METHOD *method = createMethod();
+		return BIO_new(method);
+	}
+
+	/*! Get the statistics of the calling core */
+	static Stats &getStats() {
+		static thread_local Stats stats = {0, 0};
+		return stats;
+	}
+
+	/*! Hand over the received datagram
+	 *
+	 * \param bio The BIO
+	 * \param data The datagram, it is not copied
+	 * \param len Length of the datagram
+	 */
+	static void setInput(BIO *bio, const void *data, int len) {
+		Data *d = getData(bio);
+		d->in = reinterpret_cast<const uint8_t *>(data);
+		d->inLen = len;
+	}
+
+	/*! Set where datagrams are written to
+	 *
+	 * \param bio The BIO
+	 * \param reuse The received packet, it is used for the first datagram if possible
+	 * \param offset Offset of the datagram in the packets
+	 * \param alloc Gets more packets, writing fails without it once reuse is used
+	 * \param allocArg Argument to alloc
+	 */
+	static void setOutput(BIO *bio, mbuf *reuse, uint16_t offset, AllocFun alloc = nullptr,
+		void *allocArg = nullptr) {
+		Data *d = getData(bio);
+		d->reuse = reuse;
+		d->reuseAllowed = reuse != nullptr;
+		d->offset = offset;
+		d->alloc = alloc;
+		d->allocArg = allocArg;
+		d->out.clear();
+	}
+
+	/*! Get the written packets, and drop the packets bound to the BIO
+	 *
+	 * \param bio The BIO
+	 * \return The packets with one datagram each, valid until the next setOutput().
+	 * 		Only the data length of the packets is set.
+	 */
+	static const std::vector<mbuf *> &finish(BIO *bio) {
+		Data *d = getData(bio);
+		d->in = nullptr;
+		d->inLen = 0;
+		d->reuse = nullptr;
+		d->reuseAllowed = false;
+		d->alloc = nullptr;
+		return d->out;
+	}
+};
+
+#endif /* MBUFBIO_HPP */
@@ -0,0 +1,226 @@
+#ifndef PKTPARSER_HPP
+#define PKTPARSER_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "headers.hpp"
+
+/*! Parse-once layer for Ethernet/IP/L4 headers
+ *
+ * parse() walks the headers of a packet exactly once, and stores the lengths
+ * of the L2, L3 and L4 headers in the packet itself.
+ * Identifiers call it in identify(), state functions then use the accessors
+ * below, instead of parsing the headers again.
+ *
+ * Supported are:
+ * - Up to maxVlanTags 802.1Q/802.1ad (QinQ) tags
+ * - IPv4 with options (IHL > 5)
+ * - IPv6 with up to maxIPv6ExtHeaders extension headers
+ * - TCP (including options) and UDP
+ *
+ * The packet needs to expose the following functions in addition to the
+ * ones required by the StateMachine:
+ * \code{.cpp}
+ * void setHeaderLens(uint16_t l2Len, uint16_t l3Len, uint16_t l4Len);
+ * uint16_t getL2Len();
+ * uint16_t getL3Len();
+ * uint16_t getL4Len();
+ * \endcode
+ */
+namespace PktParser {
+
+static constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+static constexpr uint16_t ETHERTYPE_QINQ = 0x88a8;
+static constexpr uint16_t ETHERTYPE_QINQ_OLD = 0x9100;
+
+static constexpr unsigned int maxVlanTags = 2;
+static constexpr unsigned int maxIPv6ExtHeaders = 4;
+
+// rte_mbuf::l3_len only has 9 bits
+static constexpr uint16_t maxL3Len = 511;
+
+/*! Result of the parsing process */
+struct Result {
+	uint16_t ethertype; //!< Ethertype of the L3 header (host byte order)
+	uint8_t proto;		//!< L4 protocol
+};
+
+inline uint16_t read16(const uint8_t *p) {
+	uint16_t ret;
+	memcpy(&ret, p, sizeof(ret));
+	return ntohs(ret);
+}
+
+/*! Skip the IPv6 extension headers and find the L4 header
+ *
+ * \param l3Payload First byte after the IPv6 header
+ * \param nextHeader Next header field of the IPv6 header
+ * \param end First byte after the packet
+ * \param proto The L4 protocol is written here
+ * \return Pointer to the L4 header, nullptr if it could not be found
+ */
+inline uint8_t *skipIPv6Ext(
+	uint8_t *l3Payload, uint8_t nextHeader, uint8_t *end, uint8_t &proto) {
+	uint8_t *cur = l3Payload;
+	for (unsigned int i = 0; i < maxIPv6ExtHeaders; i++) {
+		if (!Headers::IPv6Ext::isSkippable(nextHeader)) {
+			proto = nextHeader;
+			return cur;
+		}
+
+		if (cur + sizeof(Headers::IPv6Ext) > end) {
+			return nullptr;
+		}
+
+		auto ext = reinterpret_cast<Headers::IPv6Ext *>(cur);
+
+		// Only the first fragment carries the L4 header
+		if ((nextHeader == Headers::IPv6::EXT_FRAGMENT) &&
+			(ext->getFragmentOffset() != 0)) {
+			return nullptr;
+		}
+
+		uint8_t type = nextHeader;
+		nextHeader = ext->nextHeader;
+		cur += ext->getLength(type);
+	}
+
+	if (Headers::IPv6Ext::isSkippable(nextHeader)) {
+		return nullptr;
+	}
+	proto = nextHeader;
+	return cur;
+}
+
+/*! Parse the headers of a packet and store their lengths in the packet
+ *
+ * \param pkt The packet to parse
+ * \param res Ethertype and L4 protocol are written here
+ * \return False, if the packet could not be parsed
+ */
+template <class Packet> bool parse(Packet *pkt, Result &res) {
+	uint8_t *data = reinterpret_cast<uint8_t *>(pkt->getData());
+	uint8_t *end = data + pkt->getDataLen();
+
+	// Ethernet + VLAN tags
+	uint16_t l2Len = sizeof(Headers::Ethernet);
+	if (data + l2Len > end) {
+		return false;
+	}
+	uint16_t ethertype = read16(data + l2Len - 2);
+	for (unsigned int i = 0; i < maxVlanTags; i++) {
+		if ((ethertype != ETHERTYPE_VLAN) && (ethertype != ETHERTYPE_QINQ) &&
+			(ethertype != ETHERTYPE_QINQ_OLD)) {
+			break;
+		}
+		l2Len += 4;
+		if (data + l2Len > end) {
+			return false;
+		}
+		ethertype = read16(data + l2Len - 2);
+	}
+
+	// IPv4 or IPv6
+	uint8_t *l3 = data + l2Len;
+	uint8_t *l4;
+	uint8_t proto;
+
+	if (ethertype == Headers::Ethernet::ETHERTYPE_IPv4) {
+		auto ip = reinterpret_cast<Headers::IPv4 *>(l3);
+		if ((l3 + sizeof(Headers::IPv4) > end) || (ip->ihl() < 5)) {
+			return false;
+		}
+
+		// Only the first fragment carries the L4 header
+		if ((ntohs(ip->flags_fragmentation) & 0x1fff) != 0) {
+			return false;
+		}
+
+		proto = ip->proto;
+		l4 = reinterpret_cast<uint8_t *>(ip->getPayload());
+	} else if (ethertype == Headers::Ethernet::ETHERTYPE_IPv6) {
+		auto ip = reinterpret_cast<Headers::IPv6 *>(l3);
+		if (l3 + sizeof(Headers::IPv6) > end) {
+			return false;
+		}
+
+		l4 = skipIPv6Ext(
+			reinterpret_cast<uint8_t *>(ip->getPayload()), ip->nextHeader, end, proto);
+		if (l4 == nullptr) {
+			return false;
+		}
+	} else {
+		return false;
+	}
+
+	if ((l4 > end) || (l4 - l3 > maxL3Len)) {
+		return false;
+	}
+
+	// TCP or UDP
+	uint16_t l4Len = 0;
+	if (proto == Headers::IPv4::PROTO_TCP) {
+		auto tcp = reinterpret_cast<Headers::Tcp *>(l4);
+		if ((l4 + sizeof(Headers::Tcp) > end) || (tcp->getHeaderLen() < sizeof(Headers::Tcp)) ||
+			(l4 + tcp->getHeaderLen() > end)) {
+			return false;
+		}
+		l4Len = tcp->getHeaderLen();
+	} else if (proto == Headers::IPv4::PROTO_UDP) {
+		if (l4 + sizeof(Headers::Udp) > end) {
+			return false;
+		}
+		l4Len = sizeof(Headers::Udp);
+	}
+
+	pkt->setHeaderLens(l2Len, l4 - l3, l4Len);
+
+	res.ethertype = ethertype;
+	res.proto = proto;
+	return true;
+}
+
+/*! Get the L3 header of a parsed packet */
+template <class Packet> uint8_t *getL3(Packet *pkt) {
+	return reinterpret_cast<uint8_t *>(pkt->getData()) + pkt->getL2Len();
+}
+
+/*! Get the L4 header of a parsed packet */
+template <class Packet> uint8_t *getL4(Packet *pkt) {
+	return getL3(pkt) + pkt->getL3Len();
+}
+
+/*! Get the L4 payload of a parsed packet */
+template <class Packet> uint8_t *getPayload(Packet *pkt) {
+	return getL4(pkt) + pkt->getL4Len();
+}
+
+/*! Get the length of all headers (L2 to L4) of a parsed packet */
+template <class Packet> uint16_t getHeadersLen(Packet *pkt) {
+	return pkt->getL2Len() + pkt->getL3Len() + pkt->getL4Len();
+}
+
+/*! Get the IPv4 header of a parsed packet */
+template <class Packet> Headers::IPv4 *getIPv4(Packet *pkt) {
+	return reinterpret_cast<Headers::IPv4 *>(getL3(pkt));
+}
+
+/*! Get the IPv6 header of a parsed packet */
+template <class Packet> Headers::IPv6 *getIPv6(Packet *pkt) {
+	return reinterpret_cast<Headers::IPv6 *>(getL3(pkt));
+}
+
+/*! Get the TCP header of a parsed packet */
+template <class Packet> Headers::Tcp *getTcp(Packet *pkt) {
+	return reinterpret_cast<Headers::Tcp *>(getL4(pkt));
+}
+
+/*! Get the UDP header of a parsed packet */
+template <class Packet> Headers::Udp *getUdp(Packet *pkt) {
+	return reinterpret_cast<Headers::Udp *>(getL4(pkt));
+}
+
+}; // namespace PktParser
+
+#endif /* PKTPARSER_HPP */
@@ -0,0 +1,95 @@
+#ifndef REPLYHEADERS_HPP
+#define REPLYHEADERS_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "checksum.hpp"
+#include "headers.hpp"
+#include "pktParser.hpp"
+
+/*! Turn received packets into replies, a batch at a time
+ *
+ * Reflecting protocols answer a packet in the same buffer. Their state
+ * functions only rewrite the payload and mark the packet (see
+ * StateMachine::FunIface::replyInPlace()). At the end of the batch, the
+ * StateMachine rewrites the headers of all marked packets at once:
+ * - The IPv4 addresses and the L4 ports (of TCP or UDP) are swapped
+ * - The TTL is set to ttl, the IPv4 checksum is updated for it (RFC 1624)
+ *
+ * Swapping 16 bit words does not change any checksum, the L4 checksum only
+ * has to be updated for the rewritten payload.
+ * The Ethernet addresses are left alone, as the MoonGen scripts set them.
+ *
+ * VLAN tags are skipped as in PktParser, packets other than IPv4 are not touched.
+ */
+class ReplyHeaders {
+public:
+	//! TTL of the replies
+	static constexpr uint8_t ttl = 64;
+
+	/*! Rewrite the headers of a batch of packets
+	 *
+	 * \param pkts The packets to turn into replies
+	 * \param num Number of packets
+	 */
+	template <class Packet> static void rewrite(Packet **pkts, uint32_t num) {
+		// The state functions just touched the packets, their headers are still cached
+		for (uint32_t i = 0; i < num; i++) {
+			rewriteOne(reinterpret_cast<uint8_t *>(pkts[i]->getData()));
+		}
+	}
+
+private:
+	static void rewriteOne(uint8_t *data) {
+		// Skip VLAN tags as PktParser does, untagged IPv4 is checked first
+		uint16_t l2Len = sizeof(Headers::Ethernet);
+		uint16_t ethertype = PktParser::read16(data + l2Len - 2);
+		for (unsigned int i = 0;
+			 (ethertype != Headers::Ethernet::ETHERTYPE_IPv4) && (i < PktParser::maxVlanTags); i++) {
+			if ((ethertype != PktParser::ETHERTYPE_VLAN) &&
+				(ethertype != PktParser::ETHERTYPE_QINQ) &&
+				(ethertype != PktParser::ETHERTYPE_QINQ_OLD)) {
+				break;
+			}
+			l2Len += 4;
+			ethertype = PktParser::read16(data + l2Len - 2);
+		}
+		if (ethertype != Headers::Ethernet::ETHERTYPE_IPv4) {
+			return;
+		}
+
+		auto ipv4 = reinterpret_cast<Headers::IPv4 *>(data + l2Len);
+
+#ifdef __SSSE3__
+		// Addresses and ports are adjacent without IPv4 options, one shuffle swaps them all
+		if (ipv4->ihl() == 5) {
+			uint8_t *addrs = reinterpret_cast<uint8_t *>(&ipv4->srcIP);
+			const __m128i swap =
+				_mm_setr_epi8(4, 5, 6, 7, 0, 1, 2, 3, 10, 11, 8, 9, 12, 13, 14, 15);
+			__m128i fields = _mm_loadu_si128(reinterpret_cast<const __m128i *>(addrs));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(addrs), _mm_shuffle_epi8(fields, swap));
+			Checksum::setTtl(ipv4, ttl);
+			return;
+		}
+#endif
+
+		uint32_t tmp = ipv4->srcIP;
+		ipv4->srcIP = ipv4->dstIP;
+		ipv4->dstIP = tmp;
+
+		// TCP and UDP both start with the source and destination port
+		uint16_t *ports = reinterpret_cast<uint16_t *>(ipv4->getPayload());
+		uint16_t tmp16 = ports[0];
+		ports[0] = ports[1];
+		ports[1] = tmp16;
+
+		Checksum::setTtl(ipv4, ttl);
+	}
+};
+
+#endif /* REPLYHEADERS_HPP */
@@ -13,16 +13,31 @@ class SamplePacket {
 private:
 	void *data;
 	uint16_t dataLen;
+	uint16_t l2Len;
+	uint16_t l3Len;
+	uint16_t l4Len;
 
 public:
-	SamplePacket(const SamplePacket &p) : data(p.data), dataLen(p.dataLen){};
-	SamplePacket() : data(nullptr), dataLen(0){};
-	SamplePacket(void *data, uint16_t dataLen) : data(data), dataLen(dataLen){};
+	SamplePacket(const SamplePacket &p)
+		: data(p.data), dataLen(p.dataLen), l2Len(p.l2Len), l3Len(p.l3Len), l4Len(p.l4Len){};
+	SamplePacket() : data(nullptr), dataLen(0), l2Len(0), l3Len(0), l4Len(0){};
+	SamplePacket(void *data, uint16_t dataLen)
+		: data(data), dataLen(dataLen), l2Len(0), l3Len(0), l4Len(0){};
 	~SamplePacket() { free(data); }
 
 	void *getData() { return data; };
 	uint16_t getDataLen() { return dataLen; };
 	void setDataLen(uint16_t l) { dataLen = l; };
+
+	// Header lengths, these are filled by PktParser::parse()
+	void setHeaderLens(uint16_t l2, uint16_t l3, uint16_t l4) {
+		l2Len = l2;
+		l3Len = l3;
+		l4Len = l4;
+	};
+	uint16_t getL2Len() { return l2Len; };
+	uint16_t getL3Len() { return l3Len; };
+	uint16_t getL4Len() { return l4Len; };
 };
 
 #endif /* SAMPLE_PACKET_HPP */
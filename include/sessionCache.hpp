@@ -0,0 +1,154 @@
+#ifndef SESSIONCACHE_HPP
+#define SESSIONCACHE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <openssl/ssl.h>
+
+/*! Cache of SSL sessions by their session ID, bounded in size and age
+ *
+ * OpenSSL keeps its session cache in the SSL_CTX, all cores share it behind
+ * a lock. Instead, every core gets a cache of its own, set the callbacks of
+ * SSL_CTX_sess_set_new_cb() and friends to it. A client resuming on another
+ * core misses the cache, session tickets do not have this problem.
+ *
+ * All sessions live equally long, so the oldest session is always the first
+ * to expire. It is evicted as well, if the cache is full.
+ *
+ * A cache is not thread safe.
+ */
+class SessionCache {
+public:
+	using time_point = std::chrono::steady_clock::time_point;
+
+private:
+	struct Entry {
+		SSL_SESSION *sess;
+		time_point expires;
+	};
+
+	// Session IDs, oldest first
+	std::list<std::string> order;
+	std::unordered_map<std::string, std::pair<Entry, std::list<std::string>::iterator>> sessions;
+
+	size_t maxSize;
+	std::chrono::seconds ttl;
+
+	static std::string getKey(const unsigned char *id, unsigned int len) {
+		return std::string(reinterpret_cast<const char *>(id), len);
+	}
+
+	void erase(const std::string &key) {
+		auto it = sessions.find(key);
+		if (it == sessions.end()) {
+			return;
+		}
+		SSL_SESSION_free(it->second.first.sess);
+		order.erase(it->second.second);
+		sessions.erase(it);
+	}
+
+	void expire(time_point now) {
+		while (!order.empty() && (sessions.at(order.front()).first.expires <= now)) {
+			erase(order.front());
+		}
+	}
+
+public:
+	/*!
+	 * \param maxSize Maximum number of sessions, 0 disables the cache
+	 * \param ttl Time after which a session is removed
+	 */
+	SessionCache(size_t maxSize, std::chrono::seconds ttl) : maxSize(maxSize), ttl(ttl){};
+
+	~SessionCache() { resize(0); };
+
+	SessionCache(const SessionCache &) = delete;
+	SessionCache &operator=(const SessionCache &) = delete;
+
+	/*! Add a new session
+	 *
+	 * \param sess The session, the cache takes over the reference on success
+	 * \param now Current time
+	 * \return True, if the session was added
+	 */
+	bool add(SSL_SESSION *sess, time_point now) {
+		if (maxSize == 0) {
+			return false;
+		}
+
+		unsigned int len;
+		const unsigned char *id = SSL_SESSION_get_id(sess, &len);
+		if (len == 0) {
+			return false;
+		}
+		std::string key = getKey(id, len);
+
+		expire(now);
+		erase(key);
+		while (sessions.size() >= maxSize) {
+			erase(order.front());
+		}
+
+		order.push_back(key);
+		sessions[key] = {{sess, now + ttl}, std::prev(order.end())};
+		return true;
+	}
+
+	/*! Look a session up
+	 *
+	 * \param id The session ID
+	 * \param len Length of the session ID
+	 * \param now Current time
+	 * \return The session, nullptr if it is unknown or expired. The cache keeps
+	 * 		its reference.
+	 */
+	SSL_SESSION *get(const unsigned char *id, unsigned int len, time_point now) {
+		expire(now);
+		auto it = sessions.find(getKey(id, len));
+		if (it == sessions.end()) {
+			return nullptr;
+		}
+		return it->second.first.sess;
+	}
+
+	/*! Remove a session, OpenSSL does not want to resume it anymore
+	 *
+	 * \param sess The session
+	 */
+	void remove(SSL_SESSION *sess) {
+		unsigned int len;
+		const unsigned char *id = SSL_SESSION_get_id(sess, &len);
+		erase(getKey(id, len));
+	}
+
+	/*! Set the limits of the cache
+	 *
+	 * \param size Maximum number of sessions, 0 disables the cache
+	 * \param ttl Time after which a session is removed, applies to new sessions
+	 */
+	void resize(size_t size, std::chrono::seconds ttl) {
+		this->ttl = ttl;
+		resize(size);
+	}
+
+	/*! Set the maximum number of sessions
+	 *
+	 * \param size Maximum number of sessions, 0 disables the cache
+	 */
+	void resize(size_t size) {
+		maxSize = size;
+		while (sessions.size() > maxSize) {
+			erase(order.front());
+		}
+	}
+
+	/*! Get the number of sessions in the cache */
+	size_t size() const { return sessions.size(); }
+};
+
+#endif /* SESSIONCACHE_HPP */
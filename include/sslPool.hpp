@@ -0,0 +1,147 @@
+#ifndef SSLPOOL_HPP
+#define SSLPOOL_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <openssl/bio.h>
+#include <openssl/ssl.h>
+
+#include "mbufBio.hpp"
+
+/*! Pool of SSL objects with their BIOs (see MbufBio)
+ *
+ * Creating an SSL object and its BIOs costs several allocations and some
+ * initialization in OpenSSL, for every connection. The pool keeps the objects
+ * of closed connections instead, and resets them with SSL_clear().
+ * The buffers OpenSSL allocated for the last connection are kept as well.
+ *
+ * A pool is not thread safe, every core needs one of its own.
+ */
+class SslPool {
+public:
+	//! MTU of every SSL object
+	static constexpr long mtu = 1280;
+
+	//! An SSL object, together with the BIO it owns (for both directions)
+	struct Bundle {
+		SSL *ssl;
+		BIO *bio;
+	};
+
+private:
+	SSL_CTX *ctx;
+	std::vector<Bundle> bundles;
+	size_t maxSize;
+	uint64_t created = 0;
+
+	Bundle create() {
+		if (ctx == nullptr) {
+			throw new std::runtime_error("SslPool::create() no context set");
+		}
+
+		Bundle b;
+		b.ssl = SSL_new(ctx);
+		b.bio = MbufBio::create();
+		if ((b.ssl == nullptr) || (b.bio == nullptr)) {
+			throw new std::runtime_error("SslPool::create() cannot create SSL object");
+		}
+
+		// Make sure openSSL knows, it is a server
+		SSL_set_accept_state(b.ssl);
+		SSL_set_bio(b.ssl, b.bio, b.bio);
+
+		// Set the MTU manually, 1280 is too short, but it should always work
+		SSL_set_mtu(b.ssl, mtu);
+
+		created++;
+		return b;
+	}
+
+public:
+	/*!
+	 * \param ctx Context to create the SSL objects with
+	 * \param maxSize Maximum number of pooled objects, see resize()
+	 */
+	SslPool(SSL_CTX *ctx, size_t maxSize) : ctx(ctx), maxSize(maxSize){};
+
+	~SslPool() { resize(0); };
+
+	SslPool(const SslPool &) = delete;
+	SslPool &operator=(const SslPool &) = delete;
+
+	/*! Create the SSL objects with another context from now on
+	 *
+	 * The pooled objects hold a reference to the old context, they are freed.
+	 * Objects given out by get() must not be put() back anymore.
+	 *
+	 * \param newCtx The context, nullptr until the next setCtx()
+	 */
+	void setCtx(SSL_CTX *newCtx) {
+		size_t size = maxSize;
+		resize(0);
+		ctx = newCtx;
+		if (ctx != nullptr) {
+			resize(size);
+		}
+	}
+
+	/*! Get an SSL object in accept state, with its BIOs
+	 *
+	 * A new one is created, if the pool is empty.
+	 *
+	 * \return The SSL object, give it back with put()
+	 */
+	Bundle get() {
+		if (bundles.empty()) {
+			return create();
+		}
+		Bundle b = bundles.back();
+		bundles.pop_back();
+		return b;
+	}
+
+	/*! Give an SSL object back
+	 *
+	 * The object is reset for the next connection, or freed if the pool is full.
+	 *
+	 * \param b The SSL object, the caller must not use it anymore
+	 */
+	void put(Bundle b) {
+		if ((bundles.size() >= maxSize) || (SSL_clear(b.ssl) != 1)) {
+			SSL_free(b.ssl);
+			return;
+		}
+
+		// Nothing of the last connection must be left over, SSL_clear() drops the MTU
+		SSL_set_app_data(b.ssl, nullptr);
+		SSL_clear_options(b.ssl, SSL_OP_COOKIE_EXCHANGE);
+		SSL_set_accept_state(b.ssl);
+		SSL_set_mtu(b.ssl, mtu);
+		(void)BIO_reset(b.bio);
+
+		bundles.push_back(b);
+	}
+
+	/*! Set the maximum size of the pool, and fill it up
+	 *
+	 * \param size Number of objects to keep, 0 disables the pool
+	 */
+	void resize(size_t size) {
+		maxSize = size;
+		while (bundles.size() > maxSize) {
+			SSL_free(bundles.back().ssl);
+			bundles.pop_back();
+		}
+		bundles.reserve(maxSize);
+		while (bundles.size() < maxSize) {
+			bundles.push_back(create());
+		}
+	}
+
+	/*! Get the number of SSL objects this pool created so far */
+	uint64_t getCreated() const { return created; }
+};
+
+#endif /* SSLPOOL_HPP */
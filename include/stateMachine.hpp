@@ -1,6 +1,8 @@
 #ifndef STATE_MACHINE_HPP
 #define STATE_MACHINE_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cstdint>
@@ -11,16 +13,20 @@
 #include <mutex>
 #include <queue>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 #include <sparsehash/dense_hash_map>
 #include <tbb/concurrent_hash_map.h>
 
+#include "asyncPool.hpp"
 #include "bufArray.hpp"
 #include "common.hpp"
+#include "concurrentqueue.h"
 #include "exceptions.hpp"
 #include "measure.hpp"
+#include "replyHeaders.hpp"
 #include "spinlock.hpp"
 
 /*! State machine framework
@@ -72,6 +78,7 @@ private:
 	using ConnectionID = typename Identifier::ConnectionID;
 	using Hasher = typename Identifier::Hasher;
 	static constexpr auto timeoutIDInvalid = std::numeric_limits<uint32_t>::max();
+	static constexpr auto pktIdxInvalid = std::numeric_limits<uint32_t>::max();
 
 public:
 	/*
@@ -89,6 +96,19 @@ public:
 	/*! This is the signature any timeout function needs to expose */
 	using timeoutFun = std::function<void(State &, FunIface &)>;
 
+	/*! This is the signature of a job of a parked connection, see FunIface::runAsync() */
+	using asyncJob = std::function<void()>;
+
+	/*! What to do with a packet of an unknown connection, see registerPreAcceptFunction() */
+	enum class PreAccept {
+		accept, //!< Create a state and run the function of the start state
+		reply,  //!< The packet was rewritten in place, send it
+		drop    //!< Drop the packet
+	};
+
+	/*! This is the signature any pre-accept function needs to expose */
+	using preAcceptFun = std::function<PreAccept(ConnectionID, Packet *)>;
+
 	/*! Represents an invalid StateID */
 	static constexpr auto StateIDInvalid = std::numeric_limits<StateID>::max();
 
@@ -102,17 +122,23 @@ public:
 		void *stateData;
 		StateID state;
 		uint32_t timeoutID;
+		// A job of the connection runs, see FunIface::runAsync()
+		bool parked;
 
-		State() : stateData(nullptr), state(StateIDInvalid), timeoutID(timeoutIDInvalid){};
+		State()
+			: stateData(nullptr), state(StateIDInvalid), timeoutID(timeoutIDInvalid),
+			  parked(false){};
 		State(StateID state, void *stateData)
-			: stateData(stateData), state(state), timeoutID(timeoutIDInvalid){};
+			: stateData(stateData), state(state), timeoutID(timeoutIDInvalid), parked(false){};
 		State(const State &s)
-			: stateData(s.stateData), state(s.state), timeoutID(s.timeoutID){};
+			: stateData(s.stateData), state(s.state), timeoutID(s.timeoutID),
+			  parked(s.parked){};
 
 		void set(const State &s) {
 			stateData = s.stateData;
 			state = s.state;
 			timeoutID = s.timeoutID;
+			parked = s.parked;
 		}
 	};
 
@@ -135,16 +161,29 @@ public:
 		State &state;
 		bool sendPkt;
 		bool immediateTransition;
+		bool replied;
+		asyncJob job;
 
 		// Private -> nobody can misuse any FunIface objects
 		FunIface(StateMachine<Identifier, Packet> *sm, uint32_t pktIdx,
 			BufArray<Packet> &pktsBA, ConnectionID &cID, State &state)
 			: sm(sm), pktIdx(pktIdx), pktsBA(pktsBA), cID(cID), state(state), sendPkt(true),
-			  immediateTransition(false){};
+			  immediateTransition(false), replied(false){};
 
 	public:
 		~FunIface() {
-			if (!sendPkt) {
+			// The job starts, once the state function is done with the state data
+			if (job) {
+				assert(!immediateTransition);
+				pktsBA.markKeepPkt(pktIdx);
+				sm->submitJob(cID, std::move(job));
+				return;
+			}
+
+			// Timeout functions are not called for a packet
+			if (pktIdx == pktIdxInvalid) {
+				// Nothing to mark
+			} else if (!sendPkt) {
 				pktsBA.markDropPkt(pktIdx);
 			} else {
 				pktsBA.markSendPkt(pktIdx);
@@ -180,6 +219,7 @@ public:
 					DEBUG_ENABLED(
 						std::cout << "Reached endStateID - deleting connection" << std::endl;)
 					sm->removeState(cID);
+					sm->stat_statesClosed++;
 				}
 			}
 		}
@@ -187,7 +227,47 @@ public:
 		/*! Free the packet after the batch is processed, do not send it */
 		void freePkt() { sendPkt = false; }
 
+		/*! Send the current packet back as a reply
+		 *
+		 * The addresses and ports are swapped, and the TTL is reset, for all
+		 * marked packets at the end of the batch (see ReplyHeaders).
+		 * Until then, the headers are the ones received, the state function only
+		 * rewrites the payload (and updates the L4 checksum for it).
+		 * Calling it again for the same packet has no effect, the headers are
+		 * swapped only once.
+		 */
+		void replyInPlace() {
+			assert(pktIdx != pktIdxInvalid);
+			if (replied) {
+				return;
+			}
+			replied = true;
+			sm->replyPkts.push_back(pktsBA[pktIdx]);
+		}
+
+		/*! Get the ConnectionID of the current packet
+		 *
+		 * This is the ID as returned by Identifier::identify() for the current packet,
+		 * not the one stored in the state table.
+		 * Symmetric identifiers use this to tell the direction of the packet.
+		 *
+		 * \return ConnectionID of the current packet
+		 */
+		const ConnectionID &getConnectionID() const { return cID; }
+
+		/*! Get the number of the current batch
+		 *
+		 * Packets added with getPkt() are sent after all packets of the batch.
+		 * State functions use this to tell, if they were already called for
+		 * the same batch, e.g. to keep the order of their packets.
+		 *
+		 * \return Number of the current batch, increases with every batch
+		 */
+		uint32_t getBatchID() const { return sm->curBatchID; }
+
 		/*! Get an additional packet buffer
+		 *
+		 * Timeout functions use this to send packets, they have no current packet.
 		 *
 		 * \return The new packet buffer, this buffer will be sent
 		 */
@@ -198,6 +278,67 @@ public:
 			return ret;
 		}
 
+		/*! Get a packet buffer, which is not sent
+		 *
+		 * Other than getPkt(), the buffer is not added to the current batch.
+		 * The caller owns the buffer, and is responsible to free it.
+		 *
+		 * \return The new packet buffer
+		 */
+		Packet *allocPkt() {
+			assert(sm->getPktCB != nullptr);
+			return sm->getPktCB();
+		}
+
+		/*! Send a packet buffer with the current batch
+		 *
+		 * Use this for buffers from allocPkt(), or buffers a job of runAsync()
+		 * allocated. The state machine takes over the buffer.
+		 *
+		 * \param pkt The packet buffer to send
+		 */
+		void addPkt(Packet *pkt) { pktsBA.addPkt(pkt); }
+
+		/*! Check if runAsync() can be used
+		 *
+		 * \return True, if an AsyncPool is registered and there is a current packet
+		 */
+		bool canRunAsync() const {
+			return (sm->asyncPool != nullptr) && (pktIdx != pktIdxInvalid);
+		}
+
+		/*! Park the connection, and run a job on the AsyncPool
+		 *
+		 * The job runs on another thread, as soon as the state function returns.
+		 * Meanwhile, this core goes on with the other connections, the packets
+		 * of the parked connection are queued (the current one first).
+		 * In the first batch after the job is done, the queued packets are run
+		 * through the state functions again, in order.
+		 * Call transition() as well, the function of the new state gets the
+		 * current packet again and finishes what the job did.
+		 *
+		 * The job may only touch the state data of the connection, nothing else
+		 * does until the job is done. A timeout of the connection is cancelled.
+		 * Only connections in the state table can be parked, not the ones of
+		 * addState(). See registerAsyncPool().
+		 *
+		 * \param job The job to run, it must not use this FunIface
+		 */
+		void runAsync(asyncJob job) {
+			assert(sm->asyncPool != nullptr);
+			assert(pktIdx != pktIdxInvalid);
+			assert(job);
+
+			if (state.timeoutID != timeoutIDInvalid) {
+				sm->timeoutFunctions.erase(state.timeoutID);
+				state.timeoutID = timeoutIDInvalid;
+			}
+
+			state.parked = true;
+			sm->parkedPkts[cID].push_back(pktsBA[pktIdx]);
+			this->job = std::move(job);
+		}
+
 		/*! Transition to another state
 		 *
 		 * The new state will be used, as soon as the next packet for this
@@ -223,10 +364,21 @@ public:
 		}
 
 		/*! Set a timeout, after which a transition will happen
+		 * A connection has one timeout at most, an earlier one is cancelled.
+		 * Any packet of the connection cancels the timeout as well.
+		 * The timeout function runs with the next batch after the timeout,
+		 * an empty batch is fine. It may call getPkt() and setTimeout().
 		 * \param timeout Time in milliseconds, until timeout will occur
 		 * \param fun Function to execute, if timeout occurs
 		 */
 		void setTimeout(std::chrono::milliseconds timeout, timeoutFun fun) {
+			// The job of a parked connection owns the state data
+			assert(!state.parked);
+
+			if (state.timeoutID != timeoutIDInvalid) {
+				sm->timeoutFunctions.erase(state.timeoutID);
+			}
+
 			std::chrono::time_point<std::chrono::steady_clock> now =
 				std::chrono::steady_clock::now();
 			std::chrono::time_point<std::chrono::steady_clock> then = now + timeout;
@@ -251,6 +403,28 @@ public:
 			sm->timeoutFunctions.emplace(
 				t.timeoutID, std::make_unique<struct TimeoutData>(cID, fun));
 		}
+
+		/*! Set a timeout of any precision, it is rounded up to milliseconds
+		 * Timeouts, which are due already, run with the next batch.
+		 * \param timeout Time until timeout will occur
+		 * \param fun Function to execute, if timeout occurs
+		 */
+		template <class Rep, class Period>
+		void setTimeout(std::chrono::duration<Rep, Period> timeout, timeoutFun fun) {
+			auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(timeout);
+			if (ms < timeout) {
+				ms += std::chrono::milliseconds(1);
+			}
+			setTimeout(std::max(ms, std::chrono::milliseconds(0)), fun);
+		}
+
+		/*! Set a timeout, which occurs at a point in time (rounded up to milliseconds)
+		 * \param deadline Time, at which timeout will occur
+		 * \param fun Function to execute, if timeout occurs
+		 */
+		void setTimeout(std::chrono::steady_clock::time_point deadline, timeoutFun fun) {
+			setTimeout(deadline - std::chrono::steady_clock::now(), fun);
+		}
 	};
 
 	class ConnectionPool {
@@ -342,6 +516,10 @@ private:
 	// This is only useful, if listenToConnections is true
 	std::function<void *(ConnectionID)> startStateFun;
 
+	// This function decides, if a state is created for a new connection
+	// This is only useful, if listenToConnections is true
+	preAcceptFun preAcceptFunction;
+
 	// If a connection reaches this state, it gets destryed
 	StateID endStateID;
 
@@ -351,6 +529,27 @@ private:
 	// Basically: Server mode or client mode
 	bool listenToConnections;
 
+	// Packets of the current batch marked by FunIface::replyInPlace()
+	std::vector<Packet *> replyPkts;
+
+	/*
+	 * XXX -------------------------------------------- XXX
+	 *       Parked connections
+	 * XXX -------------------------------------------- XXX
+	 */
+
+	// The jobs of parked connections run here, see FunIface::runAsync()
+	AsyncPool *asyncPool = nullptr;
+
+	// The workers report the connections, whose jobs are done
+	moodycamel::ConcurrentQueue<ConnectionID> asyncDone;
+
+	// Number of jobs, which are not done yet
+	std::atomic<uint32_t> asyncRunning{0};
+
+	// The queued packets of the parked connections, in order
+	std::unordered_map<ConnectionID, std::vector<Packet *>, Hasher> parkedPkts;
+
 	/*
 	 * XXX -------------------------------------------- XXX
 	 *       Timeout handling
@@ -368,13 +567,16 @@ private:
 		// Make sure, that the nearest timeout is the first one in timeoutsQ (see below)
 		class Compare {
 		public:
-			bool operator()(struct Timeout a, struct Timeout b) { return a.time < b.time; };
+			bool operator()(struct Timeout a, struct Timeout b) { return a.time > b.time; };
 		};
 	};
 
 	// This increments for every timeout -> provides a unique ID
 	uint32_t curTimeoutID;
 
+	// This increments for every batch
+	uint32_t curBatchID;
+
 	// This contains all the timeouts
 	std::priority_queue<struct Timeout, std::vector<struct Timeout>,
 		typename Timeout::Compare>
@@ -427,7 +629,7 @@ private:
 	 * XXX -------------------------------------------- XXX
 	 */
 
-	auto findState(ConnectionID id) {
+	auto findState(ConnectionID id, Packet *pkt = nullptr, PreAccept *verdict = nullptr) {
 		DEBUG_ENABLED(std::cout << "StateMachine::findState() Searching for ConnectionID: "
 								<< static_cast<std::string>(id) << std::endl;)
 	findStateLoop:
@@ -452,6 +654,14 @@ private:
 					DEBUG_ENABLED(std::cout
 									  << "StateMachine::findState() found state in connPool"
 									  << std::endl;)
+					// A timeout set in addState() belongs to the StateMachine running it
+					if (st.timeoutID != timeoutIDInvalid) {
+						auto timeoutDataIt = timeoutFunctions.find(st.timeoutID);
+						if ((timeoutDataIt == timeoutFunctions.end()) ||
+							!(timeoutDataIt->second->id == id)) {
+							st.timeoutID = timeoutIDInvalid;
+						}
+					}
 					stateTable.insert({id, st});
 
 					stat_statesAdded++;
@@ -460,8 +670,22 @@ private:
 				}
 			}
 
-			// Maybe accept the new connection
-			if (listenToConnections) {
+			// Maybe accept the new connection, timeouts have no packet to accept
+			if (listenToConnections && (pkt != nullptr)) {
+				// The pre-accept function may answer the packet without any state
+				if (preAcceptFunction) {
+					PreAccept v = preAcceptFunction(id, pkt);
+					if (v != PreAccept::accept) {
+						DEBUG_ENABLED(std::cout << "StateMachine::findState() connection "
+													"not accepted (yet)"
+												<< std::endl;)
+						if (verdict != nullptr) {
+							*verdict = v;
+						}
+						return stateTable.end();
+					}
+				}
+
 				// Add new state
 				DEBUG_ENABLED(std::cout << "Adding new state" << std::endl;)
 				DEBUG_ENABLED(std::cout << "ConnectionID: " << static_cast<std::string>(id)
@@ -498,6 +722,33 @@ private:
 		return stateIt;
 	};
 
+	void submitJob(ConnectionID id, asyncJob job) {
+		asyncRunning++;
+		asyncPool->submit([this, id, job]() {
+			job();
+			asyncDone.enqueue(id);
+			asyncRunning--;
+		});
+	}
+
+	// The job of the connection is done, run its queued packets with the current batch
+	void resume(BufArray<Packet> &pktsIn, ConnectionID id) {
+		auto stateIt = stateTable.find(id);
+		assert(stateIt != stateTable.end());
+		stateIt->second.parked = false;
+
+		auto pktsIt = parkedPkts.find(id);
+		assert(pktsIt != parkedPkts.end());
+		std::vector<Packet *> pkts = std::move(pktsIt->second);
+		parkedPkts.erase(pktsIt);
+
+		// Any of the packets may park the connection again
+		for (Packet *pkt : pkts) {
+			pktsIn.addPkt(pkt);
+			runPkt(pktsIn, pktsIn.getTotalCount() - 1);
+		}
+	}
+
 	void runPkt(BufArray<Packet> &pktsIn, unsigned int cur) {
 		DEBUG_ENABLED(std::cout << std::endl << "StateMachine::runPkt() called" << std::endl;)
 
@@ -511,9 +762,15 @@ private:
 			ConnectionID identity = identifier.identify(pktIn);
 
 			// Find a state/connection associated with this packet
-			auto stateIt = findState(identity);
+			PreAccept verdict = PreAccept::drop;
+			auto stateIt = findState(identity, pktIn, &verdict);
 
 			if (stateIt == stateTable.end()) {
+				if (verdict == PreAccept::reply) {
+					// The pre-accept function answered the packet
+					return;
+				}
+
 				// We don't want this packet
 				DEBUG_ENABLED(
 					std::cout << "StateMachine::runPkt() discarding packet" << std::endl;)
@@ -523,6 +780,16 @@ private:
 				return;
 			}
 
+			// The packet waits for the job of the connection
+			if (stateIt->second.parked) {
+				DEBUG_ENABLED(
+					std::cout << "StateMachine::runPkt() queueing packet of parked connection"
+							  << std::endl;)
+				pktsIn.markKeepPkt(cur);
+				parkedPkts[identity].push_back(pktIn);
+				return;
+			}
+
 			// Invalidate any previous timeouts
 			if (stateIt->second.timeoutID != timeoutIDInvalid) {
 				this->timeoutFunctions.erase(stateIt->second.timeoutID);
@@ -589,12 +856,17 @@ public:
 
 	StateMachine()
 		: startStateID(0), endStateID(StateIDInvalid), listenToConnections(false),
-		  curTimeoutID(0), connPool(&connPoolStatic) {
+		  curTimeoutID(0), curBatchID(0), connPool(&connPoolStatic) {
 		stateTable.set_deleted_key(Identifier::getDelKey());
 		stateTable.set_empty_key(Identifier::getEmptyKey());
 	};
 
 	~StateMachine() {
+		// Jobs must not report to a destroyed state machine
+		while (asyncRunning > 0) {
+			std::this_thread::yield();
+		}
+
 		DEBUG_ENABLED(std::cout << "StateMachine stats:" << std::endl;
 					  std::cout << "stateTable.size() = " << stateTable.size() << std::endl;
 					  std::cout << "statesAdded  = " << stat_statesAdded << std::endl;
@@ -608,6 +880,25 @@ public:
 	 */
 	size_t getStateTableSize() { return stateTable.size(); };
 
+	/*! Get the number of connections created so far
+	 *
+	 * \return Number of connections
+	 */
+	uint64_t getStatesAdded() { return stat_statesAdded; };
+
+	/*! Get the number of connections, which reached the end state so far
+	 *
+	 * \return Number of connections
+	 */
+	uint64_t getStatesClosed() { return stat_statesClosed; };
+
+	/*! Get the number of buckets of the state table
+	 * This is useful to judge the memory usage and probing behavior
+	 *
+	 * \return Number of buckets
+	 */
+	size_t getStateTableBucketCount() { return stateTable.bucket_count(); };
+
 	/*! Register a function for a given state
 	 *
 	 * This function should be called once for each state you wish to use
@@ -647,6 +938,33 @@ public:
 		listenToConnections = true;
 	}
 
+	/*! Register a function, which is run before new connections are accepted
+	 *
+	 * For every packet of an unknown connection, this function decides
+	 * whether a state is created. It must not keep any state itself, but it
+	 * may rewrite the packet to answer it (e.g. TCP SYN cookies).
+	 * This is only useful, if registerStartStateID() was called.
+	 *
+	 * \param fun This function is called with the packet of the unknown connection,
+	 * 		without it, every connection is accepted
+	 */
+	void registerPreAcceptFunction(preAcceptFun fun) { preAcceptFunction = fun; }
+
+	/*! Register the worker threads for the jobs of parked connections
+	 *
+	 * State functions can only call FunIface::runAsync() with a pool.
+	 * The pool must outlive the state machine.
+	 *
+	 * \param pool The worker threads, may be shared with other state machines
+	 */
+	void registerAsyncPool(AsyncPool *pool) { asyncPool = pool; }
+
+	/*! Get the number of parked connections
+	 *
+	 * \return Number of connections, whose jobs are not done or not resumed yet
+	 */
+	size_t getParkedCount() const { return parkedPkts.size(); }
+
 	/*! Register a callback in order to get new buffer
 	 *
 	 * \param fun Function to call, if new buffers are needed
@@ -675,7 +993,14 @@ public:
 		DEBUG_ENABLED(std::cout << "stateTable::removeState() removing: "
 								<< static_cast<std::string>(id) << std::endl;)
 		uint64_t start = start_measurement();
-		stateTable.erase(id);
+		auto stateIt = stateTable.find(id);
+		if (stateIt != stateTable.end()) {
+			// A pending timeout must not bring the connection back
+			if (stateIt->second.timeoutID != timeoutIDInvalid) {
+				timeoutFunctions.erase(stateIt->second.timeoutID);
+			}
+			stateTable.erase(stateIt);
+		}
 		uint64_t stop = stop_measurement();
 		measureData.denseMap += stop - start;
 	}
@@ -764,6 +1089,7 @@ public:
 	 */
 	void runPktBatch(BufArray<Packet> &pktsIn) {
 		uint32_t inCount = pktsIn.getTotalCount();
+		curBatchID++;
 
 		DEBUG_ENABLED(
 			std::cout << std::endl
@@ -773,6 +1099,14 @@ public:
 			std::cout << "StateMachine::runPktBatch() (beginning) stateTable.size() = "
 					  << stateTable.size() << std::endl;)
 
+		// Resume the parked connections, whose jobs are done
+		if (asyncPool != nullptr) {
+			ConnectionID id;
+			while (asyncDone.try_dequeue(id)) {
+				resume(pktsIn, id);
+			}
+		}
+
 		// This loop handles the timeouts
 		// It breaks, if there are no usable timeouts anymore
 		// It will (usually) not run until timeoutsQ is empty
@@ -796,14 +1130,21 @@ public:
 			}
 
 			// Prepare function call
+			// Clean up first, the function may set a new timeout
 			std::unique_ptr<struct TimeoutData> timeoutData =
 				std::move(timeoutDataIt->second);
-			auto stateIt = findState(timeoutData->id);
-			assert(stateIt != stateTable.end());
+			timeoutsQ.pop();
+			timeoutFunctions.erase(timeoutDataIt);
 
-			// XXX Check if timeoutID is invalid
+			// A connection of addState() may still be in the ConnectionPool,
+			// or it was taken by another StateMachine, the timeout is void then
+			bool pooled = stateTable.find(timeoutData->id) == stateTable.end();
+			auto stateIt = findState(timeoutData->id);
+			if (stateIt == stateTable.end()) {
+				continue;
+			}
 
-			FunIface funIface(this, std::numeric_limits<uint32_t>::max(), pktsIn,
+			FunIface funIface(this, pktIdxInvalid, pktsIn,
 				timeoutData->id, stateIt->second);
 
 			// Clear the timeoutID from the state
@@ -817,11 +1158,14 @@ public:
 				DEBUG_ENABLED(
 					std::cout << "Reached endStateID - deleting connection" << std::endl;)
 				removeState(timeoutData->id);
+				stat_statesClosed++;
+			} else if (pooled) {
+				// No packet arrived yet, it may still arrive at another StateMachine
+				State st(stateIt->second);
+				stateTable.erase(stateIt);
+				stat_statesAdded--;
+				connPool->add(timeoutData->id, st);
 			}
-
-			// Clean up
-			timeoutsQ.pop();
-			timeoutFunctions.erase(timeoutDataIt);
 		}
 
 		// Run all the usual incoming packets
@@ -829,6 +1173,10 @@ public:
 			runPkt(pktsIn, i);
 		}
 
+		// Turn the marked packets into replies, all at once
+		ReplyHeaders::rewrite(replyPkts.data(), replyPkts.size());
+		replyPkts.clear();
+
 		DEBUG_ENABLED(std::cout << "StateMachine::runPktBatch() (ending) stateTable.size() = "
 								<< stateTable.size() << std::endl;)
 	}
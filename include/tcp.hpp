@@ -3,21 +3,56 @@
 
 //#include <mutex>
 //#include <sstream>
-#include <list>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <utility>
 
 #include "IPv4_5TupleL2Ident.hpp"
+#include "checksumMbuf.hpp"
 #include "common.hpp"
 #include "exceptions.hpp"
 #include "headers.hpp"
 #include "mbuf.hpp"
+#include "pktParser.hpp"
 #include "stateMachine.hpp"
+#include "tcpGso.hpp"
+#include "tcpOptions.hpp"
+#include "tcpReassembly.hpp"
+#include "tcpRto.hpp"
+#include "tcpSendRing.hpp"
+#include "tcpSeq.hpp"
+#include "tcpSynCookie.hpp"
 
 namespace TCP {
 using Identifier = IPv4_5TupleL2Ident<mbuf>;
 
+// Largest segment size sent and received, the peer may announce a smaller one
 static constexpr unsigned int MSS = 1460;
 
+// MSS of the peer, if its SYN holds no MSS option (RFC 9293)
+static constexpr unsigned int DEFAULT_MSS = 536;
+
+// Window announced to the peer
+// Data in order is handed to Proto right away, only the reassembly queue holds data
+static constexpr uint32_t RCV_WINDOW = TcpReassembly<mbuf>::maxSegments * MSS;
+
+// Shift of the windows announced, if the peer scales windows (RFC 7323)
+static constexpr uint8_t RCV_WSCALE = 3;
+static_assert((RCV_WINDOW >> RCV_WSCALE) <= 0xffff, "RCV_WSCALE is too small for RCV_WINDOW");
+
+// Retransmissions of a FIN, before the connection is given up
+static constexpr uint8_t FIN_RETRIES = 6;
+
+// Time to wait for the FIN of the peer, after ours was acknowledged (as Linux)
+static constexpr std::chrono::seconds FIN_WAIT_2_TIMEOUT{60};
+
+// Segments with data received, before they are acknowledged right away (RFC 5681)
+static constexpr uint8_t DELAYED_ACK_SEGMENTS = 2;
+
+// Longest time an ACK is delayed (as Linux, RFC 1122 allows up to 500 ms)
+static constexpr std::chrono::milliseconds DELAYED_ACK_TIMEOUT{40};
+
 /*
  * ===================================
  * Server
@@ -33,15 +68,50 @@ public:
 	virtual void handlePacket(uint8_t *data, uint16_t dataLen, TcpIface &tcpIface) = 0;
 };
 
+*/
+
+/*! Interface of the congestion control
+ *
+ * The ConCtl template argument of Server has to provide these functions,
+ * they are resolved at compile time, the class does not need to inherit.
+ * Windows and sequence numbers are in bytes.
+ * Implementations are TcpConCtlSimple, TcpConCtlNewReno and TcpConCtlCubic.
+ */
+/*
 class ConCtlBase {
 public:
-	virtual void initSeq(uint32_t seq, uint32_t ack) = 0;
-	virtual void handlePacket(uint32_t seq, uint32_t ack) = 0;
-	virtual bool reset(uint32_t &seq);
-	virtual unsigned int getConWindow() = 0;
+	// The connection is established, seq is the first byte of data
+	virtual void init(uint32_t seq, uint16_t mss) = 0;
+	// An ACK arrived, which acknowledged new data, or was a duplicate
+	// bytesAcked is 0 for duplicates, sndMax is the highest byte sent so far
+	virtual void handleAck(uint32_t ack, uint32_t bytesAcked, uint32_t sndMax,
+		std::chrono::steady_clock::time_point now) = 0;
+	// A round trip time was measured (never for retransmitted data)
+	virtual void handleRtt(std::chrono::microseconds rtt) = 0;
+	// The retransmission timer expired, everything from the first
+	// unacknowledged byte on is sent again
+	virtual void handleTimeout(uint32_t sndMax) = 0;
+	// Returns true, if the segment holding seq has to be sent again
+	virtual bool reset(uint32_t &seq) = 0;
+	// Returns true during fast recovery, further holes reported by SACK
+	// are retransmitted then
+	virtual bool inRecovery() const = 0;
+	virtual uint32_t getConWindow() const = 0;
+	virtual uint32_t getSsthresh() const = 0;
 };
 */
 
+/*! States of a server connection
+ *
+ * - syn_ack: SYN received, SYN ACK sent (SYN-RECEIVED)
+ * - est: Data flows in both directions (ESTABLISHED and CLOSE-WAIT)
+ * - fin: Our FIN was sent first, the FIN of the peer is missing
+ *   (FIN-WAIT-1 and FIN-WAIT-2)
+ * - ack_fin: Both FINs were sent, the ACK of ours is missing
+ *   (LAST-ACK and CLOSING)
+ *
+ * There is no TIME-WAIT, the connection is removed right away.
+ */
 struct States {
 	static constexpr StateID syn_ack = 0;
 	static constexpr StateID est = 1;
@@ -52,22 +122,57 @@ struct States {
 
 template <class Proto, class ConCtl> class Server {
 public:
-	struct segment {
-		uint8_t *dataPtr;
-		uint32_t seqNumber;
-		uint16_t dataLen;
-	};
-
 	struct connection {
 		uint32_t seqLocal = 0;
 		uint32_t seqRemote = 0;
-		std::list<struct segment> dataToSend;
-		std::list<struct segment> dataAlreadySent;
-//		std::list<struct segment> recvBuffer;
-//		uint32_t recvBytes = 0;
-		uint16_t sendWindow = 0;
+		TcpSendRing<mbuf> sendRing;
+		uint32_t sendWindow = 0;
+		uint16_t mss = MSS;
 		uint16_t ipID = 0;
 		bool closeConnectionAfterSending = false;
+
+		// Last batch, in which segments were sent in additional packets
+		uint32_t appendBatchID = 0;
+
+		// RTT measurement of one segment at a time (Karn's algorithm)
+		bool rttTiming = false;
+		uint32_t rttSeq = 0;
+		std::chrono::steady_clock::time_point rttStart;
+
+		// Retransmission timer, runs while data is outstanding
+		TcpRto rto;
+		bool rtoRunning = false;
+		std::chrono::steady_clock::time_point rtoDeadline;
+
+		// Delayed ACK, segments received since the last segment sent
+		uint8_t ackPending = 0;
+		std::chrono::steady_clock::time_point ackDeadline;
+
+		// Headers of the SYN ACK, retransmissions without a received packet use them
+		static constexpr uint16_t maxHeadersLen = 128;
+		uint8_t headers[maxHeadersLen];
+		uint16_t headersL2Len = 0;
+		uint16_t headersLen = 0;
+
+		// Both sides sent SACK permitted in their SYNs
+		bool sackPermitted = false;
+
+		// Window scaling, both shifts are 0 without the option in both SYNs
+		uint8_t sndWscale = 0; // Shift of the windows received
+		uint8_t rcvWscale = 0; // Shift of the windows sent
+
+		// Timestamps, used for RTT samples, the clock ticks in microseconds
+		bool tsEnabled = false;
+		uint32_t tsRecent = 0; // Timestamp of the peer to echo
+
+		// Data received ahead of seqRemote
+		TcpReassembly<mbuf> reassembly;
+
+		// Teardown, once our FIN is sent seqLocal includes it
+		bool finReceived = false;
+		bool finAcked = false;
+		uint8_t finRetries = 0;
+
 		ConCtl conCtl;
 		Proto proto;
 	};
@@ -76,66 +181,74 @@ public:
 	private:
 		friend class Server<Proto, ConCtl>;
 		struct connection &conn;
+		StateMachine<Identifier, mbuf>::FunIface &funIface;
 
-		TcpIface(struct connection &conn) : conn(conn){};
+		TcpIface(struct connection &conn, StateMachine<Identifier, mbuf>::FunIface &funIface)
+			: conn(conn), funIface(funIface){};
 
 	public:
 		void close() { conn.closeConnectionAfterSending = true; };
-		void sendData(uint8_t *data, uint32_t dataLen) {
-			/*
-			auto oldSize = conn.dataToSend.size();
-			conn.dataToSend.resize(oldSize + dataLen);
-			memcpy(conn.dataToSend.data() + oldSize, data, dataLen);
-			*/
-			if (dataLen <= MSS) {
-				struct segment seg;
-
-				seg.dataPtr = data;
-				seg.dataLen = dataLen;
-				seg.seqNumber = conn.seqLocal;
-				conn.seqLocal += dataLen;
-
-				conn.dataToSend.push_back(seg);
-			} else {
-				uint32_t totalLen = 0;
-
-				/*
-				 * First segment reuses the given buffer
-				 * This might mean to waste memory, but it saves malloc() and free()
-				 * calls
-				 *
-				 * It would also be possible to append to the last non-full segment
-				 */
-				struct segment segFirst;
-				segFirst.dataPtr = data;
-				segFirst.dataLen = MSS;
-				segFirst.seqNumber = conn.seqLocal;
-				conn.seqLocal += MSS;
-
-				conn.dataToSend.push_back(segFirst);
-
-				totalLen += MSS;
-
-				while (totalLen < dataLen) {
-					uint32_t curSize = std::min(dataLen - totalLen, MSS);
-
-					struct segment segCur;
-					segCur.dataPtr = reinterpret_cast<uint8_t *>(malloc(curSize));
-					memcpy(segCur.dataPtr, data + totalLen, curSize);
-					segCur.dataLen = curSize;
-					segCur.seqNumber = conn.seqLocal;
-					conn.seqLocal += curSize;
-
-					conn.dataToSend.push_back(segCur);
-
-					totalLen += curSize;
-				}
+
+		/*! Get the maximum segment size of the connection
+		 *
+		 * \return Largest payload of one segment, at most MSS
+		 */
+		uint16_t getMss() const { return conn.mss; };
+
+		/*! Get a buffer to write the payload of one segment to
+		 *
+		 * Write at most getMss() bytes to getData(), then hand the buffer to sendBuf().
+		 *
+		 * \return The buffer
+		 */
+		mbuf *getSendBuf() { return funIface.allocPkt(); };
+
+		/*! Enqueue a buffer obtained by getSendBuf() to be sent
+		 *
+		 * The payload is not copied, the connection takes over the buffer.
+		 *
+		 * \param buf The buffer holding the payload
+		 * \param len Length of the payload, at most getMss()
+		 */
+		void sendBuf(mbuf *buf, uint16_t len) {
+			buf->setDataLen(len);
+			conn.sendRing.push(buf, len);
+			conn.seqLocal += len;
+		};
+
+		/*! Enqueue data to be sent
+		 *
+		 * The data is copied into segment buffers once, the caller keeps
+		 * the ownership of data.
+		 * Use getSendBuf() and sendBuf() to avoid the copy.
+		 *
+		 * \param data Data to send
+		 * \param dataLen Length of the data
+		 */
+		void sendData(const uint8_t *data, uint32_t dataLen) {
+			uint32_t offset = 0;
+			while (offset < dataLen) {
+				uint16_t len = std::min(dataLen - offset, static_cast<uint32_t>(conn.mss));
+				mbuf *buf = getSendBuf();
+				memcpy(buf->getData(), data + offset, len);
+				sendBuf(buf, len);
+				offset += len;
 			}
 		};
 	};
 
 	static struct connection *factory(Identifier::ConnectionID id);
 
+	/*! Stateless handling of unknown connections with SYN cookies
+	 *
+	 * Register it with StateMachine::registerPreAcceptFunction().
+	 * SYNs are answered with a SYN ACK right away, its sequence number is a
+	 * cookie (see TcpSynCookie). Only an ACK returning a valid cookie creates
+	 * the connection, runSynAck() establishes it then.
+	 */
+	static StateMachine<Identifier, mbuf>::PreAccept preAccept(
+		Identifier::ConnectionID id, mbuf *pkt);
+
 	static void runSynAck(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
 		StateMachine<Identifier, mbuf>::FunIface &funIface);
 
@@ -148,138 +261,110 @@ public:
 	static void runAckFin(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
 		StateMachine<Identifier, mbuf>::FunIface &funIface);
 
-}; // namespace Server
-
-/*
- * ===================================
- * Client
- * ===================================
- *
- */
-
-namespace Client {
-
-struct States {
-	static constexpr StateID syn = 0;
-	static constexpr StateID ack = 1;
-	static constexpr StateID fin = 2;
-	static constexpr StateID END = 3;
-};
-
-StateMachine<Identifier, mbuf>::State createSyn(
-	uint32_t srcIp, uint32_t dstIp, uint16_t srcPort, uint16_t dstPort);
-
-void runAck(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
-	StateMachine<Identifier, mbuf>::FunIface &funIface);
-
-void runFin(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
-	StateMachine<Identifier, mbuf>::FunIface &funIface);
-
-} // namespace Client
-
-}; // namespace TCP
-
-/*
- * From here on down is the C interface to the above C++ functions
- */
-
-extern "C" {
-
-#if 0
-/*
- * XXX -------------------------------------------- XXX
- *       Server
- * XXX -------------------------------------------- XXX
- */
-
-/*! Init a TCP server
- *
- *	\return void* to the object (opaque)
- */
-void *TCP_Server_init();
+	/*! Timeout of the state est, set by runEst()
+	 *
+	 * If the retransmission timer expired, everything from the first
+	 * unacknowledged byte on is sent again. If an ACK was delayed for
+	 * DELAYED_ACK_TIMEOUT, it is sent.
+	 */
+	static void runEstTimeout(StateMachine<Identifier, mbuf>::State &state,
+		StateMachine<Identifier, mbuf>::FunIface &funIface);
 
-/*! Process a batch of packets
- *
- * \param obj object returned by TCPServer_init()
- * \param inPkts incoming packets to process
- * \param inCount number of incoming packets
- * \param sendCount Number of packets in sendPkts
- * \param freeCount Number of packets in freePkts
- */
-void *TCP_Server_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
-	unsigned int *sendCount, unsigned int *freeCount);
+	/*! Timeout of the states fin and ack_fin
+	 *
+	 * The FIN is sent again, until it is acknowledged or FIN_RETRIES is
+	 * reached. Once it is acknowledged, the peer has FIN_WAIT_2_TIMEOUT
+	 * to send its FIN.
+	 */
+	static void runFinTimeout(StateMachine<Identifier, mbuf>::State &state,
+		StateMachine<Identifier, mbuf>::FunIface &funIface);
 
-/*! Get the packets to send and free
- *
- * \param obj object returned by TCPServer_process
- * \param sendPkts Packets to send out (size if given in sendCount)
- * \param freePkts Packets to free (size if given in freeCount)
- */
-void TCP_Server_getPkts(void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts);
+private:
+	/*! Turn a received SYN into the SYN ACK
+	 *
+	 * The addresses and ports have to be swapped already.
+	 * The options in the SYN of the peer are answered, tsVal is only used,
+	 * if the peer sent a timestamp.
+	 */
+	static void writeSynAck(mbuf *pkt, uint32_t seqLocal, uint32_t seqRemote,
+		const TcpOptions::Parsed &options, uint32_t tsVal);
+
+	/*! Current value of the timestamp clock
+	 *
+	 * It ticks in microseconds (as the usec timestamps of Linux), otherwise
+	 * the RTT samples would be useless at the RTTs MoonState runs at.
+	 */
+	static uint32_t tsNow() {
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch())
+			.count();
+	};
 
-/*! Free recources used by the state machine
- *
- * \param obj object returned by TCPServer_init()
- */
-void TCP_Server_free(void *obj);
-#endif
+	/*! The window to announce in segments after the SYN */
+	static uint16_t getRcvWindow(connection *c) {
+		return std::min(RCV_WINDOW >> c->rcvWscale, static_cast<uint32_t>(0xffff));
+	};
 
-/*
- * XXX -------------------------------------------- XXX
- *       Client
- * XXX -------------------------------------------- XXX
- */
+	/*! Establish a connection from the ACK returning a SYN cookie
+	 *
+	 * \return False, if the cookie is invalid, the connection is left untouched then
+	 */
+	static bool acceptCookie(connection *c, mbuf *pkt);
 
-/*! Init a TCP client
- *
- * \return void* to the object (opaque)
- */
-void *TCP_Client_init();
+	// The lowest bits of the timestamp of a SYN ACK with cookie hold the window
+	// scale of the peer, all bits set if the peer does not scale
+	static constexpr uint32_t cookieTsMask = 0xf;
 
-/*! Open a connection to a server
- *
- * \param obj object returned by TCP_Client_init()
- * \param inPkts incoming packets to process
- * \param inCount number of incoming packets
- * \param sendCount Number of packets in sendPkts
- * \param freeCount Number of packets in freePkts
- * \param srcIP IP of the sender
- * \param dstIP IP of the listening server
- * \param srcPort Port the client should use
- * \param dstPort Port of the server
- * \param ident Identiry of the connection
- * \return void* to BufArray object (give to _getPkts() )
- */
-void *TCP_Client_connect(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
-	unsigned int *sendCount, unsigned int *freeCount, uint32_t srcIP, uint32_t dstIP,
-	uint16_t srcPort, uint16_t dstPort);
+	/*! The MSS to use for the options of a SYN */
+	static uint16_t peerMss(const TcpOptions::Parsed &options) {
+		return options.mss != 0 ? std::min(options.mss, static_cast<uint16_t>(MSS)) : DEFAULT_MSS;
+	};
 
-/*! Get the packets to send and free
- *
- * \param obj object returned by TCP_Client_process
- * \param sendPkts Packets to send out (size if given in sendCount)
- * \param freePkts Packets to free (size if given in freeCount)
- */
-void TCP_Client_getPkts(void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts);
+	/*! Update the retransmission timer, armTimer() sets the timeout
+	 *
+	 * \param restart Start the timer again, even if it is running
+	 */
+	static void armRto(connection *c, bool restart);
+
+	/*! Set the timeout of the state est to the earlier one of the
+	 * retransmission timer and the delayed ACK
+	 */
+	static void armTimer(connection *c, StateMachine<Identifier, mbuf>::FunIface &funIface);
+
+	/*! Get a packet holding the headers of the connection
+	 *
+	 * Segments sent by timeouts use it, as there is no received packet.
+	 *
+	 * \param ipv4 Set to the IPv4 header in the packet
+	 * \param tcp Set to the TCP header in the packet
+	 * \return The packet, the length has to be set by the caller
+	 */
+	static mbuf *getHeadersPkt(connection *c, StateMachine<Identifier, mbuf>::FunIface &funIface,
+		Headers::IPv4 *&ipv4, Headers::Tcp *&tcp);
+
+	static void armFinTimeout(connection *c, StateMachine<Identifier, mbuf>::FunIface &funIface);
+
+	/*! Turn a packet into an ACK without data
+	 *
+	 * The addresses and ports have to be set already.
+	 *
+	 * \param fin Send our FIN again, seqLocal includes it already
+	 * \return Length of the TCP header including the options
+	 */
+	static uint16_t writeAck(connection *c, Headers::IPv4 *ipv4, Headers::Tcp *tcp, bool fin);
+
+	/*! Write the options of a segment sent in the established state
+	 *
+	 * These are the timestamps, if negotiated, and the SACK blocks, while data is missing.
+	 * The data offset of the header is set as well.
+	 *
+	 * \return Length of the TCP header including the options
+	 */
+	static uint16_t writeOptions(connection *c, Headers::Tcp *tcp);
 
-/*! Process a batch of packets
- *
- * \param obj object returned by TCP_Client_init()
- * \param inPkts incoming packets to process
- * \param inCount number of incoming packets
- * \param sendCount Number of packets in sendPkts
- * \param freeCount Number of packets in freePkts
- * \return void* to BufArray object (give to _getPkts() )
- */
-void *TCP_Client_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
-	unsigned int *sendCount, unsigned int *freeCount);
+}; // namespace Server
 
-/*! Free recources used by the state machine
- *
- * \param obj object returned by TCP_Client_init()
- */
-void TCP_Client_free(void *obj);
-};
+}; // namespace TCP
 
 /*
  * YCM definition is a workaround for a libclang bug
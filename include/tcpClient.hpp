@@ -0,0 +1,234 @@
+#ifndef TCPCLIENT_HPP
+#define TCPCLIENT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+
+#include "tcp.hpp"
+
+/*
+ * ===================================
+ * Client
+ * ===================================
+ *
+ */
+
+namespace TCP {
+namespace Client {
+
+// Retransmissions of a segment, before the connection is given up
+static constexpr uint8_t CLIENT_RETRIES = 6;
+
+// Window announced to the server, the client does not scale windows
+static constexpr uint16_t CLIENT_WINDOW = 0xffff;
+
+/*! States of a client connection
+ *
+ * - syn: The SYN is written to the packet given to addState()
+ * - syn_ack: SYN sent, waiting for the SYN ACK (SYN-SENT)
+ * - est: The request is sent, the response is received (ESTABLISHED)
+ * - fin: Our FIN was sent, after the whole response arrived
+ *   (FIN-WAIT-1, FIN-WAIT-2 and CLOSING)
+ *
+ * There is no TIME-WAIT, the connection is removed right away.
+ */
+struct States {
+	static constexpr StateID syn = 0;
+	static constexpr StateID syn_ack = 1;
+	static constexpr StateID est = 2;
+	static constexpr StateID fin = 3;
+	static constexpr StateID END = 4;
+};
+
+/*! A connection sending one request, and waiting for one response
+ *
+ * The request is made up of the bytes 0, 1, ..., 255, 0, 1, ...
+ * so retransmissions do not need to keep it.
+ */
+struct connection {
+	// Host byte order
+	uint32_t srcIp;
+	uint32_t dstIp;
+	uint16_t srcPort;
+	uint16_t dstPort;
+
+	uint32_t isn;
+	uint32_t sndUna = 0;
+	uint32_t sndNxt = 0;
+	uint32_t rcvNxt = 0;
+	uint32_t sendWindow = 0;
+	uint16_t mss = DEFAULT_MSS;
+	uint16_t ipID = 0;
+
+	uint32_t requestLen;
+	uint32_t responseLen;
+	uint32_t bytesReceived = 0;
+
+	// Time the SYN was sent, the SYN ACK gives the first RTT sample
+	std::chrono::steady_clock::time_point synTime;
+	TcpRto rto;
+	uint8_t retries = 0;
+
+	bool finReceived = false;
+	bool finAcked = false;
+
+	// Last batch, in which segments were sent in additional packets
+	uint32_t appendBatchID = 0;
+};
+
+/*! Counters of all clients of this process
+ *
+ * They are updated once per connection, when it is removed.
+ */
+struct Counters {
+	std::atomic<uint64_t> completed{0};
+	std::atomic<uint64_t> failed{0};
+	std::atomic<uint64_t> bytesSent{0};
+	std::atomic<uint64_t> bytesReceived{0};
+};
+
+Counters &getCounters();
+
+/*! Get the ConnectionID of a client connection
+ *
+ * It is the ID of the packets received from the server.
+ * All parameters are in host byte order.
+ */
+Identifier::ConnectionID getConnectionID(
+	uint32_t srcIp, uint32_t dstIp, uint16_t srcPort, uint16_t dstPort);
+
+/*! Create the state of a new connection
+ *
+ * Give it to StateMachine::addState() with one packet, the SYN is written to it.
+ * Until the SYN ACK arrives, the StateMachine running addState() sends the SYN
+ * again on timeouts. The state stays in the StateMachine::ConnectionPool, the
+ * SYN ACK may arrive at another core. After CLIENT_RETRIES, the connection
+ * is given up.
+ *
+ * \param srcIp IP of the client (host byte order)
+ * \param dstIp IP of the server (host byte order)
+ * \param srcPort Port of the client (host byte order)
+ * \param dstPort Port of the server (host byte order)
+ * \param requestLen Bytes to send to the server
+ * \param responseLen Bytes to receive, before the connection is closed
+ * \return The state to add
+ */
+StateMachine<Identifier, mbuf>::State createSyn(uint32_t srcIp, uint32_t dstIp, uint16_t srcPort,
+	uint16_t dstPort, uint32_t requestLen, uint32_t responseLen);
+
+void runSyn(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
+	StateMachine<Identifier, mbuf>::FunIface &funIface);
+
+void runSynAck(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
+	StateMachine<Identifier, mbuf>::FunIface &funIface);
+
+void runEst(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
+	StateMachine<Identifier, mbuf>::FunIface &funIface);
+
+void runFin(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
+	StateMachine<Identifier, mbuf>::FunIface &funIface);
+
+/*! Timeout of the states syn_ack, est and fin
+ *
+ * Everything not acknowledged is sent again (the SYN as well), until
+ * CLIENT_RETRIES is reached.
+ */
+void runTimeout(StateMachine<Identifier, mbuf>::State &state,
+	StateMachine<Identifier, mbuf>::FunIface &funIface);
+
+} // namespace Client
+}; // namespace TCP
+
+/*
+ * From here on down is the C interface to the above C++ functions
+ */
+
+extern "C" {
+
+/*! Statistics of all TCP clients, see TCP_Client_getStats() */
+struct TCP_Client_Stats {
+	uint64_t connectionsCompleted; //!< Connections, which received the whole response
+	uint64_t connectionsFailed;    //!< Connections reset or timed out before
+	uint64_t bytesSent;            //!< Request bytes acknowledged by the servers
+	uint64_t bytesReceived;        //!< Response bytes received
+};
+
+/*
+ * XXX -------------------------------------------- XXX
+ *       Client
+ * XXX -------------------------------------------- XXX
+ */
+
+/*! Init a TCP client
+ *
+ * \param mp Mempool to allocate the packets sent in addition from
+ * \return void* to the object (opaque)
+ */
+void *TCP_Client_init(struct rte_mempool *mp);
+
+/*! Open a connection to a server
+ *
+ * \param obj object returned by TCP_Client_init()
+ * \param inPkts one packet, the SYN is written to it
+ * \param inCount number of incoming packets
+ * \param sendCount Number of packets in sendPkts
+ * \param freeCount Number of packets in freePkts
+ * \param srcIP IP of the sender
+ * \param dstIP IP of the listening server
+ * \param srcPort Port the client should use
+ * \param dstPort Port of the server
+ * \param requestLen Bytes to send to the server
+ * \param responseLen Bytes to receive, before the connection is closed
+ * \return void* to BufArray object (give to _getPkts() )
+ */
+void *TCP_Client_connect(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
+	unsigned int *sendCount, unsigned int *freeCount, uint32_t srcIP, uint32_t dstIP,
+	uint16_t srcPort, uint16_t dstPort, uint32_t requestLen, uint32_t responseLen);
+
+/*! Get the packets to send and free
+ *
+ * \param obj object returned by TCP_Client_process
+ * \param sendPkts Packets to send out (size if given in sendCount)
+ * \param freePkts Packets to free (size if given in freeCount)
+ */
+void TCP_Client_getPkts(void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts);
+
+/*! Process a batch of packets
+ *
+ * \param obj object returned by TCP_Client_init()
+ * \param inPkts incoming packets to process
+ * \param inCount number of incoming packets
+ * \param sendCount Number of packets in sendPkts
+ * \param freeCount Number of packets in freePkts
+ * \return void* to BufArray object (give to _getPkts() )
+ */
+void *TCP_Client_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
+	unsigned int *sendCount, unsigned int *freeCount);
+
+/*! Get the statistics of all clients of this process
+ *
+ * \param stats The statistics are written here
+ */
+void TCP_Client_getStats(struct TCP_Client_Stats *stats);
+
+/*! Free recources used by the state machine
+ *
+ * \param obj object returned by TCP_Client_init()
+ */
+void TCP_Client_free(void *obj);
+};
+
+/*
+ * YCM definition is a workaround for a libclang bug
+ * When compiling, YCM should never be set.
+ * Set YCM in a libclang based IDE in order to avoid errors
+ */
+#ifndef YCM
+#include "../src/tcpClient.cpp"
+#endif
+
+#endif /* TCPCLIENT_HPP */
@@ -0,0 +1,127 @@
+#ifndef TCPCONCTLCUBIC_HPP
+#define TCPCONCTLCUBIC_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include "tcpConCtlNewReno.hpp"
+
+/*! CUBIC congestion control (RFC 9438)
+ *
+ * Loss recovery is the one of NewReno, with a window reduction to 0.7.
+ * In congestion avoidance the window follows
+ * W(t) = C * (t - K)^3 + Wmax
+ * where Wmax is the window before the last reduction, and t the time since
+ * congestion avoidance was entered.
+ * The window never grows slower than the one of Reno would (Reno-friendly
+ * region), and the window grows at most by half per RTT.
+ *
+ * Windows in this class are measured in segments, as in the RFC.
+ * See TCP::ConCtlBase for the interface.
+ */
+class TcpConCtlCubic : public TcpConCtlNewReno {
+private:
+	static constexpr double C = 0.4;
+	static constexpr double betaCubic = 0.7;
+	static constexpr double alphaCubic = 3.0 * (1.0 - betaCubic) / (1.0 + betaCubic);
+
+	double wMax = 0;
+	double wEst = 0;
+	double k = 0;
+	bool epochValid = false;
+	std::chrono::steady_clock::time_point epochStart;
+	std::chrono::microseconds srtt = std::chrono::microseconds(0);
+
+	void congestionEvent(uint32_t cwndBefore) {
+		double cwndSeg = static_cast<double>(cwndBefore) / mss;
+
+		// Fast convergence, release bandwidth for new flows
+		if (cwndSeg < wMax) {
+			wMax = cwndSeg * (1.0 + betaCubic) / 2.0;
+		} else {
+			wMax = cwndSeg;
+		}
+		epochValid = false;
+	}
+
+	void congestionAvoidance(uint32_t bytesAcked, std::chrono::steady_clock::time_point now) {
+		double cwndSeg = static_cast<double>(cwnd) / mss;
+
+		if (!epochValid) {
+			epochValid = true;
+			epochStart = now;
+			if (cwndSeg < wMax) {
+				k = std::cbrt((wMax - cwndSeg) / C);
+			} else {
+				k = 0;
+				wMax = cwndSeg;
+			}
+			wEst = cwndSeg;
+		}
+
+		// The window one RTT ahead, grow at most by half per RTT
+		double t = std::chrono::duration<double>(now - epochStart + srtt).count();
+		double target = C * (t - k) * (t - k) * (t - k) + wMax;
+		target = std::max(cwndSeg, std::min(target, 1.5 * cwndSeg));
+
+		double segsAcked = static_cast<double>(bytesAcked) / mss;
+		wEst += alphaCubic * segsAcked / cwndSeg;
+
+		double newCwndSeg;
+		if (target < wEst) {
+			// Reno-friendly region
+			newCwndSeg = std::max(cwndSeg, wEst);
+		} else {
+			newCwndSeg = cwndSeg + (target - cwndSeg) / cwndSeg * segsAcked;
+		}
+		cwnd = std::max(cwnd, static_cast<uint32_t>(newCwndSeg * mss));
+	}
+
+public:
+	void init(uint32_t seq, uint16_t mss) {
+		TcpConCtlNewReno::init(seq, mss);
+		beta = static_cast<uint32_t>(betaCubic * 1024);
+		wMax = 0;
+		epochValid = false;
+		srtt = std::chrono::microseconds(0);
+	};
+
+	void handleAck(uint32_t ack, uint32_t bytesAcked, uint32_t sndMax,
+		std::chrono::steady_clock::time_point now) {
+		bool wasInRecovery = recovering;
+		uint32_t cwndBefore = cwnd;
+
+		if (lossRecovery(ack, bytesAcked, sndMax)) {
+			if (!wasInRecovery && recovering) {
+				congestionEvent(cwndBefore);
+			}
+			return;
+		}
+
+		if (cwnd < ssthresh) {
+			slowStart(bytesAcked);
+		} else {
+			congestionAvoidance(bytesAcked, now);
+		}
+	};
+
+	void handleTimeout(uint32_t sndMax) {
+		if (!timedOut) {
+			congestionEvent(cwnd);
+		}
+		TcpConCtlNewReno::handleTimeout(sndMax);
+	};
+
+	void handleRtt(std::chrono::microseconds rtt) {
+		// Smoothed like the SRTT of RFC 6298
+		if (srtt.count() == 0) {
+			srtt = rtt;
+		} else {
+			srtt = (7 * srtt + rtt) / 8;
+		}
+	};
+};
+
+#endif /* TCPCONCTLCUBIC_HPP */
@@ -0,0 +1,190 @@
+#ifndef TCPCONCTLNEWRENO_HPP
+#define TCPCONCTLNEWRENO_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+#include "tcpSeq.hpp"
+
+/*! NewReno congestion control
+ *
+ * Slow start and congestion avoidance follow RFC 5681, loss recovery is the
+ * NewReno fast retransmit/fast recovery of RFC 6582:
+ * - The third duplicate ACK starts fast recovery, if it covers more than
+ *   the data outstanding during the last recovery, or if the last ACKs
+ *   advanced by at most four segments (ACK heuristic of section 4.2)
+ * - Every further duplicate ACK inflates the window by one segment
+ * - A partial ACK retransmits the next hole, and deflates the window by
+ *   the amount of data acknowledged
+ * - The first ACK covering all data sent before the loss ends recovery
+ * - A retransmission timeout falls back to slow start with one segment
+ *
+ * The window reduction on loss is configurable with beta, so this class
+ * can be the base for other loss based algorithms (see TcpConCtlCubic).
+ * See TCP::ConCtlBase for the interface.
+ */
+class TcpConCtlNewReno /*: public TCP::ConCtlBase */ {
+protected:
+	static constexpr uint32_t dupAckThreshold = 3;
+
+	uint32_t mss = 0;
+	uint32_t cwnd = 0;
+	uint32_t ssthresh = std::numeric_limits<uint32_t>::max();
+
+	uint32_t una = 0;
+	uint32_t prevUna = 0;
+	// Highest sequence number sent, when the last recovery started
+	uint32_t recover = 0;
+	uint32_t dupAcks = 0;
+	uint32_t bytesAckedCA = 0;
+	bool recovering = false;
+	bool timedOut = false;
+
+	bool retransmitPending = false;
+	uint32_t retransmitSeq = 0;
+
+	// Window reduction on loss, in 1/1024
+	uint32_t beta = 512;
+
+	/*! Run the loss detection and recovery
+	 *
+	 * \return True, if the ACK was consumed by loss recovery, the window
+	 * must not grow then
+	 */
+	bool lossRecovery(uint32_t ack, uint32_t bytesAcked, uint32_t sndMax) {
+		if (bytesAcked == 0) {
+			// Only count ACKs, while data is outstanding (RFC 5681 duplicate ACK)
+			if ((ack != una) || !TcpSeq::lt(ack, sndMax)) {
+				return true;
+			}
+
+			dupAcks++;
+			if (recovering) {
+				cwnd += mss;
+			} else if ((dupAcks == dupAckThreshold) &&
+					   (TcpSeq::lt(recover, ack) ||
+						   ((cwnd > mss) && (una - prevUna <= 4 * mss)))) {
+				uint32_t flightSize = sndMax - una;
+				ssthresh = std::max(static_cast<uint32_t>(
+										(static_cast<uint64_t>(flightSize) * beta) >> 10),
+					2 * mss);
+				cwnd = ssthresh + dupAckThreshold * mss;
+				recover = sndMax - 1;
+				recovering = true;
+
+				retransmitPending = true;
+				retransmitSeq = una;
+			}
+			return true;
+		}
+
+		prevUna = una;
+		una = ack;
+		dupAcks = 0;
+		timedOut = false;
+
+		if (!recovering) {
+			return false;
+		}
+
+		if (TcpSeq::lt(recover, ack)) {
+			// Full ACK, everything outstanding at the loss is acknowledged
+			cwnd = std::min(ssthresh, std::max(sndMax - ack, mss) + mss);
+			recovering = false;
+			bytesAckedCA = 0;
+		} else {
+			// Partial ACK, the next segment was lost as well
+			retransmitPending = true;
+			retransmitSeq = ack;
+
+			cwnd = cwnd > bytesAcked ? cwnd - bytesAcked : 0;
+			if (bytesAcked >= mss) {
+				cwnd += mss;
+			}
+			cwnd = std::max(cwnd, mss);
+		}
+		return true;
+	}
+
+	void slowStart(uint32_t bytesAcked) { cwnd += std::min(bytesAcked, mss); }
+
+public:
+	/*! Initialize the congestion control for a new connection
+	 *
+	 * \param seq Sequence number of the first byte of data
+	 * \param mss Maximum segment size
+	 */
+	void init(uint32_t seq, uint16_t mss) {
+		this->mss = mss;
+		// Initial window of RFC 6928
+		cwnd = std::min(10u * mss, std::max(2u * mss, 14600u));
+		ssthresh = std::numeric_limits<uint32_t>::max();
+		una = seq;
+		prevUna = seq;
+		recover = seq - 1;
+		dupAcks = 0;
+		bytesAckedCA = 0;
+		recovering = false;
+		timedOut = false;
+		retransmitPending = false;
+	};
+
+	void handleAck(uint32_t ack, uint32_t bytesAcked, uint32_t sndMax,
+		std::chrono::steady_clock::time_point now) {
+		(void)now;
+		if (lossRecovery(ack, bytesAcked, sndMax)) {
+			return;
+		}
+
+		if (cwnd < ssthresh) {
+			slowStart(bytesAcked);
+		} else {
+			// One segment per window of acknowledged data
+			bytesAckedCA += bytesAcked;
+			if (bytesAckedCA >= cwnd) {
+				bytesAckedCA -= cwnd;
+				cwnd += mss;
+			}
+		}
+	};
+
+	void handleRtt(std::chrono::microseconds rtt) { (void)rtt; };
+
+	void handleTimeout(uint32_t sndMax) {
+		// Only the first timeout of a segment reduces ssthresh (RFC 5681)
+		if (!timedOut) {
+			uint32_t flightSize = sndMax - una;
+			ssthresh = std::max(
+				static_cast<uint32_t>((static_cast<uint64_t>(flightSize) * beta) >> 10),
+				2 * mss);
+		}
+		timedOut = true;
+
+		// Loss window of one segment, duplicates of the old data do not start
+		// fast recovery (RFC 6582)
+		cwnd = mss;
+		recover = sndMax - 1;
+		recovering = false;
+		dupAcks = 0;
+		bytesAckedCA = 0;
+		retransmitPending = false;
+	};
+
+	bool reset(uint32_t &seq) {
+		if (retransmitPending) {
+			seq = retransmitSeq;
+			retransmitPending = false;
+			return true;
+		}
+		return false;
+	};
+
+	bool inRecovery() const { return recovering; };
+
+	uint32_t getConWindow() const { return cwnd; };
+	uint32_t getSsthresh() const { return ssthresh; };
+};
+
+#endif /* TCPCONCTLNEWRENO_HPP */
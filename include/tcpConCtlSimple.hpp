@@ -1,37 +1,64 @@
+#ifndef TCPCONCTLSIMPLE_HPP
+#define TCPCONCTLSIMPLE_HPP
+
+#include <chrono>
 #include <cstdint>
 #include <limits>
 
-//#include "tcp.hpp"
+#include "tcpSeq.hpp"
 
+/*! Congestion control without a congestion window
+ *
+ * Everything the peer allows is sent, after three duplicate ACKs the segment
+ * following the duplicate ACK is sent again.
+ * See TCP::ConCtlBase for the interface.
+ */
 class TcpConCtlSimple /*: public TCP::ConCtlBase */ {
 private:
 	uint32_t lastAck;
 	uint32_t alreadySeen;
 public:
-	void initSeq(uint32_t seq, uint32_t ack) {
-		(void)seq;
-		lastAck = ack;
+	void init(uint32_t seq, uint16_t mss) {
+		(void)mss;
+		lastAck = seq;
+		alreadySeen = 0;
 	};
 
-	void handlePacket(uint32_t seq, uint32_t ack) {
-		if((lastAck == ack) && (ack < seq)){
+	void handleAck(uint32_t ack, uint32_t bytesAcked, uint32_t sndMax,
+		std::chrono::steady_clock::time_point now) {
+		(void)now;
+		if((bytesAcked == 0) && (lastAck == ack) && TcpSeq::lt(ack, sndMax)){
 			alreadySeen++;
-//			std::cout << "ACK already seen: " << ack << " seq: " << seq << std::endl;
+//			std::cout << "ACK already seen: " << ack << " sndMax: " << sndMax << std::endl;
 		} else {
-//			std::cout << "New ACK: " << ack  << " seq: " << seq << std::endl;
+//			std::cout << "New ACK: " << ack  << " sndMax: " << sndMax << std::endl;
 			lastAck = ack;
 			alreadySeen = 0;
 		}
 	};
 
+	void handleRtt(std::chrono::microseconds rtt) { (void)rtt; };
+
+	void handleTimeout(uint32_t sndMax) {
+		(void)sndMax;
+		alreadySeen = 0;
+	};
+
 	bool reset(uint32_t &seq) {
 		if(alreadySeen >= 3){
 //			std::cout << "Resetting to: " << lastAck << std::endl;
 			seq = lastAck;
+			// Only reset once, until three more duplicates arrive
+			alreadySeen = 0;
 			return true;
 		}
 		return false;
 	};
 
-	unsigned int getConWindow() { return std::numeric_limits<unsigned int>::max(); };
+	bool inRecovery() const { return false; };
+
+	uint32_t getConWindow() const { return std::numeric_limits<uint32_t>::max(); };
+	uint32_t getSsthresh() const { return std::numeric_limits<uint32_t>::max(); };
 };
+
+#endif /* TCPCONCTLSIMPLE_HPP */
@@ -0,0 +1,187 @@
+#ifndef TCPGRO_HPP
+#define TCPGRO_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "headers.hpp"
+#include "mbuf.hpp"
+#include "pktParser.hpp"
+
+/*! Receive coalescing of TCP segments (software GRO)
+ *
+ * Consecutive in-order segments of a connection in one batch are merged
+ * into the first of them, before the batch is given to the StateMachine.
+ * The connection then runs once for all of them.
+ *
+ * The payload is not copied: The headers of a merged segment are cut off,
+ * and its buffer is chained to the first packet. The IPv4 length of the
+ * first packet covers all payload, the checksums are not updated.
+ * TCP::Server::runEst() takes such a chain apart again (see mbuf::splitNext()).
+ *
+ * As in Linux, only segments with the flags ACK (and PSH), the same
+ * acknowledgement, window and options, are merged. PSH ends a run, every
+ * other TCP packet of a connection ends it without being merged.
+ */
+class TcpGro {
+public:
+	//! Connections merged at the same time, more replace the older ones
+	static constexpr uint32_t maxFlows = 8;
+
+	//! Buffers chained to one packet at most
+	static constexpr uint16_t maxSegs = 64;
+
+private:
+	static constexpr uint8_t flagsAck = 0x10;
+	static constexpr uint8_t flagPsh = 0x08;
+
+	struct Flow {
+		// Network byte order
+		uint32_t srcIP;
+		uint32_t dstIP;
+		uint16_t srcPort;
+		uint16_t dstPort;
+
+		mbuf *head;			 // Packet the others are merged into
+		mbuf *last;			 // Last buffer of its chain
+		uint32_t nextSeq;	 // Sequence number expected next
+		uint16_t headersLen; // L2 to L4 headers of head
+	};
+
+	static bool sameFlow(const Flow &flow, Headers::IPv4 *ipv4, Headers::Tcp *tcp) {
+		return (flow.srcIP == ipv4->srcIP) && (flow.dstIP == ipv4->dstIP) &&
+			   (flow.srcPort == tcp->srcPort) && (flow.dstPort == tcp->dstPort);
+	}
+
+	// Can the payload of tcp be appended to the flow?
+	static bool canMerge(const Flow &flow, Headers::Tcp *tcp, uint16_t len) {
+		auto headIPv4 = PktParser::getIPv4(flow.head);
+		auto headTcp = PktParser::getTcp(flow.head);
+
+		if ((tcp->getSeq() != flow.nextSeq) || (tcp->ack != headTcp->ack) ||
+			(tcp->window != headTcp->window) ||
+			(tcp->getHeaderLen() != headTcp->getHeaderLen()) ||
+			(flow.head->nb_segs >= maxSegs) ||
+			(ntohs(headIPv4->total_length) + static_cast<uint32_t>(len) > 0xffff)) {
+			return false;
+		}
+
+		// Timestamps are only merged, if they are the same
+		return memcmp(reinterpret_cast<uint8_t *>(tcp) + sizeof(Headers::Tcp),
+				   reinterpret_cast<uint8_t *>(headTcp) + sizeof(Headers::Tcp),
+				   tcp->getHeaderLen() - sizeof(Headers::Tcp)) == 0;
+	}
+
+	static void merge(Flow &flow, mbuf *pkt, Headers::Tcp *tcp, uint16_t headersLen, uint16_t len) {
+		auto headIPv4 = PktParser::getIPv4(flow.head);
+		auto headTcp = PktParser::getTcp(flow.head);
+
+		// Cut off the Ethernet padding of the first packet
+		if (flow.last == flow.head) {
+			flow.head->setDataLen(flow.headersLen + headIPv4->getPayloadLength() -
+								  headTcp->getHeaderLen());
+		}
+
+		pkt->cutFront(headersLen);
+		pkt->setDataLen(len);
+
+		flow.last->next = pkt;
+		flow.last = pkt;
+		flow.head->nb_segs++;
+		flow.head->pkt_len += len;
+
+		headIPv4->setPayloadLength(headIPv4->getPayloadLength() + len);
+		headTcp->flags |= tcp->flags;
+		flow.nextSeq += len;
+	}
+
+public:
+	/*! Merge the segments of a batch
+	 *
+	 * The merged packets are removed from the array, the order of the
+	 * remaining ones is kept.
+	 *
+	 * \param pkts The received packets
+	 * \param count Number of packets in pkts
+	 * \return Number of packets left in pkts
+	 */
+	static uint32_t coalesce(mbuf **pkts, uint32_t count) {
+		Flow flows[maxFlows];
+		uint32_t numFlows = 0;
+		uint32_t nextReplaced = 0;
+		uint32_t numOut = 0;
+
+		for (uint32_t i = 0; i < count; i++) {
+			mbuf *pkt = pkts[i];
+			pkts[numOut++] = pkt;
+
+			PktParser::Result res;
+			if (!PktParser::parse(pkt, res) ||
+				(res.ethertype != Headers::Ethernet::ETHERTYPE_IPv4) ||
+				(res.proto != Headers::IPv4::PROTO_TCP)) {
+				continue;
+			}
+
+			auto ipv4 = PktParser::getIPv4(pkt);
+			auto tcp = PktParser::getTcp(pkt);
+			uint16_t headersLen = PktParser::getHeadersLen(pkt);
+
+			Flow *flow = nullptr;
+			for (uint32_t f = 0; f < numFlows; f++) {
+				if (sameFlow(flows[f], ipv4, tcp)) {
+					flow = &flows[f];
+					break;
+				}
+			}
+
+			// Plain data segments without IPv4 options or fragmentation
+			uint16_t ipPayload = ipv4->getPayloadLength();
+			bool mergeable = (pkt->next == nullptr) && (ipv4->ihl() == 5) &&
+							 ((ntohs(ipv4->flags_fragmentation) & 0x3fff) == 0) &&
+							 ((tcp->flags & ~flagPsh) == flagsAck) &&
+							 (ipPayload > tcp->getHeaderLen()) &&
+							 (pkt->getL2Len() + sizeof(Headers::IPv4) + ipPayload <=
+								 pkt->getDataLen());
+			uint16_t len = mergeable ? ipPayload - tcp->getHeaderLen() : 0;
+
+			if ((flow != nullptr) && mergeable && canMerge(*flow, tcp, len)) {
+				merge(*flow, pkt, tcp, headersLen, len);
+				numOut--;
+				if (tcp->flags & flagPsh) {
+					*flow = flows[--numFlows];
+				}
+				continue;
+			}
+
+			if (!mergeable || (tcp->flags & flagPsh)) {
+				if (flow != nullptr) {
+					*flow = flows[--numFlows];
+				}
+				continue;
+			}
+
+			// The packet starts a new run of its connection
+			if (flow == nullptr) {
+				if (numFlows < maxFlows) {
+					flow = &flows[numFlows++];
+				} else {
+					flow = &flows[nextReplaced];
+					nextReplaced = (nextReplaced + 1) % maxFlows;
+				}
+			}
+
+			flow->srcIP = ipv4->srcIP;
+			flow->dstIP = ipv4->dstIP;
+			flow->srcPort = tcp->srcPort;
+			flow->dstPort = tcp->dstPort;
+			flow->head = pkt;
+			flow->last = pkt;
+			flow->nextSeq = tcp->getSeq() + len;
+			flow->headersLen = headersLen;
+		}
+
+		return numOut;
+	}
+};
+
+#endif /* TCPGRO_HPP */
@@ -0,0 +1,75 @@
+#ifndef TCPGSO_HPP
+#define TCPGSO_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "checksumMbuf.hpp"
+#include "headers.hpp"
+#include "mbuf.hpp"
+
+/*! Software segmentation of TCP data (GSO)
+ *
+ * The segments a connection sends at once are written as frames in one pass.
+ * The headers are complete in the first frame only, every other frame copies
+ * them and only updates the sequence number, the IPv4 ID and the lengths.
+ *
+ * The payload is never copied. The buffer of a segment stays in the send ring
+ * of the connection (see TcpSendRing), every frame takes another reference to
+ * it (ref()) and chains it behind its headers. So the same buffer can be part
+ * of several frames at once, e.g. a retransmission sent while the NIC still
+ * holds the first one. It is always the last buffer of these chains, its next
+ * pointer stays unset. Chaining the segments into one large frame for TSO on
+ * the NIC would set it, for all frames sharing the buffer.
+ *
+ * A segment shared this way must not be changed (data, lengths or chain)
+ * until the NIC has freed all frames with it, i.e. it holds the only
+ * reference again.
+ */
+class TcpGso {
+public:
+	//! Segments written in one pass
+	static constexpr uint32_t maxSegments = 64;
+
+	/*! Write the frames of a burst of segments
+	 *
+	 * The checksums are left to the caller (see Checksum::setIPv4Tcp()).
+	 *
+	 * \param frames One buffer per segment, frames[0] holds the headers already
+	 * \param segs The segments, they need the fields pkt, seq and len
+	 * \param num Number of segments
+	 * \param l2Len Length of the L2 header
+	 * \param l3HeadersLen Length of the L2 and L3 headers
+	 * \param tcpHeaderLen Length of the TCP header, including the options
+	 * \param ipID IPv4 ID of the first frame, it is incremented for every frame
+	 */
+	template <class Segment>
+	static void write(mbuf **frames, const Segment *segs, uint32_t num, uint16_t l2Len,
+		uint16_t l3HeadersLen, uint16_t tcpHeaderLen, uint16_t &ipID) {
+		const uint8_t *tmpl = reinterpret_cast<uint8_t *>(frames[0]->getData());
+		uint16_t headersLen = l3HeadersLen + tcpHeaderLen;
+		uint16_t ipTotalLen = l3HeadersLen - l2Len + tcpHeaderLen;
+
+		for (uint32_t i = 0; i < num; i++) {
+			mbuf *frame = frames[i];
+			uint8_t *data = reinterpret_cast<uint8_t *>(frame->getData());
+			if (i > 0) {
+				memcpy(data, tmpl, headersLen);
+			}
+
+			auto ipv4 = reinterpret_cast<Headers::IPv4 *>(data + l2Len);
+			auto tcp = reinterpret_cast<Headers::Tcp *>(data + l3HeadersLen);
+			ipv4->id = htons(ipID++);
+			ipv4->total_length = htons(ipTotalLen + segs[i].len);
+			tcp->setSeq(segs[i].seq);
+
+			// The payload stays in the send ring, only chain another reference to it
+			segs[i].pkt->ref();
+			frame->setHeaderLens(l2Len, l3HeadersLen - l2Len, tcpHeaderLen);
+			frame->setDataLen(headersLen);
+			frame->chain(segs[i].pkt);
+		}
+	}
+};
+
+#endif /* TCPGSO_HPP */
@@ -0,0 +1,197 @@
+#ifndef TCPOPTIONS_HPP
+#define TCPOPTIONS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "headers.hpp"
+
+/*! Parsing and writing of TCP options
+ *
+ * Only the options in use by TCP::Server are handled, all others are
+ * skipped while parsing.
+ */
+namespace TcpOptions {
+
+static constexpr uint8_t KIND_EOL = 0;
+static constexpr uint8_t KIND_NOP = 1;
+static constexpr uint8_t KIND_MSS = 2;
+static constexpr uint8_t KIND_WSCALE = 3;
+static constexpr uint8_t KIND_SACK_PERMITTED = 4;
+static constexpr uint8_t KIND_SACK = 5;
+static constexpr uint8_t KIND_TIMESTAMP = 8;
+
+// Larger shifts are treated as 14 (RFC 7323)
+static constexpr uint8_t maxWscale = 14;
+
+// 40 bytes of options, minus two NOPs and kind and length, leave room for
+// four SACK blocks. Three are sent, as other stacks do, which leaves space
+// for the timestamp option.
+static constexpr uint8_t maxSackBlocks = 4;
+static constexpr uint8_t sendSackBlocks = 3;
+
+//! One block of contiguous data received, [left, right)
+struct SackBlock {
+	uint32_t left;
+	uint32_t right;
+};
+
+//! The options of one received segment
+struct Parsed {
+	uint16_t mss = 0; //!< 0, if the option is missing
+	bool hasWscale = false;
+	uint8_t wscale = 0;
+	bool sackPermitted = false;
+	bool hasTimestamp = false;
+	uint32_t tsVal = 0;
+	uint32_t tsEcr = 0;
+	uint8_t numSackBlocks = 0;
+	SackBlock sackBlocks[maxSackBlocks];
+};
+
+inline uint32_t read32(const uint8_t *p) {
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return ntohl(v);
+}
+
+inline void write32(uint8_t *p, uint32_t v) {
+	v = htonl(v);
+	memcpy(p, &v, sizeof(v));
+}
+
+/*! Parse the options of a TCP header
+ *
+ * Malformed options end the parsing, what was found so far is kept.
+ *
+ * \param tcp The TCP header, the options have to follow it
+ * \param res The options are written here
+ */
+inline void parse(Headers::Tcp *tcp, Parsed &res) {
+	const uint8_t *opt = reinterpret_cast<const uint8_t *>(tcp->getPayload());
+	const uint8_t *end = reinterpret_cast<const uint8_t *>(tcp) + tcp->getHeaderLen();
+
+	while (opt < end) {
+		uint8_t kind = opt[0];
+		if (kind == KIND_EOL) {
+			return;
+		}
+		if (kind == KIND_NOP) {
+			opt++;
+			continue;
+		}
+
+		if ((opt + 2 > end) || (opt[1] < 2) || (opt + opt[1] > end)) {
+			return;
+		}
+		uint8_t len = opt[1];
+
+		if ((kind == KIND_MSS) && (len == 4)) {
+			res.mss = (opt[2] << 8) | opt[3];
+		} else if ((kind == KIND_WSCALE) && (len == 3)) {
+			res.hasWscale = true;
+			res.wscale = std::min(opt[2], maxWscale);
+		} else if ((kind == KIND_TIMESTAMP) && (len == 10)) {
+			res.hasTimestamp = true;
+			res.tsVal = read32(opt + 2);
+			res.tsEcr = read32(opt + 6);
+		} else if ((kind == KIND_SACK_PERMITTED) && (len == 2)) {
+			res.sackPermitted = true;
+		} else if ((kind == KIND_SACK) && ((len - 2) % 8 == 0)) {
+			res.numSackBlocks = 0;
+			for (const uint8_t *block = opt + 2;
+				 (block < opt + len) && (res.numSackBlocks < maxSackBlocks); block += 8) {
+				SackBlock &b = res.sackBlocks[res.numSackBlocks++];
+				b.left = read32(block);
+				b.right = read32(block + 4);
+			}
+		}
+		opt += len;
+	}
+}
+
+/*! Write the MSS option (for SYN segments)
+ *
+ * \param opt The option is written here
+ * \param mss Largest segment size to receive
+ * \return Number of bytes written, a multiple of four
+ */
+inline uint8_t writeMss(uint8_t *opt, uint16_t mss) {
+	opt[0] = KIND_MSS;
+	opt[1] = 4;
+	opt[2] = mss >> 8;
+	opt[3] = mss & 0xff;
+	return 4;
+}
+
+/*! Write the window scale option (for SYN segments)
+ *
+ * \param opt The option is written here
+ * \param shift Shift of the windows sent after the SYN
+ * \return Number of bytes written, a multiple of four
+ */
+inline uint8_t writeWscale(uint8_t *opt, uint8_t shift) {
+	opt[0] = KIND_NOP;
+	opt[1] = KIND_WSCALE;
+	opt[2] = 3;
+	opt[3] = shift;
+	return 4;
+}
+
+/*! Write the timestamp option
+ *
+ * \param opt The option is written here
+ * \param tsVal Current value of the timestamp clock
+ * \param tsEcr Timestamp to echo to the peer
+ * \return Number of bytes written, a multiple of four
+ */
+inline uint8_t writeTimestamp(uint8_t *opt, uint32_t tsVal, uint32_t tsEcr) {
+	opt[0] = KIND_NOP;
+	opt[1] = KIND_NOP;
+	opt[2] = KIND_TIMESTAMP;
+	opt[3] = 10;
+	write32(opt + 4, tsVal);
+	write32(opt + 8, tsEcr);
+	return 12;
+}
+
+/*! Write the SACK permitted option (for SYN segments)
+ *
+ * \param opt The option is written here
+ * \return Number of bytes written, a multiple of four
+ */
+inline uint8_t writeSackPermitted(uint8_t *opt) {
+	opt[0] = KIND_NOP;
+	opt[1] = KIND_NOP;
+	opt[2] = KIND_SACK_PERMITTED;
+	opt[3] = 2;
+	return 4;
+}
+
+/*! Write a SACK option
+ *
+ * \param opt The option is written here
+ * \param blocks The SACK blocks
+ * \param numBlocks Number of blocks, at most maxSackBlocks
+ * \return Number of bytes written, a multiple of four
+ */
+inline uint8_t writeSack(uint8_t *opt, const SackBlock *blocks, uint8_t numBlocks) {
+	if (numBlocks == 0) {
+		return 0;
+	}
+
+	opt[0] = KIND_NOP;
+	opt[1] = KIND_NOP;
+	opt[2] = KIND_SACK;
+	opt[3] = 2 + 8 * numBlocks;
+	for (uint8_t i = 0; i < numBlocks; i++) {
+		write32(opt + 4 + 8 * i, blocks[i].left);
+		write32(opt + 8 + 8 * i, blocks[i].right);
+	}
+	return 4 + 8 * numBlocks;
+}
+
+}; // namespace TcpOptions
+
+#endif /* TCPOPTIONS_HPP */
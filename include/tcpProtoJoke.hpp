@@ -12,8 +12,7 @@ public:
 		std::string str("The good thing about TCP jokes is, that you always get them.");
 		tcpIface.sendData(reinterpret_cast<const uint8_t *>(str.c_str()), str.length());
 		*/
-		uint8_t* dataCpy = reinterpret_cast<uint8_t*>(malloc(dataLen));
-		memcpy(dataCpy, data, dataLen);
-		tcpIface.sendData(dataCpy, dataLen);
+		// sendData() copies the data into the send buffer
+		tcpIface.sendData(data, dataLen);
 	};
 };
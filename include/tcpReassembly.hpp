@@ -0,0 +1,199 @@
+#ifndef TCPREASSEMBLY_HPP
+#define TCPREASSEMBLY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "tcpOptions.hpp"
+#include "tcpSeq.hpp"
+
+/*! Receive queue for out-of-order data of one TCP connection
+ *
+ * Segments arriving ahead of the next expected byte are kept in the packet
+ * buffers they arrived in, the queue only holds a reference.
+ * The segments are stored in a list ordered by sequence number, they never
+ * overlap: Parts of a new segment, which were queued already, are cut off.
+ * Contiguous segments form the SACK blocks reported to the peer (RFC 2018).
+ *
+ * The packet class needs to provide the following functions:
+ * \code{.cpp}
+ * void ref();     // Take another reference
+ * void release(); // Drop one reference, free the buffer with the last one
+ * \endcode
+ *
+ * \tparam Packet The packet class in use
+ */
+template <class Packet> class TcpReassembly {
+public:
+	//! Without a real receive buffer, the queue is limited in segments
+	static constexpr uint32_t maxSegments = 256;
+
+	struct Segment {
+		Packet *pkt;   //!< Buffer holding the payload
+		uint8_t *data; //!< First byte of the payload
+		uint32_t seq;  //!< Sequence number of the first byte
+		uint16_t len;  //!< Length of the payload
+	};
+
+private:
+	std::vector<Segment> segs;
+
+	// The most recently received segment is reported first (RFC 2018)
+	uint32_t lastSeq = 0;
+
+	typename std::vector<Segment>::iterator lowerBound(uint32_t seq) {
+		return std::lower_bound(segs.begin(), segs.end(), seq,
+			[](const Segment &s, uint32_t seq) { return TcpSeq::lt(s.seq, seq); });
+	}
+
+	typename std::vector<Segment>::const_iterator lowerBoundConst(uint32_t seq) const {
+		return std::lower_bound(segs.begin(), segs.end(), seq,
+			[](const Segment &s, uint32_t seq) { return TcpSeq::lt(s.seq, seq); });
+	}
+
+	// The block of contiguous segments around it
+	TcpOptions::SackBlock mergeBlock(typename std::vector<Segment>::const_iterator it) const {
+		auto first = it;
+		while ((first != segs.begin()) && ((first - 1)->seq + (first - 1)->len == first->seq)) {
+			first--;
+		}
+		auto last = it;
+		while ((last + 1 != segs.end()) && (last->seq + last->len == (last + 1)->seq)) {
+			last++;
+		}
+		return TcpOptions::SackBlock{first->seq, last->seq + last->len};
+	}
+
+public:
+	TcpReassembly() = default;
+	TcpReassembly(const TcpReassembly &) = delete;
+	TcpReassembly &operator=(const TcpReassembly &) = delete;
+
+	~TcpReassembly() {
+		for (auto &seg : segs) {
+			seg.pkt->release();
+		}
+	}
+
+	/*! Queue a segment received out of order
+	 *
+	 * Only the part of the segment before the next queued segment is kept,
+	 * the rest was received already, or will be sent again by the peer.
+	 * If the segment is queued, the queue takes another reference to pkt.
+	 *
+	 * \param rcvNxt Next byte expected in order
+	 * \param pkt Buffer holding the payload
+	 * \param data First byte of the payload
+	 * \param seq Sequence number of the first byte
+	 * \param len Length of the payload
+	 * \return True, if (a part of) the segment was queued
+	 */
+	bool insert(uint32_t rcvNxt, Packet *pkt, uint8_t *data, uint32_t seq, uint16_t len) {
+		uint32_t end = seq + len;
+		if (!TcpSeq::lt(rcvNxt, end)) {
+			return false;
+		}
+		if (TcpSeq::lt(seq, rcvNxt)) {
+			data += rcvNxt - seq;
+			seq = rcvNxt;
+		}
+
+		auto it = lowerBound(seq);
+		if (it != segs.begin()) {
+			auto prev = it - 1;
+			uint32_t prevEnd = prev->seq + prev->len;
+			if (TcpSeq::lt(seq, prevEnd)) {
+				data += prevEnd - seq;
+				seq = prevEnd;
+			}
+		}
+		if ((it != segs.end()) && TcpSeq::lt(it->seq, end)) {
+			end = it->seq;
+		}
+		if (!TcpSeq::lt(seq, end) || (segs.size() >= maxSegments)) {
+			return false;
+		}
+
+		pkt->ref();
+		segs.insert(it, Segment{pkt, data, seq, static_cast<uint16_t>(end - seq)});
+		lastSeq = seq;
+		return true;
+	}
+
+	/*! Take the next segment in order
+	 *
+	 * The segment may start before rcvNxt, if it overlaps with data received
+	 * in order in the meantime, it is cut off then.
+	 * The caller takes over the reference to the packet.
+	 *
+	 * \param rcvNxt Next byte expected in order
+	 * \param seg The segment is written here
+	 * \return True, if a segment was taken
+	 */
+	bool pop(uint32_t rcvNxt, Segment &seg) {
+		while (!segs.empty()) {
+			Segment &first = segs.front();
+			if (TcpSeq::lt(rcvNxt, first.seq)) {
+				return false;
+			}
+
+			uint32_t end = first.seq + first.len;
+			if (!TcpSeq::lt(rcvNxt, end)) {
+				// Received in order already
+				first.pkt->release();
+				segs.erase(segs.begin());
+				continue;
+			}
+
+			seg = first;
+			seg.data += rcvNxt - first.seq;
+			seg.seq = rcvNxt;
+			seg.len = end - rcvNxt;
+			segs.erase(segs.begin());
+			return true;
+		}
+		return false;
+	}
+
+	/*! Get the SACK blocks to report to the peer
+	 *
+	 * The block holding the most recently received segment comes first,
+	 * the others follow from the highest sequence number down.
+	 *
+	 * \param blocks The blocks are written here
+	 * \param maxBlocks Maximum number of blocks to write
+	 * \return Number of blocks written
+	 */
+	uint8_t getSackBlocks(TcpOptions::SackBlock *blocks, uint8_t maxBlocks) const {
+		if (segs.empty() || (maxBlocks == 0)) {
+			return 0;
+		}
+
+		uint8_t num = 0;
+
+		// The block holding the last segment received, if it is still queued
+		auto recent = lowerBoundConst(lastSeq);
+		if ((recent != segs.end()) && (recent->seq == lastSeq)) {
+			blocks[num++] = mergeBlock(recent);
+		}
+
+		// Walk the contiguous blocks from the highest one down
+		auto it = segs.end();
+		while ((it != segs.begin()) && (num < maxBlocks)) {
+			TcpOptions::SackBlock block = mergeBlock(it - 1);
+			it = lowerBoundConst(block.left);
+			if ((num == 0) || (blocks[0].left != block.left)) {
+				blocks[num++] = block;
+			}
+		}
+		return num;
+	}
+
+	bool empty() const { return segs.empty(); }
+
+	/*! Number of segments held by the queue */
+	uint32_t getNumSegments() const { return segs.size(); }
+};
+
+#endif /* TCPREASSEMBLY_HPP */
@@ -0,0 +1,58 @@
+#ifndef TCPRTO_HPP
+#define TCPRTO_HPP
+
+#include <algorithm>
+#include <chrono>
+
+/*! Retransmission timeout of one TCP connection (RFC 6298)
+ *
+ * The RTO is derived from the smoothed RTT and its variation, every timeout
+ * doubles it, until the next RTT sample arrives.
+ * Other than the 1 second of the RFC, the minimum RTO is 200 ms (as in Linux),
+ * which suits the short RTTs MoonState usually runs at better.
+ */
+class TcpRto {
+public:
+	using duration = std::chrono::microseconds;
+
+	static constexpr duration initialRto() { return std::chrono::seconds(1); }
+	static constexpr duration minRto() { return std::chrono::milliseconds(200); }
+	static constexpr duration maxRto() { return std::chrono::seconds(60); }
+
+	// Granularity of the StateMachine timeouts
+	static constexpr duration granularity() { return std::chrono::milliseconds(1); }
+
+private:
+	duration srtt = duration(0);
+	duration rttvar = duration(0);
+	duration rto = initialRto();
+
+public:
+	/*! Add an RTT sample
+	 *
+	 * Samples must not be taken from retransmitted segments (Karn's algorithm).
+	 *
+	 * \param rtt The measured round trip time
+	 */
+	void sample(duration rtt) {
+		if (srtt.count() == 0) {
+			srtt = rtt;
+			rttvar = rtt / 2;
+		} else {
+			duration delta = srtt > rtt ? srtt - rtt : rtt - srtt;
+			rttvar = (3 * rttvar + delta) / 4;
+			srtt = (7 * srtt + rtt) / 8;
+		}
+
+		rto = std::max(
+			minRto(), std::min(maxRto(), srtt + std::max(granularity(), 4 * rttvar)));
+	}
+
+	/*! Double the RTO after it expired */
+	void backoff() { rto = std::min(maxRto(), 2 * rto); }
+
+	duration get() const { return rto; }
+	duration getSrtt() const { return srtt; }
+};
+
+#endif /* TCPRTO_HPP */
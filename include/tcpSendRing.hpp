@@ -0,0 +1,344 @@
+#ifndef TCPSENDRING_HPP
+#define TCPSENDRING_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+#include "tcpSeq.hpp"
+
+/*! Send queue of one TCP connection
+ *
+ * The payload of every segment lives in its own packet buffer, the queue
+ * only holds a reference to it.
+ * Transmitting a segment means taking another reference and chaining the
+ * buffer behind the headers, the payload is never copied.
+ *
+ * The segments are kept in a circular array, ordered by sequence number.
+ * It tracks three sequence numbers:
+ * - una: The first byte, which is not acknowledged yet
+ * - nxt: The next byte to send
+ * - end: The byte after the last one queued
+ *
+ * Bytes in [una, nxt) are in flight, bytes in [nxt, end) wait to be sent.
+ * In addition, max is the highest nxt ever reached, bytes below it were
+ * sent at least once.
+ * A cumulative ACK releases the acknowledged segments at the head,
+ * a retransmission moves nxt back to the segment holding the given
+ * sequence number.
+ *
+ * Segments in flight can be marked as received by SACK blocks of the peer
+ * (RFC 2018). Together with the segments retransmitted already, this
+ * scoreboard tells which holes are lost (RFC 6675).
+ *
+ * The packet class needs to provide the following function:
+ * \code{.cpp}
+ * void release(); // Drop one reference, free the buffer with the last one
+ * \endcode
+ *
+ * \tparam Packet The packet class in use
+ */
+template <class Packet> class TcpSendRing {
+public:
+	struct Segment {
+		Packet *pkt;		//!< Buffer holding the payload
+		uint32_t seq;		//!< Sequence number of the first byte
+		uint16_t len;		//!< Length of the payload
+		bool sacked;		//!< The peer reported the segment in a SACK block
+		bool retransmitted; //!< Retransmitted since the last timeout
+	};
+
+private:
+	static constexpr uint32_t minCapacity = 64;
+
+	// A hole is lost, once this many segments above it were SACKed (RFC 6675)
+	static constexpr uint32_t dupThresh = 3;
+
+	Segment *segs;
+	uint32_t capacity;
+
+	// Free running indices into segs, the position is (idx & (capacity - 1))
+	uint32_t headIdx;
+	uint32_t nxtIdx;
+	uint32_t tailIdx;
+
+	uint32_t una;
+	uint32_t nxt;
+	uint32_t end;
+	uint32_t max;
+
+	// Number of segments marked as SACKed
+	uint32_t sackedSegs;
+
+	Segment &at(uint32_t idx) const { return segs[idx & (capacity - 1)]; }
+
+	// Binary search for the segment holding seq in [headIdx, hi)
+	uint32_t search(uint32_t seq, uint32_t hi) const {
+		uint32_t lo = headIdx;
+		while (hi - lo > 1) {
+			uint32_t mid = lo + (hi - lo) / 2;
+			if (TcpSeq::le(at(mid).seq, seq)) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo;
+	}
+
+	void grow() {
+		uint32_t newCapacity = capacity == 0 ? minCapacity : capacity * 2;
+		Segment *newSegs = reinterpret_cast<Segment *>(malloc(newCapacity * sizeof(Segment)));
+		if (newSegs == nullptr) {
+			throw new std::bad_alloc();
+		}
+
+		for (uint32_t idx = headIdx; idx != tailIdx; idx++) {
+			newSegs[idx & (newCapacity - 1)] = at(idx);
+		}
+
+		free(segs);
+		segs = newSegs;
+		capacity = newCapacity;
+	}
+
+public:
+	TcpSendRing()
+		: segs(nullptr), capacity(0), headIdx(0), nxtIdx(0), tailIdx(0), una(0), nxt(0),
+		  end(0), max(0), sackedSegs(0){};
+	TcpSendRing(const TcpSendRing &) = delete;
+	TcpSendRing &operator=(const TcpSendRing &) = delete;
+
+	~TcpSendRing() {
+		for (uint32_t idx = headIdx; idx != tailIdx; idx++) {
+			at(idx).pkt->release();
+		}
+		free(segs);
+	}
+
+	/*! Set the sequence number of the first byte
+	 *
+	 * Must only be called, while the queue is empty.
+	 *
+	 * \param seq Sequence number of the first byte to send
+	 */
+	void init(uint32_t seq) {
+		una = seq;
+		nxt = seq;
+		end = seq;
+		max = seq;
+	}
+
+	/*! Append a segment
+	 *
+	 * The queue takes over the reference to pkt.
+	 *
+	 * \param pkt Buffer holding the payload
+	 * \param len Length of the payload
+	 */
+	void push(Packet *pkt, uint16_t len) {
+		if (tailIdx - headIdx == capacity) {
+			grow();
+		}
+
+		Segment &seg = at(tailIdx++);
+		seg.pkt = pkt;
+		seg.seq = end;
+		seg.len = len;
+		seg.sacked = false;
+		seg.retransmitted = false;
+		end += len;
+	}
+
+	/*! Process a cumulative ACK
+	 *
+	 * Fully acknowledged segments are released.
+	 * ACKs for old or not yet sent data are ignored.
+	 *
+	 * \param ack Acknowledgement number of the received segment
+	 * \return Number of bytes acknowledged
+	 */
+	uint32_t ack(uint32_t ack) {
+		if (!TcpSeq::le(una, ack) || !TcpSeq::le(ack, max)) {
+			return 0;
+		}
+
+		while (headIdx != tailIdx) {
+			Segment &seg = at(headIdx);
+			if (TcpSeq::lt(ack, seg.seq + seg.len)) {
+				break;
+			}
+			sackedSegs -= seg.sacked;
+			seg.pkt->release();
+			headIdx++;
+		}
+
+		uint32_t acked = ack - una;
+		una = ack;
+
+		// The ACK may cover segments, which were rewound for retransmission
+		if (TcpSeq::lt(nxt, una)) {
+			nxt = una;
+		}
+		if (nxtIdx - headIdx > tailIdx - headIdx) {
+			nxtIdx = headIdx;
+		}
+		return acked;
+	}
+
+	/*! Go back to seq, in order to retransmit everything from there on
+	 *
+	 * Retransmission starts with the segment holding seq.
+	 * seq is clamped to the bytes in flight.
+	 * The scoreboard is cleared, after a timeout the peer may have dropped
+	 * data it reported in SACK blocks before (RFC 2018).
+	 *
+	 * \param seq Sequence number to resend from
+	 */
+	void rewind(uint32_t seq) {
+		if (!TcpSeq::lt(seq, nxt) || (nxtIdx == headIdx)) {
+			return;
+		}
+
+		for (uint32_t idx = headIdx; idx != nxtIdx; idx++) {
+			at(idx).sacked = false;
+			at(idx).retransmitted = false;
+		}
+		sackedSegs = 0;
+
+		uint32_t lo = search(seq, nxtIdx);
+
+		// The first segment may be acknowledged in parts
+		nxtIdx = lo;
+		nxt = TcpSeq::lt(at(lo).seq, una) ? una : at(lo).seq;
+	}
+
+	/*! Get the segment holding seq, in order to retransmit only this one
+	 *
+	 * Other than rewind(), nxt is not changed.
+	 * The queue keeps its reference to the packet.
+	 *
+	 * \param seq Sequence number of a byte, which was sent before
+	 * \param seg The segment is written here
+	 * \return True, if a segment holding seq was found
+	 */
+	bool find(uint32_t seq, Segment &seg) const {
+		if (!TcpSeq::le(una, seq) || !TcpSeq::lt(seq, max) || (headIdx == tailIdx)) {
+			return false;
+		}
+
+		seg = at(search(seq, tailIdx));
+		return true;
+	}
+
+	/*! Mark the segments covered by a SACK block
+	 *
+	 * Only segments in flight are marked, and only if the block covers
+	 * them completely.
+	 *
+	 * \param left First byte of the block
+	 * \param right The byte after the block
+	 * \return Number of segments marked newly
+	 */
+	uint32_t sack(uint32_t left, uint32_t right) {
+		if (TcpSeq::lt(left, una)) {
+			left = una;
+		}
+		if (TcpSeq::lt(nxt, right)) {
+			right = nxt;
+		}
+		if (!TcpSeq::lt(left, right)) {
+			return 0;
+		}
+
+		uint32_t idx = search(left, nxtIdx);
+		if (TcpSeq::lt(at(idx).seq, left)) {
+			idx++;
+		}
+
+		uint32_t marked = 0;
+		for (; idx != nxtIdx; idx++) {
+			Segment &seg = at(idx);
+			if (TcpSeq::lt(right, seg.seq + seg.len)) {
+				break;
+			}
+			if (!seg.sacked) {
+				seg.sacked = true;
+				marked++;
+			}
+		}
+		sackedSegs += marked;
+		return marked;
+	}
+
+	/*! Get the next lost segment, which was not retransmitted yet
+	 *
+	 * A segment is considered lost, if at least dupThresh segments above it
+	 * were SACKed (RFC 6675, in segments instead of bytes).
+	 * The segment is marked as retransmitted, the queue keeps its reference
+	 * to the packet.
+	 *
+	 * \param seg The segment is written here
+	 * \return True, if a lost segment was found
+	 */
+	bool nextLost(Segment &seg) {
+		uint32_t sackedAbove = sackedSegs;
+		for (uint32_t idx = headIdx; (idx != nxtIdx) && (sackedAbove >= dupThresh); idx++) {
+			Segment &cur = at(idx);
+			if (cur.sacked) {
+				sackedAbove--;
+			} else if (!cur.retransmitted) {
+				cur.retransmitted = true;
+				seg = cur;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/*! Take the next segment to send
+	 *
+	 * Segments are never split, if the next one is longer than maxLen,
+	 * nothing is taken.
+	 * The queue keeps its reference to the packet.
+	 *
+	 * \param maxLen Maximum length of the segment
+	 * \param seg The segment is written here
+	 * \return True, if a segment was taken
+	 */
+	bool take(uint32_t maxLen, Segment &seg) {
+		if ((nxtIdx == tailIdx) || (at(nxtIdx).len > maxLen)) {
+			return false;
+		}
+
+		seg = at(nxtIdx++);
+		nxt = seg.seq + seg.len;
+		if (TcpSeq::lt(max, nxt)) {
+			max = nxt;
+		}
+		return true;
+	}
+
+	uint32_t getUna() const { return una; }
+	uint32_t getNxt() const { return nxt; }
+	uint32_t getEnd() const { return end; }
+	uint32_t getMax() const { return max; }
+
+	/*! Number of bytes sent, but not acknowledged */
+	uint32_t getInFlight() const { return nxt - una; }
+
+	/*! Number of bytes not sent yet */
+	uint32_t getUnsent() const { return end - nxt; }
+
+	/*! Number of bytes held by the queue */
+	uint32_t getBuffered() const { return end - una; }
+
+	/*! Number of segments in flight marked as SACKed */
+	uint32_t getSackedSegments() const { return sackedSegs; }
+
+	/*! Number of segments held by the queue */
+	uint32_t getNumSegments() const { return tailIdx - headIdx; }
+};
+
+#endif /* TCPSENDRING_HPP */
@@ -0,0 +1,18 @@
+#ifndef TCPSEQ_HPP
+#define TCPSEQ_HPP
+
+#include <cstdint>
+
+/*! Comparison of TCP sequence numbers
+ *
+ * Sequence numbers wrap around, a is considered smaller than b, if b is
+ * less than 2^31 bytes ahead of a (RFC 1982).
+ */
+namespace TcpSeq {
+
+inline bool lt(uint32_t a, uint32_t b) { return static_cast<int32_t>(b - a) > 0; }
+inline bool le(uint32_t a, uint32_t b) { return static_cast<int32_t>(b - a) >= 0; }
+
+}; // namespace TcpSeq
+
+#endif /* TCPSEQ_HPP */
@@ -0,0 +1,159 @@
+#ifndef TCPSERVER_C_HPP
+#define TCPSERVER_C_HPP
+
+#include <cstdint>
+
+#include <rte_mbuf.h>
+#include <rte_mempool.h>
+
+#include "tcp.hpp"
+
+extern "C" {
+
+/*! Statistics of a TCP server, see TCP_Server_<NAME>_getStats() */
+struct TCP_Server_Stats {
+	uint64_t connections;       //!< Connections currently tracked
+	uint64_t connectionsOpened; //!< Connections created so far
+	uint64_t connectionsClosed; //!< Connections removed so far
+	uint64_t pktsIn;            //!< Packets handed to process()
+	uint64_t pktsSent;          //!< Packets returned to be sent
+	uint64_t pktsFreed;         //!< Packets returned to be freed
+	uint64_t pktsMerged;        //!< Packets merged into others by GRO, they are not returned
+};
+};
+
+namespace TCP {
+
+/*! The C interface of TCP::Server<Proto, ConCtl>
+ *
+ * All functions work on an opaque object, so they can be handed to C (and
+ * Lua) as they are. Use TCP_SERVER_C_ABI() to export them for a protocol.
+ */
+template <class Proto, class ConCtl> class ServerC {
+private:
+	using Srv = Server<Proto, ConCtl>;
+
+	struct Instance {
+		StateMachine<Identifier, mbuf> sm;
+		struct TCP_Server_Stats stats;
+		bool gro = false;
+	};
+
+public:
+	/*! Init a TCP server
+	 *
+	 * All states are registered, including the teardown.
+	 *
+	 * \param mp Mempool to allocate the packets sent in addition from
+	 * \return void* to the object (opaque)
+	 */
+	static void *init(struct rte_mempool *mp);
+
+	/*! Enable or disable SYN cookies
+	 *
+	 * \param obj object returned by init()
+	 * \param enable Answer SYNs without creating a state (see Server::preAccept())
+	 */
+	static void setSynCookies(void *obj, bool enable);
+
+	/*! Enable or disable receive coalescing
+	 *
+	 * \param obj object returned by init()
+	 * \param enable Merge the segments of a connection in a batch (see TcpGro)
+	 *
+	 * process() removes the merged packets from inPkts then.
+	 */
+	static void setGro(void *obj, bool enable);
+
+	/*! Enable or disable checksum offloading
+	 *
+	 * This is a setting of the whole process (see Checksum::setOffload()),
+	 * all ports the packets are sent on have to support it.
+	 *
+	 * \param obj object returned by init()
+	 * \param enable Let the NIC fill in the IPv4 and TCP checksums
+	 */
+	static void setChecksumOffload(void *obj, bool enable);
+
+	/*! Process a batch of packets
+	 *
+	 * \param obj object returned by init()
+	 * \param inPkts incoming packets to process
+	 * \param inCount number of incoming packets
+	 * \param sendCount Number of packets in sendPkts
+	 * \param freeCount Number of packets in freePkts
+	 * \return void* to BufArray object (give to getPkts() )
+	 */
+	static void *process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
+		unsigned int *sendCount, unsigned int *freeCount);
+
+	/*! Get the packets to send and free
+	 *
+	 * \param obj object returned by process()
+	 * \param sendPkts Packets to send out (size if given in sendCount)
+	 * \param freePkts Packets to free (size if given in freeCount)
+	 */
+	static void getPkts(void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts);
+
+	/*! Get the statistics
+	 *
+	 * \param obj object returned by init()
+	 * \param stats The statistics are written here
+	 */
+	static void getStats(void *obj, struct TCP_Server_Stats *stats);
+
+	/*! Free recources used by the state machine
+	 *
+	 * \param obj object returned by init()
+	 */
+	static void free(void *obj);
+};
+
+}; // namespace TCP
+
+/*! Export the C interface of TCP::Server<PROTO, CONCTL>
+ *
+ * The functions are named TCP_Server_<NAME>_init(), _setSynCookies(), _setGro(),
+ * _setChecksumOffload(), _process(), _getPkts(), _getStats() and _free().
+ * Use it once per protocol, in one translation unit (see src/tcpJoke.cpp).
+ * PROTO and CONCTL must not contain commas, use an alias for those.
+ */
+#define TCP_SERVER_C_ABI(NAME, PROTO, CONCTL)                                                \
+	extern "C" {                                                                           \
+	void *TCP_Server_##NAME##_init(struct rte_mempool *mp) {                               \
+		return TCP::ServerC<PROTO, CONCTL>::init(mp);                                      \
+	}                                                                                      \
+	void TCP_Server_##NAME##_setSynCookies(void *obj, bool enable) {                       \
+		TCP::ServerC<PROTO, CONCTL>::setSynCookies(obj, enable);                           \
+	}                                                                                      \
+	void TCP_Server_##NAME##_setGro(void *obj, bool enable) {                              \
+		TCP::ServerC<PROTO, CONCTL>::setGro(obj, enable);                                  \
+	}                                                                                      \
+	void TCP_Server_##NAME##_setChecksumOffload(void *obj, bool enable) {                  \
+		TCP::ServerC<PROTO, CONCTL>::setChecksumOffload(obj, enable);                      \
+	}                                                                                      \
+	void *TCP_Server_##NAME##_process(void *obj, struct rte_mbuf **inPkts,                 \
+		unsigned int inCount, unsigned int *sendCount, unsigned int *freeCount) {          \
+		return TCP::ServerC<PROTO, CONCTL>::process(                                       \
+			obj, inPkts, inCount, sendCount, freeCount);                                   \
+	}                                                                                      \
+	void TCP_Server_##NAME##_getPkts(                                                      \
+		void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts) {               \
+		TCP::ServerC<PROTO, CONCTL>::getPkts(obj, sendPkts, freePkts);                     \
+	}                                                                                      \
+	void TCP_Server_##NAME##_getStats(void *obj, struct TCP_Server_Stats *stats) {         \
+		TCP::ServerC<PROTO, CONCTL>::getStats(obj, stats);                                 \
+	}                                                                                      \
+	void TCP_Server_##NAME##_free(void *obj) { TCP::ServerC<PROTO, CONCTL>::free(obj); }   \
+	}
+
+/*
+ * YCM definition is a workaround for a libclang bug
+ * When compiling, YCM should never be set.
+ * Set YCM in a libclang based IDE in order to avoid errors
+ */
+#ifndef YCM
+#include "../src/tcpServer_C.cpp"
+#endif
+
+#endif /* TCPSERVER_C_HPP */
@@ -0,0 +1,149 @@
+#ifndef TCPSYNCOOKIE_HPP
+#define TCPSYNCOOKIE_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#include "sodium.h"
+
+/*! Stateless SYN cookies
+ *
+ * The sequence number of the SYN ACK carries everything needed to create the
+ * connection, once the ACK of the handshake returns it:
+ * - Bits 31-27: Time counter, it advances every 64 seconds
+ * - Bits 26-25: Index of the MSS of the peer in the MSS table (rounded down)
+ * - Bit 24: The peer sent SACK permitted
+ * - Bits 23-0: Keyed hash over the addresses, the ports, the ISN of the peer,
+ *   the full time counter and the bits above
+ *
+ * The hash is SipHash-2-4 with a random key per process, cookies older than
+ * maxAge ticks of the time counter are rejected.
+ */
+class TcpSynCookie {
+public:
+	using time_point = std::chrono::steady_clock::time_point;
+
+	struct Key {
+		uint8_t k[crypto_shorthash_KEYBYTES];
+
+		Key() { randombytes_buf(k, sizeof(k)); };
+	};
+
+	//! Number of counter ticks, after which a cookie expires
+	static constexpr uint32_t maxAge = 2;
+
+	//! Number of MSS values a cookie can hold
+	static constexpr uint8_t numMss = 4;
+
+private:
+	static constexpr uint32_t hashMask = 0xffffff;
+	static constexpr unsigned int counterShift = 27;
+	static constexpr unsigned int mssShift = 25;
+	static constexpr unsigned int sackShift = 24;
+
+	static uint32_t getCounter(time_point now) {
+		return std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch())
+				   .count() >>
+			6;
+	}
+
+	static uint32_t hash(uint32_t peerIP, uint32_t localIP, uint16_t peerPort,
+		uint16_t localPort, uint32_t peerIsn, uint32_t counter, uint32_t bits) {
+		uint64_t words[3];
+		words[0] = (static_cast<uint64_t>(peerIP) << 32) | localIP;
+		words[1] = (static_cast<uint64_t>(peerPort) << 48) |
+			(static_cast<uint64_t>(localPort) << 32) | peerIsn;
+		words[2] = (static_cast<uint64_t>(counter) << 32) | bits;
+
+		uint64_t res;
+		crypto_shorthash(reinterpret_cast<uint8_t *>(&res),
+			reinterpret_cast<const uint8_t *>(words), sizeof(words), getKey().k);
+		return static_cast<uint32_t>(res) & hashMask;
+	}
+
+public:
+	/*! Get the key of this process
+	 *
+	 * The key is generated on first use.
+	 * All cores share it, so an ACK may arrive at another core than its SYN.
+	 *
+	 * \return The key used for every cookie
+	 */
+	static Key &getKey() {
+		static Key key;
+		return key;
+	}
+
+	/*! Get the MSS stored at an index of the cookie
+	 *
+	 * The values are the ones Linux uses, they cover the common cases.
+	 *
+	 * \param idx Index, less than numMss
+	 * \return The MSS
+	 */
+	static uint16_t getMss(uint8_t idx) {
+		static const uint16_t mssTable[numMss] = {536, 1300, 1440, 1460};
+		return mssTable[idx];
+	}
+
+	/*! Create the cookie for a SYN
+	 *
+	 * \param peerIP IP of the peer, which sent the SYN (host byte order)
+	 * \param localIP Local IP (host byte order)
+	 * \param peerPort Port of the peer (host byte order)
+	 * \param localPort Local port (host byte order)
+	 * \param peerIsn Sequence number of the SYN
+	 * \param mss MSS to use, the cookie holds the next lower value of the table
+	 * \param sackPermitted The peer sent SACK permitted
+	 * \param now Current time
+	 * \return The sequence number of the SYN ACK
+	 */
+	static uint32_t make(uint32_t peerIP, uint32_t localIP, uint16_t peerPort,
+		uint16_t localPort, uint32_t peerIsn, uint16_t mss, bool sackPermitted,
+		time_point now) {
+		uint8_t mssIdx = numMss - 1;
+		while ((mssIdx > 0) && (getMss(mssIdx) > mss)) {
+			mssIdx--;
+		}
+
+		uint32_t counter = getCounter(now);
+		uint32_t bits = ((counter & 0x1f) << counterShift) | (mssIdx << mssShift) |
+			(static_cast<uint32_t>(sackPermitted) << sackShift);
+		return bits | hash(peerIP, localIP, peerPort, localPort, peerIsn, counter, bits);
+	}
+
+	/*! Check the cookie returned by the ACK of the handshake
+	 *
+	 * \param peerIP IP of the peer, which sent the ACK (host byte order)
+	 * \param localIP Local IP (host byte order)
+	 * \param peerPort Port of the peer (host byte order)
+	 * \param localPort Local port (host byte order)
+	 * \param peerIsn Sequence number of the ACK minus one
+	 * \param cookie Acknowledgment number of the ACK minus one
+	 * \param mss The MSS stored in the cookie is written here
+	 * \param sackPermitted Whether the peer sent SACK permitted is written here
+	 * \param now Current time
+	 * \return True, if the cookie is valid and did not expire
+	 */
+	static bool check(uint32_t peerIP, uint32_t localIP, uint16_t peerPort,
+		uint16_t localPort, uint32_t peerIsn, uint32_t cookie, uint16_t &mss,
+		bool &sackPermitted, time_point now) {
+		uint32_t counter = getCounter(now);
+		uint32_t age = (counter - (cookie >> counterShift)) & 0x1f;
+		if (age > maxAge) {
+			return false;
+		}
+
+		uint32_t bits = cookie & ~hashMask;
+		if (hash(peerIP, localIP, peerPort, localPort, peerIsn, counter - age, bits) !=
+			(cookie & hashMask)) {
+			return false;
+		}
+
+		mss = getMss((cookie >> mssShift) & (numMss - 1));
+		sackPermitted = (cookie >> sackShift) & 1;
+		return true;
+	}
+};
+
+#endif /* TCPSYNCOOKIE_HPP */
@@ -0,0 +1,137 @@
+#ifndef TOEPLITZ_HPP
+#define TOEPLITZ_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*! Software implementation of the Toeplitz hash used for RSS
+ *
+ * NICs calculate this hash for every received packet, if RSS is enabled.
+ * The software version is needed whenever there is no NIC hash available,
+ * e.g. for generated packets, pcap or connections opened by ourselves.
+ * Both only match, if the NIC is configured with the same key (see getKey())
+ * and hashes IPv4 addresses and L4 ports (ETH_RSS_NONFRAG_IPV4_TCP/UDP).
+ *
+ * The default key is the one from the Microsoft RSS specification,
+ * which is also the default key of most DPDK drivers.
+ */
+class Toeplitz {
+public:
+	static constexpr size_t keyLen = 40;
+
+	// Length of the input for IPv4: srcIP, dstIP, srcPort, dstPort
+	static constexpr size_t ipv4TupleLen = 12;
+
+private:
+	struct Ctx {
+		uint8_t key[keyLen];
+
+		// Precalculated hash contribution of every byte value at every position
+		uint32_t ipv4Table[ipv4TupleLen][256];
+
+		Ctx() {
+			static const uint8_t defaultKey[keyLen] = {0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b,
+				0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0, 0xd0, 0xca, 0x2b,
+				0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+				0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa};
+			setKey(defaultKey);
+		};
+
+		void setKey(const uint8_t *k) {
+			memcpy(key, k, keyLen);
+			for (size_t pos = 0; pos < ipv4TupleLen; pos++) {
+				for (unsigned int val = 0; val < 256; val++) {
+					uint8_t b = val;
+					ipv4Table[pos][val] = hashByte(key, pos, b);
+				}
+			}
+		};
+	};
+
+	static Ctx &getCtx() {
+		static Ctx ctx;
+		return ctx;
+	};
+
+	// Hash contribution of one input byte at position pos
+	static inline uint32_t hashByte(const uint8_t *key, size_t pos, uint8_t b) {
+		// The 32 bit window of the key slides one bit per input bit
+		uint64_t window = 0;
+		for (size_t i = 0; i < 5; i++) {
+			window <<= 8;
+			if (pos + i < keyLen) {
+				window |= key[pos + i];
+			}
+		}
+
+		uint32_t res = 0;
+		for (int bit = 0; bit < 8; bit++) {
+			if (b & (0x80 >> bit)) {
+				res ^= static_cast<uint32_t>(window >> (8 - bit));
+			}
+		}
+		return res;
+	};
+
+public:
+	/*! Get the key currently in use
+	 *
+	 * Use this key to configure the NIC
+	 *
+	 * \return Pointer to keyLen bytes
+	 */
+	static const uint8_t *getKey() { return getCtx().key; };
+
+	/*! Set the key
+	 *
+	 * This has to be done before any hash is calculated,
+	 * and has to match the key configured on the NIC.
+	 *
+	 * \param key keyLen bytes of key material
+	 */
+	static void setKey(const uint8_t *key) { getCtx().setKey(key); };
+
+	/*! Calculate the Toeplitz hash over arbitrary input
+	 *
+	 * \param input The input in network byte order
+	 * \param len Length of the input, at most keyLen - 4 bytes
+	 * \return The hash
+	 */
+	static uint32_t hash(const uint8_t *input, size_t len) {
+		const uint8_t *key = getKey();
+		uint32_t res = 0;
+		for (size_t pos = 0; pos < len; pos++) {
+			res ^= hashByte(key, pos, input[pos]);
+		}
+		return res;
+	};
+
+	/*! Calculate the Toeplitz hash over an IPv4 5-tuple
+	 *
+	 * This is the same as what the NIC calculates for TCP and UDP packets.
+	 * All parameters are expected in network byte order.
+	 *
+	 * \param srcIP Source IP address
+	 * \param dstIP Destination IP address
+	 * \param srcPort Source port
+	 * \param dstPort Destination port
+	 * \return The hash
+	 */
+	static uint32_t hashIPv4(uint32_t srcIP, uint32_t dstIP, uint16_t srcPort, uint16_t dstPort) {
+		uint8_t input[ipv4TupleLen];
+		memcpy(input, &srcIP, 4);
+		memcpy(input + 4, &dstIP, 4);
+		memcpy(input + 8, &srcPort, 2);
+		memcpy(input + 10, &dstPort, 2);
+
+		const Ctx &ctx = getCtx();
+		uint32_t res = 0;
+		for (size_t pos = 0; pos < ipv4TupleLen; pos++) {
+			res ^= ctx.ipv4Table[pos][input[pos]];
+		}
+		return res;
+	};
+};
+
+#endif /* TOEPLITZ_HPP */
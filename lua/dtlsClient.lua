@@ -36,30 +36,29 @@ function mod.process(obj, inPkts, inCount)
 
 	if 0 < inCount then
 		log:info("helloBye.process() called (>0 packets)")
+	end
 
-		local ba = ffi.C.DtlsClient_process(obj.obj, inPkts, inCount, obj.sbc,
-		obj.fbc)
+	-- Run even without incoming packets, timeouts send packets as well
+	local ba = ffi.C.DtlsClient_process(obj.obj, inPkts, inCount, obj.sbc,
+	obj.fbc)
 
-		if obj.sbc[0] > obj.sbufsS then
-			obj.sbufs = memory.bufArray(obj.sbc[0])
-			obj.sbufsS = obj.sbc[0]
-		end
+	if obj.sbc[0] > obj.sbufsS then
+		obj.sbufs = memory.bufArray(obj.sbc[0])
+		obj.sbufsS = obj.sbc[0]
+	end
 
-		if obj.fbc[0] > obj.fbufsS then
-			obj.fbufs = memory.bufArray(obj.fbc[0])
-			obj.fbufsS = obj.fbc[0]
-		end
+	if obj.fbc[0] > obj.fbufsS then
+		obj.fbufs = memory.bufArray(obj.fbc[0])
+		obj.fbufsS = obj.fbc[0]
+	end
 
-		ffi.C.DtlsClient_getPkts(ba, obj.sbufs.array, obj.fbufs.array)
+	ffi.C.DtlsClient_getPkts(ba, obj.sbufs.array, obj.fbufs.array)
 
-		obj.sbufs.size = obj.sbc[0]
-		ret.send = obj.sbufs
-		ret.sendCount = obj.sbc[0]
+	obj.sbufs.size = obj.sbc[0]
+	ret.send = obj.sbufs
+	ret.sendCount = obj.sbc[0]
 
-		obj.fbufs:freeAll()
-	else
-		ret.sendCount = 0
-	end
+	obj.fbufs:freeAll()
 
 	return ret
 end
@@ -5,6 +5,22 @@ local log = require "log"
 ffi.cdef[[
 void *DtlsServer_init(struct mempool*);
 
+void DtlsServer_setCookies(void *obj, bool enable);
+
+void DtlsServer_setSslPoolSize(void *obj, unsigned int size);
+
+void DtlsServer_setSessionTickets(void *obj, bool enable);
+
+void DtlsServer_setIdleTimeout(void *obj, unsigned int timeout);
+
+unsigned int DtlsServer_getConnections(void *obj);
+
+void DtlsServer_setSessionCache(void *obj, unsigned int size, unsigned int ttl);
+
+void DtlsServer_setAsyncWorkers(void *obj, unsigned int numWorkers);
+
+void DtlsServer_setFastPath(void *obj, bool enable);
+
 void DtlsServer_getPkts(void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts);
 
 void *DtlsServer_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
@@ -15,11 +31,22 @@ void DtlsServer_free(void *obj);
 
 local mod = {}
 
-function mod.init()
+function mod.init(cookies, sslPoolSize, sessionCacheSize, asyncWorkers, fastPath)
 
 	ret = {}
 	ret.mempool = memory.createMemPool()
 	ret.obj = ffi.C.DtlsServer_init(ret.mempool)
+	ffi.C.DtlsServer_setCookies(ret.obj, cookies or false)
+	if sslPoolSize then
+		ffi.C.DtlsServer_setSslPoolSize(ret.obj, sslPoolSize)
+	end
+	if sessionCacheSize then
+		ffi.C.DtlsServer_setSessionCache(ret.obj, sessionCacheSize, 3600)
+	end
+	if (asyncWorkers or 0) > 0 then
+		ffi.C.DtlsServer_setAsyncWorkers(ret.obj, asyncWorkers)
+	end
+	ffi.C.DtlsServer_setFastPath(ret.obj, fastPath or false)
 
 	ret.sbc = ffi.new("unsigned int[1]")
 	ret.fbc = ffi.new("unsigned int[1]")
@@ -36,31 +63,27 @@ function mod.process(obj, inPkts, inCount)
 	obj.sbc[0] = 0
 	obj.fbc[0] = 0
 
-	if 0 < inCount then
-
-		local ba = ffi.C.DtlsServer_process(obj.obj, inPkts, inCount, obj.sbc,
-		obj.fbc)
+	-- Run even without incoming packets, timeouts and the workers send packets as well
+	local ba = ffi.C.DtlsServer_process(obj.obj, inPkts, inCount, obj.sbc,
+	obj.fbc)
 
-		if obj.sbc[0] > obj.sbufsS then
-			obj.sbufs = memory.bufArray(obj.sbc[0])
-			obj.sbufsS = obj.sbc[0]
-		end
+	if obj.sbc[0] > obj.sbufsS then
+		obj.sbufs = memory.bufArray(obj.sbc[0])
+		obj.sbufsS = obj.sbc[0]
+	end
 
-		if obj.fbc[0] > obj.fbufsS then
-			obj.fbufs = memory.bufArray(obj.fbc[0])
-			obj.fbufsS = obj.fbc[0]
-		end
+	if obj.fbc[0] > obj.fbufsS then
+		obj.fbufs = memory.bufArray(obj.fbc[0])
+		obj.fbufsS = obj.fbc[0]
+	end
 
-		ffi.C.DtlsServer_getPkts(ba, obj.sbufs.array, obj.fbufs.array)
+	ffi.C.DtlsServer_getPkts(ba, obj.sbufs.array, obj.fbufs.array)
 
-		obj.sbufs.size = obj.sbc[0]
-		ret.send = obj.sbufs
-		ret.sendCount = obj.sbc[0]
+	obj.sbufs.size = obj.sbc[0]
+	ret.send = obj.sbufs
+	ret.sendCount = obj.sbc[0]
 
-		obj.fbufs:freeAll()
-	else
-		ret.sendCount = 0
-	end
+	obj.fbufs:freeAll()
 
 	return ret
 end
@@ -0,0 +1,114 @@
+local ffi = require "ffi"
+local memory = require "memory"
+local log = require "log"
+
+ffi.cdef[[
+struct TCP_Client_Stats {
+	uint64_t connectionsCompleted;
+	uint64_t connectionsFailed;
+	uint64_t bytesSent;
+	uint64_t bytesReceived;
+};
+
+void *TCP_Client_init(struct mempool *mp);
+
+void *TCP_Client_connect(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
+	unsigned int *sendCount, unsigned int *freeCount, uint32_t srcIP, uint32_t dstIP,
+	uint16_t srcPort, uint16_t dstPort, uint32_t requestLen, uint32_t responseLen);
+
+void TCP_Client_getPkts(
+	void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts);
+
+void *TCP_Client_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
+	unsigned int *sendCount, unsigned int *freeCount);
+
+void TCP_Client_getStats(struct TCP_Client_Stats *stats);
+
+void TCP_Client_free(void *obj);
+]]
+
+local mod = {}
+
+function mod.init()
+	ret = {}
+	ret.mempool = memory.createMemPool()
+	ret.obj = ffi.C.TCP_Client_init(ret.mempool)
+	ret.sbc = ffi.new("unsigned int[1]")
+	ret.fbc = ffi.new("unsigned int[1]")
+	ret.fbufs = memory.bufArray(128)
+	ret.fbufsS = 128
+	ret.sbufs = memory.bufArray(128)
+	ret.sbufsS = 128
+	ret.stats = ffi.new("struct TCP_Client_Stats")
+	return ret
+end
+
+function mod.process(obj, inPkts, inCount)
+	ret = {}
+
+	-- Even without packets the retransmission timers have to run
+	local ba = ffi.C.TCP_Client_process(obj.obj, inPkts, inCount, obj.sbc, obj.fbc)
+
+	if obj.sbc[0] > obj.sbufsS then
+		obj.sbufs = memory.bufArray(obj.sbc[0])
+		obj.sbufsS = obj.sbc[0]
+	end
+
+	if obj.fbc[0] > obj.fbufsS then
+		obj.fbufs = memory.bufArray(obj.fbc[0])
+		obj.fbufsS = obj.fbc[0]
+	end
+
+	ffi.C.TCP_Client_getPkts(ba, obj.sbufs.array, obj.fbufs.array)
+
+	obj.sbufs.size = obj.sbc[0]
+	ret.send = obj.sbufs
+	ret.sendCount = obj.sbc[0]
+
+	obj.fbufs.size = obj.fbc[0]
+	obj.fbufs:freeAll()
+
+	return ret
+end
+
+--- Open bSize connections, one SYN is sent per connection
+-- The source ports srcPort, srcPort+1, ... are used
+function mod.connect(mempool, obj, srcIP, dstIP, srcPort, dstPort, requestLen, responseLen, bSize)
+	local bufArray = mempool:bufArray(bSize)
+	bufArray:alloc(100)
+
+	local sendBufsAll = memory.bufArray(bSize)
+	local sendCount = 0
+
+	for i = 1,bSize do
+		local bAC = ffi.C.TCP_Client_connect(obj.obj, bufArray.array + (i-1), 1, obj.sbc,
+		obj.fbc, srcIP, dstIP, srcPort + (i-1), dstPort, requestLen, responseLen)
+
+		local freeBufs = memory.bufArray(obj.fbc[0])
+
+		ffi.C.TCP_Client_getPkts(bAC, sendBufsAll.array + sendCount, freeBufs.array)
+		sendCount = sendCount + obj.sbc[0]
+	end
+
+	sendBufsAll.size = sendCount
+
+	ret = {}
+
+	ret.send = sendBufsAll
+	ret.sendCount = sendCount
+
+	return ret
+end
+
+--- Get the statistics of all clients of this process
+-- @return struct TCP_Client_Stats, it is overwritten by the next call
+function mod.stats(obj)
+	ffi.C.TCP_Client_getStats(obj.stats)
+	return obj.stats
+end
+
+function mod.free(obj)
+	ffi.C.TCP_Client_free(obj.obj)
+end
+
+return mod
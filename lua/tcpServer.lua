@@ -3,67 +3,127 @@ local memory = require "memory"
 local log = require "log"
 
 ffi.cdef[[
-void *TCP_Server_Joke_init(struct mempool *mp);
+struct TCP_Server_Stats {
+	uint64_t connections;
+	uint64_t connectionsOpened;
+	uint64_t connectionsClosed;
+	uint64_t pktsIn;
+	uint64_t pktsSent;
+	uint64_t pktsFreed;
+	uint64_t pktsMerged;
+};
+]]
+
+-- The functions exported by TCP_SERVER_C_ABI(), NAME is replaced by the name given to it
+local cdefTemplate = [[
+void *TCP_Server_NAME_init(struct mempool *mp);
+
+void TCP_Server_NAME_setSynCookies(void *obj, bool enable);
+
+void TCP_Server_NAME_setGro(void *obj, bool enable);
+
+void TCP_Server_NAME_setChecksumOffload(void *obj, bool enable);
 
-void *TCP_Server_Joke_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
+void *TCP_Server_NAME_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
 	unsigned int *sendCount, unsigned int *freeCount);
 
-void TCP_Server_Joke_getPkts(
+void TCP_Server_NAME_getPkts(
 	void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts);
 
-void TCP_Server_Joke_free(void *obj);
+void TCP_Server_NAME_getStats(void *obj, struct TCP_Server_Stats *stats);
+
+void TCP_Server_NAME_free(void *obj);
 ]]
 
+local declared = {}
+
+local function getFunctions(name)
+	if not declared[name] then
+		ffi.cdef((cdefTemplate:gsub("NAME", name)))
+		declared[name] = true
+	end
+
+	local prefix = "TCP_Server_" .. name .. "_"
+	return {
+		init = ffi.C[prefix .. "init"],
+		setSynCookies = ffi.C[prefix .. "setSynCookies"],
+		setGro = ffi.C[prefix .. "setGro"],
+		setChecksumOffload = ffi.C[prefix .. "setChecksumOffload"],
+		process = ffi.C[prefix .. "process"],
+		getPkts = ffi.C[prefix .. "getPkts"],
+		getStats = ffi.C[prefix .. "getStats"],
+		free = ffi.C[prefix .. "free"],
+	}
+end
+
 local mod = {}
 
-function mod.init()
+--- Create a TCP server
+-- @param name Name given to TCP_SERVER_C_ABI(), "Joke" if not given
+-- @param synCookies Answer SYNs without creating a state
+-- @param gro Merge the segments of a connection received in one batch
+-- @param offload Let the NIC fill in the checksums, for all servers of this process
+function mod.init(name, synCookies, gro, offload)
 	ret = {}
+	ret.fn = getFunctions(name or "Joke")
 	ret.mempool = memory.createMemPool()
-	ret.obj = ffi.C.TCP_Server_Joke_init(ret.mempool)
+	ret.obj = ret.fn.init(ret.mempool)
+	if synCookies then
+		ret.fn.setSynCookies(ret.obj, true)
+	end
+	if gro then
+		ret.fn.setGro(ret.obj, true)
+	end
+	if offload then
+		ret.fn.setChecksumOffload(ret.obj, true)
+	end
 	ret.sbc = ffi.new("unsigned int[1]")
 	ret.fbc = ffi.new("unsigned int[1]")
 	ret.fbufs = memory.bufArray(128)
 	ret.fbufsS = 128
 	ret.sbufs = memory.bufArray(128)
 	ret.sbufsS = 128
+	ret.stats = ffi.new("struct TCP_Server_Stats")
 	return ret
 end
 
 function mod.process(obj, inPkts, inCount)
 	ret = {}
 
-	if 0 < inCount then
---		log:info("helloBye.process() called (>0 packets)")
-
-		local ba = ffi.C.TCP_Server_Joke_process(obj.obj, inPkts, inCount, obj.sbc,
-		obj.fbc)
+	-- Even without packets the timers have to run
+	local ba = obj.fn.process(obj.obj, inPkts, inCount, obj.sbc, obj.fbc)
 
-		if obj.sbc[0] > obj.sbufsS then
-			obj.sbufs = memory.bufArray(obj.sbc[0])
-			obj.sbufsS = obj.sbc[0]
-		end
+	if obj.sbc[0] > obj.sbufsS then
+		obj.sbufs = memory.bufArray(obj.sbc[0])
+		obj.sbufsS = obj.sbc[0]
+	end
 
-		if obj.fbc[0] > obj.fbufsS then
-			obj.fbufs = memory.bufArray(obj.fbc[0])
-			obj.fbufsS = obj.fbc[0]
-		end
+	if obj.fbc[0] > obj.fbufsS then
+		obj.fbufs = memory.bufArray(obj.fbc[0])
+		obj.fbufsS = obj.fbc[0]
+	end
 
-		ffi.C.TCP_Server_Joke_getPkts(ba, obj.sbufs.array, obj.fbufs.array)
+	obj.fn.getPkts(ba, obj.sbufs.array, obj.fbufs.array)
 
-		obj.sbufs.size = obj.sbc[0]
-		ret.send = obj.sbufs
-		ret.sendCount = obj.sbc[0]
+	obj.sbufs.size = obj.sbc[0]
+	ret.send = obj.sbufs
+	ret.sendCount = obj.sbc[0]
 
-		obj.fbufs:freeAll()
-	else
-		ret.sendCount = 0
-	end
+	obj.fbufs.size = obj.fbc[0]
+	obj.fbufs:freeAll()
 
 	return ret
 end
 
+--- Get the statistics of the server
+-- @return struct TCP_Server_Stats, it is overwritten by the next call
+function mod.stats(obj)
+	obj.fn.getStats(obj.obj, obj.stats)
+	return obj.stats
+end
+
 function mod.free(obj)
-	ffi.C.TCP_Server_Joke_free(obj.obj)
+	obj.fn.free(obj.obj)
 end
 
 return mod
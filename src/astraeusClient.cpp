@@ -1,6 +1,7 @@
 #include <rte_errno.h>
 
 #include "astraeusClient.hpp"
+#include "checksumMbuf.hpp"
 
 using namespace AstraeusProto;
 using namespace Astraeus_Client;
@@ -83,15 +84,15 @@ void Astraeus_Client::initHandshakeNoTransition(
 	auto ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
 	auto udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
 
-	ipv4->checksum = 0;
 	ipv4->setDstIP(client->remoteIP);
 	ipv4->setSrcIP(client->localIP);
 	ipv4->setPayloadLength(sizeof(Headers::Udp) + sendLen);
 
-	udp->checksum = 0;
 	udp->setDstPort(client->remotePort);
 	udp->setSrcPort(client->localPort);
 	udp->setPayloadLength(sendLen);
+	pkt->setHeaderLens(sizeof(Headers::Ethernet), sizeof(Headers::IPv4), sizeof(Headers::Udp));
+	Checksum::setIPv4Udp(pkt);
 };
 
 void Astraeus_Client::initHandshake(
@@ -120,18 +121,19 @@ void Astraeus_Client::runHandshake(StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>:
 	auto ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
 	auto udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
 
-	ipv4->checksum = 0;
 	ipv4->setDstIP(client->remoteIP);
 	ipv4->setSrcIP(client->localIP);
 	ipv4->setPayloadLength(sizeof(Headers::Udp) + sendLen);
 
-	udp->checksum = 0;
 	udp->setDstPort(client->remotePort);
 	udp->setSrcPort(client->localPort);
 	udp->setPayloadLength(sendLen);
+	pkt->setHeaderLens(sizeof(Headers::Ethernet), sizeof(Headers::IPv4), sizeof(Headers::Udp));
 
 	if (sendLen <= 0) {
 		funIface.freePkt();
+	} else {
+		Checksum::setIPv4Udp(pkt);
 	}
 
 	if (!handshakeOngoing(client->handle)) {
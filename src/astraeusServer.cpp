@@ -1,6 +1,7 @@
 #include <rte_errno.h>
 
 #include "astraeusServer.hpp"
+#include "checksumMbuf.hpp"
 
 using namespace AstraeusProto;
 using namespace Astraeus_Server;
@@ -66,30 +67,25 @@ void Astraeus_Server::runHandshake(StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf>:
 
 	astraeusClient *client = reinterpret_cast<astraeusClient *>(state.stateData);
 	int sendLen;
-	handleHandshakeServer(client->handle,
-		reinterpret_cast<uint8_t *>(pkt->getData()) + sizeof(Headers::Ethernet) +
-			sizeof(Headers::IPv4) + sizeof(Headers::Udp),
-		sendLen);
+	handleHandshakeServer(client->handle, PktParser::getPayload(pkt), sendLen);
 
-	pkt->setDataLen(
-		sendLen + sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Udp));
+	pkt->setDataLen(sendLen + PktParser::getHeadersLen(pkt));
 
-	auto ethernet = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
-	auto ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
-	auto udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+	auto ipv4 = PktParser::getIPv4(pkt);
+	auto udp = PktParser::getUdp(pkt);
 
-	ipv4->checksum = 0;
 	ipv4->setDstIP(client->remoteIP);
 	ipv4->setSrcIP(client->localIP);
 	ipv4->setPayloadLength(sizeof(Headers::Udp) + sendLen);
 
-	udp->checksum = 0;
 	udp->setDstPort(client->remotePort);
 	udp->setSrcPort(client->localPort);
 	udp->setPayloadLength(sendLen);
 
 	if (sendLen <= 0) {
 		funIface.freePkt();
+	} else {
+		Checksum::setIPv4Udp(pkt);
 	}
 
 	if (!handshakeOngoing(client->handle)) {
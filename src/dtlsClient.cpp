@@ -5,6 +5,7 @@
 
 #include <rte_errno.h>
 
+#include "checksumMbuf.hpp"
 #include "dtlsClient.hpp"
 #include "headers.hpp"
 
@@ -106,8 +107,8 @@ static int writeAllDataAvailable(dtlsClient *client, mbuf *pkt, SM::FunIface &fu
 
 	int ret = 0;
 
-	// Is there data to write? (There should be)
-	if (BIO_eof(client->wbio) == false) {
+	// Is there data to write? (There should be, unless this is a timeout without packet)
+	if ((pkt != nullptr) && (BIO_eof(client->wbio) == false)) {
 
 		DEBUG_ENABLED(
 			std::cout << "DTLS_Client::writeAllDataAvailable() sending packet" << std::endl;)
@@ -132,12 +133,14 @@ static int writeAllDataAvailable(dtlsClient *client, mbuf *pkt, SM::FunIface &fu
 		ipv4->setProtoUDP();
 		ipv4->setSrcIP(client->localIP);
 		ipv4->setDstIP(client->remoteIP);
-		ipv4->checksum = 0;
 		ipv4->ttl = 64;
 
 		udp->setDstPort(client->remotePort);
 		udp->setSrcPort(client->localPort);
 		udp->setPayloadLength(dataLen);
+		pkt->setHeaderLens(
+			sizeof(Headers::Ethernet), sizeof(Headers::IPv4), sizeof(Headers::Udp));
+		Checksum::setIPv4Udp(pkt);
 
 		ret++;
 	} else {
@@ -175,12 +178,14 @@ static int writeAllDataAvailable(dtlsClient *client, mbuf *pkt, SM::FunIface &fu
 		ipv4->setProtoUDP();
 		ipv4->setSrcIP(client->localIP);
 		ipv4->setDstIP(client->remoteIP);
-		ipv4->checksum = 0;
 		ipv4->ttl = 64;
 
 		udp->setDstPort(client->remotePort);
 		udp->setSrcPort(client->localPort);
 		udp->setPayloadLength(dataLen);
+		xtraPkt->setHeaderLens(
+			sizeof(Headers::Ethernet), sizeof(Headers::IPv4), sizeof(Headers::Udp));
+		Checksum::setIPv4Udp(xtraPkt);
 
 		ret++;
 	}
@@ -188,6 +193,63 @@ static int writeAllDataAvailable(dtlsClient *client, mbuf *pkt, SM::FunIface &fu
 	return ret;
 }
 
+static void runHandshakeTimeout(SM::State &state, SM::FunIface &funIface);
+static void runIdleTimeout(SM::State &state, SM::FunIface &funIface);
+
+/* Set the timeout of the connection, once a state function is done
+ *
+ * During the handshake, this is the retransmission timer of OpenSSL.
+ * Otherwise, idle connections are closed. Every packet of the connection
+ * cancels the timeout, so each state function arms it again.
+ */
+static void armTimer(dtlsClient *client, SM::FunIface &funIface) {
+	struct timeval tv;
+	if (!SSL_is_init_finished(client->ssl) && (DTLSv1_get_timeout(client->ssl, &tv) == 1)) {
+		funIface.setTimeout(
+			std::chrono::seconds(tv.tv_sec) + std::chrono::microseconds(tv.tv_usec),
+			runHandshakeTimeout);
+	} else {
+		funIface.setTimeout(idleTimeout, runIdleTimeout);
+	}
+}
+
+// Retransmit the last flight, there is no packet to reuse for it
+static void runHandshakeTimeout(SM::State &state, SM::FunIface &funIface) {
+	DEBUG_ENABLED(std::cout << "DTLS_Client::runHandshakeTimeout() is called" << std::endl;)
+
+	dtlsClient *client = reinterpret_cast<dtlsClient *>(state.stateData);
+
+	int ret = DTLSv1_handle_timeout(client->ssl);
+	writeAllDataAvailable(client, nullptr, funIface);
+
+	// OpenSSL gives up after too many retransmissions
+	if (ret < 0) {
+		ERR_clear_error();
+		SSL_free(client->ssl);
+		delete (client);
+		funIface.transition(States::DELETED);
+		return;
+	}
+
+	armTimer(client, funIface);
+}
+
+// Close the connection, the peer learns about it, if it is still there
+static void runIdleTimeout(SM::State &state, SM::FunIface &funIface) {
+	DEBUG_ENABLED(std::cout << "DTLS_Client::runIdleTimeout() is called" << std::endl;)
+
+	dtlsClient *client = reinterpret_cast<dtlsClient *>(state.stateData);
+
+	if (SSL_is_init_finished(client->ssl)) {
+		SSL_shutdown(client->ssl);
+		writeAllDataAvailable(client, nullptr, funIface);
+	}
+
+	SSL_free(client->ssl);
+	delete (client);
+	funIface.transition(States::DELETED);
+}
+
 void initHandshake(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 	DEBUG_ENABLED(std::cout << "DTLS_Client::initHandshake() is called" << std::endl;)
 	dtlsClient *client = reinterpret_cast<dtlsClient *>(state.stateData);
@@ -197,6 +259,7 @@ void initHandshake(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 	assert(writeAllDataAvailable(client, pkt, funIface) >= 1);
 
 	funIface.transition(States::HANDSHAKE);
+	armTimer(client, funIface);
 };
 
 void runHandshake(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
@@ -241,7 +304,6 @@ void runHandshake(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 		ipv4->setProtoUDP();
 		ipv4->setSrcIP(client->localIP);
 		ipv4->setDstIP(client->remoteIP);
-		ipv4->checksum = 0;
 		ipv4->ttl = 64;
 
 		Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
@@ -263,7 +325,12 @@ void runHandshake(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 		udp->setDstPort(client->remotePort);
 		udp->setSrcPort(client->localPort);
 		udp->setPayloadLength(dataLen);
+		xtraPkt->setHeaderLens(
+			sizeof(Headers::Ethernet), sizeof(Headers::IPv4), sizeof(Headers::Udp));
+		Checksum::setIPv4Udp(xtraPkt);
 	}
+
+	armTimer(client, funIface);
 };
 
 void sendData(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
@@ -288,6 +355,7 @@ void sendData(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 
 	// Same procedure as everytime
 	writeAllDataAvailable(client, pkt, funIface);
+	armTimer(client, funIface);
 };
 
 void runTeardown(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <functional>
 #include <sstream>
@@ -7,9 +10,17 @@
 
 #include <openssl/dh.h>
 
+#include "checksumMbuf.hpp"
+#include "dtlsAead.hpp"
+#include "dtlsCookie.hpp"
 #include "dtlsServer.hpp"
+#include "dtlsTicketKeys.hpp"
 #include "headers.hpp"
+#include "mbufBio.hpp"
+#include "pktParser.hpp"
+#include "sessionCache.hpp"
 #include "spinlock.hpp"
+#include "sslPool.hpp"
 
 #include "measure.hpp"
 
@@ -58,6 +69,95 @@ static DH *get_dh2048() {
 	return dh;
 }
 
+// The cookie callbacks get the connection from the app data of the SSL object
+static int generateCookie(SSL *ssl, unsigned char *cookie, unsigned int *cookieLen) {
+	auto peer = reinterpret_cast<const DtlsCookie::Peer *>(SSL_get_app_data(ssl));
+	if (peer == nullptr) {
+		return 0;
+	}
+	DtlsCookie::make(*peer, cookie, std::chrono::steady_clock::now());
+	*cookieLen = DtlsCookie::length;
+	return 1;
+}
+
+static int verifyCookie(SSL *ssl, const unsigned char *cookie, unsigned int cookieLen) {
+	auto peer = reinterpret_cast<const DtlsCookie::Peer *>(SSL_get_app_data(ssl));
+	if (peer == nullptr) {
+		return 0;
+	}
+	return DtlsCookie::check(*peer, cookie, cookieLen, std::chrono::steady_clock::now());
+}
+
+// Session tickets are encrypted with the keys of DtlsTicketKeys
+static int ticketKeyCb(SSL *ssl, unsigned char *keyName, unsigned char *iv,
+	EVP_CIPHER_CTX *cipherCtx, HMAC_CTX *hmacCtx, int enc) {
+	(void)ssl;
+	auto now = std::chrono::steady_clock::now();
+
+	if (enc) {
+		const DtlsTicketKeys::Key &key = DtlsTicketKeys::getCurrent(now);
+		if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_128_cbc())) != 1) {
+			return -1;
+		}
+		memcpy(keyName, key.name, DtlsTicketKeys::nameLen);
+		EVP_EncryptInit_ex(cipherCtx, EVP_aes_128_cbc(), nullptr, key.aesKey, iv);
+		HMAC_Init_ex(hmacCtx, key.hmacKey, DtlsTicketKeys::hmacKeyLen, EVP_sha256(), nullptr);
+		return 1;
+	}
+
+	// Unknown or expired keys lead to a full handshake
+	const DtlsTicketKeys::Key *key = DtlsTicketKeys::find(keyName, now);
+	if (key == nullptr) {
+		return 0;
+	}
+	HMAC_Init_ex(hmacCtx, key->hmacKey, DtlsTicketKeys::hmacKeyLen, EVP_sha256(), nullptr);
+	EVP_DecryptInit_ex(cipherCtx, EVP_aes_128_cbc(), nullptr, key->aesKey, iv);
+
+	// Issue a ticket with the current keys
+	return DtlsTicketKeys::isOld(*key, now) ? 2 : 1;
+}
+
+// The limits of the session caches, see DtlsServer_setSessionCache()
+static std::atomic<unsigned int> sessionCacheSize{0};
+static std::atomic<unsigned int> sessionCacheTtl{3600};
+
+/* Every thread running handshakes caches the sessions of its connections
+ *
+ * These are the cores, or the workers of the AsyncPool.
+ * The cache is empty, until DtlsServer_setSessionCache() enables it.
+ */
+static SessionCache &getSessionCache() {
+	static thread_local SessionCache cache(0, std::chrono::seconds(3600));
+	cache.resize(sessionCacheSize, std::chrono::seconds(sessionCacheTtl));
+	return cache;
+}
+
+static int newSession(SSL *ssl, SSL_SESSION *sess) {
+	(void)ssl;
+	return getSessionCache().add(sess, std::chrono::steady_clock::now());
+}
+
+static SSL_SESSION *getSession(SSL *ssl, const unsigned char *id, int len, int *copy) {
+	(void)ssl;
+	// OpenSSL takes a reference of its own
+	*copy = 1;
+	return getSessionCache().get(id, len, std::chrono::steady_clock::now());
+}
+
+static void removeSession(SSL_CTX *ctx, SSL_SESSION *sess) {
+	(void)ctx;
+	getSessionCache().remove(sess);
+}
+
+// Whether to issue session tickets, see DtlsServer_setSessionTickets()
+static bool sessionTickets = true;
+
+// Connections without packets are closed after this, see DtlsServer_setIdleTimeout()
+static std::chrono::milliseconds idleTimeout(60000);
+
+// Whether established records bypass OpenSSL, see DtlsServer_setFastPath()
+static bool fastPath = false;
+
 SSL_CTX *createCTX() {
 	uint64_t start = read_rdtsc();
 
@@ -125,6 +225,23 @@ SSL_CTX *createCTX() {
 	// Do not query the BIO for an MTU
 	SSL_CTX_set_options(ctx, SSL_OP_NO_QUERY_MTU);
 
+	// Cookies of the HelloVerifyRequest, see preAccept()
+	SSL_CTX_set_cookie_generate_cb(ctx, generateCookie);
+	SSL_CTX_set_cookie_verify_cb(ctx, verifyCookie);
+
+	// Sessions are resumed, the peer certificate is not checked again
+	static const unsigned char sessionIdCtx[] = "MoonState DTLS";
+	SSL_CTX_set_session_id_context(ctx, sessionIdCtx, sizeof(sessionIdCtx) - 1);
+
+	// Stateless session tickets with rotating keys
+	SSL_CTX_set_tlsext_ticket_key_cb(ctx, ticketKeyCb);
+
+	// Session IDs are looked up in the cache of the core, not in the locked one of OpenSSL
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+	SSL_CTX_sess_set_new_cb(ctx, newSession);
+	SSL_CTX_sess_set_get_cb(ctx, getSession);
+	SSL_CTX_sess_set_remove_cb(ctx, removeSession);
+
 	uint64_t stop = read_rdtsc();
 	measureData.openssl += stop - start;
 
@@ -136,6 +253,7 @@ static rte_mempool *mp;
 void configStateMachine(SM &sm) {
 	//	sm.registerFunction(States::DOWN, initHandshake);
 	sm.registerFunction(States::HANDSHAKE, runHandshake);
+	sm.registerFunction(States::FINISH_HANDSHAKE, finishHandshake);
 	sm.registerFunction(States::ESTABLISHED, sendData);
 	sm.registerFunction(States::RUN_TEARDOWN, runTeardown);
 
@@ -152,7 +270,150 @@ void configStateMachine(SM &sm) {
 	sm.registerEndStateID(States::DELETED);
 };
 
-static SSL_CTX *ctx;
+/* Every core recycles the SSL objects of closed connections
+ *
+ * DtlsServer_init() sets the context of the pool of the core it is called on,
+ * and fills it. DtlsServer_free() empties it, see freeSslObjects().
+ */
+static SslPool &getPool() {
+	static thread_local SslPool pool(nullptr, 0);
+	return pool;
+}
+
+static void releaseSsl(dtlsServer *server) {
+	getPool().put({server->ssl, server->bio});
+	server->ssl = nullptr;
+	delete server->aead;
+	server->aead = nullptr;
+}
+
+/* Every core checks cookies with an SSL object of its own
+ *
+ * DTLSv1_listen() keeps a ClientHello with a valid cookie in it, and sets it
+ * up to continue the handshake. factory() takes the listener over then, and the
+ * next cookie is checked by another one.
+ */
+struct Listener {
+	SslPool::Bundle b = {nullptr, nullptr};
+	BIO_ADDR *client = nullptr;
+	bool accepted = false;
+	DtlsCookie::Peer peer;
+
+	~Listener() {
+		if (b.ssl != nullptr) {
+			SSL_free(b.ssl);
+		}
+		if (client != nullptr) {
+			BIO_ADDR_free(client);
+		}
+	}
+};
+
+static thread_local Listener listener;
+
+/* Free the SSL objects of this core, before their context is freed
+ *
+ * They hold a reference to it, the destructors of the thread_local pool and
+ * listener would drop it only when the thread exits.
+ */
+static void freeSslObjects() {
+	if (listener.b.ssl != nullptr) {
+		SSL_free(listener.b.ssl);
+		listener.b.ssl = nullptr;
+	}
+	listener.accepted = false;
+	getPool().setCtx(nullptr);
+}
+
+SM::PreAccept preAccept(IPv4_5TupleL2Ident<mbuf>::ConnectionID id, mbuf *pkt) {
+	(void)id;
+
+	Headers::Ethernet *ethernet = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Udp *udp = PktParser::getUdp(pkt);
+	uint8_t *payload = reinterpret_cast<uint8_t *>(udp->getPayload());
+	uint16_t payloadLen = udp->getPayloadLength();
+
+	// Only a handshake record (22) holding a ClientHello (1) may start a connection
+	static constexpr uint16_t recordHeaderLen = 13;
+	static constexpr uint16_t handshakeHeaderLen = 12;
+	if ((payloadLen < recordHeaderLen + handshakeHeaderLen) || (payload[0] != 22) ||
+		(payload[recordHeaderLen] != 1)) {
+		return SM::PreAccept::drop;
+	}
+
+	uint64_t start = read_rdtsc();
+
+	if (listener.b.ssl == nullptr) {
+		listener.b = getPool().get();
+	}
+	if (listener.client == nullptr) {
+		listener.client = BIO_ADDR_new();
+		assert(listener.client != NULL);
+	}
+	listener.peer = {ipv4->getSrcIP(), ipv4->getDstIP(), udp->getSrcPort(), udp->getDstPort()};
+	SSL_set_app_data(listener.b.ssl, &listener.peer);
+
+	// The HelloVerifyRequest is written over the ClientHello
+	uint16_t payloadOffset = payload - reinterpret_cast<uint8_t *>(pkt->getData());
+	MbufBio::setInput(listener.b.bio, payload, payloadLen);
+	MbufBio::setOutput(listener.b.bio, pkt, payloadOffset);
+	int ret = DTLSv1_listen(listener.b.ssl, listener.client);
+	const std::vector<mbuf *> &out = MbufBio::finish(listener.b.bio);
+
+	if (ret > 0) {
+		uint64_t stop = read_rdtsc();
+		measureData.openssl += stop - start;
+
+		DEBUG_ENABLED(std::cout << "DTLS_Server::preAccept() ClientHello with valid cookie"
+								<< std::endl;)
+		listener.accepted = true;
+		return SM::PreAccept::accept;
+	}
+
+	if (ret < 0) {
+		ERR_clear_error();
+	}
+
+	int dataLen = 0;
+	if (out.empty() == false) {
+		dataLen = pkt->getDataLen() - payloadOffset;
+	}
+
+	uint64_t stop = read_rdtsc();
+	measureData.openssl += stop - start;
+
+	if (dataLen <= 0) {
+		DEBUG_ENABLED(std::cout << "DTLS_Server::preAccept() Dropping invalid ClientHello"
+								<< std::endl;)
+		return SM::PreAccept::drop;
+	}
+
+	DEBUG_ENABLED(std::cout << "DTLS_Server::preAccept() Sending HelloVerifyRequest"
+							<< std::endl;)
+
+	// Send the HelloVerifyRequest back
+	std::array<uint8_t, 6> tmpMac;
+	memcpy(tmpMac.data(), ethernet->srcMac.data(), 6);
+	memcpy(ethernet->srcMac.data(), ethernet->destMac.data(), 6);
+	memcpy(ethernet->destMac.data(), tmpMac.data(), 6);
+
+	uint32_t tmp = ipv4->getSrcIP();
+	ipv4->setSrcIP(ipv4->getDstIP());
+	ipv4->setDstIP(tmp);
+	ipv4->ttl = 64;
+	ipv4->setPayloadLength(dataLen + sizeof(Headers::Udp));
+
+	uint16_t tmp16 = udp->getSrcPort();
+	udp->setSrcPort(udp->getDstPort());
+	udp->setDstPort(tmp16);
+	udp->setPayloadLength(dataLen);
+
+	pkt->setHeaderLens(pkt->getL2Len(), pkt->getL3Len(), sizeof(Headers::Udp));
+	Checksum::setIPv4Udp(pkt);
+
+	return SM::PreAccept::reply;
+}
 
 void *factory(IPv4_5TupleL2Ident<mbuf>::ConnectionID id) {
 	(void)id;
@@ -160,8 +421,8 @@ void *factory(IPv4_5TupleL2Ident<mbuf>::ConnectionID id) {
 	// Create necessary structures
 	uint64_t startMem = read_rdtsc();
 
+	// Value-initialized, all zero
 	dtlsServer *server = new dtlsServer();
-	memset(server, 0, sizeof(dtlsServer));
 	SM::State state(DTLS_Server::States::HANDSHAKE, reinterpret_cast<void *>(server));
 
 	uint64_t stopMem = read_rdtsc();
@@ -169,22 +430,31 @@ void *factory(IPv4_5TupleL2Ident<mbuf>::ConnectionID id) {
 
 	uint64_t start = read_rdtsc();
 
-	// Create SSL and memQ BIOs
-	server->ssl = SSL_new(ctx);
-	assert(server->ssl != NULL);
+	SslPool::Bundle b;
+	if (listener.accepted) {
+		// preAccept() checked the cookie, the listener holds the ClientHello
+		b = listener.b;
+		server->helloBuffered = true;
+		server->cookiePeer = listener.peer;
+		SSL_set_app_data(b.ssl, &server->cookiePeer);
 
-	server->wbio = BIO_new(BIO_s_memQ());
-	assert(server->wbio != NULL);
+		// DTLSv1_listen() ran SSL_clear(), which may drop the MTU
+		SSL_set_mtu(b.ssl, SslPool::mtu);
 
-	server->rbio = BIO_new(BIO_s_memQ());
-	assert(server->rbio != NULL);
-
-	// Make sure openSSL knows, it is a server
-	SSL_set_accept_state(server->ssl);
-	SSL_set_bio(server->ssl, server->rbio, server->wbio);
+		listener.b.ssl = nullptr;
+		listener.accepted = false;
+	} else {
+		// Take SSL and BIO from the pool
+		b = getPool().get();
+	}
+	server->ssl = b.ssl;
+	server->bio = b.bio;
 
-	// Set the MTU manually, 1280 is too short, but it should always work
-	SSL_set_mtu(server->ssl, 1280);
+	if (sessionTickets) {
+		SSL_clear_options(server->ssl, SSL_OP_NO_TICKET);
+	} else {
+		SSL_set_options(server->ssl, SSL_OP_NO_TICKET);
+	}
 
 	uint64_t stop = read_rdtsc();
 	measureData.openssl += stop - start;
@@ -192,126 +462,250 @@ void *factory(IPv4_5TupleL2Ident<mbuf>::ConnectionID id) {
 	return server;
 };
 
-static int writeAllDataAvailable(dtlsServer *server, mbuf *pkt, SM::FunIface &funIface) {
+// More packets for the datagrams of OpenSSL, see MbufBio::setOutput()
+static mbuf *getExtraPkt(void *funIface) {
+	mbuf *xtraPkt = reinterpret_cast<SM::FunIface *>(funIface)->getPkt();
+	assert(xtraPkt != NULL);
+	return xtraPkt;
+}
 
-	DEBUG_ENABLED(std::cout << std::dec;)
+// Extra packets of the workers, they are added to the batch by finishHandshake()
+static mbuf *allocAsyncPkt(void *arg) {
+	(void)arg;
+	mbuf *xtraPkt = reinterpret_cast<mbuf *>(rte_pktmbuf_alloc(mp));
+	assert(xtraPkt != NULL);
+	return xtraPkt;
+}
 
-	int allHeaderLength =
-		sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Udp);
+/* Let OpenSSL read the payload of pkt, and write into pkt and extra packets
+ *
+ * udp is nullptr, if OpenSSL has nothing to read.
+ */
+static void bindPkts(dtlsServer *server, mbuf *pkt, Headers::Udp *udp,
+	MbufBio::AllocFun alloc, void *allocArg) {
+	if (udp != nullptr) {
+		MbufBio::setInput(server->bio, udp->getPayload(), udp->getPayloadLength());
+	}
+	MbufBio::setOutput(server->bio, pkt, MbufBio::defaultOffset, alloc, allocArg);
+}
 
-	int ret = 0;
+static void bindPkts(dtlsServer *server, mbuf *pkt, Headers::Udp *udp, SM::FunIface &funIface) {
+	bindPkts(server, pkt, udp, getExtraPkt, &funIface);
+}
 
-	// Is there data to write? (There should be)
-	if (BIO_eof(server->wbio) == false) {
+// Complete the headers of a packet, the datagram is at MbufBio::defaultOffset
+static void setHeaders(dtlsServer *server, mbuf *outPkt) {
+	int dataLen = outPkt->getDataLen() - MbufBio::defaultOffset;
 
-		Headers::Ethernet *ethernet = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
-		Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
+	Headers::Ethernet *ethernet = reinterpret_cast<Headers::Ethernet *>(outPkt->getData());
+	Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
 
-		ipv4->setVersion();
-		ipv4->setIHL(5);
+	ipv4->setVersion();
+	ipv4->setIHL(5);
 
-		Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+	Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
 
-		int udpMaxLen =
-			std::min(pkt->getBufLen(), static_cast<uint16_t>(1500)) - allHeaderLength;
+	// Set the whole Header stuff
+	ethernet->setDstAddr(server->remoteMac);
+	ethernet->setSrcAddr(server->localMac);
+	ethernet->setEthertype(Headers::Ethernet::ETHERTYPE_IPv4);
+
+	ipv4->setPayloadLength(dataLen + sizeof(Headers::Udp));
+	ipv4->setProtoUDP();
+	ipv4->setSrcIP(server->localIP);
+	ipv4->setDstIP(server->remoteIP);
+	ipv4->ttl = 64;
+
+	udp->setDstPort(server->remotePort);
+	udp->setSrcPort(server->localPort);
+	udp->setPayloadLength(dataLen);
+	outPkt->setHeaderLens(
+		sizeof(Headers::Ethernet), sizeof(Headers::IPv4), sizeof(Headers::Udp));
+	Checksum::setIPv4Udp(outPkt);
+
+	DEBUG_ENABLED(std::cout << "DTLS_Server::setHeaders() sending packet. "
+							   "len: "
+							<< outPkt->getDataLen() << std::endl;)
+}
 
-		// Try to read bytes openssl wants to write
-		uint64_t start = read_rdtsc();
+// Complete the headers of the packets OpenSSL wrote to
+static int sendAllPkts(dtlsServer *server, mbuf *pkt, SM::FunIface &funIface) {
 
-		int dataLen = BIO_read(server->wbio, udp->getPayload(), udpMaxLen);
+	DEBUG_ENABLED(std::cout << std::dec;)
 
-		uint64_t stop = read_rdtsc();
-		measureData.openssl += stop - start;
+	const std::vector<mbuf *> &out = MbufBio::finish(server->bio);
 
-		assert(dataLen > 0);
-		pkt->setDataLen(dataLen + allHeaderLength);
+	// The received packet is sent, if OpenSSL wrote to it
+	if ((out.empty()) || (out.front() != pkt)) {
+		funIface.freePkt();
+	}
 
-		// Set the whole Header stuff
-		ethernet->setDstAddr(server->remoteMac);
-		ethernet->setSrcAddr(server->localMac);
-		ethernet->setEthertype(Headers::Ethernet::ETHERTYPE_IPv4);
+	for (mbuf *outPkt : out) {
+		setHeaders(server, outPkt);
+	}
 
-		ipv4->setVersion();
-		ipv4->setIHL(5);
-		ipv4->setPayloadLength(dataLen + sizeof(Headers::Udp));
-		ipv4->setProtoUDP();
-		ipv4->setSrcIP(server->localIP);
-		ipv4->setDstIP(server->remoteIP);
-		ipv4->checksum = 0;
-		ipv4->ttl = 64;
+	return out.size();
+}
 
-		udp->setDstPort(server->remotePort);
-		udp->setSrcPort(server->localPort);
-		udp->setPayloadLength(dataLen);
+/* Write an alert into a packet, with the records of the fast path
+ *
+ * \return False, if the sequence numbers are used up
+ */
+static bool sealAlert(dtlsServer *server, mbuf *outPkt, uint8_t level, uint8_t desc) {
+	uint8_t *rec = reinterpret_cast<uint8_t *>(outPkt->getData()) + MbufBio::defaultOffset;
+	uint8_t *plain = rec + server->aead->getPlainOffset();
+	plain[0] = level;
+	plain[1] = desc;
+
+	int recLen = server->aead->seal(rec, DtlsAead::typeAlert, 2);
+	if (recLen < 0) {
+		return false;
+	}
+	outPkt->setDataLen(MbufBio::defaultOffset + recLen);
+	setHeaders(server, outPkt);
+	return true;
+}
 
-		DEBUG_ENABLED(std::cout << "DTLS_Server::writeAllDataAvailable() sending packet. "
-								   "len: "
-								<< pkt->getDataLen() << std::endl;)
+static void runHandshakeTimeout(SM::State &state, SM::FunIface &funIface);
+static void runIdleTimeout(SM::State &state, SM::FunIface &funIface);
 
-		ret++;
-	} else {
-		funIface.freePkt();
-	}
+// During the handshake, this is the retransmission timer of OpenSSL, otherwise the idle timeout
+static void setTimer(dtlsServer *server, SM::FunIface &funIface) {
+	auto idleDeadline = server->lastPkt + idleTimeout;
 
-	// Maybe there is more data to send, therefore request extra packets if need be
-	while (BIO_eof(server->wbio) == false) {
-		DEBUG_ENABLED(std::cout << "DTLS_Server::writeAllDataAvailable() sending extra packet"
-								<< std::endl;)
+	struct timeval tv;
+	if (!SSL_is_init_finished(server->ssl) && (DTLSv1_get_timeout(server->ssl, &tv) == 1)) {
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(tv.tv_sec) +
+			std::chrono::microseconds(tv.tv_usec);
 
-		// Try to get an extra packet
-		mbuf *xtraPkt = funIface.getPkt();
-		assert(xtraPkt != NULL);
+		// The retransmissions end with the idle timeout
+		if ((idleTimeout.count() > 0) && (idleDeadline < deadline)) {
+			deadline = idleDeadline;
+		}
+		funIface.setTimeout(deadline, runHandshakeTimeout);
+	} else if (idleTimeout.count() > 0) {
+		funIface.setTimeout(idleDeadline, runIdleTimeout);
+	}
+}
 
-		DEBUG_ENABLED(std::cout << "hexdump of packet before" << std::endl;
-					  hexdump(xtraPkt->getData(), 64);)
+/* Set the timeout of the connection, once a state function is done
+ *
+ * Every packet of the connection cancels the timeout, so each state function
+ * arms it again.
+ */
+static void armTimer(dtlsServer *server, SM::FunIface &funIface) {
+	server->lastPkt = std::chrono::steady_clock::now();
+	setTimer(server, funIface);
+}
 
-		Headers::Ethernet *ethernet =
-			reinterpret_cast<Headers::Ethernet *>(xtraPkt->getData());
-		Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
+// Retransmit the last flight, there is no packet to reuse for it
+static void runHandshakeTimeout(SM::State &state, SM::FunIface &funIface) {
+	DEBUG_ENABLED(std::cout << "DTLS_Server::runHandshakeTimeout() is called" << std::endl;)
 
-		ipv4->setVersion();
-		ipv4->setIHL(5);
+	dtlsServer *server = reinterpret_cast<dtlsServer *>(state.stateData);
 
-		Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+	// A peer, which is silent for too long, is gone
+	if ((idleTimeout.count() > 0) &&
+		(std::chrono::steady_clock::now() - server->lastPkt >= idleTimeout)) {
+		runIdleTimeout(state, funIface);
+		return;
+	}
 
-		int udpMaxLen =
-			std::min(pkt->getBufLen(), static_cast<uint16_t>(1500)) - allHeaderLength;
+	bindPkts(server, nullptr, nullptr, funIface);
 
-		uint64_t start = read_rdtsc();
+	uint64_t start = read_rdtsc();
+	int ret = DTLSv1_handle_timeout(server->ssl);
+	uint64_t stop = read_rdtsc();
+	measureData.openssl += stop - start;
 
-		int dataLen = BIO_read(server->wbio, udp->getPayload(), udpMaxLen);
+	sendAllPkts(server, nullptr, funIface);
 
-		uint64_t stop = read_rdtsc();
-		measureData.openssl += stop - start;
+	// OpenSSL gives up after too many retransmissions
+	if (ret < 0) {
+		ERR_clear_error();
+		releaseSsl(server);
+		delete (server);
+		funIface.transition(States::DELETED);
+		return;
+	}
 
-		assert(dataLen > 0);
-		xtraPkt->setDataLen(dataLen + allHeaderLength);
+	setTimer(server, funIface);
+}
 
-		// Set the whole Header stuff
-		ethernet->setEthertype(Headers::Ethernet::ETHERTYPE_IPv4);
-		ethernet->setDstAddr(server->remoteMac);
-		ethernet->setSrcAddr(server->localMac);
+// Close the connection, the peer learns about it, if it is still there
+static void runIdleTimeout(SM::State &state, SM::FunIface &funIface) {
+	DEBUG_ENABLED(std::cout << "DTLS_Server::runIdleTimeout() is called" << std::endl;)
 
-		ipv4->setPayloadLength(dataLen + sizeof(Headers::Udp));
-		ipv4->setProtoUDP();
-		ipv4->setSrcIP(server->localIP);
-		ipv4->setDstIP(server->remoteIP);
-		ipv4->checksum = 0;
-		ipv4->ttl = 64;
+	dtlsServer *server = reinterpret_cast<dtlsServer *>(state.stateData);
 
-		udp->setDstPort(server->remotePort);
-		udp->setSrcPort(server->localPort);
+	if (server->aead != nullptr) {
+		// OpenSSL must not write anymore, see sendDataFast()
+		mbuf *outPkt = funIface.allocPkt();
+		if (sealAlert(server, outPkt, SSL3_AL_WARNING, SSL3_AD_CLOSE_NOTIFY)) {
+			funIface.addPkt(outPkt);
+		} else {
+			rte_pktmbuf_free(reinterpret_cast<rte_mbuf *>(outPkt));
+		}
+	} else {
+		bindPkts(server, nullptr, nullptr, funIface);
+		if (SSL_is_init_finished(server->ssl)) {
+			SSL_shutdown(server->ssl);
+		}
+		sendAllPkts(server, nullptr, funIface);
+	}
 
-		udp->setPayloadLength(dataLen);
+	releaseSsl(server);
+	delete (server);
+	funIface.transition(States::DELETED);
+}
 
-		DEBUG_ENABLED(std::cout << "DTLS_Server::writeAllDataAvailable() sending packet. "
-								   "len: "
-								<< xtraPkt->getDataLen() << std::endl;)
+/* Continue the handshake with the bound packets, and echo data right after it
+ *
+ * This runs on a worker of the AsyncPool, if there is one. Nothing is
+ * thrown, the worker would take the whole process down.
+ *
+ * \return False, if the handshake failed, and the connection has to be closed
+ */
+static bool continueHandshake(dtlsServer *server) {
+	int ret = SSL_accept(server->ssl);
+	if (ret <= 0) {
+		// More flights of the peer are needed, everything else is fatal
+		int err = SSL_get_error(server->ssl, ret);
+		ERR_clear_error();
+		if ((err != SSL_ERROR_WANT_READ) && (err != SSL_ERROR_WANT_WRITE)) {
+			DEBUG_ENABLED(std::cout << "DTLS_Server::continueHandshake() SSL_accept() failed"
+									<< std::endl;)
+			return false;
+		}
+	}
 
-		ret++;
+	// Check if the handshake is finished
+	if (SSL_is_init_finished(server->ssl)) {
+		char buf[2048];
+		// Try to read from the DTLS connection
+		int readLen = SSL_read(server->ssl, buf, 2048);
+
+		if (readLen > 0) {
+			// Reflect the data
+			if (SSL_write(server->ssl, buf, readLen) != readLen) {
+				DEBUG_ENABLED(std::cout << "DTLS_Server::continueHandshake() SSL_write() failed"
+										<< std::endl;)
+				ERR_clear_error();
+				return false;
+			}
+		} else {
+			ERR_clear_error();
+		}
 	}
+	return true;
+}
 
-	return ret;
+// Send what OpenSSL wrote last (e.g. its alert), and close the failed connection
+static void closeFailed(dtlsServer *server, mbuf *pkt, SM::FunIface &funIface) {
+	sendAllPkts(server, pkt, funIface);
+	releaseSsl(server);
+	delete (server);
+	funIface.transition(States::DELETED);
 }
 
 void runHandshake(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
@@ -320,8 +714,8 @@ void runHandshake(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 	dtlsServer *server = reinterpret_cast<dtlsServer *>(state.stateData);
 
 	Headers::Ethernet *ethernet = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
-	Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
-	Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Udp *udp = PktParser::getUdp(pkt);
 
 	server->localIP = ipv4->getDstIP();
 	server->remoteIP = ipv4->getSrcIP();
@@ -332,47 +726,184 @@ void runHandshake(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 	memcpy(server->localMac.data(), ethernet->destMac.data(), 6);
 	memcpy(server->remoteMac.data(), ethernet->srcMac.data(), 6);
 
-	// Write the incoming packet to the BIO
-	int writeBytes = BIO_write(server->rbio, udp->getPayload(), udp->getPayloadLength());
-	assert(writeBytes > 0);
+	// Hand the incoming packet to the BIO, unless DTLSv1_listen() kept it
+	if (server->helloBuffered) {
+		server->helloBuffered = false;
+		udp = nullptr;
+	}
+
+	// The public-key operations run on a worker, the core goes on meanwhile
+	if (funIface.canRunAsync()) {
+		bindPkts(server, pkt, udp, allocAsyncPkt, nullptr);
+		funIface.transition(States::FINISH_HANDSHAKE);
+		funIface.runAsync(
+			[server]() { server->handshakeFailed = !continueHandshake(server); });
+		return;
+	}
+
+	bindPkts(server, pkt, udp, funIface);
 
 	uint64_t start = read_rdtsc();
+	bool ok = continueHandshake(server);
+	uint64_t stop = read_rdtsc();
+	measureData.openssl += stop - start;
 
-	SSL_accept(server->ssl);
+	if (!ok) {
+		closeFailed(server, pkt, funIface);
+		return;
+	}
 
 	// Check if the handshake is finished
 	if (SSL_is_init_finished(server->ssl)) {
 		funIface.transition(States::ESTABLISHED);
+	}
 
-		char buf[2048];
-		// Try to read from the DTLS connection
-		int readLen = SSL_read(server->ssl, buf, 2048);
+	sendAllPkts(server, pkt, funIface);
+	armTimer(server, funIface);
+};
 
-		if (readLen > 0) {
-			// Reflect the data
-			if (SSL_write(server->ssl, buf, readLen) != readLen) {
-				throw new std::runtime_error("DTLS_Server::sendData() SSL_write() failed");
-			}
+void finishHandshake(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
+	DEBUG_ENABLED(std::cout << "DTLS_Server::finishHandshake() is called" << std::endl;)
+
+	dtlsServer *server = reinterpret_cast<dtlsServer *>(state.stateData);
+
+	// The worker allocated the extra packets, they are not part of the batch yet
+	for (mbuf *outPkt : MbufBio::finish(server->bio)) {
+		if (outPkt != pkt) {
+			funIface.addPkt(outPkt);
+		}
+	}
+
+	if (server->handshakeFailed) {
+		closeFailed(server, pkt, funIface);
+		return;
+	}
+
+	if (SSL_is_init_finished(server->ssl)) {
+		funIface.transition(States::ESTABLISHED);
+	} else {
+		funIface.transition(States::HANDSHAKE);
+	}
+
+	sendAllPkts(server, pkt, funIface);
+	armTimer(server, funIface);
+};
+
+/* Echo a record of an established connection without OpenSSL
+ *
+ * The record is opened and sealed in place, in the packet it arrived in.
+ * OpenSSL cannot take the records back, its sequence numbers are stale.
+ * So alerts are answered here, and renegotiations are refused.
+ */
+static void sendDataFast(dtlsServer *server, mbuf *pkt, SM::FunIface &funIface) {
+	Headers::Udp *udp = PktParser::getUdp(pkt);
+	uint8_t *payload = reinterpret_cast<uint8_t *>(udp->getPayload());
+	uint16_t payloadLen = udp->getPayloadLength();
+
+	// The reply has no IP options, the record moves to where the datagram starts then
+	uint8_t *rec = reinterpret_cast<uint8_t *>(pkt->getData()) + MbufBio::defaultOffset;
+	if (rec != payload) {
+		memmove(rec, payload, payloadLen);
+	}
+
+	uint64_t start = read_rdtsc();
+
+	uint8_t type;
+	int plainLen = server->aead->open(rec, payloadLen, type);
+	uint8_t *plain = rec + server->aead->getPlainOffset();
+	bool reply = false;
+	bool closed = false;
+
+	if (plainLen < 0) {
+		// Forged, replayed, of an old epoch, or more than one record: drop it
+	} else if (type == DtlsAead::typeData) {
+		measureData.numBytes += plainLen;
+
+		// Reflect the data
+		int recLen = server->aead->seal(rec, DtlsAead::typeData, plainLen);
+		if (recLen > 0) {
+			pkt->setDataLen(MbufBio::defaultOffset + recLen);
+			setHeaders(server, pkt);
+			reply = true;
+		} else {
+			closed = true;
 		}
+	} else if ((type == DtlsAead::typeAlert) && (plainLen == 2)) {
+		if (plain[1] == SSL3_AD_CLOSE_NOTIFY) {
+			// Send a shutdown on our end
+			reply = sealAlert(server, pkt, SSL3_AL_WARNING, SSL3_AD_CLOSE_NOTIFY);
+			closed = true;
+		} else if (plain[0] == SSL3_AL_FATAL) {
+			closed = true;
+		}
+	} else if (type == DtlsAead::typeHandshake) {
+		reply = sealAlert(server, pkt, SSL3_AL_WARNING, SSL_AD_NO_RENEGOTIATION);
 	}
+
 	uint64_t stop = read_rdtsc();
 	measureData.openssl += stop - start;
 
-	writeAllDataAvailable(server, pkt, funIface);
-};
+	if (!reply) {
+		funIface.freePkt();
+	}
+
+	if (closed) {
+		funIface.transition(States::DELETED);
+		releaseSsl(server);
+		delete (server);
+	} else if (plainLen >= 0) {
+		armTimer(server, funIface);
+	} else {
+		// Dropped records do not keep the connection open
+		setTimer(server, funIface);
+	}
+}
+
+/* Hand the records over to the fast path, once OpenSSL echoed a record
+ *
+ * \param lastOpened The record OpenSSL just read
+ */
+static void takeOverRecords(dtlsServer *server, const DtlsAead::Header &lastOpened) {
+	const std::vector<mbuf *> &out = MbufBio::finish(server->bio);
+	if (out.empty() || (SSL_has_pending(server->ssl) != 0)) {
+		return;
+	}
+
+	// The echo is the last record OpenSSL wrote
+	mbuf *lastPkt = out.back();
+	DtlsAead::Header lastSealed;
+	if (!DtlsAead::parseLast(
+			reinterpret_cast<uint8_t *>(lastPkt->getData()) + MbufBio::defaultOffset,
+			lastPkt->getDataLen() - MbufBio::defaultOffset, lastSealed)) {
+		return;
+	}
+
+	// Other ciphers stay with OpenSSL
+	server->aead = DtlsAead::create(server->ssl, lastOpened, lastSealed);
+}
 
 void sendData(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 	dtlsServer *server = reinterpret_cast<dtlsServer *>(state.stateData);
 
-	Headers::Ethernet *ethernet = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
-	Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
-	Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+	if (server->aead != nullptr) {
+		sendDataFast(server, pkt, funIface);
+		return;
+	}
+
+	Headers::Udp *udp = PktParser::getUdp(pkt);
+
+	// Only a datagram with a single record of data may be the last one of OpenSSL
+	DtlsAead::Header inHeader;
+	bool takeOver = fastPath &&
+		DtlsAead::parse(reinterpret_cast<uint8_t *>(udp->getPayload()),
+			udp->getPayloadLength(), inHeader) &&
+		(inHeader.type == DtlsAead::typeData) &&
+		(DtlsAead::headerLen + inHeader.len == udp->getPayloadLength());
 
 	uint64_t start = read_rdtsc();
 
-	// Write the incoming packet to the BIO
-	int writeBytes = BIO_write(server->rbio, udp->getPayload(), udp->getPayloadLength());
-	assert(writeBytes > 0);
+	// Hand the incoming packet to the BIO, the echo is written right into it
+	bindPkts(server, pkt, udp, funIface);
 
 	char buf[2048];
 
@@ -391,7 +922,8 @@ void sendData(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 	// Start to shutdown the connection
 	// SSL_shutdown(client->ssl);
 
-	if (SSL_get_shutdown(server->ssl) != 0) {
+	bool closed = SSL_get_shutdown(server->ssl) != 0;
+	if (closed) {
 		// Send a shutdown on our end
 		SSL_shutdown(server->ssl);
 		// funIface.transition(States::RUN_TEARDOWN);
@@ -402,7 +934,21 @@ void sendData(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 	measureData.openssl += stop - start;
 
 	// Same procedure as everytime
-	writeAllDataAvailable(server, pkt, funIface);
+	sendAllPkts(server, pkt, funIface);
+
+	// The SSL object is used for the next connection
+	if (closed) {
+		releaseSsl(server);
+		delete (server);
+	} else {
+		if (takeOver && (readLen > 0)) {
+			start = read_rdtsc();
+			takeOverRecords(server, inHeader);
+			stop = read_rdtsc();
+			measureData.openssl += stop - start;
+		}
+		armTimer(server, funIface);
+	}
 };
 
 void runTeardown(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
@@ -410,25 +956,24 @@ void runTeardown(SM::State &state, mbuf *pkt, SM::FunIface &funIface) {
 
 	dtlsServer *server = reinterpret_cast<dtlsServer *>(state.stateData);
 
-	Headers::Ethernet *ethernet = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
-	Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(ethernet->getPayload());
-	Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+	Headers::Udp *udp = PktParser::getUdp(pkt);
+
+	// Hand the incoming packet to the BIO
+	bindPkts(server, pkt, udp, funIface);
 
-	// Write the incoming packet to the BIO
-	int writeBytes = BIO_write(server->rbio, udp->getPayload(), udp->getPayloadLength());
-	assert(writeBytes > 0);
+	bool closed = SSL_shutdown(server->ssl) == 1;
 
-	if (SSL_shutdown(server->ssl) == 1) {
+	// Same procedure as everytime
+	sendAllPkts(server, pkt, funIface);
+
+	if (closed) {
 		// In this case, we need to free the object
-		SSL_free(server->ssl);
+		releaseSsl(server);
 		delete (server);
 		funIface.transition(States::DELETED);
-
-		funIface.freePkt();
+	} else {
+		armTimer(server, funIface);
 	}
-
-	// Same procedure as everytime
-	writeAllDataAvailable(server, pkt, funIface);
 };
 
 }; // namespace DTLS_Server
@@ -442,6 +987,7 @@ struct Dtls_C_config {
 	SSL_CTX *ctx;
 	StateMachine<IPv4_5TupleL2Ident<mbuf>, mbuf> *sm;
 	struct rte_mempool *mp;
+	AsyncPool *pool = nullptr;
 };
 
 void *DtlsServer_init(struct rte_mempool *memp) {
@@ -450,7 +996,6 @@ void *DtlsServer_init(struct rte_mempool *memp) {
 
 		struct Dtls_C_config *ret = new Dtls_C_config();
 		ret->ctx = DTLS_Server::createCTX();
-		DTLS_Server::ctx = ret->ctx;
 		ret->sm = obj;
 
 		DTLS_Server::mp = memp;
@@ -466,6 +1011,10 @@ void *DtlsServer_init(struct rte_mempool *memp) {
 
 		DTLS_Server::configStateMachine(*obj);
 
+		// Create the SSL objects of this core now, not with the first connections
+		DTLS_Server::getPool().setCtx(ret->ctx);
+		DTLS_Server::getPool().resize(DTLS_Server::sslPoolSize);
+
 		return ret;
 	} catch (std::exception *e) {
 		std::cout << "DtlsServer_init() caught exception:" << std::endl
@@ -474,6 +1023,57 @@ void *DtlsServer_init(struct rte_mempool *memp) {
 	}
 };
 
+void DtlsServer_setCookies(void *obj, bool enable) {
+	auto config = reinterpret_cast<Dtls_C_config *>(obj);
+	if (enable) {
+		config->sm->registerPreAcceptFunction(DTLS_Server::preAccept);
+	} else {
+		config->sm->registerPreAcceptFunction(nullptr);
+	}
+};
+
+void DtlsServer_setSslPoolSize(void *obj, unsigned int size) {
+	(void)obj;
+	DTLS_Server::getPool().resize(size);
+};
+
+void DtlsServer_setSessionTickets(void *obj, bool enable) {
+	(void)obj;
+	DTLS_Server::sessionTickets = enable;
+};
+
+void DtlsServer_setIdleTimeout(void *obj, unsigned int timeout) {
+	(void)obj;
+	DTLS_Server::idleTimeout = std::chrono::milliseconds(timeout);
+};
+
+void DtlsServer_setFastPath(void *obj, bool enable) {
+	(void)obj;
+	DTLS_Server::fastPath = enable;
+};
+
+unsigned int DtlsServer_getConnections(void *obj) {
+	auto config = reinterpret_cast<Dtls_C_config *>(obj);
+	return config->sm->getStateTableSize();
+};
+
+void DtlsServer_setSessionCache(void *obj, unsigned int size, unsigned int ttl) {
+	(void)obj;
+	DTLS_Server::sessionCacheSize = size;
+	DTLS_Server::sessionCacheTtl = ttl;
+};
+
+void DtlsServer_setAsyncWorkers(void *obj, unsigned int numWorkers) {
+	auto config = reinterpret_cast<Dtls_C_config *>(obj);
+	if (config->pool != nullptr) {
+		throw new std::runtime_error("DtlsServer_setAsyncWorkers() workers already started");
+	}
+	if (numWorkers > 0) {
+		config->pool = new AsyncPool(numWorkers);
+		config->sm->registerAsyncPool(config->pool);
+	}
+};
+
 void DtlsServer_getPkts(void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts) {
 	try {
 		BufArray<mbuf> *inPktsBA = reinterpret_cast<BufArray<mbuf> *>(obj);
@@ -536,9 +1136,11 @@ void DtlsServer_free(void *obj) {
 		auto config = reinterpret_cast<Dtls_C_config *>(obj);
 
 		delete (config->sm);
-		OPENSSL_free(config->ctx);
-		delete (config);
+		delete (config->pool);
+		DTLS_Server::freeSslObjects();
+		SSL_CTX_free(config->ctx);
 		rte_mempool_free(config->mp);
+		delete (config);
 
 	} catch (std::exception *e) {
 		std::cout << "DtlsServer_free() caught exception:" << std::endl
@@ -5,6 +5,7 @@
 #include <sstream>
 
 #include "IPv4_5TupleL2Ident.hpp"
+#include "checksum.hpp"
 #include "headers.hpp"
 #include "helloBye2Proto.hpp"
 #include "mbuf.hpp"
@@ -70,25 +71,17 @@ void Hello<Identifier, Packet>::fun(
 	DEBUG_ENABLED(std::cout << "HelloBye2::Server::Hello::fun() clientCookie: "
 							<< static_cast<int>(clientCookie) << std::endl;)
 
+	Checksum::Update udpUpdate;
+	udpUpdate.remove(msg, sizeof(*msg));
 	msg->role = msg::ROLE_SERVER;
 	msg->msg = msg::MSG_HELLO;
 	msg->cookie = serverCookie;
+	udpUpdate.add(msg, sizeof(*msg));
 
-	// Set the IP header stuff
-	// Leave the payload length alone for now...
-
-	ipv4->ttl = 64;
-	uint32_t tmp = ipv4->dstIP;
-	ipv4->dstIP = ipv4->srcIP;
-	ipv4->srcIP = tmp;
-	ipv4->checksum = 0;
+	udp->checksum = udpUpdate.applyUdp(udp->checksum);
 
-	// Set UDP checksum to 0 and hope for the best
-
-	udp->checksum = 0;
-	uint16_t tmp16 = udp->dstPort;
-	udp->dstPort = udp->srcPort;
-	udp->srcPort = tmp16;
+	// Addresses, ports and TTL are set for the whole batch
+	funIface.replyInPlace();
 
 	funIface.transition(States::Bye);
 };
@@ -133,23 +126,17 @@ void Bye<Identifier, Packet>::fun(
 	}
 
 	// Prepare new packet
+	Checksum::Update udpUpdate;
+	udpUpdate.remove(msg, sizeof(*msg));
 	msg->cookie = this->clientCookie;
 	msg->role = msg::ROLE_SERVER;
 	msg->msg = msg::MSG_BYE;
+	udpUpdate.add(msg, sizeof(*msg));
 
-	// Set the IP header stuff
-	// Leave the payload length alone for now...
-	ipv4->ttl = 64;
-	uint32_t tmp = ipv4->dstIP;
-	ipv4->dstIP = ipv4->srcIP;
-	ipv4->srcIP = tmp;
-	ipv4->checksum = 0;
+	udp->checksum = udpUpdate.applyUdp(udp->checksum);
 
-	// Set UDP checksum to 0 and hope for the best
-	udp->checksum = 0;
-	uint16_t tmp16 = udp->dstPort;
-	udp->dstPort = udp->srcPort;
-	udp->srcPort = tmp16;
+	// Addresses, ports and TTL are set for the whole batch
+	funIface.replyInPlace();
 
 	// We are done after this -> transition to Terminate
 	funIface.transition(States::Terminate);
@@ -193,7 +180,6 @@ void Hello<Identifier, Packet>::fun(
 	ipv4->setDstIP(this->dstIp);
 	ipv4->setSrcIP(config.getSrcIP());
 	ipv4->setProtoUDP();
-	ipv4->checksum = 0;
 
 	Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
 	struct msg *msg = reinterpret_cast<struct msg *>(udp->getPayload());
@@ -206,12 +192,13 @@ void Hello<Identifier, Packet>::fun(
 
 	ether->ethertype = htons(0x0800);
 
-	// Set UDP checksum to 0 and hope for the best
-	udp->checksum = 0;
 	udp->setDstPort(config.getDstPort());
 	udp->setSrcPort(this->srcPort);
 	udp->setPayloadLength(50);
 
+	Checksum::setIPv4(ipv4);
+	Checksum::setUdp(ipv4, udp);
+
 	funIface.transition(States::Bye);
 };
 
@@ -252,23 +239,17 @@ void Bye<Identifier, Packet>::fun(
 	// Get server cookie
 	this->serverCookie = msg->cookie;
 
+	Checksum::Update udpUpdate;
+	udpUpdate.remove(msg, sizeof(*msg));
 	msg->cookie = serverCookie;
 	msg->role = msg::ROLE_CLIENT;
 	msg->msg = msg::MSG_BYE;
+	udpUpdate.add(msg, sizeof(*msg));
 
-	// Set the IP header stuff
-	// Leave the payload length alone for now...
-	ipv4->ttl = 64;
-	uint32_t tmp = ipv4->dstIP;
-	ipv4->dstIP = ipv4->srcIP;
-	ipv4->srcIP = tmp;
-	ipv4->checksum = 0;
-
-	// Set UDP checksum to 0 and hope for the best
-	udp->checksum = 0;
-	uint16_t tmp16 = udp->dstPort;
-	udp->dstPort = udp->srcPort;
-	udp->srcPort = tmp16;
+	udp->checksum = udpUpdate.applyUdp(udp->checksum);
+
+	// Addresses, ports and TTL are set for the whole batch
+	funIface.replyInPlace();
 
 	DEBUG_ENABLED(
 		std::cout << "HelloBye2::Client::Bye::fun() Dump of outgoing packet" << std::endl;)
@@ -9,6 +9,7 @@
 #include <rte_mempool.h>
 
 #include "IPv4_5TupleL2Ident.hpp"
+#include "checksum.hpp"
 #include "headers.hpp"
 #include "helloBye3MemPool.hpp"
 #include "mbuf.hpp"
@@ -77,25 +78,17 @@ void runHello(StateMachine<Identifier<mbuf>, mbuf>::State &state, mbuf *pkt,
 	DEBUG_ENABLED(std::cout << "HelloBye3MemPool::Server::runHello() clientCookie: "
 							<< static_cast<int>(s->clientCookie) << std::endl;)
 
+	Checksum::Update udpUpdate;
+	udpUpdate.remove(msg, sizeof(*msg));
 	msg->role = msg::ROLE_SERVER;
 	msg->msg = msg::MSG_HELLO;
 	msg->cookie = s->serverCookie;
+	udpUpdate.add(msg, sizeof(*msg));
 
-	// Set the IP header stuff
-	// Leave the payload length alone for now...
-
-	ipv4->ttl = 64;
-	uint32_t tmp = ipv4->dstIP;
-	ipv4->dstIP = ipv4->srcIP;
-	ipv4->srcIP = tmp;
-	ipv4->checksum = 0;
+	udp->checksum = udpUpdate.applyUdp(udp->checksum);
 
-	// Set UDP checksum to 0 and hope for the best
-
-	udp->checksum = 0;
-	uint16_t tmp16 = udp->dstPort;
-	udp->dstPort = udp->srcPort;
-	udp->srcPort = tmp16;
+	// Addresses, ports and TTL are set for the whole batch
+	funIface.replyInPlace();
 
 	funIface.transition(States::Bye);
 };
@@ -130,23 +123,17 @@ void runBye(StateMachine<Identifier<mbuf>, mbuf>::State &state, mbuf *pkt,
 	}
 
 	// Prepare new packet
+	Checksum::Update udpUpdate;
+	udpUpdate.remove(msg, sizeof(*msg));
 	msg->cookie = s->clientCookie;
 	msg->role = msg::ROLE_SERVER;
 	msg->msg = msg::MSG_BYE;
+	udpUpdate.add(msg, sizeof(*msg));
 
-	// Set the IP header stuff
-	// Leave the payload length alone for now...
-	ipv4->ttl = 64;
-	uint32_t tmp = ipv4->dstIP;
-	ipv4->dstIP = ipv4->srcIP;
-	ipv4->srcIP = tmp;
-	ipv4->checksum = 0;
+	udp->checksum = udpUpdate.applyUdp(udp->checksum);
 
-	// Set UDP checksum to 0 and hope for the best
-	udp->checksum = 0;
-	uint16_t tmp16 = udp->dstPort;
-	udp->dstPort = udp->srcPort;
-	udp->srcPort = tmp16;
+	// Addresses, ports and TTL are set for the whole batch
+	funIface.replyInPlace();
 
 	// We are done after this -> transition to Terminate
 	funIface.transition(States::Terminate);
@@ -200,7 +187,6 @@ void runHello(StateMachine<Identifier<mbuf>, mbuf>::State &state, mbuf *pkt,
 	ipv4->setDstIP(c->dstIp);
 	ipv4->setSrcIP(c->srcIp);
 	ipv4->setProtoUDP();
-	ipv4->checksum = 0;
 
 	Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
 	struct msg *msg = reinterpret_cast<struct msg *>(udp->getPayload());
@@ -213,12 +199,13 @@ void runHello(StateMachine<Identifier<mbuf>, mbuf>::State &state, mbuf *pkt,
 
 	ether->ethertype = htons(0x0800);
 
-	// Set UDP checksum to 0 and hope for the best
-	udp->checksum = 0;
 	udp->setDstPort(c->dstPort);
 	udp->setSrcPort(c->srcPort);
 	udp->setPayloadLength(50);
 
+	Checksum::setIPv4(ipv4);
+	Checksum::setUdp(ipv4, udp);
+
 	funIface.transition(States::Bye);
 };
 
@@ -248,23 +235,17 @@ void runBye(StateMachine<Identifier<mbuf>, mbuf>::State &state, mbuf *pkt,
 	// Get server cookie
 	c->serverCookie = msg->cookie;
 
+	Checksum::Update udpUpdate;
+	udpUpdate.remove(msg, sizeof(*msg));
 	msg->cookie = c->serverCookie;
 	msg->role = msg::ROLE_CLIENT;
 	msg->msg = msg::MSG_BYE;
+	udpUpdate.add(msg, sizeof(*msg));
 
-	// Set the IP header stuff
-	// Leave the payload length alone for now...
-	ipv4->ttl = 64;
-	uint32_t tmp = ipv4->dstIP;
-	ipv4->dstIP = ipv4->srcIP;
-	ipv4->srcIP = tmp;
-	ipv4->checksum = 0;
-
-	// Set UDP checksum to 0 and hope for the best
-	udp->checksum = 0;
-	uint16_t tmp16 = udp->dstPort;
-	udp->dstPort = udp->srcPort;
-	udp->srcPort = tmp16;
+	udp->checksum = udpUpdate.applyUdp(udp->checksum);
+
+	// Addresses, ports and TTL are set for the whole batch
+	funIface.replyInPlace();
 
 	DEBUG_ENABLED(std::cout << "HelloBye3MemPool::Client::runBye() Dump of outgoing packet"
 							<< std::endl;)
@@ -1,10 +1,12 @@
 #ifndef HELLOBYEPROTO_CPP
 #define HELLOBYEPROTO_CPP
 
+#include <algorithm>
 #include <cstdlib>
 #include <sstream>
 
 #include "IPv4_5TupleL2Ident.hpp"
+#include "checksum.hpp"
 #include "headers.hpp"
 #include "helloByeProto.hpp"
 #include "mbuf.hpp"
@@ -54,23 +56,15 @@ void HelloBye::HelloByeServerHello<Identifier, Packet>::fun(
 	std::stringstream sstream;
 	sstream << "SERVER HELLO:" << this->serverCookie << std::endl;
 	std::string serverHelloStr = sstream.str();
+	Checksum::Update udpUpdate;
+	udpUpdate.remove(udp->getPayload(), serverHelloStr.length());
 	memcpy(udp->getPayload(), serverHelloStr.c_str(), serverHelloStr.length());
+	udpUpdate.add(udp->getPayload(), serverHelloStr.length());
 
-	// Set the IP header stuff
-	// Leave the payload length alone for now...
-
-	ipv4->ttl = 64;
-	uint32_t tmp = ipv4->dstIP;
-	ipv4->dstIP = ipv4->srcIP;
-	ipv4->srcIP = tmp;
-	ipv4->checksum = 0;
+	udp->checksum = udpUpdate.applyUdp(udp->checksum);
 
-	// Set UDP checksum to 0 and hope for the best
-
-	udp->checksum = 0;
-	uint16_t tmp16 = udp->dstPort;
-	udp->dstPort = udp->srcPort;
-	udp->srcPort = tmp16;
+	// Addresses, ports and TTL are set for the whole batch
+	funIface.replyInPlace();
 
 	funIface.transition(HelloByeServer::Bye);
 };
@@ -121,21 +115,15 @@ void HelloBye::HelloByeServerBye<Identifier, Packet>::fun(
 	std::stringstream sstream;
 	sstream << "SERVER BYE:" << this->clientCookie << std::endl;
 	std::string serverByeStr = sstream.str();
+	Checksum::Update udpUpdate;
+	udpUpdate.remove(udp->getPayload(), serverByeStr.length());
 	memcpy(udp->getPayload(), serverByeStr.c_str(), serverByeStr.length());
+	udpUpdate.add(udp->getPayload(), serverByeStr.length());
 
-	// Set the IP header stuff
-	// Leave the payload length alone for now...
-	ipv4->ttl = 64;
-	uint32_t tmp = ipv4->dstIP;
-	ipv4->dstIP = ipv4->srcIP;
-	ipv4->srcIP = tmp;
-	ipv4->checksum = 0;
+	udp->checksum = udpUpdate.applyUdp(udp->checksum);
 
-	// Set UDP checksum to 0 and hope for the best
-	udp->checksum = 0;
-	uint16_t tmp16 = udp->dstPort;
-	udp->dstPort = udp->srcPort;
-	udp->srcPort = tmp16;
+	// Addresses, ports and TTL are set for the whole batch
+	funIface.replyInPlace();
 
 	// We are done after this -> transition to Terminate
 	funIface.transition(HelloByeServer::Terminate);
@@ -178,7 +166,6 @@ void HelloBye::HelloByeClientHello<Identifier, Packet>::fun(
 	ipv4->setDstIP(this->dstIp);
 	ipv4->setSrcIP(config->getSrcIP());
 	ipv4->setProtoUDP();
-	ipv4->checksum = 0;
 
 	Headers::Udp *udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
 
@@ -191,12 +178,13 @@ void HelloBye::HelloByeClientHello<Identifier, Packet>::fun(
 
 	ether->ethertype = htons(0x0800);
 
-	// Set UDP checksum to 0 and hope for the best
-	udp->checksum = 0;
 	udp->setDstPort(config->getDstPort());
 	udp->setSrcPort(this->srcPort);
 	udp->setPayloadLength(50);
 
+	Checksum::setIPv4(ipv4);
+	Checksum::setUdp(ipv4, udp);
+
 	funIface.transition(HelloByeClient::Bye);
 };
 
@@ -242,22 +230,17 @@ void HelloBye::HelloByeClientBye<Identifier, Packet>::fun(
 	std::string clientByeStr = sstream.str();
 
 	// Zero out old data - just assume 20 bytes...
+	uint32_t rewritten = std::max<uint32_t>(20, clientByeStr.length());
+	Checksum::Update udpUpdate;
+	udpUpdate.remove(udp->getPayload(), rewritten);
 	memset(udp->getPayload(), 0, 20);
 	memcpy(udp->getPayload(), clientByeStr.c_str(), clientByeStr.length());
+	udpUpdate.add(udp->getPayload(), rewritten);
 
-	// Set the IP header stuff
-	// Leave the payload length alone for now...
-	ipv4->ttl = 64;
-	uint32_t tmp = ipv4->dstIP;
-	ipv4->dstIP = ipv4->srcIP;
-	ipv4->srcIP = tmp;
-	ipv4->checksum = 0;
-
-	// Set UDP checksum to 0 and hope for the best
-	udp->checksum = 0;
-	uint16_t tmp16 = udp->dstPort;
-	udp->dstPort = udp->srcPort;
-	udp->srcPort = tmp16;
+	udp->checksum = udpUpdate.applyUdp(udp->checksum);
+
+	// Addresses, ports and TTL are set for the whole batch
+	funIface.replyInPlace();
 
 	// We need to wait for the server reply
 	funIface.transition(HelloByeClient::RecvBye);
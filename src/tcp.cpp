@@ -1,6 +1,7 @@
 #ifndef TCP_CPP
 #define TCP_CPP
 
+#include <limits>
 #include <type_traits>
 
 #include "tcp.hpp"
@@ -30,10 +31,22 @@ void Server<Proto, ConCtl>::runSynAck(StateMachine<Identifier, mbuf>::State &sta
 	StateMachine<Identifier, mbuf>::FunIface &funIface) {
 	connection *c = reinterpret_cast<struct connection *>(state.stateData);
 
-	// Get info from packet
-	Headers::Ethernet *ether = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
-	Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
-	Headers::Tcp *tcp = reinterpret_cast<Headers::Tcp *>(ipv4->getPayload());
+	// Get info from packet, the headers were parsed by the identifier
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+	uint16_t l3HeadersLen = pkt->getL2Len() + pkt->getL3Len();
+
+	// With SYN cookies, the connection is created by the ACK of the handshake
+	// It may carry data already, so it is handled as in the established state
+	if (tcp->getAckFlag() && !tcp->getSynFlag() && !tcp->getRstFlag() &&
+		acceptCookie(c, pkt)) {
+		DEBUG_ENABLED(std::cout << "TCP::Server::runSynAck() Valid SYN cookie, transition "
+								   "into ESTABLISHED"
+								<< std::endl;)
+		funIface.transition(States::est);
+		runEst(state, pkt, funIface);
+		return;
+	}
 
 	/*
 	assert(tcp->getSynFlag());
@@ -52,14 +65,19 @@ void Server<Proto, ConCtl>::runSynAck(StateMachine<Identifier, mbuf>::State &sta
 	tcp->setDstPort(tmp16);
 
 	ipv4->ttl = 64;
-	ipv4->checksum = 0;
 	ipv4->setPayloadLength(sizeof(Headers::Tcp));
 
 	if ((!tcp->getSynFlag()) || tcp->getAckFlag() || tcp->getFinFlag() || tcp->getRstFlag()) {
+		// Segments merged by TcpGro must not go out with the RST
+		pkt->unchain();
 		tcp->clearFlags();
 		tcp->setRstFlag();
+		tcp->setOffset(5);
+		pkt->setDataLen(l3HeadersLen + sizeof(Headers::Tcp));
+		Checksum::setIPv4Tcp(pkt);
 
 		funIface.transition(States::END);
+		delete c;
 		return;
 	}
 
@@ -69,43 +87,211 @@ void Server<Proto, ConCtl>::runSynAck(StateMachine<Identifier, mbuf>::State &sta
 	c->seqRemote = tcp->getSeq()+1;
 	c->seqLocal = 0;
 
-	tcp->setAck(c->seqRemote);
-	//	std::cout << "Setting ack to: " << c->seqRemote +1 << std::endl;
-	uint32_t curSeqNo = c->seqLocal++;
-	tcp->setSeq(curSeqNo);
-	//	std::cout << "Setting seq to: " << 0 << std::endl;
-	tcp->setAckFlag();
-	tcp->setOffset(5);
+	TcpOptions::Parsed options;
+	TcpOptions::parse(tcp, options);
+	c->sackPermitted = options.sackPermitted;
+	c->mss = peerMss(options);
+	if (options.hasWscale) {
+		c->sndWscale = options.wscale;
+		c->rcvWscale = RCV_WSCALE;
+	}
+	if (options.hasTimestamp) {
+		c->tsEnabled = true;
+		c->tsRecent = options.tsVal;
+	}
 
-	pkt->setDataLen(sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Tcp));
+	uint32_t curSeqNo = c->seqLocal++;
+	writeSynAck(pkt, curSeqNo, c->seqRemote, options, tsNow());
 
 	DEBUG_ENABLED(
 		std::cout << "TCP::Server::runSynAck() Sending ACK, transition into ESTABLISHED"
 				  << std::endl;)
 
-	struct segment seg;
-	seg.dataPtr = reinterpret_cast<uint8_t *>(malloc(pkt->getDataLen()));
-	memcpy(seg.dataPtr, pkt->getData(), pkt->getDataLen());
-	seg.dataLen = pkt->getDataLen();
-	seg.seqNumber = curSeqNo;
+	// The SYN consumed one sequence number, data starts after it
+	c->sendRing.init(c->seqLocal);
+	c->conCtl.init(c->seqLocal, c->mss);
 
-	c->dataAlreadySent.push_back(seg);
+	// Keep the headers for segments sent by the retransmission timer
+	// The options are written again for every segment
+	c->headersL2Len = pkt->getL2Len();
+	c->headersLen = l3HeadersLen + sizeof(Headers::Tcp);
+	assert(c->headersLen <= connection::maxHeadersLen);
+	memcpy(c->headers, pkt->getData(), c->headersLen);
 
 	funIface.transition(States::est);
 };
 
+template <class Proto, class ConCtl>
+typename StateMachine<Identifier, mbuf>::PreAccept Server<Proto, ConCtl>::preAccept(
+	Identifier::ConnectionID id, mbuf *pkt) {
+	using PreAccept = StateMachine<Identifier, mbuf>::PreAccept;
+	(void)id;
+
+	// Get info from packet, the headers were parsed by the identifier
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+	auto now = std::chrono::steady_clock::now();
+
+	if (tcp->getRstFlag() || tcp->getFinFlag()) {
+		return PreAccept::drop;
+	}
+
+	if (tcp->getSynFlag() && !tcp->getAckFlag()) {
+		TcpOptions::Parsed options;
+		TcpOptions::parse(tcp, options);
+
+		// Only the timestamp brings the window scale back, see acceptCookie()
+		// Without it, window scaling is not offered at all (as Linux does)
+		if (!options.hasTimestamp) {
+			options.hasWscale = false;
+		}
+
+		uint32_t cookie = TcpSynCookie::make(ipv4->getSrcIP(), ipv4->getDstIP(),
+			tcp->getSrcPort(), tcp->getDstPort(), tcp->getSeq(), peerMss(options),
+			options.sackPermitted, now);
+
+		DEBUG_ENABLED(std::cout << "TCP::Server::preAccept() Sending SYN ACK with cookie "
+								<< cookie << std::endl;)
+
+		// Send SYN ACK
+		uint32_t tmp = ipv4->getSrcIP();
+		ipv4->setSrcIP(ipv4->getDstIP());
+		ipv4->setDstIP(tmp);
+
+		uint16_t tmp16 = tcp->getSrcPort();
+		tcp->setSrcPort(tcp->getDstPort());
+		tcp->setDstPort(tmp16);
+
+		ipv4->ttl = 64;
+
+		// The cookie has no room for the window scale, the timestamp returned
+		// by the ACK keeps it in the lowest bits (as Linux does)
+		uint32_t tsVal = (tsNow() & ~cookieTsMask) |
+			(options.hasWscale ? options.wscale : cookieTsMask);
+
+		writeSynAck(pkt, cookie, tcp->getSeq() + 1, options, tsVal);
+		return PreAccept::reply;
+	}
+
+	if (tcp->getAckFlag() && !tcp->getSynFlag()) {
+		uint16_t mss;
+		bool sackPermitted;
+		if (TcpSynCookie::check(ipv4->getSrcIP(), ipv4->getDstIP(), tcp->getSrcPort(),
+				tcp->getDstPort(), tcp->getSeq() - 1, tcp->getAck() - 1, mss, sackPermitted,
+				now)) {
+			return PreAccept::accept;
+		}
+	}
+
+	DEBUG_ENABLED(std::cout << "TCP::Server::preAccept() Dropping packet without valid cookie"
+							<< std::endl;)
+	return PreAccept::drop;
+};
+
+template <class Proto, class ConCtl>
+void Server<Proto, ConCtl>::writeSynAck(mbuf *pkt, uint32_t seqLocal, uint32_t seqRemote,
+	const TcpOptions::Parsed &options, uint32_t tsVal) {
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+	uint16_t l3HeadersLen = pkt->getL2Len() + pkt->getL3Len();
+
+	tcp->setAck(seqRemote);
+	tcp->setSeq(seqLocal);
+	tcp->clearFlags();
+	tcp->setSynFlag();
+	tcp->setAckFlag();
+	// The window of a SYN is never scaled
+	tcp->setWindow(std::min(RCV_WINDOW, static_cast<uint32_t>(0xffff)));
+
+	// The options were parsed already, they are overwritten now
+	uint8_t *opt = reinterpret_cast<uint8_t *>(tcp->getPayload());
+	uint8_t optionsLen = TcpOptions::writeMss(opt, MSS);
+	if (options.sackPermitted) {
+		optionsLen += TcpOptions::writeSackPermitted(opt + optionsLen);
+	}
+	if (options.hasWscale) {
+		optionsLen += TcpOptions::writeWscale(opt + optionsLen, RCV_WSCALE);
+	}
+	if (options.hasTimestamp) {
+		optionsLen += TcpOptions::writeTimestamp(opt + optionsLen, tsVal, options.tsVal);
+	}
+	tcp->setOffset((sizeof(Headers::Tcp) + optionsLen) / 4);
+	ipv4->setPayloadLength(sizeof(Headers::Tcp) + optionsLen);
+	pkt->setDataLen(l3HeadersLen + sizeof(Headers::Tcp) + optionsLen);
+	Checksum::setIPv4Tcp(pkt);
+};
+
+template <class Proto, class ConCtl>
+bool Server<Proto, ConCtl>::acceptCookie(connection *c, mbuf *pkt) {
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+	uint16_t l3HeadersLen = pkt->getL2Len() + pkt->getL3Len();
+
+	uint16_t mss;
+	bool sackPermitted;
+	if (!TcpSynCookie::check(ipv4->getSrcIP(), ipv4->getDstIP(), tcp->getSrcPort(),
+			tcp->getDstPort(), tcp->getSeq() - 1, tcp->getAck() - 1, mss, sackPermitted,
+			std::chrono::steady_clock::now())) {
+		return false;
+	}
+
+	// Both SYNs are acknowledged already
+	c->seqRemote = tcp->getSeq();
+	c->seqLocal = tcp->getAck();
+	c->sackPermitted = sackPermitted;
+	c->mss = std::min(mss, static_cast<uint16_t>(MSS));
+
+	// Without timestamps, preAccept() did not offer window scaling
+	TcpOptions::Parsed options;
+	TcpOptions::parse(tcp, options);
+	if (options.hasTimestamp) {
+		c->tsEnabled = true;
+		c->tsRecent = options.tsVal;
+		if ((options.tsEcr & cookieTsMask) != cookieTsMask) {
+			c->sndWscale = options.tsEcr & cookieTsMask;
+			c->rcvWscale = RCV_WSCALE;
+		}
+	}
+
+	c->sendRing.init(c->seqLocal);
+	c->conCtl.init(c->seqLocal, c->mss);
+
+	// Keep the headers for segments sent by the retransmission timer
+	// They are the ones of the reply, other than in the received packet
+	c->headersL2Len = pkt->getL2Len();
+	c->headersLen = l3HeadersLen + sizeof(Headers::Tcp);
+	assert(c->headersLen <= connection::maxHeadersLen);
+	memcpy(c->headers, pkt->getData(), c->headersLen);
+
+	auto ipv4Tmpl = reinterpret_cast<Headers::IPv4 *>(c->headers + c->headersL2Len);
+	auto tcpTmpl = reinterpret_cast<Headers::Tcp *>(c->headers + l3HeadersLen);
+	ipv4Tmpl->setSrcIP(ipv4->getDstIP());
+	ipv4Tmpl->setDstIP(ipv4->getSrcIP());
+	tcpTmpl->setSrcPort(tcp->getDstPort());
+	tcpTmpl->setDstPort(tcp->getSrcPort());
+	ipv4Tmpl->ttl = 64;
+	ipv4Tmpl->checksum = 0;
+
+	return true;
+};
+
 template <class Proto, class ConCtl>
 void Server<Proto, ConCtl>::runEst(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
 	StateMachine<Identifier, mbuf>::FunIface &funIface) {
 	connection *c = reinterpret_cast<struct connection *>(state.stateData);
 
-	// Get info from packet
-	Headers::Ethernet *ether = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
-	Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
-	Headers::Tcp *tcp = reinterpret_cast<Headers::Tcp *>(ipv4->getPayload());
+	// Get info from packet, the headers were parsed by the identifier
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+	uint16_t l3HeadersLen = pkt->getL2Len() + pkt->getL3Len();
 
 	bool freePkt = true;
 
+	// Segments merged by TcpGro follow in a chain, their headers were cut off
+	// They are taken apart here, pkt only holds its own segment afterwards
+	mbuf *merged = pkt->splitNext();
+	uint32_t numMerged = merged != nullptr ? merged->pkt_len : 0;
+
 	/*
 	assert(!tcp->getSynFlag());
 	assert(tcp->getAckFlag());
@@ -123,7 +309,6 @@ void Server<Proto, ConCtl>::runEst(StateMachine<Identifier, mbuf>::State &state,
 	tcp->setDstPort(tmp16);
 
 	ipv4->ttl = 64;
-	ipv4->checksum = 0;
 
 	/*
 	assert(tcp->getAck() == 1);
@@ -144,232 +329,377 @@ void Server<Proto, ConCtl>::runEst(StateMachine<Identifier, mbuf>::State &state,
 		DEBUG_ENABLED(std::cout << "c->seqLocal = " << c->seqLocal << std::endl;)
 		DEBUG_ENABLED(std::cout << "c->seqRemote = " << c->seqRemote << std::endl;)
 
+		if (merged != nullptr) {
+			merged->release();
+		}
+
 		tcp->clearFlags();
 		tcp->setRstFlag();
 		tcp->setAck(0);
 		tcp->setSeq(c->seqLocal);
+		tcp->setOffset(5);
 		ipv4->setPayloadLength(sizeof(Headers::Tcp));
-		pkt->setDataLen(
-			sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Tcp));
+		pkt->setDataLen(l3HeadersLen + sizeof(Headers::Tcp));
+		Checksum::setIPv4Tcp(pkt);
 
 		funIface.transition(States::END);
+		delete c;
 		return;
 	}
 
 	DEBUG_ENABLED(
 		std::cout << "TCP::Server::runEst() All received flags are correct" << std::endl;)
 
-	// Erase all the old acknowledged segments
-	for (auto i = c->dataAlreadySent.begin(); i != c->dataAlreadySent.end();) {
-		if (tcp->getAck() > (i->seqNumber + i->dataLen)) {
-			// In this case, the data is acknowledged
-			auto del = i;
-			i++;
+	// Release all acknowledged data
+	uint32_t bytesAcked = c->sendRing.ack(tcp->getAck());
 
-			struct segment delSeg = *del;
+	TcpOptions::Parsed options;
+	if (tcp->getHeaderLen() > sizeof(Headers::Tcp)) {
+		TcpOptions::parse(tcp, options);
+	}
 
-			//std::cout << "segment is acknowledged - deleting: " << std::hex << reinterpret_cast<uint64_t>(delSeg.dataPtr) << std::dec << std::endl;
+	// Mark what the peer received above the holes
+	if (c->sackPermitted) {
+		for (uint8_t i = 0; i < options.numSackBlocks; i++) {
+			c->sendRing.sack(options.sackBlocks[i].left, options.sackBlocks[i].right);
+		}
+	}
 
-			free(delSeg.dataPtr);
-			c->dataAlreadySent.erase(del);
-		} else {
-			i++;
-		}	/* else {
-			break;
-		} */
+	// Echo the timestamp of the segments, which did not arrive ahead of a hole (RFC 7323)
+	bool hasTimestamp = c->tsEnabled && options.hasTimestamp;
+	if (hasTimestamp && TcpSeq::le(tcp->getSeq(), c->seqRemote)) {
+		c->tsRecent = options.tsVal;
 	}
 
 	// Run whatever congestion control magic we have
-	c->conCtl.handlePacket(c->seqLocal, tcp->getAck());
-	uint32_t resetSeq;
-	if (c->conCtl.reset(resetSeq)) {
-		// For not, ignore resetSeq.
-		// Just resend all previous segments
-		//(void)resetSeq;
-
-		//std::abort();
-
-		// Identify all the segments we have to resend
-		// XXX In the future: Check if we can aggregate frames
-		for(auto i = c->dataAlreadySent.begin(); i != c->dataAlreadySent.end();){
-//		for (auto i : c->dataAlreadySent) {
-			// We have to resend the data
-			if(i->seqNumber > resetSeq){
-				c->dataToSend.push_front(*i);
-				//std::cout << "Enqueue old packet: seq:" << i->seqNumber << std::endl;
-				auto old = i++;
-				c->dataAlreadySent.erase(old);
-			} else {
-				i++;
-			}
+	// Segments carrying data are no duplicate ACKs (RFC 5681)
+	bool hasData = ipv4->getPayloadLength() > tcp->getHeaderLen();
+	if ((bytesAcked > 0) || !hasData) {
+		auto now = std::chrono::steady_clock::now();
+		uint32_t ts = tsNow();
+		if (hasTimestamp && (bytesAcked > 0) && (options.tsEcr != 0) &&
+			TcpSeq::le(options.tsEcr, ts)) {
+			// Every ACK of new data is a sample, retransmissions included
+			auto rtt = std::chrono::microseconds(ts - options.tsEcr);
+			c->rto.sample(rtt);
+			c->conCtl.handleRtt(rtt);
+		} else if (c->rttTiming && TcpSeq::le(c->rttSeq, tcp->getAck())) {
+			c->rttTiming = false;
+			auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(now - c->rttStart);
+			c->rto.sample(rtt);
+			c->conCtl.handleRtt(rtt);
 		}
-		//c->dataAlreadySent.clear();
+
+		c->conCtl.handleAck(tcp->getAck(), bytesAcked, c->sendRing.getMax(), now);
 	}
 
-	c->sendWindow = tcp->getWindow();
+	// Timeouts end with every packet, so the timer is set again in any case
+	// Only new data restarts it (RFC 6298)
+	armRto(c, bytesAcked > 0);
+
+	c->sendWindow = static_cast<uint32_t>(tcp->getWindow()) << c->sndWscale;
 
 	// See how long the TCP payload is and set the current remote seq number
 	DEBUG_ENABLED(std::cout << "TCP::Server::runEst() old c->seqRemote = " << c->seqRemote
 							<< std::endl;)
-	uint16_t numBytesReceived = ipv4->getPayloadLength() - tcp->getHeaderLen();
+	uint16_t numBytesReceived = ipv4->getPayloadLength() - tcp->getHeaderLen() - numMerged;
 	DEBUG_ENABLED(std::cout << "TCP::Server::runEst() ipv4->getPayloadLength() = "
 							<< ipv4->getPayloadLength() << std::endl;)
 	DEBUG_ENABLED(std::cout << "TCP::Server::runEst() tcp->getHeaderLen() = "
 							<< static_cast<uint16_t>(tcp->getHeaderLen()) << std::endl;)
 
-	if(tcp->getSeq() != c->seqRemote){
-		// This packet was not expected - Let's be dump and play Go-Back-N
+	uint32_t seq = tcp->getSeq();
+	uint8_t *payload = PktParser::getPayload(pkt);
+	uint32_t mergedSeq = seq + numBytesReceived;
+
+	// A retransmission may hold data received before, skip that part
+	// The merged segments may hold new data, even if pkt does not
+	if (TcpSeq::lt(seq, c->seqRemote) &&
+		TcpSeq::lt(c->seqRemote, mergedSeq + numMerged)) {
+		uint16_t skip = std::min(c->seqRemote - seq, static_cast<uint32_t>(numBytesReceived));
+		payload += skip;
+		numBytesReceived -= skip;
+		seq = c->seqRemote;
+	}
 
-		//std::cout << "packet not expected" << std::endl;
+	// Take the next merged segment off the chain, the caller releases it
+	auto nextMerged = [&]() {
+		mbuf *cur = merged;
+		merged = cur->splitNext();
+		return cur;
+	};
+
+	if (seq != c->seqRemote) {
+		// Data ahead of seqRemote is kept, until the hole in front of it is filled
+		// A FIN out of order is ignored, the peer sends it again
+		mbuf *ackPkt = pkt;
+		if ((numBytesReceived > 0) &&
+			c->reassembly.insert(c->seqRemote, pkt, payload, seq, numBytesReceived)) {
+			// The payload has to stay intact, answer with another buffer
+			ackPkt = funIface.getPkt();
+			memcpy(ackPkt->getData(), pkt->getData(), l3HeadersLen + sizeof(Headers::Tcp));
+			ackPkt->setHeaderLens(pkt->getL2Len(), pkt->getL3Len(), sizeof(Headers::Tcp));
+			c->appendBatchID = funIface.getBatchID();
+			funIface.freePkt();
+
+			uint8_t *ackData = reinterpret_cast<uint8_t *>(ackPkt->getData());
+			ipv4 = reinterpret_cast<Headers::IPv4 *>(ackData + pkt->getL2Len());
+			tcp = reinterpret_cast<Headers::Tcp *>(ackData + l3HeadersLen);
+		}
 
-		//std::abort();
+		// The merged segments are queued on their own
+		while (merged != nullptr) {
+			mbuf *cur = nextMerged();
+			c->reassembly.insert(
+				c->seqRemote, cur, reinterpret_cast<uint8_t *>(cur->getData()), mergedSeq,
+				cur->getDataLen());
+			mergedSeq += cur->getDataLen();
+			cur->release();
+		}
 
+		// Duplicate ACK, the SACK blocks tell the peer what arrived
 		tcp->clearFlags();
 		tcp->setAckFlag();
-
-		tcp->setSeq(c->seqLocal);
+		tcp->setSeq(c->sendRing.getNxt());
 		tcp->setAck(c->seqRemote);
-		tcp->setOffset(5);
+		tcp->setWindow(getRcvWindow(c));
+		uint16_t tcpHeaderLen = writeOptions(c, tcp);
 
-		ipv4->setPayloadLength(sizeof(Headers::Tcp));
-		if(c->dataToSend.empty()){
-			tcp->setSeq(c->seqLocal);
-		} else {
-			tcp->setSeq(c->dataToSend.front().seqNumber);
-		}
-		tcp->setWindow(4*MSS);
-		pkt->setDataLen(sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Tcp));
+		ipv4->setPayloadLength(tcpHeaderLen);
+		ackPkt->setDataLen(l3HeadersLen + tcpHeaderLen);
+		Checksum::setIPv4Tcp(ackPkt);
+
+		// Out-of-order data is acknowledged right away (RFC 5681)
+		c->ackPending = 0;
+		armTimer(c, funIface);
 
 		// Do not try to send some data, even if we could do so
 		return;
 	}
 
-	c->seqRemote = tcp->getSeq() + numBytesReceived;
 	DEBUG_ENABLED(std::cout << "TCP::Server::runEst() numBytesReceived = " << numBytesReceived
 							<< std::endl;)
+
+	// Filling a hole and the FIN are acknowledged right away, other data may wait
+	bool ackNow = false;
+
+	TcpIface tcpIface(*c, funIface);
+	auto deliver = [&](uint8_t *data, uint16_t len) {
+		c->proto.handlePacket(data, len, tcpIface);
+		c->seqRemote += len;
+
+		// The segment may have filled a hole, hand over the data queued behind it
+		TcpReassembly<mbuf>::Segment queued;
+		while (c->reassembly.pop(c->seqRemote, queued)) {
+			c->proto.handlePacket(queued.data, queued.len, tcpIface);
+			c->seqRemote += queued.len;
+			queued.pkt->release();
+			ackNow = true;
+		}
+	};
+
+	if (numBytesReceived > 0) {
+		DEBUG_ENABLED(
+			std::cout << "TCP::Server:runEst() pumping data into the protocol implementation"
+					  << std::endl;)
+		deliver(payload, numBytesReceived);
+	}
+
+	// The merged segments follow in order, parts of them may be queued already
+	// With at least two segments received, the ACK does not wait
+	while (merged != nullptr) {
+		mbuf *cur = nextMerged();
+		uint8_t *data = reinterpret_cast<uint8_t *>(cur->getData());
+		uint16_t len = cur->getDataLen();
+		uint16_t skip = std::min(c->seqRemote - mergedSeq, static_cast<uint32_t>(len));
+		if (skip < len) {
+			deliver(data + skip, len - skip);
+		}
+		mergedSeq += len;
+		cur->release();
+		ackNow = true;
+	}
+
 	DEBUG_ENABLED(std::cout << "TCP::Server::runEst() new c->seqRemote = " << c->seqRemote
 							<< std::endl;)
 
 	if (tcp->getFinFlag()) {
 		DEBUG_ENABLED(std::cout << "TCP::Server:runEst() Peer sent FIN" << std::endl;)
 		c->closeConnectionAfterSending = true;
+		c->finReceived = true;
 		c->seqRemote++;
+		ackNow = true;
 	}
 
+	// The payload was consumed, the options may overwrite it
 	tcp->clearFlags();
 	tcp->setAckFlag();
 
-	tcp->setSeq(c->seqLocal);
+	tcp->setSeq(c->sendRing.getNxt());
 	// tcp->setFinFlag();
 	tcp->setAck(c->seqRemote);
-	tcp->setOffset(5);
+	tcp->setWindow(getRcvWindow(c));
+	uint16_t tcpHeaderLen = writeOptions(c, tcp);
 
-	// funIface.transition(States::ack_fin);
+	// Unless data is sent below, this is a pure ACK
+	ipv4->setPayloadLength(tcpHeaderLen);
+	pkt->setDataLen(l3HeadersLen + tcpHeaderLen);
 
-	uint16_t dataLen = ipv4->getPayloadLength() - tcp->getHeaderLen();
-	if (dataLen > 0) {
-		DEBUG_ENABLED(
-			std::cout << "TCP::Server:runEst() pumping data into the protocol implementation"
-					  << std::endl;)
+	// funIface.transition(States::ack_fin);
 
-		freePkt = false;
-		TcpIface tcpIface(*c);
-		c->proto.handlePacket(
-			reinterpret_cast<uint8_t *>(tcp->getPayload()), dataLen, tcpIface);
+	// Resend only the segment holding resetSeq, retransmissions are not timed
+	// With SACK, the scoreboard knows better, which hole is lost (RFC 6675)
+	uint32_t resetSeq;
+	TcpSendRing<mbuf>::Segment resetSeg;
+	bool retransmit = false;
+	if (c->conCtl.reset(resetSeq)) {
+		retransmit = c->sackPermitted ? c->sendRing.nextLost(resetSeg)
+									  : c->sendRing.find(resetSeq, resetSeg);
+	}
+	if (retransmit) {
+		c->rttTiming = false;
 	}
 
-	if (!c->dataToSend.empty()) {
-		uint32_t maxSend = std::min(static_cast<uint32_t>(c->sendWindow),
-			static_cast<uint32_t>(c->conCtl.getConWindow()));
+	// Additional packets are sent after the whole batch, once this connection
+	// added one, the following segments have to go there as well to keep the order
+	bool firstPacket = c->appendBatchID != funIface.getBatchID();
 
-		DEBUG_ENABLED(std::cout << "TCP::Server::runEst() c->sendWindow = " << c->sendWindow
-								<< " bytes" << std::endl;)
-		DEBUG_ENABLED(std::cout << "TCP::Server::runEst() c->conCtl.getConWindow = "
-								<< c->conCtl.getConWindow() << " bytes" << std::endl;)
-//		DEBUG_ENABLED(
-//			std::cout << "TCP::Server::runEst() data available = "
-//					  << static_cast<uint32_t>(c->dataToSend.size() - c->dataToSendOffset)
-//					  << " bytes" << std::endl;)
+	// Every segment sent carries the ACK
+	bool ackSent = false;
 
-		mbuf *curSendMbuf = pkt;
-		uint32_t alreadySent = 0;
-		bool firstPacket = true;
+	// The segments are collected, and written as frames at once (see TcpGso)
+	TcpSendRing<mbuf>::Segment burst[TcpGso::maxSegments];
+	mbuf *frames[TcpGso::maxSegments];
+	uint32_t burstLen = 0;
 
-		while ((maxSend > alreadySent) && (!c->dataToSend.empty())) {
+	auto flushBurst = [&]() {
+		for (uint32_t i = 0; i < burstLen; i++) {
+			if (firstPacket) {
+				frames[i] = pkt;
+				freePkt = false;
+				firstPacket = false;
+			} else {
+				frames[i] = funIface.getPkt();
+				c->appendBatchID = funIface.getBatchID();
+			}
+		}
 
-			freePkt = false;
+		// Every frame uses the headers of the received packet
+		if (frames[0] != pkt) {
+			memcpy(frames[0]->getData(), pkt->getData(), l3HeadersLen + tcpHeaderLen);
+		}
+		TcpGso::write(frames, burst, burstLen, pkt->getL2Len(), l3HeadersLen, tcpHeaderLen,
+			c->ipID);
+		for (uint32_t i = 0; i < burstLen; i++) {
+			Checksum::setIPv4Tcp(frames[i]);
+		}
 
-			if (!firstPacket) {
-				curSendMbuf = funIface.getPkt();
-			}
+		DEBUG_ENABLED(std::cout << "TCP::Server::runEst() Sending " << burstLen << " segments"
+								<< std::endl;)
+		burstLen = 0;
+	};
+
+	auto sendSegment = [&](const TcpSendRing<mbuf>::Segment &seg) {
+		ackSent = true;
+		burst[burstLen++] = seg;
+		if (burstLen == TcpGso::maxSegments) {
+			flushBurst();
+		}
+	};
 
-			ether = reinterpret_cast<Headers::Ethernet *>(curSendMbuf->getData());
-			ipv4 = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
-			tcp = reinterpret_cast<Headers::Tcp *>(ipv4->getPayload());
+	// The retransmission does not wait for the window (RFC 5681 fast retransmit)
+	if (retransmit) {
+		DEBUG_ENABLED(std::cout << "TCP::Server::runEst() Retransmitting segment "
+								<< resetSeg.seq << std::endl;)
+		sendSegment(resetSeg);
+	}
 
-			// This should now be a copy, not a reference
-			segment segmentToSend = c->dataToSend.front();
+	// During recovery, the holes SACK shows to be lost go first (RFC 6675)
+	bool resendLost = c->sackPermitted && c->conCtl.inRecovery();
 
-			uint16_t curSend =
-				std::min(segmentToSend.dataLen, static_cast<uint16_t>(maxSend - alreadySent));
-			alreadySent += curSend;
+	if ((c->sendRing.getUnsent() > 0) || resendLost) {
+		// Only send, what fits into the windows, minus what is still in flight
+		uint32_t window =
+			std::min(static_cast<uint32_t>(c->sendWindow), c->conCtl.getConWindow());
+		uint32_t inFlight = c->sendRing.getInFlight();
+		uint32_t maxSend = window > inFlight ? window - inFlight : 0;
 
-			if (curSend == segmentToSend.dataLen) {
-				// We can send the whole enqueued segment
-				c->dataToSend.pop_front();
-				c->dataAlreadySent.push_back(segmentToSend);
+		DEBUG_ENABLED(std::cout << "TCP::Server::runEst() c->sendWindow = " << c->sendWindow
+								<< " bytes" << std::endl;)
+		DEBUG_ENABLED(std::cout << "TCP::Server::runEst() c->conCtl.getConWindow = "
+								<< c->conCtl.getConWindow() << " bytes" << std::endl;)
+		DEBUG_ENABLED(std::cout << "TCP::Server::runEst() data available = "
+								<< c->sendRing.getUnsent() << " bytes" << std::endl;)
 
-				memcpy(tcp->getPayload(), segmentToSend.dataPtr, segmentToSend.dataLen);
-			} else {
-				// We can only send a part of the segment
-				segmentToSend.dataLen = curSend;
-
-				// XXX Can we modify it using a .begin() iterator?
-				// save some pop/push
-				segment oldModSeg;
-				oldModSeg = segmentToSend;
-				oldModSeg.dataLen -= curSend;
-				oldModSeg.seqNumber += curSend;
-				oldModSeg.dataPtr = reinterpret_cast<uint8_t *>(malloc(oldModSeg.dataLen));
-				memcpy(oldModSeg.dataPtr, segmentToSend.dataPtr + curSend,
-					segmentToSend.dataLen - curSend);
-				c->dataToSend.pop_front();
-				c->dataToSend.push_front(oldModSeg);
-
-				memmove(segmentToSend.dataPtr, segmentToSend.dataPtr + curSend,
-					segmentToSend.dataLen - curSend);
-				segmentToSend.dataLen -= curSend;
-				c->dataAlreadySent.push_back(segmentToSend);
-
-				memcpy(tcp->getPayload(), segmentToSend.dataPtr, segmentToSend.dataLen);
-
-				//std::cout << "Splitting segment. send: " << std::hex << reinterpret_cast<uint64_t>(segmentToSend.dataPtr)
-				//	<< " remain: " << reinterpret_cast<uint64_t>(oldModSeg.dataPtr) << std::dec << std::endl;
-			}
+		uint32_t alreadySent = 0;
+		TcpSendRing<mbuf>::Segment seg;
+		uint32_t sndMax = c->sendRing.getMax();
+
+		while (resendLost && (alreadySent < maxSend) && c->sendRing.nextLost(seg)) {
+			DEBUG_ENABLED(std::cout << "TCP::Server::runEst() Retransmitting lost segment "
+									<< seg.seq << std::endl;)
+			alreadySent += seg.len;
+			c->rttTiming = false;
+			sendSegment(seg);
+		}
 
-			ipv4->id = htons(c->ipID++);
-			tcp->setWindow(4*MSS);
+		while (c->sendRing.take(maxSend > alreadySent ? maxSend - alreadySent : 0, seg)) {
+			alreadySent += seg.len;
 
-			ipv4->setPayloadLength(sizeof(Headers::Tcp) + segmentToSend.dataLen);
-			tcp->setSeq(segmentToSend.seqNumber);
-			pkt->setDataLen(sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) +
-							sizeof(Headers::Tcp) + segmentToSend.dataLen);
+			// Time the first new segment, if no other one is timed
+			// With timestamps, every ACK is timed already
+			if (!c->tsEnabled && !c->rttTiming && TcpSeq::le(sndMax, seg.seq)) {
+				c->rttTiming = true;
+				c->rttSeq = seg.seq + seg.len;
+				c->rttStart = std::chrono::steady_clock::now();
+			}
+			sndMax = c->sendRing.getMax();
 
-			DEBUG_ENABLED(std::cout << "TCP::Server::runEst() Sending segment with "
-									<< segmentToSend.dataLen << " bytes" << std::endl;)
+			sendSegment(seg);
 		}
 	} else {
 		DEBUG_ENABLED(std::cout << "TCP::Server:runEst() no data to be sent" << std::endl;)
 	}
 
-	if (c->closeConnectionAfterSending && c->dataToSend.empty()) {
+	if (burstLen > 0) {
+		flushBurst();
+	}
+
+	// Start the timer, if it did not run before
+	if (!c->rtoRunning) {
+		armRto(c, false);
+	}
+
+	// The FIN waits for the ACK of all data, so only the timer of the FIN
+	// runs afterwards, and nothing was sent above: pkt is still the pure ACK
+	if (c->closeConnectionAfterSending && (c->sendRing.getUnsent() == 0) &&
+		(c->sendRing.getUna() == c->sendRing.getMax())) {
 		DEBUG_ENABLED(std::cout << "TCP::Server::runEst() Setting FIN" << std::endl;)
 		freePkt = false;
 		tcp->setFinFlag();
+		Checksum::setIPv4Tcp(pkt);
 		c->seqLocal++;
-		funIface.transition(States::ack_fin);
+		funIface.transition(c->finReceived ? States::ack_fin : States::fin);
+		armFinTimeout(c, funIface);
+		return;
 	}
 
+	// Without a segment to carry it, the ACK of data waits for the next
+	// segment received, or DELAYED_ACK_TIMEOUT (RFC 1122, RFC 5681)
+	// pkt is still the pure ACK then, it is sent or freed
+	if (ackSent) {
+		c->ackPending = 0;
+	} else if ((numBytesReceived > 0) || ackNow) {
+		if (ackNow || (++c->ackPending >= DELAYED_ACK_SEGMENTS)) {
+			freePkt = false;
+			Checksum::setIPv4Tcp(pkt);
+			c->ackPending = 0;
+		} else if (c->ackPending == 1) {
+			c->ackDeadline = std::chrono::steady_clock::now() + DELAYED_ACK_TIMEOUT;
+		}
+	}
+	armTimer(c, funIface);
+
 	if (freePkt) {
 		//std::cout << "freeing packet" << std::endl;
 		funIface.freePkt();
@@ -378,21 +708,313 @@ void Server<Proto, ConCtl>::runEst(StateMachine<Identifier, mbuf>::State &state,
 	}
 };
 
+template <class Proto, class ConCtl>
+void Server<Proto, ConCtl>::armRto(connection *c, bool restart) {
+	if (c->sendRing.getUna() == c->sendRing.getMax()) {
+		// Everything is acknowledged
+		c->rtoRunning = false;
+		return;
+	}
+
+	if (restart || !c->rtoRunning) {
+		c->rtoRunning = true;
+		c->rtoDeadline = std::chrono::steady_clock::now() + c->rto.get();
+	}
+};
+
+template <class Proto, class ConCtl>
+void Server<Proto, ConCtl>::armTimer(
+	connection *c, StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	std::chrono::steady_clock::time_point deadline;
+	if (c->rtoRunning && (c->ackPending > 0)) {
+		deadline = std::min(c->rtoDeadline, c->ackDeadline);
+	} else if (c->rtoRunning) {
+		deadline = c->rtoDeadline;
+	} else if (c->ackPending > 0) {
+		deadline = c->ackDeadline;
+	} else {
+		return;
+	}
+
+	funIface.setTimeout(deadline, runEstTimeout);
+};
+
+template <class Proto, class ConCtl>
+mbuf *Server<Proto, ConCtl>::getHeadersPkt(connection *c,
+	StateMachine<Identifier, mbuf>::FunIface &funIface, Headers::IPv4 *&ipv4,
+	Headers::Tcp *&tcp) {
+	mbuf *pkt = funIface.getPkt();
+	memcpy(pkt->getData(), c->headers, c->headersLen);
+
+	uint8_t *sendData = reinterpret_cast<uint8_t *>(pkt->getData());
+	ipv4 = reinterpret_cast<Headers::IPv4 *>(sendData + c->headersL2Len);
+	tcp = reinterpret_cast<Headers::Tcp *>(sendData + c->headersLen - sizeof(Headers::Tcp));
+	pkt->setHeaderLens(c->headersL2Len, c->headersLen - sizeof(Headers::Tcp) - c->headersL2Len,
+		sizeof(Headers::Tcp));
+
+	ipv4->id = htons(c->ipID++);
+	return pkt;
+};
+
+template <class Proto, class ConCtl>
+void Server<Proto, ConCtl>::runEstTimeout(StateMachine<Identifier, mbuf>::State &state,
+	StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	connection *c = reinterpret_cast<struct connection *>(state.stateData);
+
+	if (state.state != States::est) {
+		return;
+	}
+
+	// The timer of the StateMachine may fire a bit early
+	auto now = std::chrono::steady_clock::now();
+	bool rtoExpired = c->rtoRunning && (now >= c->rtoDeadline);
+	bool ackExpired = (c->ackPending > 0) && (now >= c->ackDeadline);
+
+	Headers::IPv4 *ipv4;
+	Headers::Tcp *tcp;
+
+	if (rtoExpired) {
+		DEBUG_ENABLED(std::cout << "TCP::Server::runEstTimeout() Retransmission timeout, RTO = "
+								<< c->rto.get().count() << " us" << std::endl;)
+
+		c->rto.backoff();
+		c->conCtl.handleTimeout(c->sendRing.getMax());
+		c->sendRing.rewind(c->sendRing.getUna());
+		c->rttTiming = false;
+
+		// Send the first segment again, the ACKs clock out the rest
+		TcpSendRing<mbuf>::Segment seg;
+		if (c->sendRing.take(std::numeric_limits<uint32_t>::max(), seg)) {
+			mbuf *pkt = getHeadersPkt(c, funIface, ipv4, tcp);
+
+			tcp->clearFlags();
+			tcp->setAckFlag();
+			tcp->setSeq(seg.seq);
+			tcp->setAck(c->seqRemote);
+			tcp->setWindow(getRcvWindow(c));
+
+			// The template holds no options, write them behind it
+			uint16_t tcpHeaderLen = writeOptions(c, tcp);
+			ipv4->setPayloadLength(tcpHeaderLen + seg.len);
+
+			seg.pkt->ref();
+			pkt->setDataLen(c->headersLen - sizeof(Headers::Tcp) + tcpHeaderLen);
+			pkt->chain(seg.pkt);
+			Checksum::setIPv4Tcp(pkt);
+
+			ackExpired = false;
+			c->ackPending = 0;
+		}
+
+		armRto(c, true);
+	}
+
+	if (ackExpired) {
+		DEBUG_ENABLED(std::cout << "TCP::Server::runEstTimeout() Sending delayed ACK"
+								<< std::endl;)
+
+		mbuf *pkt = getHeadersPkt(c, funIface, ipv4, tcp);
+
+		tcp->clearFlags();
+		tcp->setAckFlag();
+		tcp->setSeq(c->sendRing.getNxt());
+		tcp->setAck(c->seqRemote);
+		tcp->setWindow(getRcvWindow(c));
+
+		uint16_t tcpHeaderLen = writeOptions(c, tcp);
+		ipv4->setPayloadLength(tcpHeaderLen);
+		pkt->setDataLen(c->headersLen - sizeof(Headers::Tcp) + tcpHeaderLen);
+		Checksum::setIPv4Tcp(pkt);
+
+		c->ackPending = 0;
+	}
+
+	armTimer(c, funIface);
+};
+
+template <class Proto, class ConCtl>
+uint16_t Server<Proto, ConCtl>::writeOptions(connection *c, Headers::Tcp *tcp) {
+	uint8_t *opt = reinterpret_cast<uint8_t *>(tcp->getPayload());
+	uint8_t optionsLen = 0;
+
+	if (c->tsEnabled) {
+		optionsLen = TcpOptions::writeTimestamp(opt, tsNow(), c->tsRecent);
+	}
+
+	// Three blocks still fit behind the timestamps
+	if (c->sackPermitted && !c->reassembly.empty()) {
+		TcpOptions::SackBlock blocks[TcpOptions::sendSackBlocks];
+		uint8_t numBlocks = c->reassembly.getSackBlocks(blocks, TcpOptions::sendSackBlocks);
+		optionsLen += TcpOptions::writeSack(opt + optionsLen, blocks, numBlocks);
+	}
+
+	tcp->setOffset((sizeof(Headers::Tcp) + optionsLen) / 4);
+	return sizeof(Headers::Tcp) + optionsLen;
+};
+
+template <class Proto, class ConCtl>
+uint16_t Server<Proto, ConCtl>::writeAck(
+	connection *c, Headers::IPv4 *ipv4, Headers::Tcp *tcp, bool fin) {
+	tcp->clearFlags();
+	tcp->setAckFlag();
+	if (fin) {
+		tcp->setFinFlag();
+	}
+	tcp->setSeq(fin ? c->seqLocal - 1 : c->seqLocal);
+	tcp->setAck(c->seqRemote);
+	tcp->setWindow(getRcvWindow(c));
+	uint16_t tcpHeaderLen = writeOptions(c, tcp);
+
+	ipv4->setPayloadLength(tcpHeaderLen);
+	return tcpHeaderLen;
+};
+
+template <class Proto, class ConCtl>
+void Server<Proto, ConCtl>::armFinTimeout(
+	connection *c, StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	if (c->finAcked) {
+		funIface.setTimeout(FIN_WAIT_2_TIMEOUT, runFinTimeout);
+		return;
+	}
+	funIface.setTimeout(c->rto.get(), runFinTimeout);
+};
+
+template <class Proto, class ConCtl>
+void Server<Proto, ConCtl>::runFinTimeout(StateMachine<Identifier, mbuf>::State &state,
+	StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	connection *c = reinterpret_cast<struct connection *>(state.stateData);
+
+	// Either the peer never sent its FIN, or it does not answer at all
+	if (c->finAcked || (++c->finRetries > FIN_RETRIES)) {
+		DEBUG_ENABLED(std::cout << "TCP::Server::runFinTimeout() Giving up the connection"
+								<< std::endl;)
+		funIface.transition(States::END);
+		delete c;
+		return;
+	}
+
+	DEBUG_ENABLED(std::cout << "TCP::Server::runFinTimeout() Sending FIN again" << std::endl;)
+
+	c->rto.backoff();
+
+	Headers::IPv4 *ipv4;
+	Headers::Tcp *tcp;
+	mbuf *pkt = getHeadersPkt(c, funIface, ipv4, tcp);
+	uint16_t tcpHeaderLen = writeAck(c, ipv4, tcp, true);
+	pkt->setDataLen(c->headersLen - sizeof(Headers::Tcp) + tcpHeaderLen);
+	Checksum::setIPv4Tcp(pkt);
+
+	armFinTimeout(c, funIface);
+};
+
+template <class Proto, class ConCtl>
+void Server<Proto, ConCtl>::runFin(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
+	StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	connection *c = reinterpret_cast<struct connection *>(state.stateData);
+
+	// Get info from packet, the headers were parsed by the identifier
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+	uint16_t l3HeadersLen = pkt->getL2Len() + pkt->getL3Len();
+
+	// Swap addresses
+	uint32_t tmp = ipv4->getSrcIP();
+	ipv4->setSrcIP(ipv4->getDstIP());
+	ipv4->setDstIP(tmp);
+
+	uint16_t tmp16 = tcp->getSrcPort();
+	tcp->setSrcPort(tcp->getDstPort());
+	tcp->setDstPort(tmp16);
+
+	ipv4->ttl = 64;
+
+	// The data of segments merged by TcpGro is not taken anymore,
+	// the IPv4 length still covers it
+	pkt->unchain();
+
+	if (tcp->getRstFlag()) {
+		DEBUG_ENABLED(std::cout << "TCP::Server::runFin() Peer reset the connection"
+								<< std::endl;)
+		funIface.freePkt();
+		funIface.transition(States::END);
+		delete c;
+		return;
+	}
+
+	uint16_t numBytesReceived = ipv4->getPayloadLength() - tcp->getHeaderLen();
+	uint32_t seqEnd = tcp->getSeq() + numBytesReceived;
+
+	// The application closed the connection, there is nobody to take new data
+	if (tcp->getSynFlag() || (!tcp->getAckFlag()) ||
+		((numBytesReceived > 0) && TcpSeq::lt(c->seqRemote, seqEnd))) {
+
+		DEBUG_ENABLED(std::cout << "TCP::Server::runFin() Some flag or number doesn't add up"
+								<< std::endl;)
+
+		tcp->clearFlags();
+		tcp->setRstFlag();
+		tcp->setAck(0);
+		tcp->setSeq(c->seqLocal);
+		tcp->setOffset(5);
+		ipv4->setPayloadLength(sizeof(Headers::Tcp));
+		pkt->setDataLen(l3HeadersLen + sizeof(Headers::Tcp));
+		Checksum::setIPv4Tcp(pkt);
+
+		funIface.transition(States::END);
+		delete c;
+		return;
+	}
+
+	TcpOptions::Parsed options;
+	if (c->tsEnabled && (tcp->getHeaderLen() > sizeof(Headers::Tcp))) {
+		TcpOptions::parse(tcp, options);
+		if (options.hasTimestamp && TcpSeq::le(tcp->getSeq(), c->seqRemote)) {
+			c->tsRecent = options.tsVal;
+		}
+	}
+
+	if (tcp->getAck() == c->seqLocal) {
+		c->finAcked = true;
+	}
+
+	if (tcp->getFinFlag() && (seqEnd == c->seqRemote)) {
+		DEBUG_ENABLED(std::cout << "TCP::Server::runFin() Peer sent FIN" << std::endl;)
+		c->finReceived = true;
+		c->seqRemote++;
+
+		uint16_t tcpHeaderLen = writeAck(c, ipv4, tcp, false);
+		pkt->setDataLen(l3HeadersLen + tcpHeaderLen);
+		Checksum::setIPv4Tcp(pkt);
+
+		if (c->finAcked) {
+			funIface.transition(States::END);
+			delete c;
+		} else {
+			// Both FINs crossed (CLOSING)
+			funIface.transition(States::ack_fin);
+			armFinTimeout(c, funIface);
+		}
+		return;
+	}
+
+	funIface.freePkt();
+	armFinTimeout(c, funIface);
+};
+
 template <class Proto, class ConCtl>
 void Server<Proto, ConCtl>::runAckFin(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
 	StateMachine<Identifier, mbuf>::FunIface &funIface) {
 	// Parse FIN ACK
 	connection *c = reinterpret_cast<struct connection *>(state.stateData);
 
-	// Get info from packet
-	Headers::Ethernet *ether = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
-	Headers::IPv4 *ipv4 = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
-	Headers::Tcp *tcp = reinterpret_cast<Headers::Tcp *>(ipv4->getPayload());
+	// Get info from packet, the headers were parsed by the identifier
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+	uint16_t l3HeadersLen = pkt->getL2Len() + pkt->getL3Len();
 
 	/*
 	assert(!tcp->getSynFlag());
 	assert(tcp->getAckFlag());
-	assert(tcp->getFinFlag());
 	assert(!tcp->getRstFlag());
 	*/
 
@@ -406,24 +1028,26 @@ void Server<Proto, ConCtl>::runAckFin(StateMachine<Identifier, mbuf>::State &sta
 	tcp->setDstPort(tmp16);
 
 	ipv4->ttl = 64;
-	ipv4->checksum = 0;
 
-	/*
-	assert(tcp->getAck() == 2);
-	assert(tcp->getSeq() == c->seqRemote);
-	*/
+	// The data of segments merged by TcpGro is not taken anymore
+	pkt->unchain();
 
-	if (tcp->getSynFlag() || (!tcp->getAckFlag()) || tcp->getRstFlag() ||
-		(tcp->getAck() != c->seqLocal) || (tcp->getSeq() != c->seqRemote)) {
+	if (tcp->getRstFlag()) {
+		DEBUG_ENABLED(std::cout << "TCP::Server::runAckFin() Peer reset the connection"
+								<< std::endl;)
+		funIface.freePkt();
+		funIface.transition(States::END);
+		delete c;
+		return;
+	}
+
+	if (tcp->getSynFlag() || (!tcp->getAckFlag())) {
 
 		DEBUG_ENABLED(
 			std::cout << "TCP::Server::runAckFin() Some flag or number doesn't add up"
 					  << std::endl;)
-		DEBUG_ENABLED(std::cout << "Flags " << tcp->getSynFlag() << std::endl;)
 		DEBUG_ENABLED(std::cout << "SYN = " << tcp->getSynFlag() << std::endl;)
 		DEBUG_ENABLED(std::cout << "ACK = " << tcp->getAckFlag() << std::endl;)
-		DEBUG_ENABLED(std::cout << "FIN = " << tcp->getFinFlag() << std::endl;)
-		DEBUG_ENABLED(std::cout << "RST = " << tcp->getRstFlag() << std::endl;)
 		DEBUG_ENABLED(std::cout << "Seq # = " << tcp->getSeq() << std::endl;)
 		DEBUG_ENABLED(std::cout << "Ack # = " << tcp->getAck() << std::endl;)
 		DEBUG_ENABLED(std::cout << "c->seqLocal = " << c->seqLocal << std::endl;)
@@ -431,78 +1055,38 @@ void Server<Proto, ConCtl>::runAckFin(StateMachine<Identifier, mbuf>::State &sta
 
 		tcp->clearFlags();
 		tcp->setRstFlag();
+		tcp->setAck(0);
+		tcp->setSeq(c->seqLocal);
+		tcp->setOffset(5);
+		ipv4->setPayloadLength(sizeof(Headers::Tcp));
+		pkt->setDataLen(l3HeadersLen + sizeof(Headers::Tcp));
+		Checksum::setIPv4Tcp(pkt);
 
 		funIface.transition(States::END);
+		delete c;
 		return;
 	}
 
-	//	std::cout << "tcp->getSeq() = " << tcp->getSeq() << std::endl;
-	//	std::cout << "c->seqRemote = " << c->seqRemote << std::endl;
-	if (tcp->getFinFlag()) {
-		c->seqLocal++;
-		c->seqRemote = tcp->getSeq();
-
-		tcp->setSeq(c->seqLocal);
-		tcp->setAck(c->seqRemote + 1);
-		tcp->clearFlags();
-		tcp->setAckFlag();
-		tcp->setOffset(5);
-
+	if (tcp->getAck() == c->seqLocal) {
+		DEBUG_ENABLED(std::cout << "TCP::Server::runAckFin() FIN acknowledged, closing"
+								<< std::endl;)
+		funIface.freePkt();
 		funIface.transition(States::END);
+		delete c;
+		return;
+	}
+
+	if (tcp->getFinFlag()) {
+		// The peer sends its FIN again, our ACK of it got lost
+		uint16_t tcpHeaderLen = writeAck(c, ipv4, tcp, true);
+		pkt->setDataLen(l3HeadersLen + tcpHeaderLen);
+		Checksum::setIPv4Tcp(pkt);
 	} else {
 		funIface.freePkt();
 	}
+	armFinTimeout(c, funIface);
 };
 
 }; // namespace TCP
 
-#if 0
-extern "C" {
-
-/*
- * Server
- */
-
-void *TCP_Server_init() {
-	auto *obj = new StateMachine<TCP::Identifier, mbuf>();
-
-	obj->registerEndStateID(TCP::Server::States::END);
-	obj->registerStartStateID(TCP::Server::States::syn_ack, TCP::Server::factory);
-
-	obj->registerFunction(TCP::Server::States::syn_ack, TCP::Server::runSynAck);
-	obj->registerFunction(TCP::Server::States::fin, TCP::Server::runFin);
-	obj->registerFunction(TCP::Server::States::ack_fin, TCP::Server::runAckFin);
-
-	return obj;
-};
-
-void *TCP_Server_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
-	unsigned int *sendCount, unsigned int *freeCount) {
-
-	BufArray<mbuf> *inPktsBA =
-		new BufArray<mbuf>(reinterpret_cast<mbuf **>(inPkts), inCount, true);
-
-	auto *sm = reinterpret_cast<StateMachine<TCP::Identifier, mbuf> *>(obj);
-	sm->runPktBatch(*inPktsBA);
-	*sendCount = inPktsBA->getSendCount();
-	*freeCount = inPktsBA->getFreeCount();
-
-	return inPktsBA;
-};
-
-void TCP_Server_getPkts(void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts) {
-	BufArray<mbuf> *inPktsBA = reinterpret_cast<BufArray<mbuf> *>(obj);
-
-	inPktsBA->getSendBufs(reinterpret_cast<mbuf **>(sendPkts));
-	inPktsBA->getFreeBufs(reinterpret_cast<mbuf **>(freePkts));
-
-	delete (inPktsBA);
-};
-
-void TCP_Server_free(void *obj) {
-	delete (reinterpret_cast<StateMachine<TCP::Identifier, mbuf> *>(obj));
-};
-};
-#endif
-
 #endif /* TCP_CPP */
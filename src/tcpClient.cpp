@@ -0,0 +1,473 @@
+#ifndef TCPCLIENT_CPP
+#define TCPCLIENT_CPP
+
+#include <cstdlib>
+
+#include "tcpClient.hpp"
+
+namespace TCP {
+namespace Client {
+
+static constexpr uint16_t headersLen =
+	sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Tcp);
+
+Counters &getCounters() {
+	static Counters counters;
+	return counters;
+};
+
+Identifier::ConnectionID getConnectionID(
+	uint32_t srcIp, uint32_t dstIp, uint16_t srcPort, uint16_t dstPort) {
+	// The fields are in network byte order, as in the packets of the server
+	Identifier::ConnectionID id;
+	id.dstIP = htonl(srcIp);
+	id.srcIP = htonl(dstIp);
+	id.dstPort = htons(srcPort);
+	id.srcPort = htons(dstPort);
+	id.proto = Headers::IPv4::PROTO_TCP;
+	return id;
+};
+
+StateMachine<Identifier, mbuf>::State createSyn(uint32_t srcIp, uint32_t dstIp, uint16_t srcPort,
+	uint16_t dstPort, uint32_t requestLen, uint32_t responseLen) {
+	connection *c = new connection();
+	c->srcIp = srcIp;
+	c->dstIp = dstIp;
+	c->srcPort = srcPort;
+	c->dstPort = dstPort;
+	c->isn = static_cast<uint32_t>(rand());
+	c->requestLen = requestLen;
+	c->responseLen = responseLen;
+
+	StateMachine<Identifier, mbuf>::State state(States::syn, reinterpret_cast<void *>(c));
+	return state;
+};
+
+/*! Write all headers of a segment from scratch
+ *
+ * Received packets are reused as well, the buffers chained to them are released.
+ * The flags are cleared, the acknowledgment number is rcvNxt.
+ * The checksums are written last, by Checksum::setIPv4Tcp().
+ */
+static Headers::Tcp *writeHeaders(
+	connection *c, mbuf *pkt, uint8_t optionsLen, uint16_t payloadLen) {
+	pkt->unchain();
+	memset(pkt->getData(), 0, headersLen);
+
+	auto ether = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
+	ether->setEthertype(Headers::Ethernet::ETHERTYPE_IPv4);
+
+	auto ipv4 = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
+	ipv4->setVersion();
+	ipv4->setIHL(5);
+	ipv4->ttl = 64;
+	ipv4->id = htons(c->ipID++);
+	ipv4->setProtoTCP();
+	ipv4->setSrcIP(c->srcIp);
+	ipv4->setDstIP(c->dstIp);
+	ipv4->setPayloadLength(sizeof(Headers::Tcp) + optionsLen + payloadLen);
+
+	auto tcp = reinterpret_cast<Headers::Tcp *>(ipv4->getPayload());
+	tcp->setSrcPort(c->srcPort);
+	tcp->setDstPort(c->dstPort);
+	tcp->setOffset((sizeof(Headers::Tcp) + optionsLen) / 4);
+	tcp->setAck(c->rcvNxt);
+	tcp->setWindow(CLIENT_WINDOW);
+
+	pkt->setDataLen(headersLen + optionsLen + payloadLen);
+	pkt->setHeaderLens(
+		sizeof(Headers::Ethernet), sizeof(Headers::IPv4), sizeof(Headers::Tcp) + optionsLen);
+	return tcp;
+};
+
+/*! Turn a packet into an ACK, with our FIN if it was sent already */
+static void writeAck(connection *c, mbuf *pkt, bool fin) {
+	Headers::Tcp *tcp = writeHeaders(c, pkt, 0, 0);
+	tcp->setAckFlag();
+	if (fin) {
+		tcp->setFinFlag();
+		tcp->setSeq(c->sndNxt - 1);
+	} else {
+		tcp->setSeq(c->sndNxt);
+	}
+	Checksum::setIPv4Tcp(pkt);
+};
+
+/*! Send the request, as far as the window of the server allows
+ *
+ * Every segment is an additional packet.
+ *
+ * \return Number of segments sent
+ */
+static unsigned int sendRequest(
+	connection *c, StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	uint32_t requestEnd = c->isn + 1 + c->requestLen;
+	unsigned int segments = 0;
+
+	while (TcpSeq::lt(c->sndNxt, requestEnd)) {
+		uint32_t inFlight = c->sndNxt - c->sndUna;
+		if (inFlight >= c->sendWindow) {
+			break;
+		}
+
+		uint32_t len = std::min(requestEnd - c->sndNxt, c->sendWindow - inFlight);
+		len = std::min(len, static_cast<uint32_t>(c->mss));
+
+		mbuf *pkt = funIface.getPkt();
+		Headers::Tcp *tcp = writeHeaders(c, pkt, 0, len);
+		tcp->setAckFlag();
+		tcp->setSeq(c->sndNxt);
+
+		uint8_t *payload = reinterpret_cast<uint8_t *>(tcp->getPayload());
+		uint32_t offset = c->sndNxt - (c->isn + 1);
+		for (uint32_t i = 0; i < len; i++) {
+			payload[i] = static_cast<uint8_t>(offset + i);
+		}
+		Checksum::setIPv4Tcp(pkt);
+
+		c->sndNxt += len;
+		c->appendBatchID = funIface.getBatchID();
+		segments++;
+	}
+
+	return segments;
+};
+
+static void armTimeout(connection *c, StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	funIface.setTimeout(c->rto.get(), runTimeout);
+};
+
+/*! Remove the connection and count it */
+static void finish(connection *c, StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	Counters &counters = getCounters();
+	if (c->bytesReceived >= c->responseLen) {
+		counters.completed.fetch_add(1, std::memory_order_relaxed);
+	} else {
+		counters.failed.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// The FIN and the SYN are no request bytes, the SYN may not be acknowledged
+	uint32_t acked = TcpSeq::lt(c->sndUna, c->isn + 1) ? 0 : c->sndUna - (c->isn + 1);
+	counters.bytesSent.fetch_add(std::min(acked, c->requestLen), std::memory_order_relaxed);
+	counters.bytesReceived.fetch_add(c->bytesReceived, std::memory_order_relaxed);
+
+	funIface.transition(States::END);
+	delete c;
+};
+
+/*! The whole request was sent, and the whole response arrived */
+static bool isDone(connection *c) {
+	return (c->bytesReceived >= c->responseLen) && (c->sndNxt == c->isn + 1 + c->requestLen);
+};
+
+/*! Send our FIN in place of the received packet
+ *
+ * Additional packets are sent after the whole batch. Once this connection
+ * added one, the FIN has to go there as well to stay behind the data.
+ */
+static void sendFin(connection *c, mbuf *pkt, StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	DEBUG_ENABLED(std::cout << "TCP::Client::sendFin() Sending FIN" << std::endl;)
+	if (c->appendBatchID == funIface.getBatchID()) {
+		funIface.freePkt();
+		pkt = funIface.getPkt();
+	}
+
+	c->sndNxt++;
+	writeAck(c, pkt, true);
+	funIface.transition(States::fin);
+	armTimeout(c, funIface);
+};
+
+/*! Turn a packet into our SYN */
+static void writeSyn(connection *c, mbuf *pkt) {
+	Headers::Tcp *tcp = writeHeaders(c, pkt, 4, 0);
+	tcp->setSynFlag();
+	tcp->setSeq(c->isn);
+	tcp->setAck(0);
+	TcpOptions::writeMss(reinterpret_cast<uint8_t *>(tcp->getPayload()), MSS);
+	Checksum::setIPv4Tcp(pkt);
+};
+
+void runSyn(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
+	StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	connection *c = reinterpret_cast<struct connection *>(state.stateData);
+
+	writeSyn(c, pkt);
+
+	c->sndUna = c->isn;
+	c->sndNxt = c->isn + 1;
+	c->synTime = std::chrono::steady_clock::now();
+
+	funIface.transition(States::syn_ack);
+	armTimeout(c, funIface);
+};
+
+void runSynAck(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
+	StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	connection *c = reinterpret_cast<struct connection *>(state.stateData);
+
+	// Get info from packet, the headers were parsed by the identifier
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+
+	if (tcp->getRstFlag() || !tcp->getSynFlag() || !tcp->getAckFlag() ||
+		(tcp->getAck() != c->isn + 1)) {
+		DEBUG_ENABLED(std::cout << "TCP::Client::runSynAck() No valid SYN ACK" << std::endl;)
+		funIface.freePkt();
+		finish(c, funIface);
+		return;
+	}
+
+	TcpOptions::Parsed options;
+	TcpOptions::parse(tcp, options);
+	c->mss = options.mss != 0 ? std::min(options.mss, static_cast<uint16_t>(MSS)) : DEFAULT_MSS;
+
+	c->sndUna = c->isn + 1;
+	c->rcvNxt = tcp->getSeq() + 1;
+	c->sendWindow = tcp->getWindow();
+
+	// The SYN ACK of a SYN sent again gives no RTT sample (Karn's algorithm)
+	if (c->retries == 0) {
+		c->rto.sample(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - c->synTime));
+	}
+	c->retries = 0;
+
+	funIface.transition(States::est);
+
+	// The segments of the request acknowledge the SYN ACK
+	unsigned int segments = sendRequest(c, funIface);
+	if (isDone(c)) {
+		sendFin(c, pkt, funIface);
+		return;
+	}
+
+	if (segments > 0) {
+		funIface.freePkt();
+	} else {
+		writeAck(c, pkt, false);
+	}
+	armTimeout(c, funIface);
+};
+
+void runEst(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
+	StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	connection *c = reinterpret_cast<struct connection *>(state.stateData);
+
+	// Get info from packet, the headers were parsed by the identifier
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+
+	if (tcp->getRstFlag()) {
+		DEBUG_ENABLED(std::cout << "TCP::Client::runEst() Server reset the connection"
+								<< std::endl;)
+		funIface.freePkt();
+		finish(c, funIface);
+		return;
+	}
+
+	// The SYN ACK was sent again, our ACK got lost
+	if (tcp->getSynFlag() || !tcp->getAckFlag()) {
+		writeAck(c, pkt, false);
+		armTimeout(c, funIface);
+		return;
+	}
+
+	uint32_t ack = tcp->getAck();
+	if (TcpSeq::lt(c->sndUna, ack) && TcpSeq::le(ack, c->sndNxt)) {
+		c->sndUna = ack;
+		c->retries = 0;
+	}
+	c->sendWindow = tcp->getWindow();
+
+	bool ackNeeded = false;
+	uint16_t len = ipv4->getPayloadLength() - tcp->getHeaderLen();
+	if ((len > 0) || tcp->getFinFlag()) {
+		// Segments out of order are dropped, the duplicate ACK asks for the hole
+		ackNeeded = true;
+		if (tcp->getSeq() == c->rcvNxt) {
+			c->rcvNxt += len;
+			c->bytesReceived += len;
+			if (tcp->getFinFlag()) {
+				c->rcvNxt++;
+				c->finReceived = true;
+			}
+		}
+	}
+
+	unsigned int segments = sendRequest(c, funIface);
+	if (isDone(c) || c->finReceived) {
+		sendFin(c, pkt, funIface);
+		return;
+	}
+
+	if ((segments > 0) || !ackNeeded) {
+		funIface.freePkt();
+	} else {
+		writeAck(c, pkt, false);
+	}
+	armTimeout(c, funIface);
+};
+
+void runFin(StateMachine<Identifier, mbuf>::State &state, mbuf *pkt,
+	StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	connection *c = reinterpret_cast<struct connection *>(state.stateData);
+
+	// Get info from packet, the headers were parsed by the identifier
+	Headers::IPv4 *ipv4 = PktParser::getIPv4(pkt);
+	Headers::Tcp *tcp = PktParser::getTcp(pkt);
+
+	if (tcp->getRstFlag()) {
+		DEBUG_ENABLED(std::cout << "TCP::Client::runFin() Server reset the connection"
+								<< std::endl;)
+		funIface.freePkt();
+		finish(c, funIface);
+		return;
+	}
+
+	if (tcp->getAckFlag()) {
+		uint32_t ack = tcp->getAck();
+		if (TcpSeq::lt(c->sndUna, ack) && TcpSeq::le(ack, c->sndNxt)) {
+			c->sndUna = ack;
+		}
+		if (ack == c->sndNxt) {
+			c->finAcked = true;
+		}
+	}
+
+	// Data may still arrive, until the FIN of the server
+	bool ackNeeded = false;
+	uint16_t len = ipv4->getPayloadLength() - tcp->getHeaderLen();
+	if ((len > 0) || tcp->getFinFlag()) {
+		ackNeeded = true;
+		if (tcp->getSeq() == c->rcvNxt) {
+			c->rcvNxt += len;
+			c->bytesReceived += len;
+			if (tcp->getFinFlag()) {
+				c->rcvNxt++;
+				c->finReceived = true;
+			}
+		}
+	}
+
+	if (ackNeeded) {
+		writeAck(c, pkt, !c->finAcked);
+	} else {
+		funIface.freePkt();
+	}
+
+	if (c->finAcked && c->finReceived) {
+		DEBUG_ENABLED(std::cout << "TCP::Client::runFin() Connection closed" << std::endl;)
+		finish(c, funIface);
+		return;
+	}
+	armTimeout(c, funIface);
+};
+
+void runTimeout(StateMachine<Identifier, mbuf>::State &state,
+	StateMachine<Identifier, mbuf>::FunIface &funIface) {
+	connection *c = reinterpret_cast<struct connection *>(state.stateData);
+
+	if (++c->retries > CLIENT_RETRIES) {
+		DEBUG_ENABLED(std::cout << "TCP::Client::runTimeout() Giving up the connection"
+								<< std::endl;)
+		finish(c, funIface);
+		return;
+	}
+
+	c->rto.backoff();
+
+	if (state.state == States::syn_ack) {
+		writeSyn(c, funIface.getPkt());
+	} else if (state.state == States::est) {
+		// Go back to the first byte not acknowledged
+		c->sndNxt = c->sndUna;
+		sendRequest(c, funIface);
+	} else if (!c->finAcked) {
+		writeAck(c, funIface.getPkt(), true);
+		c->appendBatchID = funIface.getBatchID();
+	}
+
+	armTimeout(c, funIface);
+};
+
+} // namespace Client
+}; // namespace TCP
+
+extern "C" {
+
+/*
+ * Client
+ */
+
+void *TCP_Client_init(struct rte_mempool *mp) {
+	auto *obj = new StateMachine<TCP::Identifier, mbuf>();
+
+	obj->registerGetPktCB([mp]() { return reinterpret_cast<mbuf *>(rte_pktmbuf_alloc(mp)); });
+
+	obj->registerEndStateID(TCP::Client::States::END);
+
+	obj->registerFunction(TCP::Client::States::syn, TCP::Client::runSyn);
+	obj->registerFunction(TCP::Client::States::syn_ack, TCP::Client::runSynAck);
+	obj->registerFunction(TCP::Client::States::est, TCP::Client::runEst);
+	obj->registerFunction(TCP::Client::States::fin, TCP::Client::runFin);
+
+	return obj;
+};
+
+void *TCP_Client_connect(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
+	unsigned int *sendCount, unsigned int *freeCount, uint32_t srcIP, uint32_t dstIP,
+	uint16_t srcPort, uint16_t dstPort, uint32_t requestLen, uint32_t responseLen) {
+
+	auto *sm = reinterpret_cast<StateMachine<TCP::Identifier, mbuf> *>(obj);
+
+	BufArray<mbuf> *inPktsBA =
+		new BufArray<mbuf>(reinterpret_cast<mbuf **>(inPkts), inCount, true);
+
+	auto cID = TCP::Client::getConnectionID(srcIP, dstIP, srcPort, dstPort);
+	auto state =
+		TCP::Client::createSyn(srcIP, dstIP, srcPort, dstPort, requestLen, responseLen);
+
+	sm->addState(cID, state, *inPktsBA);
+
+	*sendCount = inPktsBA->getSendCount();
+	*freeCount = inPktsBA->getFreeCount();
+
+	return inPktsBA;
+};
+
+void TCP_Client_getPkts(void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts) {
+	BufArray<mbuf> *inPktsBA = reinterpret_cast<BufArray<mbuf> *>(obj);
+
+	inPktsBA->getSendBufs(reinterpret_cast<mbuf **>(sendPkts));
+	inPktsBA->getFreeBufs(reinterpret_cast<mbuf **>(freePkts));
+
+	delete (inPktsBA);
+};
+
+void *TCP_Client_process(void *obj, struct rte_mbuf **inPkts, unsigned int inCount,
+	unsigned int *sendCount, unsigned int *freeCount) {
+	BufArray<mbuf> *inPktsBA =
+		new BufArray<mbuf>(reinterpret_cast<mbuf **>(inPkts), inCount, true);
+
+	auto *sm = reinterpret_cast<StateMachine<TCP::Identifier, mbuf> *>(obj);
+	sm->runPktBatch(*inPktsBA);
+	*sendCount = inPktsBA->getSendCount();
+	*freeCount = inPktsBA->getFreeCount();
+
+	return inPktsBA;
+};
+
+void TCP_Client_getStats(struct TCP_Client_Stats *stats) {
+	TCP::Client::Counters &counters = TCP::Client::getCounters();
+	stats->connectionsCompleted = counters.completed.load(std::memory_order_relaxed);
+	stats->connectionsFailed = counters.failed.load(std::memory_order_relaxed);
+	stats->bytesSent = counters.bytesSent.load(std::memory_order_relaxed);
+	stats->bytesReceived = counters.bytesReceived.load(std::memory_order_relaxed);
+};
+
+void TCP_Client_free(void *obj) {
+	delete (reinterpret_cast<StateMachine<TCP::Identifier, mbuf> *>(obj));
+};
+};
+
+#endif /* TCPCLIENT_CPP */
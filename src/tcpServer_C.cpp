@@ -0,0 +1,101 @@
+#ifndef TCPSERVER_C_CPP
+#define TCPSERVER_C_CPP
+
+#include "checksumMbuf.hpp"
+#include "tcpGro.hpp"
+#include "tcpServer_C.hpp"
+
+namespace TCP {
+
+template <class Proto, class ConCtl> void *ServerC<Proto, ConCtl>::init(struct rte_mempool *mp) {
+	auto *obj = new Instance();
+	memset(&obj->stats, 0, sizeof(obj->stats));
+
+	obj->sm.registerGetPktCB([mp]() { return reinterpret_cast<mbuf *>(rte_pktmbuf_alloc(mp)); });
+
+	obj->sm.registerEndStateID(States::END);
+	obj->sm.registerStartStateID(States::syn_ack, Srv::factory);
+
+	obj->sm.registerFunction(States::syn_ack, Srv::runSynAck);
+	obj->sm.registerFunction(States::est, Srv::runEst);
+	obj->sm.registerFunction(States::fin, Srv::runFin);
+	obj->sm.registerFunction(States::ack_fin, Srv::runAckFin);
+
+	return obj;
+};
+
+template <class Proto, class ConCtl>
+void ServerC<Proto, ConCtl>::setSynCookies(void *obj, bool enable) {
+	auto *inst = reinterpret_cast<Instance *>(obj);
+	if (enable) {
+		inst->sm.registerPreAcceptFunction(Srv::preAccept);
+	} else {
+		inst->sm.registerPreAcceptFunction(nullptr);
+	}
+};
+
+template <class Proto, class ConCtl> void ServerC<Proto, ConCtl>::setGro(void *obj, bool enable) {
+	auto *inst = reinterpret_cast<Instance *>(obj);
+	inst->gro = enable;
+};
+
+template <class Proto, class ConCtl>
+void ServerC<Proto, ConCtl>::setChecksumOffload(void *obj, bool enable) {
+	(void)obj;
+	Checksum::setOffload(enable);
+};
+
+template <class Proto, class ConCtl>
+void *ServerC<Proto, ConCtl>::process(void *obj, struct rte_mbuf **inPkts,
+	unsigned int inCount, unsigned int *sendCount, unsigned int *freeCount) {
+	auto *inst = reinterpret_cast<Instance *>(obj);
+	inst->stats.pktsIn += inCount;
+
+	// The merged packets are freed with the ones they are chained to
+	if (inst->gro) {
+		unsigned int numLeft = TcpGro::coalesce(reinterpret_cast<mbuf **>(inPkts), inCount);
+		inst->stats.pktsMerged += inCount - numLeft;
+		inCount = numLeft;
+	}
+
+	BufArray<mbuf> *inPktsBA =
+		new BufArray<mbuf>(reinterpret_cast<mbuf **>(inPkts), inCount, true);
+
+	inst->sm.runPktBatch(*inPktsBA);
+	*sendCount = inPktsBA->getSendCount();
+	*freeCount = inPktsBA->getFreeCount();
+
+	inst->stats.pktsSent += *sendCount;
+	inst->stats.pktsFreed += *freeCount;
+
+	return inPktsBA;
+};
+
+template <class Proto, class ConCtl>
+void ServerC<Proto, ConCtl>::getPkts(
+	void *obj, struct rte_mbuf **sendPkts, struct rte_mbuf **freePkts) {
+	BufArray<mbuf> *inPktsBA = reinterpret_cast<BufArray<mbuf> *>(obj);
+
+	inPktsBA->getSendBufs(reinterpret_cast<mbuf **>(sendPkts));
+	inPktsBA->getFreeBufs(reinterpret_cast<mbuf **>(freePkts));
+
+	delete (inPktsBA);
+};
+
+template <class Proto, class ConCtl>
+void ServerC<Proto, ConCtl>::getStats(void *obj, struct TCP_Server_Stats *stats) {
+	auto *inst = reinterpret_cast<Instance *>(obj);
+
+	*stats = inst->stats;
+	stats->connections = inst->sm.getStateTableSize();
+	stats->connectionsOpened = inst->sm.getStatesAdded();
+	stats->connectionsClosed = inst->sm.getStatesClosed();
+};
+
+template <class Proto, class ConCtl> void ServerC<Proto, ConCtl>::free(void *obj) {
+	delete (reinterpret_cast<Instance *>(obj));
+};
+
+}; // namespace TCP
+
+#endif /* TCPSERVER_C_CPP */
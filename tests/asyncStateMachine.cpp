@@ -0,0 +1,161 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "asyncPool.hpp"
+#include "samplePacket.hpp"
+#include "stateMachine.hpp"
+
+using namespace std;
+
+class Identifier;
+using SM = StateMachine<Identifier, SamplePacket>;
+
+// The first word of a packet is the connection, the second one a sequence number
+class Identifier {
+public:
+	struct ConnectionID {
+		uint64_t val;
+
+		bool operator==(const ConnectionID &c) const { return val == c.val; }
+
+		bool operator<(const ConnectionID &c) const { return val < c.val; }
+
+		operator std::string() const { return ""; }
+
+		ConnectionID(const ConnectionID &c) : val(c.val){};
+		ConnectionID() : val(0){};
+	};
+
+	struct Hasher {
+		size_t operator()(const ConnectionID &id) const { return id.val; }
+	};
+
+	static ConnectionID identify(SamplePacket *pkt) {
+		ConnectionID id;
+		id.val = reinterpret_cast<uint32_t *>(pkt->getData())[0];
+		return id;
+	};
+
+	static ConnectionID getDelKey() {
+		ConnectionID id;
+		id.val = std::numeric_limits<uint64_t>::max();
+		return id;
+	};
+
+	static ConnectionID getEmptyKey() {
+		ConnectionID id;
+		id.val = std::numeric_limits<uint64_t>::max() - 1;
+		return id;
+	};
+};
+
+SamplePacket *getPkt(uint32_t conn, uint32_t seq) {
+	uint32_t *data = reinterpret_cast<uint32_t *>(malloc(64));
+	data[0] = conn;
+	data[1] = seq;
+	return new SamplePacket(data, 64);
+}
+
+struct Conn {
+	// Written by the job on a worker thread
+	std::thread::id worker;
+	uint32_t jobsDone = 0;
+};
+
+// Sequence numbers of the packets, as the connections see them after the job
+std::vector<uint32_t> seen[2];
+
+// State 1 runs a slow job, and continues in state 2 afterwards
+void fun1(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
+	(void)pktIn;
+	Conn *conn = reinterpret_cast<Conn *>(state.stateData);
+
+	fi.transition(2);
+	fi.runAsync([conn]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		conn->worker = std::this_thread::get_id();
+		conn->jobsDone++;
+	});
+}
+
+void fun2(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
+	(void)fi;
+	Conn *conn = reinterpret_cast<Conn *>(state.stateData);
+
+	// The job is done, before any packet is run again
+	assert(conn->jobsDone == 1);
+	assert(conn->worker != std::this_thread::get_id());
+
+	uint32_t *data = reinterpret_cast<uint32_t *>(pktIn->getData());
+	seen[data[0]].push_back(data[1]);
+}
+
+BufArray<SamplePacket> *makeBatch(std::vector<SamplePacket *> pkts) {
+	SamplePacket **array =
+		reinterpret_cast<SamplePacket **>(malloc(sizeof(void *) * (pkts.size() + 1)));
+	for (unsigned int i = 0; i < pkts.size(); i++) {
+		array[i] = pkts[i];
+	}
+	return new BufArray<SamplePacket>(array, pkts.size());
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	try {
+		AsyncPool pool(2);
+		SM sm;
+
+		sm.registerStartStateID(1, [](Identifier::ConnectionID) { return new Conn(); });
+		sm.registerEndStateID(3);
+		sm.registerFunction(1, fun1);
+		sm.registerFunction(2, fun2);
+		sm.registerAsyncPool(&pool);
+
+		// The first packet parks connection 0, it is kept for later
+		BufArray<SamplePacket> *ba = makeBatch({getPkt(0, 0)});
+		sm.runPktBatch(*ba);
+		assert(sm.getParkedCount() == 1);
+		assert(ba->getKeepCount() == 1);
+		assert(ba->getSendCount() == 0);
+		assert(ba->getFreeCount() == 0);
+		delete ba;
+
+		// More packets of connection 0 are queued, connection 1 parks as well
+		ba = makeBatch({getPkt(0, 1), getPkt(1, 0), getPkt(0, 2)});
+		sm.runPktBatch(*ba);
+		assert(sm.getParkedCount() == 2);
+		assert(ba->getKeepCount() == 3);
+		assert(seen[0].empty() && seen[1].empty());
+		delete ba;
+
+		// Once the jobs are done, the queued packets join the next batch in order
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		ba = makeBatch({getPkt(0, 3)});
+		sm.runPktBatch(*ba);
+		assert(sm.getParkedCount() == 0);
+		assert((seen[0] == std::vector<uint32_t>{0, 1, 2, 3}));
+		assert((seen[1] == std::vector<uint32_t>{0}));
+		assert(ba->getTotalCount() == 5);
+		assert(ba->getSendCount() == 5);
+		assert(ba->getKeepCount() == 0);
+		delete ba;
+
+		cout << "Async state machine test passed" << endl;
+
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	return 0;
+}
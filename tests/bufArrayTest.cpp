@@ -131,10 +131,8 @@ int main(int argc, char **argv) {
 
 	delete (ba);
 
+	// SamplePacket frees its data itself
 	for (unsigned int i = 0; i < numPkts; i++) {
-		free(pkts[i]->getData());
-		free(pkts2[i]->getData());
-
 		delete (pkts[i]);
 		delete (pkts2[i]);
 	}
@@ -142,5 +140,19 @@ int main(int argc, char **argv) {
 	free(pkts);
 	free(pkts2);
 
+	// Empty BufArrays grow as well
+	{
+		BufArray<SamplePacket> empty(nullptr, 0);
+		assert(empty.getTotalCount() == 0);
+		assert(empty.getSendCount() == 0);
+
+		SamplePacket *pkt = new SamplePacket(malloc(100), 100);
+		empty.addPkt(pkt);
+		assert(empty.getSendCount() == 1);
+		assert(empty[0] == pkt);
+
+		delete (pkt);
+	}
+
 	return 0;
 }
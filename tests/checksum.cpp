@@ -0,0 +1,182 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <rte_eal.h>
+
+#include "checksumMbuf.hpp"
+#include "headers.hpp"
+#include "mbuf.hpp"
+
+using namespace std;
+
+// One's complement sum of 16 bit words as RFC 1071 writes it (host byte order)
+uint16_t naiveSum(const uint8_t *data, uint32_t len, uint32_t sum = 0) {
+	for (uint32_t i = 0; i < len; i += 2) {
+		sum += data[i] << 8;
+		if (i + 1 < len) {
+			sum += data[i + 1];
+		}
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+	return sum;
+}
+
+uint16_t naiveChecksum(const uint8_t *data, uint32_t len) {
+	return htons(static_cast<uint16_t>(~naiveSum(data, len)));
+}
+
+int main(int argc, char **argv) {
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		cout << "FATAL: cannot init EAL" << endl;
+		return 1;
+	}
+
+	srand(42);
+	uint8_t buf[4096 + 64];
+	for (auto &b : buf) {
+		b = rand();
+	}
+
+	// All lengths and alignments, with and without the AVX2 rounds
+	for (uint32_t offset = 0; offset < 32; offset += 2) {
+		for (uint32_t len = 0; len <= 4096; len += (len < 256 ? 1 : 61)) {
+			assert(Checksum::finish(Checksum::add(buf + offset, len)) ==
+				   naiveChecksum(buf + offset, len));
+		}
+	}
+
+	// Words of 0xffff must not overflow the lanes
+	uint8_t *ones = reinterpret_cast<uint8_t *>(malloc(1 << 21));
+	memset(ones, 0xff, 1 << 21);
+	assert(Checksum::fold(Checksum::add(ones, 1 << 21)) == 0xffff);
+	free(ones);
+
+	{
+		// The checksum of an IPv4 header, the old one sums twice the header
+		Headers::IPv4 ipv4;
+		memset(&ipv4, 0, sizeof(ipv4));
+		ipv4.setVersion();
+		ipv4.setIHL(5);
+		ipv4.setProtoUDP();
+		ipv4.ttl = 17;
+		ipv4.setSrcIP(0x0a000001);
+		ipv4.setDstIP(0xc0a80102);
+		ipv4.setPayloadLength(1000);
+		ipv4.calcChecksum();
+		uint16_t old = ipv4.checksum;
+		Checksum::setIPv4(&ipv4);
+		assert(ipv4.checksum == old);
+		assert(naiveSum(reinterpret_cast<uint8_t *>(&ipv4), sizeof(ipv4)) == 0xffff);
+
+		// Swapping the addresses keeps the checksum, the TTL changes it (RFC 1624)
+		uint32_t tmp = ipv4.srcIP;
+		ipv4.srcIP = ipv4.dstIP;
+		ipv4.dstIP = tmp;
+		uint16_t ttlProto;
+		memcpy(&ttlProto, &ipv4.ttl, 2);
+		ipv4.ttl = 64;
+		uint16_t newTtlProto;
+		memcpy(&newTtlProto, &ipv4.ttl, 2);
+		ipv4.checksum = Checksum::update16(ipv4.checksum, ttlProto, newTtlProto);
+		assert(naiveSum(reinterpret_cast<uint8_t *>(&ipv4), sizeof(ipv4)) == 0xffff);
+
+		uint32_t oldIP = ipv4.srcIP;
+		ipv4.setSrcIP(0x01020304);
+		ipv4.checksum = Checksum::update32(ipv4.checksum, oldIP, ipv4.srcIP);
+		assert(naiveSum(reinterpret_cast<uint8_t *>(&ipv4), sizeof(ipv4)) == 0xffff);
+	}
+
+	{
+		// Rewrite parts of a block with a valid checksum, an odd length included
+		uint8_t data[100];
+		memcpy(data, buf, sizeof(data));
+		data[10] = data[11] = 0;
+		uint16_t check = Checksum::finish(Checksum::add(data, sizeof(data)));
+		memcpy(data + 10, &check, 2);
+
+		for (uint32_t round = 0; round < 1000; round++) {
+			uint32_t pos = (rand() % 40) * 2 + 12;
+			uint32_t len = rand() % (sizeof(data) - pos);
+			Checksum::Update upd;
+			upd.remove(data + pos, len);
+			for (uint32_t i = 0; i < len; i++) {
+				data[pos + i] = rand();
+			}
+			upd.add(data + pos, len);
+
+			uint16_t cur;
+			memcpy(&cur, data + 10, 2);
+			cur = upd.apply(cur);
+			memcpy(data + 10, &cur, 2);
+			assert(naiveSum(data, sizeof(data)) == 0xffff);
+		}
+	}
+
+	{
+		// TCP over a chain of buffers of odd lengths
+		rte_mempool *mempool = rte_pktmbuf_pool_create(
+			"checksum pool", 63, 0, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+		assert(mempool != nullptr);
+
+		uint16_t headersLen = sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Tcp);
+		uint16_t lens[] = {static_cast<uint16_t>(headersLen + 3), 1, 1460, 7, 0, 100};
+		mbuf *pkt = nullptr;
+		uint32_t total = 0;
+		uint8_t flat[4096];
+		for (int i = 5; i >= 0; i--) {
+			mbuf *cur = reinterpret_cast<mbuf *>(rte_pktmbuf_alloc(mempool));
+			memcpy(cur->getData(), buf + 100 * i, lens[i]);
+			cur->setDataLen(lens[i]);
+			if (pkt != nullptr) {
+				cur->chain(pkt);
+			}
+			pkt = cur;
+		}
+		for (mbuf *cur = pkt; cur != nullptr; cur = static_cast<mbuf *>(cur->next)) {
+			memcpy(flat + total, cur->getData(), cur->getDataLen());
+			total += cur->getDataLen();
+		}
+
+		uint8_t *data = reinterpret_cast<uint8_t *>(pkt->getData());
+		auto ipv4 = reinterpret_cast<Headers::IPv4 *>(data + sizeof(Headers::Ethernet));
+		ipv4->setVersion();
+		ipv4->setIHL(5);
+		ipv4->setProtoTCP();
+		ipv4->setPayloadLength(total - sizeof(Headers::Ethernet) - sizeof(Headers::IPv4));
+		pkt->setHeaderLens(sizeof(Headers::Ethernet), sizeof(Headers::IPv4), sizeof(Headers::Tcp));
+		memcpy(flat, data, headersLen);
+
+		Checksum::setIPv4L4(pkt, false);
+		memcpy(flat, data, headersLen);
+		assert(naiveSum(flat + sizeof(Headers::Ethernet), sizeof(Headers::IPv4)) == 0xffff);
+
+		// The pseudo header, then TCP header and payload
+		uint8_t pseudo[12];
+		memcpy(pseudo, &ipv4->srcIP, 8);
+		pseudo[8] = 0;
+		pseudo[9] = ipv4->proto;
+		uint16_t l4Len = htons(ipv4->getPayloadLength());
+		memcpy(pseudo + 10, &l4Len, 2);
+		uint16_t sum = naiveSum(pseudo, sizeof(pseudo));
+		uint32_t l4Offset = sizeof(Headers::Ethernet) + sizeof(Headers::IPv4);
+		assert(naiveSum(flat + l4Offset, total - l4Offset, sum) == 0xffff);
+
+		// With offloading, only the pseudo header is in the checksum
+		Checksum::setOffload(true);
+		Checksum::setIPv4L4(pkt, false);
+		Checksum::setOffload(false);
+		assert(pkt->ol_flags & PKT_TX_TCP_CKSUM);
+		auto tcp = reinterpret_cast<Headers::Tcp *>(data + l4Offset);
+		assert(tcp->checksum == htons(sum));
+
+		pkt->release();
+	}
+
+	cout << "Checksum test passed" << endl;
+	return 0;
+}
@@ -0,0 +1,219 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <openssl/bio.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include "dtlsAead.hpp"
+
+using namespace std;
+
+using Datagram = std::vector<uint8_t>;
+
+// A self-signed ECDSA certificate, the test needs no files
+void useCert(SSL_CTX *ctx) {
+	EVP_PKEY *key = nullptr;
+	EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+	assert(pctx != nullptr);
+	assert(EVP_PKEY_keygen_init(pctx) == 1);
+	assert(EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) == 1);
+	assert(EVP_PKEY_keygen(pctx, &key) == 1);
+	EVP_PKEY_CTX_free(pctx);
+
+	X509 *cert = X509_new();
+	assert(cert != nullptr);
+	ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+	X509_set_pubkey(cert, key);
+	X509_NAME *name = X509_get_subject_name(cert);
+	X509_NAME_add_entry_by_txt(
+		name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("test"), -1, -1, 0);
+	X509_set_issuer_name(cert, name);
+	assert(X509_sign(cert, key, EVP_sha256()) > 0);
+
+	assert(SSL_CTX_use_certificate(ctx, cert) == 1);
+	assert(SSL_CTX_use_PrivateKey(ctx, key) == 1);
+	X509_free(cert);
+	EVP_PKEY_free(key);
+}
+
+SSL *newSsl(SSL_CTX *ctx, bool server) {
+	SSL *ssl = SSL_new(ctx);
+	assert(ssl != nullptr);
+	SSL_set_bio(ssl, BIO_new(BIO_s_memQ()), BIO_new(BIO_s_memQ()));
+	if (server) {
+		SSL_set_accept_state(ssl);
+	} else {
+		SSL_set_connect_state(ssl);
+	}
+	return ssl;
+}
+
+// The datagrams an SSL object wrote
+std::vector<Datagram> takeDatagrams(SSL *ssl) {
+	std::vector<Datagram> ret;
+	uint8_t buf[2048];
+	int len;
+	while ((len = BIO_read(SSL_get_wbio(ssl), buf, sizeof(buf))) > 0) {
+		ret.emplace_back(buf, buf + len);
+	}
+	return ret;
+}
+
+void give(SSL *ssl, const Datagram &d) { BIO_write(SSL_get_rbio(ssl), d.data(), d.size()); }
+
+// Write a record of data, it is the only datagram
+Datagram writeData(SSL *ssl, const std::string &data) {
+	assert(SSL_write(ssl, data.data(), data.size()) == static_cast<int>(data.size()));
+	std::vector<Datagram> out = takeDatagrams(ssl);
+	assert(out.size() == 1);
+	return out[0];
+}
+
+std::string readData(SSL *ssl) {
+	char buf[2048];
+	int len = SSL_read(ssl, buf, sizeof(buf));
+	assert(len >= 0);
+	return std::string(buf, len);
+}
+
+// Open a record of data, and check its plaintext
+void checkOpen(DtlsAead &aead, Datagram d, const std::string &data) {
+	uint8_t type;
+	int len = aead.open(d.data(), d.size(), type);
+	assert(len == static_cast<int>(data.size()));
+	assert(type == DtlsAead::typeData);
+	assert(memcmp(d.data() + aead.getPlainOffset(), data.data(), len) == 0);
+}
+
+void testCipher(const char *cipher, bool aeadCipher) {
+	SSL_CTX *serverCtx = SSL_CTX_new(DTLS_method());
+	SSL_CTX *clientCtx = SSL_CTX_new(DTLS_method());
+	assert((serverCtx != nullptr) && (clientCtx != nullptr));
+	useCert(serverCtx);
+	SSL_CTX_set_max_proto_version(clientCtx, DTLS1_2_VERSION);
+	assert(SSL_CTX_set_cipher_list(clientCtx, cipher) == 1);
+
+	SSL *server = newSsl(serverCtx, true);
+	SSL *client = newSsl(clientCtx, false);
+	for (int i = 0; (i < 16) && !(SSL_is_init_finished(server) && SSL_is_init_finished(client));
+		 i++) {
+		SSL_do_handshake(client);
+		for (auto &d : takeDatagrams(client)) {
+			give(server, d);
+		}
+		SSL_do_handshake(server);
+		for (auto &d : takeDatagrams(server)) {
+			give(client, d);
+		}
+	}
+	assert(SSL_is_init_finished(server) && SSL_is_init_finished(client));
+
+	// OpenSSL echoes the first record, then the records are handed over
+	Datagram d = writeData(client, "first");
+	Datagram first(d);
+	DtlsAead::Header lastOpened;
+	assert(DtlsAead::parse(d.data(), d.size(), lastOpened));
+	give(server, d);
+	assert(readData(server) == "first");
+	d = writeData(server, "first");
+	DtlsAead::Header lastSealed;
+	assert(DtlsAead::parseLast(d.data(), d.size(), lastSealed));
+	assert((lastOpened.type == DtlsAead::typeData) && (lastSealed.type == DtlsAead::typeData));
+	give(client, d);
+	assert(readData(client) == "first");
+
+	DtlsAead *aead = DtlsAead::create(server, lastOpened, lastSealed);
+	if (!aeadCipher) {
+		assert(aead == nullptr);
+	} else {
+		assert(aead != nullptr);
+
+		// A record of the client is opened, and sealed in place as the echo
+		std::string data(300, 'x');
+		d = writeData(client, data);
+		Datagram replayed(d);
+		uint8_t type;
+		int len = aead->open(d.data(), d.size(), type);
+		assert((len == 300) && (type == DtlsAead::typeData));
+		assert(memcmp(d.data() + aead->getPlainOffset(), data.data(), len) == 0);
+		assert(aead->seal(d.data(), DtlsAead::typeData, len) ==
+			static_cast<int>(len + aead->getOverhead()));
+		give(client, d);
+		assert(readData(client) == data);
+
+		// Replays are rejected, forged records do not move the window
+		Datagram a = writeData(client, "a");
+		Datagram b = writeData(client, "b");
+		Datagram forged(b);
+		forged.back() ^= 1;
+		assert(aead->open(forged.data(), forged.size(), type) == -1);
+		checkOpen(*aead, b, "b");
+		checkOpen(*aead, a, "a");
+		assert(aead->open(a.data(), a.size(), type) == -1);
+		assert(aead->open(replayed.data(), replayed.size(), type) == -1);
+
+		// The records OpenSSL read count as opened
+		assert(aead->open(first.data(), first.size(), type) == -1);
+
+		// Records too far behind are rejected
+		Datagram old = writeData(client, "old");
+		for (int i = 0; i < 64; i++) {
+			checkOpen(*aead, writeData(client, "new"), "new");
+		}
+		assert(aead->open(old.data(), old.size(), type) == -1);
+
+		// Two records in one datagram are rejected
+		Datagram two = writeData(client, "one");
+		Datagram second = writeData(client, "two");
+		two.insert(two.end(), second.begin(), second.end());
+		assert(aead->open(two.data(), two.size(), type) == -1);
+
+		// The close_notify of the client is answered with one of the server
+		SSL_shutdown(client);
+		std::vector<Datagram> out = takeDatagrams(client);
+		assert(out.size() == 1);
+		len = aead->open(out[0].data(), out[0].size(), type);
+		assert((len == 2) && (type == DtlsAead::typeAlert));
+		assert(out[0][aead->getPlainOffset() + 1] == SSL3_AD_CLOSE_NOTIFY);
+
+		Datagram alert(64);
+		alert[aead->getPlainOffset()] = SSL3_AL_WARNING;
+		alert[aead->getPlainOffset() + 1] = SSL3_AD_CLOSE_NOTIFY;
+		len = aead->seal(alert.data(), DtlsAead::typeAlert, 2);
+		assert(len == 2 + aead->getOverhead());
+		alert.resize(len);
+		give(client, alert);
+		assert(SSL_shutdown(client) == 1);
+		delete aead;
+	}
+
+	SSL_free(client);
+	SSL_free(server);
+	SSL_CTX_free(clientCtx);
+	SSL_CTX_free(serverCtx);
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	testCipher("ECDHE-ECDSA-AES128-GCM-SHA256", true);
+	testCipher("ECDHE-ECDSA-AES256-GCM-SHA384", true);
+	testCipher("ECDHE-ECDSA-CHACHA20-POLY1305", true);
+
+	// Ciphers with a MAC stay with OpenSSL
+	testCipher("ECDHE-ECDSA-AES128-SHA256", false);
+
+	cout << "DTLS AEAD test passed" << endl;
+
+	return 0;
+}
@@ -0,0 +1,49 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "dtlsCookie.hpp"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	auto now = std::chrono::steady_clock::now();
+	DtlsCookie::Peer peer = {0x0a000001, 0x0a000002, 40000, 4433};
+	uint8_t cookie[DtlsCookie::length];
+
+	DtlsCookie::make(peer, cookie, now);
+	assert(DtlsCookie::check(peer, cookie, sizeof(cookie), now));
+
+	// Another connection, or a tampered or truncated cookie, are rejected
+	DtlsCookie::Peer other = peer;
+	other.peerIP++;
+	assert(!DtlsCookie::check(other, cookie, sizeof(cookie), now));
+	other = peer;
+	other.peerPort++;
+	assert(!DtlsCookie::check(other, cookie, sizeof(cookie), now));
+	assert(!DtlsCookie::check(peer, cookie, sizeof(cookie) - 1, now));
+	cookie[5] ^= 1;
+	assert(!DtlsCookie::check(peer, cookie, sizeof(cookie), now));
+	cookie[5] ^= 1;
+
+	// The key rotates every 64 seconds, the previous key is still accepted
+	uint8_t newCookie[DtlsCookie::length];
+	auto later = now + std::chrono::seconds(64 * DtlsCookie::maxAge);
+	DtlsCookie::make(peer, newCookie, later);
+	assert(memcmp(cookie, newCookie, sizeof(cookie)) != 0);
+	assert(DtlsCookie::check(peer, cookie, sizeof(cookie), later));
+	later += std::chrono::seconds(64);
+	assert(!DtlsCookie::check(peer, cookie, sizeof(cookie), later));
+
+	// Cookies from the future are not accepted either
+	assert(!DtlsCookie::check(peer, cookie, sizeof(cookie), now - std::chrono::seconds(64)));
+
+	cout << "DTLS cookie test passed" << endl;
+
+	return 0;
+}
@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include "bufArray.hpp"
+#include "checksum.hpp"
 #include "helloBye2Proto.hpp"
 #include "samplePacket.hpp"
 #include "stateMachine.hpp"
@@ -16,6 +17,22 @@ using namespace std;
 #define BATCH_SIZE 8
 #define BUF_SIZE 100
 
+// Check the IPv4 and UDP checksums of the packets
+void checkChecksums(Packet **pkts) {
+	for (int i = 0; i < BATCH_SIZE; i++) {
+		Packet *pkt = pkts[i];
+		auto ether = reinterpret_cast<Headers::Ethernet *>(pkt->getData());
+		auto ipv4 = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
+		auto udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+		uint16_t udpLen = ntohs(udp->len);
+
+		assert(Checksum::fold(Checksum::add(ipv4, ipv4->ihl() * 4)) == 0xffff);
+		assert(udp->checksum != 0);
+		assert(Checksum::fold(Checksum::add(udp, udpLen, Checksum::pseudoIPv4(ipv4, udpLen))) ==
+			   0xffff);
+	}
+}
+
 int main(int argc, char **argv) {
 	(void)argc;
 	(void)argv;
@@ -71,6 +88,8 @@ int main(int argc, char **argv) {
 		counter++;
 	}
 
+	checkChecksums(spArrayInit);
+
 	// The new connections are all not bound to the core/instance yet
 	assert(client.getStateTableSize() == 0);
 	assert(server.getStateTableSize() == 0);
@@ -83,6 +102,7 @@ int main(int argc, char **argv) {
 	server.runPktBatch(bufArray);
 	assert(bufArray.getSendCount() == BATCH_SIZE);
 	assert(bufArray.getFreeCount() == 0);
+	checkChecksums(spArrayInit);
 	assert(client.getStateTableSize() == 0);
 	assert(server.getStateTableSize() == BATCH_SIZE);
 
@@ -94,6 +114,7 @@ int main(int argc, char **argv) {
 	client.runPktBatch(bufArray);
 	assert(bufArray.getSendCount() == BATCH_SIZE);
 	assert(bufArray.getFreeCount() == 0);
+	checkChecksums(spArrayInit);
 	assert(client.getStateTableSize() == BATCH_SIZE);
 	assert(server.getStateTableSize() == BATCH_SIZE);
 
@@ -105,6 +126,7 @@ int main(int argc, char **argv) {
 	server.runPktBatch(bufArray);
 	assert(bufArray.getSendCount() == BATCH_SIZE);
 	assert(bufArray.getFreeCount() == 0);
+	checkChecksums(spArrayInit);
 	assert(client.getStateTableSize() == BATCH_SIZE);
 	assert(server.getStateTableSize() == 0);
 
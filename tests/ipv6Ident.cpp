@@ -0,0 +1,150 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "IPDualStack_5TupleL2Ident.hpp"
+#include "IPv6_5TupleL2Ident.hpp"
+#include "headers.hpp"
+#include "samplePacket.hpp"
+
+using namespace std;
+
+using Ident6 = IPv6_5TupleL2Ident<SamplePacket>;
+using IdentDual = IPDualStack_5TupleL2Ident<SamplePacket>;
+
+/* Build an IPv6 UDP packet with the given chain of extension headers
+ * The last extension header is followed by UDP
+ */
+SamplePacket *getPkt6(const uint8_t *extTypes, unsigned int numExt, uint16_t fragOffset = 0) {
+	uint16_t dataLen = 256;
+	uint8_t *data = reinterpret_cast<uint8_t *>(malloc(dataLen));
+	memset(data, 0, dataLen);
+
+	auto ether = reinterpret_cast<Headers::Ethernet *>(data);
+	ether->setEthertype(Headers::Ethernet::ETHERTYPE_IPv6);
+	auto ip = reinterpret_cast<Headers::IPv6 *>(ether->getPayload());
+	ip->setVersion();
+	assert(inet_pton(AF_INET6, "2001:db8::1", ip->srcIP.data()) == 1);
+	assert(inet_pton(AF_INET6, "2001:db8::2", ip->dstIP.data()) == 1);
+
+	uint8_t *cur = reinterpret_cast<uint8_t *>(ip->getPayload());
+	uint8_t *nextHeader = &ip->nextHeader;
+	for (unsigned int i = 0; i < numExt; i++) {
+		*nextHeader = extTypes[i];
+		auto ext = reinterpret_cast<Headers::IPv6Ext *>(cur);
+		if (extTypes[i] == Headers::IPv6::EXT_FRAGMENT) {
+			uint16_t offFlags = htons(fragOffset << 3);
+			memcpy(cur + 2, &offFlags, 2);
+		} else {
+			// 16 bytes per options header
+			ext->hdrExtLen = 1;
+		}
+		nextHeader = &ext->nextHeader;
+		cur += ext->getLength(extTypes[i]);
+	}
+	*nextHeader = Headers::IPv4::PROTO_UDP;
+
+	auto udp = reinterpret_cast<Headers::Udp *>(cur);
+	udp->setSrcPort(5000);
+	udp->setDstPort(53);
+
+	return new SamplePacket(data, dataLen);
+}
+
+SamplePacket *getPkt4(uint32_t srcIP, uint32_t dstIP) {
+	uint16_t dataLen = 64;
+	uint8_t *data = reinterpret_cast<uint8_t *>(malloc(dataLen));
+	memset(data, 0, dataLen);
+
+	auto ether = reinterpret_cast<Headers::Ethernet *>(data);
+	ether->setEthertype(Headers::Ethernet::ETHERTYPE_IPv4);
+	auto ip = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
+	ip->setVersion();
+	ip->setIHL(5);
+	ip->setProtoTCP();
+	ip->setSrcIP(srcIP);
+	ip->setDstIP(dstIP);
+	auto tcp = reinterpret_cast<Headers::Tcp *>(ip->getPayload());
+	tcp->setSrcPort(40000);
+	tcp->setDstPort(80);
+	tcp->setOffset(5);
+
+	return new SamplePacket(data, dataLen);
+}
+
+bool identifies(SamplePacket *pkt) {
+	try {
+		Ident6::identify(pkt);
+		return true;
+	} catch (PacketNotIdentified *e) {
+		delete e;
+		return false;
+	}
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	// Plain IPv6 + UDP
+	SamplePacket *plain = getPkt6(nullptr, 0);
+	Ident6::ConnectionID plainID = Ident6::identify(plain);
+	assert(plainID.proto == Headers::IPv4::PROTO_UDP);
+	assert(ntohs(plainID.srcPort) == 5000);
+	assert(ntohs(plainID.dstPort) == 53);
+	cout << static_cast<std::string>(plainID) << endl;
+
+	// Extension headers have to be skipped, the ID stays the same
+	const uint8_t exts[] = {Headers::IPv6::EXT_HOP_BY_HOP, Headers::IPv6::EXT_DEST_OPTS,
+		Headers::IPv6::EXT_ROUTING, Headers::IPv6::EXT_FRAGMENT, Headers::IPv6::EXT_DEST_OPTS};
+	SamplePacket *withExt = getPkt6(exts, 4);
+	Ident6::ConnectionID extID = Ident6::identify(withExt);
+	assert(extID == plainID);
+	assert(Ident6::Hasher()(extID) == Ident6::Hasher()(plainID));
+
+	// Too many extension headers
+	SamplePacket *tooMany = getPkt6(exts, 5);
+	assert(!identifies(tooMany));
+
+	// Only the first fragment can be identified
+	const uint8_t frag[] = {Headers::IPv6::EXT_FRAGMENT};
+	SamplePacket *firstFrag = getPkt6(frag, 1, 0);
+	SamplePacket *laterFrag = getPkt6(frag, 1, 100);
+	assert(identifies(firstFrag));
+	assert(!identifies(laterFrag));
+
+	// Every byte of the key is part of the comparison
+	for (size_t i = 0; i < 37; i++) {
+		Ident6::ConnectionID other(plainID);
+		reinterpret_cast<uint8_t *>(&other)[i] ^= 1;
+		assert(!(other == plainID));
+	}
+
+	// Dual-stack: IPv6 packets result in the same ID as before
+	assert(IdentDual::identify(withExt) == plainID);
+
+	// Dual-stack: IPv4 is mapped to ::ffff:a.b.c.d
+	SamplePacket *v4 = getPkt4(0x0a000001, 0x0a000002);
+	IdentDual::ConnectionID v4ID = IdentDual::identify(v4);
+	uint8_t mapped[16];
+	assert(inet_pton(AF_INET6, "::ffff:10.0.0.1", mapped) == 1);
+	assert(memcmp(v4ID.srcIP, mapped, 16) == 0);
+	assert(inet_pton(AF_INET6, "::ffff:10.0.0.2", mapped) == 1);
+	assert(memcmp(v4ID.dstIP, mapped, 16) == 0);
+	assert(v4ID.proto == Headers::IPv4::PROTO_TCP);
+	assert(ntohs(v4ID.dstPort) == 80);
+	assert(!(v4ID == plainID));
+	cout << static_cast<std::string>(v4ID) << endl;
+
+	delete plain;
+	delete withExt;
+	delete tooMany;
+	delete firstFrag;
+	delete laterFrag;
+	delete v4;
+
+	cout << "IPv6 identifier test passed" << endl;
+
+	return 0;
+}
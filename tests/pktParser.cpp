@@ -0,0 +1,115 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "IPv4_5TupleL2Ident.hpp"
+#include "headers.hpp"
+#include "pktParser.hpp"
+#include "samplePacket.hpp"
+
+using namespace std;
+
+using Ident = IPv4_5TupleL2Ident<SamplePacket>;
+
+/* Build a TCP packet with the given VLAN tags, IPv4 options and TCP options
+ * The payload is a single 0xab byte
+ */
+SamplePacket *getPkt(const uint16_t *tags, unsigned int numTags, uint8_t ihl, uint8_t tcpOffset) {
+	uint16_t dataLen = 256;
+	uint8_t *data = reinterpret_cast<uint8_t *>(malloc(dataLen));
+	memset(data, 0, dataLen);
+
+	// Every tag is followed by the next ethertype
+	uint8_t *cur = data + 12;
+	for (unsigned int i = 0; i < numTags; i++) {
+		uint16_t tpid = htons(tags[i]);
+		memcpy(cur, &tpid, 2);
+		cur += 4;
+	}
+	uint16_t ethertype = htons(Headers::Ethernet::ETHERTYPE_IPv4);
+	memcpy(cur, &ethertype, 2);
+	cur += 2;
+
+	auto ip = reinterpret_cast<Headers::IPv4 *>(cur);
+	ip->setVersion();
+	ip->setIHL(ihl);
+	ip->setProtoTCP();
+	ip->setSrcIP(0x0a000001);
+	ip->setDstIP(0x0a000002);
+
+	auto tcp = reinterpret_cast<Headers::Tcp *>(ip->getPayload());
+	tcp->setSrcPort(40000);
+	tcp->setDstPort(80);
+	tcp->setOffset(tcpOffset);
+	reinterpret_cast<uint8_t *>(tcp)[tcpOffset * 4] = 0xab;
+
+	return new SamplePacket(data, dataLen);
+}
+
+bool parses(SamplePacket *pkt) {
+	PktParser::Result res;
+	return PktParser::parse(pkt, res);
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	// No tags, no options
+	SamplePacket *plain = getPkt(nullptr, 0, 5, 5);
+	PktParser::Result res;
+	assert(PktParser::parse(plain, res));
+	assert(res.ethertype == Headers::Ethernet::ETHERTYPE_IPv4);
+	assert(res.proto == Headers::IPv4::PROTO_TCP);
+	assert(plain->getL2Len() == 14);
+	assert(plain->getL3Len() == 20);
+	assert(plain->getL4Len() == 20);
+	assert(*PktParser::getPayload(plain) == 0xab);
+	Ident::ConnectionID plainID = Ident::identify(plain);
+
+	// QinQ, IPv4 options and TCP options
+	const uint16_t tags[] = {PktParser::ETHERTYPE_QINQ, PktParser::ETHERTYPE_VLAN,
+		PktParser::ETHERTYPE_VLAN};
+	SamplePacket *tagged = getPkt(tags, 2, 8, 8);
+	assert(PktParser::parse(tagged, res));
+	assert(tagged->getL2Len() == 22);
+	assert(tagged->getL3Len() == 32);
+	assert(tagged->getL4Len() == 32);
+	assert(PktParser::getHeadersLen(tagged) == 86);
+	assert(*PktParser::getPayload(tagged) == 0xab);
+	assert(PktParser::getTcp(tagged)->getDstPort() == 80);
+
+	// The ID does not depend on the encapsulation
+	assert(Ident::identify(tagged) == plainID);
+
+	// Too many tags, broken IHL, broken TCP offset
+	SamplePacket *tooManyTags = getPkt(tags, 3, 5, 5);
+	SamplePacket *badIHL = getPkt(nullptr, 0, 4, 5);
+	SamplePacket *badOffset = getPkt(nullptr, 0, 5, 4);
+	assert(!parses(tooManyTags));
+	assert(!parses(badIHL));
+	assert(!parses(badOffset));
+
+	// Truncated packets
+	plain->setDataLen(14 + 20 + 10);
+	assert(!parses(plain));
+
+	// Later fragments carry no L4 header
+	SamplePacket *frag = getPkt(nullptr, 0, 5, 5);
+	auto fragIP = reinterpret_cast<Headers::IPv4 *>(
+		reinterpret_cast<uint8_t *>(frag->getData()) + sizeof(Headers::Ethernet));
+	fragIP->flags_fragmentation = htons(100);
+	assert(!parses(frag));
+
+	delete plain;
+	delete tagged;
+	delete tooManyTags;
+	delete badIHL;
+	delete badOffset;
+	delete frag;
+
+	cout << "Packet parser test passed" << endl;
+
+	return 0;
+}
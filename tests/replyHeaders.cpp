@@ -0,0 +1,130 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "IPv4_5TupleL2Ident.hpp"
+#include "checksum.hpp"
+#include "headers.hpp"
+#include "replyHeaders.hpp"
+#include "samplePacket.hpp"
+#include "stateMachine.hpp"
+
+using namespace std;
+
+using SM = StateMachine<IPv4_5TupleL2Ident<SamplePacket>, SamplePacket>;
+
+#define BUF_SIZE 128
+
+/* Build a UDP packet of 10.0.0.1:1000 to 10.0.0.2:<dstPort>
+ * vlanTags VLAN tags are put in front of IPv4, and ihl sets the IPv4 header length
+ */
+SamplePacket *getPkt(uint16_t dstPort, unsigned int vlanTags, uint8_t ihl) {
+	uint8_t *data = reinterpret_cast<uint8_t *>(calloc(1, BUF_SIZE));
+	uint16_t l2Len = sizeof(Headers::Ethernet) + 4 * vlanTags;
+	for (unsigned int i = 0; i < vlanTags; i++) {
+		uint16_t tpid = htons(PktParser::ETHERTYPE_VLAN);
+		memcpy(data + 12 + 4 * i, &tpid, sizeof(tpid));
+	}
+	uint16_t ethertype = htons(Headers::Ethernet::ETHERTYPE_IPv4);
+	memcpy(data + l2Len - 2, &ethertype, sizeof(ethertype));
+
+	auto ipv4 = reinterpret_cast<Headers::IPv4 *>(data + l2Len);
+	ipv4->setVersion();
+	ipv4->setIHL(ihl);
+	ipv4->ttl = 3;
+	ipv4->setProtoUDP();
+	ipv4->setSrcIP(0x0a000001);
+	ipv4->setDstIP(0x0a000002);
+	ipv4->setPayloadLength(sizeof(Headers::Udp) + 20);
+
+	auto udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+	udp->setSrcPort(1000);
+	udp->setDstPort(dstPort);
+	udp->setPayloadLength(20);
+	memset(udp->getPayload(), 0xab, 20);
+
+	Checksum::setIPv4(ipv4);
+	Checksum::setUdp(ipv4, udp);
+	return new SamplePacket(data, BUF_SIZE);
+}
+
+// Check, that pkt is the reply to getPkt(dstPort, vlanTags, ihl)
+void checkReply(SamplePacket *pkt, uint16_t dstPort, unsigned int vlanTags) {
+	uint8_t *data = reinterpret_cast<uint8_t *>(pkt->getData());
+	auto ipv4 = reinterpret_cast<Headers::IPv4 *>(
+		data + sizeof(Headers::Ethernet) + 4 * vlanTags);
+	auto udp = reinterpret_cast<Headers::Udp *>(ipv4->getPayload());
+	uint16_t udpLen = ntohs(udp->len);
+
+	assert(ipv4->getSrcIP() == 0x0a000002);
+	assert(ipv4->getDstIP() == 0x0a000001);
+	assert(udp->getSrcPort() == dstPort);
+	assert(udp->getDstPort() == 1000);
+	assert(udpLen == sizeof(Headers::Udp) + 20);
+	assert(ipv4->ttl == ReplyHeaders::ttl);
+
+	assert(Checksum::fold(Checksum::add(ipv4, ipv4->ihl() * 4)) == 0xffff);
+	assert(Checksum::fold(Checksum::add(udp, udpLen, Checksum::pseudoIPv4(ipv4, udpLen))) ==
+		   0xffff);
+}
+
+// A state function, that asks twice to reply with the packet
+void replyTwice(SM::State &state, SamplePacket *pkt, SM::FunIface &fi) {
+	(void)state;
+	(void)pkt;
+	fi.replyInPlace();
+	fi.replyInPlace();
+	fi.transition(1);
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	// More packets than prefetched, with and without IPv4 options and VLAN tags
+	const uint32_t numPkts = 10;
+	SamplePacket *pkts[numPkts];
+	for (uint32_t i = 0; i < numPkts; i++) {
+		pkts[i] = getPkt(2000 + i, i % 3, (i % 2) ? 6 : 5);
+	}
+
+	ReplyHeaders::rewrite(pkts, numPkts);
+	for (uint32_t i = 0; i < numPkts; i++) {
+		checkReply(pkts[i], 2000 + i, i % 3);
+	}
+
+	// Other packets than IPv4 are left alone
+	SamplePacket *arp = new SamplePacket(calloc(1, BUF_SIZE), BUF_SIZE);
+	uint8_t *arpData = reinterpret_cast<uint8_t *>(arp->getData());
+	arpData[12] = 0x08;
+	arpData[13] = 0x06;
+	memset(arpData + 14, 0xcd, BUF_SIZE - 14);
+	ReplyHeaders::rewrite(&arp, 1);
+	for (unsigned int i = 14; i < BUF_SIZE; i++) {
+		assert(arpData[i] == 0xcd);
+	}
+
+	// The headers of a packet are swapped once, however often the reply is asked for
+	SM sm;
+	sm.registerStartStateID(0, nullptr);
+	sm.registerEndStateID(1);
+	sm.registerFunction(0, replyTwice);
+	SamplePacket **smPkts = reinterpret_cast<SamplePacket **>(malloc(sizeof(SamplePacket *)));
+	smPkts[0] = getPkt(3000, 0, 5);
+	BufArray<SamplePacket> smPktsBA(smPkts, 1);
+	sm.runPktBatch(smPktsBA);
+	assert(smPktsBA.getSendCount() == 1);
+	checkReply(smPktsBA[0], 3000, 0);
+
+	for (uint32_t i = 0; i < numPkts; i++) {
+		delete pkts[i];
+	}
+	delete arp;
+	delete smPktsBA[0];
+
+	cout << "Reply headers test passed" << endl;
+	return 0;
+}
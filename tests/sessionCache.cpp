@@ -0,0 +1,76 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <openssl/ssl.h>
+
+#include "dtlsTicketKeys.hpp"
+#include "sessionCache.hpp"
+
+using namespace std;
+
+SSL_SESSION *makeSession(uint8_t id) {
+	SSL_SESSION *sess = SSL_SESSION_new();
+	assert(sess != nullptr);
+	unsigned char sid[32] = {id};
+	SSL_SESSION_set1_id(sess, sid, sizeof(sid));
+	return sess;
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	auto now = std::chrono::steady_clock::now();
+	unsigned char sid[32] = {0};
+
+	// A disabled cache does not take sessions
+	SessionCache cache(0, std::chrono::seconds(10));
+	SSL_SESSION *sess = makeSession(1);
+	assert(!cache.add(sess, now));
+	SSL_SESSION_free(sess);
+
+	// The oldest session is evicted, once the cache is full
+	cache.resize(2);
+	for (uint8_t i = 1; i <= 3; i++) {
+		assert(cache.add(makeSession(i), now));
+	}
+	assert(cache.size() == 2);
+	sid[0] = 1;
+	assert(cache.get(sid, sizeof(sid), now) == nullptr);
+	sid[0] = 3;
+	sess = cache.get(sid, sizeof(sid), now);
+	assert(sess != nullptr);
+
+	// Removed and expired sessions are gone
+	cache.remove(sess);
+	assert(cache.get(sid, sizeof(sid), now) == nullptr);
+	sid[0] = 2;
+	assert(cache.get(sid, sizeof(sid), now + std::chrono::seconds(9)) != nullptr);
+	assert(cache.get(sid, sizeof(sid), now + std::chrono::seconds(10)) == nullptr);
+	assert(cache.size() == 0);
+
+	// Ticket keys rotate, old keys are accepted for a while
+	const DtlsTicketKeys::Key &key = DtlsTicketKeys::getCurrent(now);
+	uint8_t name[DtlsTicketKeys::nameLen];
+	memcpy(name, key.name, sizeof(name));
+	assert(DtlsTicketKeys::find(name, now) != nullptr);
+	assert(!DtlsTicketKeys::isOld(*DtlsTicketKeys::find(name, now), now));
+
+	auto later = now + std::chrono::seconds(4096 * DtlsTicketKeys::maxAge);
+	const DtlsTicketKeys::Key *oldKey = DtlsTicketKeys::find(name, later);
+	assert(oldKey != nullptr);
+	assert(DtlsTicketKeys::isOld(*oldKey, later));
+	assert(memcmp(DtlsTicketKeys::getCurrent(later).name, name, sizeof(name)) != 0);
+	assert(DtlsTicketKeys::find(name, later + std::chrono::seconds(4096)) == nullptr);
+
+	// Unknown keys are rejected
+	name[5] ^= 1;
+	assert(DtlsTicketKeys::find(name, now) == nullptr);
+
+	cout << "Session cache test passed" << endl;
+
+	return 0;
+}
@@ -0,0 +1,125 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "IPv4_5TupleSymIdent.hpp"
+#include "headers.hpp"
+#include "samplePacket.hpp"
+#include "stateMachine.hpp"
+
+using namespace std;
+
+using Ident = IPv4_5TupleSymIdent<SamplePacket>;
+using SM = StateMachine<Ident, SamplePacket>;
+
+// Per connection state of this tiny firewall
+struct FlowState {
+	bool initiatorFromHi;
+	unsigned int pktsOrig;
+	unsigned int pktsReply;
+};
+
+FlowState lastFlow;
+
+// Build a UDP packet for the given 5-tuple (host byte order)
+SamplePacket *getPkt(uint32_t srcIP, uint32_t dstIP, uint16_t srcPort, uint16_t dstPort) {
+	uint16_t dataLen = sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Udp);
+	void *data = malloc(dataLen);
+	memset(data, 0, dataLen);
+
+	auto ether = reinterpret_cast<Headers::Ethernet *>(data);
+	auto ip = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
+	ip->setVersion();
+	ip->setIHL(5);
+	auto udp = reinterpret_cast<Headers::Udp *>(ip->getPayload());
+
+	ether->setEthertype(0x0800);
+	ip->setProtoUDP();
+	ip->setSrcIP(srcIP);
+	ip->setDstIP(dstIP);
+	udp->setSrcPort(srcPort);
+	udp->setDstPort(dstPort);
+
+	return new SamplePacket(data, dataLen);
+}
+
+void *factory(Ident::ConnectionID id) {
+	FlowState *fs = new FlowState();
+	fs->initiatorFromHi = id.fromHi;
+	fs->pktsOrig = 0;
+	fs->pktsReply = 0;
+	return fs;
+}
+
+void runFlow(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
+	(void)pktIn;
+	FlowState *fs = reinterpret_cast<FlowState *>(state.stateData);
+
+	if (fi.getConnectionID().fromHi == fs->initiatorFromHi) {
+		fs->pktsOrig++;
+	} else {
+		fs->pktsReply++;
+	}
+
+	lastFlow = *fs;
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	uint32_t clientIP = 0x0a000002;
+	uint32_t serverIP = 0x0a000001;
+	uint16_t clientPort = 40000;
+	uint16_t serverPort = 443;
+
+	// Both directions have to map to the same ID and hash
+	{
+		SamplePacket *fwd = getPkt(clientIP, serverIP, clientPort, serverPort);
+		SamplePacket *rev = getPkt(serverIP, clientIP, serverPort, clientPort);
+		Ident::ConnectionID fwdID = Ident::identify(fwd);
+		Ident::ConnectionID revID = Ident::identify(rev);
+
+		assert(fwdID == revID);
+		assert(Ident::Hasher()(fwdID) == Ident::Hasher()(revID));
+		assert(fwdID.fromHi != revID.fromHi);
+		assert(fwdID.getSrcIP() == htonl(clientIP));
+		assert(revID.getSrcIP() == htonl(serverIP));
+		assert(fwdID.getDstPort() == htons(serverPort));
+		assert(revID.getDstPort() == htons(clientPort));
+
+		delete fwd;
+		delete rev;
+	}
+
+	try {
+		SM sm;
+		sm.registerStartStateID(0, factory);
+		sm.registerFunction(0, runFlow);
+
+		SamplePacket **spArray = reinterpret_cast<SamplePacket **>(malloc(3 * sizeof(void *)));
+		spArray[0] = getPkt(clientIP, serverIP, clientPort, serverPort);
+		spArray[1] = getPkt(serverIP, clientIP, serverPort, clientPort);
+		spArray[2] = getPkt(clientIP, serverIP, clientPort, serverPort);
+
+		BufArray<SamplePacket> pktsIn(spArray, 3);
+		sm.runPktBatch(pktsIn);
+
+		// One entry serves both directions
+		assert(sm.getStateTableSize() == 1);
+		assert(lastFlow.pktsOrig == 2);
+		assert(lastFlow.pktsReply == 1);
+
+	} catch (exception *e) {
+		// Just catch whatever fails there may be
+		cout << endl << "FATAL:" << endl;
+		cout << e->what() << endl;
+
+		return 1;
+	}
+
+	cout << "Symmetric identifier test passed" << endl;
+
+	return 0;
+}
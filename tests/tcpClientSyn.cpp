@@ -0,0 +1,121 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "headers.hpp"
+#include "mbuf.hpp"
+#include "pktParser.hpp"
+#include "stateMachine.hpp"
+#include "tcpClient.hpp"
+
+using namespace std;
+
+using SM = StateMachine<TCP::Identifier, mbuf>;
+
+static constexpr uint32_t clientIP = 0x0a000001;
+static constexpr uint32_t serverIP = 0x0a000002;
+static constexpr uint16_t clientPort = 40000;
+static constexpr uint16_t serverPort = 80;
+
+// Process a batch of at most one packet, the packets sent are returned
+std::vector<struct rte_mbuf *> process(void *obj, struct rte_mbuf *pkt) {
+	unsigned int sbc, fbc;
+	void *ba = TCP_Client_process(obj, &pkt, pkt != nullptr ? 1 : 0, &sbc, &fbc);
+
+	std::vector<struct rte_mbuf *> sent(sbc);
+	std::vector<struct rte_mbuf *> freeBufs(fbc);
+	TCP_Client_getPkts(ba, sent.data(), freeBufs.data());
+	for (auto p : freeBufs) {
+		rte_pktmbuf_free(p);
+	}
+	return sent;
+}
+
+// Check, that pkt is the SYN of the connection, and get its sequence number
+uint32_t checkSyn(struct rte_mbuf *pkt) {
+	PktParser::Result res;
+	assert(PktParser::parse(reinterpret_cast<mbuf *>(pkt), res));
+	auto ipv4 = PktParser::getIPv4(reinterpret_cast<mbuf *>(pkt));
+	auto tcp = PktParser::getTcp(reinterpret_cast<mbuf *>(pkt));
+	assert(ipv4->getSrcIP() == clientIP);
+	assert(tcp->getSrcPort() == clientPort);
+	assert(tcp->getSynFlag() && !tcp->getAckFlag());
+	return tcp->getSeq();
+}
+
+// Turn the SYN into the SYN ACK of the server
+void makeSynAck(struct rte_mbuf *pkt) {
+	auto ipv4 = PktParser::getIPv4(reinterpret_cast<mbuf *>(pkt));
+	auto tcp = PktParser::getTcp(reinterpret_cast<mbuf *>(pkt));
+	ipv4->setSrcIP(serverIP);
+	ipv4->setDstIP(clientIP);
+	tcp->setSrcPort(serverPort);
+	tcp->setDstPort(clientPort);
+	tcp->setAck(tcp->getSeq() + 1);
+	tcp->setSeq(5000);
+	tcp->setAckFlag();
+}
+
+int main(int argc, char **argv) {
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		cout << "FATAL: cannot init EAL" << endl;
+		return 1;
+	}
+
+	rte_mempool *mempool = rte_pktmbuf_pool_create(
+		"tcpClientSyn pool", 1023, 0, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	assert(mempool != nullptr);
+
+	// The connection is opened by one client, the SYN ACK arrives at the other
+	SM::ConnectionPool connPool;
+	void *connector = TCP_Client_init(mempool);
+	void *reflector = TCP_Client_init(mempool);
+	reinterpret_cast<SM *>(connector)->setConnectionPool(&connPool);
+	reinterpret_cast<SM *>(reflector)->setConnectionPool(&connPool);
+
+	struct rte_mbuf *pkt = rte_pktmbuf_alloc(mempool);
+	unsigned int sbc, fbc;
+	void *ba = TCP_Client_connect(
+		connector, &pkt, 1, &sbc, &fbc, clientIP, serverIP, clientPort, serverPort, 10, 10);
+	assert((sbc == 1) && (fbc == 0));
+	struct rte_mbuf *syn;
+	TCP_Client_getPkts(ba, &syn, nullptr);
+	uint32_t isn = checkSyn(syn);
+	rte_pktmbuf_free(syn);
+
+	// Nothing is sent before the RTO expired
+	assert(process(connector, nullptr).empty());
+
+	// The SYN is sent again, the connection stays in the pool
+	std::this_thread::sleep_for(TcpRto::initialRto() + std::chrono::milliseconds(100));
+	std::vector<struct rte_mbuf *> sent = process(connector, nullptr);
+	assert(sent.size() == 1);
+	assert(checkSyn(sent[0]) == isn);
+	assert(reinterpret_cast<SM *>(connector)->getStateTableSize() == 0);
+
+	// The other client takes the connection with the SYN ACK, and sends the request
+	makeSynAck(sent[0]);
+	sent = process(reflector, sent[0]);
+	assert(sent.size() == 1);
+	assert(PktParser::getTcp(reinterpret_cast<mbuf *>(sent[0]))->getSeq() == isn + 1);
+	rte_pktmbuf_free(sent[0]);
+	assert(reinterpret_cast<SM *>(reflector)->getStateTableSize() == 1);
+
+	// The timeout of the connector is void now
+	std::this_thread::sleep_for(2 * TcpRto::initialRto() + std::chrono::milliseconds(100));
+	assert(process(connector, nullptr).empty());
+	assert(reinterpret_cast<SM *>(connector)->getStateTableSize() == 0);
+
+	TCP_Client_free(connector);
+	TCP_Client_free(reflector);
+
+	cout << "TCP client SYN test passed" << endl;
+	return 0;
+}
@@ -0,0 +1,138 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#include "tcpConCtlCubic.hpp"
+#include "tcpConCtlNewReno.hpp"
+#include "tcpRto.hpp"
+
+using namespace std;
+
+static constexpr uint32_t mss = 1000;
+static constexpr uint32_t isn = 0xfffff000;
+
+// Run a loss in the middle of 20 segments in flight through the congestion control
+template <class ConCtl> void testLoss(ConCtl &cc, uint32_t expectedSsthresh) {
+	auto now = std::chrono::steady_clock::now();
+	uint32_t seq;
+
+	cc.init(isn, mss);
+	assert(cc.getConWindow() == 10 * mss);
+	assert(!cc.reset(seq));
+
+	// Slow start, one segment per ACK
+	uint32_t sndMax = isn + 20 * mss;
+	for (uint32_t i = 1; i <= 5; i++) {
+		cc.handleAck(isn + i * mss, mss, sndMax, now);
+	}
+	assert(cc.getConWindow() == 15 * mss);
+
+	// The 6th segment was lost, two duplicates are no loss yet
+	uint32_t una = isn + 5 * mss;
+	cc.handleAck(una, 0, sndMax, now);
+	cc.handleAck(una, 0, sndMax, now);
+	assert(!cc.reset(seq));
+
+	// The third duplicate starts fast recovery
+	cc.handleAck(una, 0, sndMax, now);
+	assert(cc.reset(seq));
+	assert(seq == una);
+	assert(!cc.reset(seq));
+	assert(cc.getSsthresh() == expectedSsthresh);
+	assert(cc.getConWindow() == expectedSsthresh + 3 * mss);
+
+	// Further duplicates inflate the window
+	cc.handleAck(una, 0, sndMax, now);
+	assert(cc.getConWindow() == expectedSsthresh + 4 * mss);
+
+	// A partial ACK retransmits the next hole
+	sndMax = isn + 24 * mss;
+	cc.handleAck(isn + 10 * mss, 5 * mss, sndMax, now);
+	assert(cc.reset(seq));
+	assert(seq == isn + 10 * mss);
+
+	// The full ACK ends recovery, without another retransmission
+	cc.handleAck(isn + 20 * mss, 10 * mss, sndMax, now);
+	assert(!cc.reset(seq));
+	assert(cc.getConWindow() <= expectedSsthresh);
+
+	// Congestion avoidance grows the window again
+	uint32_t cwnd = cc.getConWindow();
+	for (uint32_t i = 21; i <= 60; i++) {
+		cc.handleAck(isn + i * mss, mss, isn + (i + 10) * mss, now);
+	}
+	assert(cc.getConWindow() > cwnd);
+	assert(cc.getConWindow() < cwnd + 40 * mss);
+}
+
+// A timeout falls back to one segment, and reduces ssthresh only once
+template <class ConCtl> void testTimeout(ConCtl &cc) {
+	auto now = std::chrono::steady_clock::now();
+	uint32_t seq;
+
+	cc.init(isn, mss);
+	uint32_t sndMax = isn + 10 * mss;
+	cc.handleTimeout(sndMax);
+	assert(cc.getConWindow() == mss);
+	uint32_t ssthresh = cc.getSsthresh();
+	assert(ssthresh < 10 * mss);
+
+	cc.handleTimeout(sndMax);
+	assert(cc.getConWindow() == mss);
+	assert(cc.getSsthresh() == ssthresh);
+
+	// Duplicates of data sent before the timeout do not start fast recovery
+	cc.handleAck(isn, 0, sndMax, now);
+	cc.handleAck(isn, 0, sndMax, now);
+	cc.handleAck(isn, 0, sndMax, now);
+	assert(!cc.reset(seq));
+
+	// Slow start again
+	cc.handleAck(isn + mss, mss, sndMax, now);
+	assert(cc.getConWindow() == 2 * mss);
+}
+
+void testRto() {
+	using namespace std::chrono;
+	TcpRto rto;
+	assert(rto.get() == TcpRto::initialRto());
+
+	// Short RTTs are clamped to the minimum
+	rto.sample(microseconds(1000));
+	assert(rto.getSrtt() == microseconds(1000));
+	assert(rto.get() == TcpRto::minRto());
+
+	// SRTT + 4 * RTTVAR
+	TcpRto slow;
+	slow.sample(milliseconds(400));
+	assert(slow.get() == milliseconds(1200));
+	slow.sample(milliseconds(400));
+	assert(slow.get() == milliseconds(1000));
+
+	// Backoff doubles up to the maximum
+	for (int i = 0; i < 10; i++) {
+		slow.backoff();
+	}
+	assert(slow.get() == TcpRto::maxRto());
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	// NewReno halves the flight size of 15 segments, CUBIC reduces it to 0.7
+	TcpConCtlNewReno newReno;
+	testLoss(newReno, 7500);
+
+	TcpConCtlCubic cubic;
+	testLoss(cubic, 15 * mss * 716 / 1024);
+
+	testTimeout(newReno);
+	testTimeout(cubic);
+	testRto();
+
+	cout << "TCP congestion control test passed" << endl;
+
+	return 0;
+}
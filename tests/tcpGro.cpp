@@ -0,0 +1,151 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include <rte_eal.h>
+
+#include "headers.hpp"
+#include "mbuf.hpp"
+#include "pktParser.hpp"
+#include "tcpGro.hpp"
+
+using namespace std;
+
+static rte_mempool *mempool;
+
+/* Build a TCP segment of 10.0.0.1:<srcPort> to 10.0.0.2:80
+ * The payload holds the lower bytes of its sequence numbers
+ */
+mbuf *getPkt(uint16_t srcPort, uint32_t seq, uint16_t len, uint8_t flags = 0x10) {
+	mbuf *pkt = reinterpret_cast<mbuf *>(rte_pktmbuf_alloc(mempool));
+	uint16_t headersLen = sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Tcp);
+	uint8_t *data = reinterpret_cast<uint8_t *>(pkt->getData());
+	memset(data, 0, headersLen);
+
+	auto eth = reinterpret_cast<Headers::Ethernet *>(data);
+	eth->ethertype = htons(Headers::Ethernet::ETHERTYPE_IPv4);
+
+	auto ip = reinterpret_cast<Headers::IPv4 *>(data + sizeof(Headers::Ethernet));
+	ip->setVersion();
+	ip->setIHL(5);
+	ip->setProtoTCP();
+	ip->setSrcIP(0x0a000001);
+	ip->setDstIP(0x0a000002);
+	ip->setPayloadLength(sizeof(Headers::Tcp) + len);
+
+	auto tcp = reinterpret_cast<Headers::Tcp *>(ip->getPayload());
+	tcp->setSrcPort(srcPort);
+	tcp->setDstPort(80);
+	tcp->setOffset(5);
+	tcp->setSeq(seq);
+	tcp->setAck(1000);
+	tcp->setWindow(0xffff);
+	tcp->flags = flags;
+
+	for (uint16_t i = 0; i < len; i++) {
+		data[headersLen + i] = static_cast<uint8_t>(seq + i);
+	}
+	pkt->setDataLen(headersLen + len);
+	return pkt;
+}
+
+// Check, that the chain of pkt holds the bytes [seq, seq + len)
+void checkPayload(mbuf *pkt, uint32_t seq, uint32_t len) {
+	assert(pkt->pkt_len == PktParser::getHeadersLen(pkt) + len);
+	assert(PktParser::getIPv4(pkt)->getPayloadLength() == sizeof(Headers::Tcp) + len);
+	assert(PktParser::getTcp(pkt)->getSeq() == seq);
+
+	uint8_t *data = PktParser::getPayload(pkt);
+	uint16_t left = pkt->getDataLen() - PktParser::getHeadersLen(pkt);
+	for (uint32_t i = 0; i < len; i++) {
+		while (left == 0) {
+			pkt = static_cast<mbuf *>(pkt->next);
+			data = reinterpret_cast<uint8_t *>(pkt->getData());
+			left = pkt->getDataLen();
+		}
+		assert(*data == static_cast<uint8_t>(seq + i));
+		data++;
+		left--;
+	}
+	assert(pkt->next == nullptr);
+}
+
+int main(int argc, char **argv) {
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		cout << "FATAL: cannot init EAL" << endl;
+		return 1;
+	}
+
+	mempool = rte_pktmbuf_pool_create(
+		"tcpGro pool", 1023, 0, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	assert(mempool != nullptr);
+
+	{
+		// Two connections interleaved, the second one with PSH in the middle
+		mbuf *pkts[] = {getPkt(1, 100, 10), getPkt(2, 500, 10), getPkt(1, 110, 20),
+			getPkt(2, 510, 10, 0x18), getPkt(1, 130, 5), getPkt(2, 520, 10)};
+		assert(TcpGro::coalesce(pkts, 6) == 3);
+
+		checkPayload(pkts[0], 100, 35);
+		assert(pkts[0]->nb_segs == 3);
+		checkPayload(pkts[1], 500, 20);
+		assert(PktParser::getTcp(pkts[1])->flags == 0x18);
+		checkPayload(pkts[2], 520, 10);
+
+		// The segments are taken apart again as runEst() does it
+		mbuf *rest = pkts[0]->splitNext();
+		assert((pkts[0]->nb_segs == 1) && (pkts[0]->next == nullptr));
+		assert((rest->nb_segs == 2) && (rest->pkt_len == 25));
+		mbuf *last = rest->splitNext();
+		assert((rest->pkt_len == 20) && (last->pkt_len == 5));
+		last->release();
+		rest->release();
+
+		for (unsigned int i = 0; i < 3; i++) {
+			pkts[i]->release();
+		}
+	}
+
+	{
+		// Holes, retransmissions, other flags and empty segments are not merged
+		mbuf *pkts[] = {getPkt(1, 100, 10), getPkt(1, 120, 10), getPkt(1, 120, 10),
+			getPkt(1, 130, 0), getPkt(1, 130, 10, 0x11), getPkt(1, 140, 10), getPkt(1, 150, 10)};
+		mbuf *orig[7];
+		memcpy(orig, pkts, sizeof(pkts));
+		assert(TcpGro::coalesce(pkts, 7) == 6);
+
+		// Only the last segment was merged, the order is kept
+		for (unsigned int i = 0; i < 6; i++) {
+			assert(pkts[i] == orig[i]);
+		}
+		checkPayload(pkts[5], 140, 20);
+
+		for (unsigned int i = 0; i < 6; i++) {
+			pkts[i]->release();
+		}
+	}
+
+	{
+		// With more connections than tracked, the oldest one is replaced
+		const unsigned int numPkts = TcpGro::maxFlows + 3;
+		mbuf *pkts[numPkts];
+		for (unsigned int i = 0; i <= TcpGro::maxFlows; i++) {
+			pkts[i] = getPkt(i, 100, 10);
+		}
+		pkts[TcpGro::maxFlows + 1] = getPkt(TcpGro::maxFlows, 110, 10);
+		pkts[TcpGro::maxFlows + 2] = getPkt(0, 110, 10);
+		assert(TcpGro::coalesce(pkts, numPkts) == numPkts - 1);
+		checkPayload(pkts[TcpGro::maxFlows], 100, 20);
+		checkPayload(pkts[TcpGro::maxFlows + 1], 110, 10);
+
+		for (unsigned int i = 0; i < numPkts - 1; i++) {
+			pkts[i]->release();
+		}
+	}
+
+	cout << "TCP GRO test passed" << endl;
+	return 0;
+}
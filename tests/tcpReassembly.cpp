@@ -0,0 +1,170 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+#include "headers.hpp"
+#include "tcpOptions.hpp"
+#include "tcpReassembly.hpp"
+
+using namespace std;
+
+// Reference counted buffer, as the reassembly queue expects it
+struct TestPkt {
+	static int alive;
+	int refcnt = 1;
+	uint8_t data[100];
+
+	TestPkt() { alive++; }
+	~TestPkt() { alive--; }
+
+	void ref() { refcnt++; }
+	void release() {
+		if (--refcnt == 0) {
+			delete this;
+		}
+	}
+};
+
+int TestPkt::alive = 0;
+
+// Queue a segment of the given bytes, the payload holds the sequence numbers
+static bool insert(TcpReassembly<TestPkt> &queue, uint32_t rcvNxt, uint32_t seq, uint16_t len) {
+	TestPkt *pkt = new TestPkt();
+	for (uint16_t i = 0; i < len; i++) {
+		pkt->data[i] = static_cast<uint8_t>(seq + i);
+	}
+	bool queued = queue.insert(rcvNxt, pkt, pkt->data, seq, len);
+	// The receive path drops its own reference
+	pkt->release();
+	return queued;
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	{
+		// Start close to the end of the sequence number space
+		uint32_t rcvNxt = 0xffffffc0;
+		TcpReassembly<TestPkt> queue;
+		TcpOptions::SackBlock blocks[TcpOptions::maxSackBlocks];
+
+		// Old data is not queued
+		assert(!insert(queue, rcvNxt, rcvNxt - 100, 100));
+		assert(queue.empty());
+
+		// Three holes, across the wrap of the sequence numbers
+		assert(insert(queue, rcvNxt, rcvNxt + 100, 50));
+		assert(insert(queue, rcvNxt, rcvNxt + 300, 50));
+		assert(insert(queue, rcvNxt, rcvNxt + 200, 50));
+		assert(insert(queue, rcvNxt, rcvNxt + 150, 50));
+		assert(queue.getNumSegments() == 4);
+		assert(TestPkt::alive == 4);
+
+		// Duplicates are not queued, overlaps are cut off
+		assert(!insert(queue, rcvNxt, rcvNxt + 100, 50));
+		assert(insert(queue, rcvNxt, rcvNxt + 240, 30));
+		assert(queue.getNumSegments() == 5);
+
+		// The most recent block first, then from the top down
+		assert(queue.getSackBlocks(blocks, 3) == 2);
+		assert(blocks[0].left == rcvNxt + 100);
+		assert(blocks[0].right == rcvNxt + 270);
+		assert(blocks[1].left == rcvNxt + 300);
+		assert(blocks[1].right == rcvNxt + 350);
+
+		assert(queue.getSackBlocks(blocks, 1) == 1);
+		assert(blocks[0].left == rcvNxt + 100);
+
+		// Nothing in order yet
+		TcpReassembly<TestPkt>::Segment seg;
+		assert(!queue.pop(rcvNxt, seg));
+
+		// Segment [0, 120) arrived in order, the queued data follows it
+		rcvNxt += 120;
+		assert(queue.pop(rcvNxt, seg));
+		assert(seg.seq == rcvNxt);
+		assert(seg.len == 30);
+		assert(seg.data[0] == static_cast<uint8_t>(rcvNxt));
+		seg.pkt->release();
+		rcvNxt += seg.len;
+
+		while (queue.pop(rcvNxt, seg)) {
+			assert(seg.seq == rcvNxt);
+			assert(seg.data[0] == static_cast<uint8_t>(rcvNxt));
+			rcvNxt += seg.len;
+			seg.pkt->release();
+		}
+		assert(rcvNxt == 0xffffffc0 + 270);
+		assert(queue.getNumSegments() == 1);
+		assert(TestPkt::alive == 1);
+
+		// The last segment is released with the queue
+	}
+	assert(TestPkt::alive == 0);
+
+	{
+		// The SACK option survives a round trip through a TCP header
+		uint8_t buf[sizeof(Headers::Tcp) + 40] = {};
+		auto tcp = reinterpret_cast<Headers::Tcp *>(buf);
+		TcpOptions::SackBlock blocks[2] = {{1000, 2000}, {0xfffffff0, 10}};
+
+		uint8_t len = TcpOptions::writeSack(
+			reinterpret_cast<uint8_t *>(tcp->getPayload()), blocks, 2);
+		assert(len == 20);
+		tcp->setOffset((sizeof(Headers::Tcp) + len) / 4);
+
+		TcpOptions::Parsed options;
+		TcpOptions::parse(tcp, options);
+		assert(!options.sackPermitted);
+		assert(options.numSackBlocks == 2);
+		assert(options.sackBlocks[1].left == 0xfffffff0);
+		assert(options.sackBlocks[1].right == 10);
+
+		len = TcpOptions::writeSackPermitted(reinterpret_cast<uint8_t *>(tcp->getPayload()));
+		tcp->setOffset((sizeof(Headers::Tcp) + len) / 4);
+		TcpOptions::Parsed synOptions;
+		TcpOptions::parse(tcp, synOptions);
+		assert(synOptions.sackPermitted);
+		assert(synOptions.numSackBlocks == 0);
+
+		// The options of a SYN with everything
+		uint8_t *opt = reinterpret_cast<uint8_t *>(tcp->getPayload());
+		len = TcpOptions::writeMss(opt, 1460);
+		len += TcpOptions::writeSackPermitted(opt + len);
+		len += TcpOptions::writeWscale(opt + len, 7);
+		len += TcpOptions::writeTimestamp(opt + len, 0xdeadbeef, 42);
+		assert(len == 24);
+		tcp->setOffset((sizeof(Headers::Tcp) + len) / 4);
+		TcpOptions::Parsed allOptions;
+		TcpOptions::parse(tcp, allOptions);
+		assert(allOptions.mss == 1460);
+		assert(allOptions.sackPermitted);
+		assert(allOptions.hasWscale && (allOptions.wscale == 7));
+		assert(allOptions.hasTimestamp);
+		assert(allOptions.tsVal == 0xdeadbeef);
+		assert(allOptions.tsEcr == 42);
+
+		// Segments after the SYN carry the timestamps in front of the SACK blocks
+		len = TcpOptions::writeTimestamp(opt, 1, 2);
+		len += TcpOptions::writeSack(opt + len, blocks, 2);
+		assert(len == 32);
+		tcp->setOffset((sizeof(Headers::Tcp) + len) / 4);
+		TcpOptions::Parsed estOptions;
+		TcpOptions::parse(tcp, estOptions);
+		assert(estOptions.hasTimestamp && (estOptions.tsEcr == 2));
+		assert(!estOptions.hasWscale);
+		assert(estOptions.numSackBlocks == 2);
+
+		// Shifts above 14 are cut
+		TcpOptions::writeWscale(opt, 15);
+		tcp->setOffset((sizeof(Headers::Tcp) + 4) / 4);
+		TcpOptions::Parsed bigShift;
+		TcpOptions::parse(tcp, bigShift);
+		assert(bigShift.wscale == TcpOptions::maxWscale);
+	}
+
+	cout << "TCP reassembly test passed" << endl;
+
+	return 0;
+}
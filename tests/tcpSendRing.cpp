@@ -0,0 +1,146 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+
+#include "tcpSendRing.hpp"
+
+using namespace std;
+
+// Reference counted buffer, as the send ring expects it
+struct TestPkt {
+	static int alive;
+	int refcnt = 1;
+
+	TestPkt() { alive++; }
+	~TestPkt() { alive--; }
+
+	void ref() { refcnt++; }
+	void release() {
+		if (--refcnt == 0) {
+			delete this;
+		}
+	}
+};
+
+int TestPkt::alive = 0;
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	{
+		// Start close to the end of the sequence number space
+		uint32_t isn = 0xffffff00;
+		TcpSendRing<TestPkt> ring;
+		ring.init(isn);
+
+		// 200 segments of 100 bytes, the ring has to grow
+		for (int i = 0; i < 200; i++) {
+			ring.push(new TestPkt(), 100);
+		}
+		assert(ring.getUnsent() == 20000);
+		assert(TestPkt::alive == 200);
+
+		// Segments are never split
+		TcpSendRing<TestPkt>::Segment seg;
+		assert(!ring.take(99, seg));
+		for (int i = 0; i < 50; i++) {
+			assert(ring.take(100, seg));
+			assert(seg.seq == isn + i * 100);
+			// Transmitting takes a reference, the NIC drops it again
+			seg.pkt->ref();
+			seg.pkt->release();
+		}
+		assert(ring.getInFlight() == 5000);
+		assert(ring.getMax() == isn + 5000);
+
+		// ACKs outside of the window are ignored
+		assert(ring.ack(isn - 5) == 0);
+		assert(ring.ack(isn + 30000) == 0);
+		assert(ring.ack(isn + 5100) == 0);
+
+		// Cumulative ACK, across the wrap of the sequence numbers
+		// The partially acknowledged segment is kept
+		assert(ring.ack(isn + 1050) == 1050);
+		assert(ring.getUna() == isn + 1050);
+		assert(ring.getNumSegments() == 190);
+		assert(TestPkt::alive == 190);
+
+		// Find single segments, without touching nxt
+		assert(ring.find(isn + 1050, seg));
+		assert(seg.seq == isn + 1000);
+		assert(ring.find(isn + 4999, seg));
+		assert(seg.seq == isn + 4900);
+		assert(!ring.find(isn + 5000, seg));
+		assert(!ring.find(isn + 1049, seg));
+		assert(ring.getNxt() == isn + 5000);
+
+		// Retransmit the segment holding isn + 2020
+		ring.rewind(isn + 2020);
+		assert(ring.getNxt() == isn + 2000);
+		assert(ring.take(100, seg));
+		assert(seg.seq == isn + 2000);
+
+		// Retransmit from the first unacknowledged byte
+		ring.rewind(isn);
+		assert(ring.getNxt() == isn + 1050);
+		assert(ring.getInFlight() == 0);
+		assert(ring.getMax() == isn + 5000);
+		assert(ring.take(100, seg));
+		assert(seg.seq == isn + 1000);
+
+		// An ACK for data sent before the rewind
+		assert(ring.ack(isn + 4000) == 2950);
+		assert(ring.getNxt() == isn + 4000);
+		assert(ring.take(100, seg));
+		assert(seg.seq == isn + 4000);
+
+		// The remaining segments are released with the ring
+	}
+	assert(TestPkt::alive == 0);
+
+	{
+		// SACK scoreboard, 10 segments of 100 bytes in flight
+		TcpSendRing<TestPkt> ring;
+		ring.init(0);
+		TcpSendRing<TestPkt>::Segment seg;
+		for (int i = 0; i < 10; i++) {
+			ring.push(new TestPkt(), 100);
+			assert(ring.take(100, seg));
+		}
+
+		// Only segments covered completely are marked
+		assert(ring.sack(150, 300) == 1);
+		assert(ring.sack(200, 300) == 0);
+		assert(!ring.nextLost(seg));
+
+		// Segments 0 and 1 have three SACKed segments above them, 3 only two
+		// Every lost segment is returned once
+		assert(ring.sack(400, 600) == 2);
+		assert(ring.getSackedSegments() == 3);
+		assert(ring.nextLost(seg));
+		assert(seg.seq == 0);
+		assert(ring.nextLost(seg));
+		assert(seg.seq == 100);
+		assert(!ring.nextLost(seg));
+
+		assert(ring.sack(800, 900) == 1);
+		assert(ring.nextLost(seg));
+		assert(seg.seq == 300);
+		assert(!ring.nextLost(seg));
+
+		// The cumulative ACK releases SACKed segments as well
+		assert(ring.ack(500) == 500);
+		assert(ring.getSackedSegments() == 2);
+
+		// A timeout clears the scoreboard
+		ring.rewind(500);
+		assert(ring.getSackedSegments() == 0);
+		assert(!ring.nextLost(seg));
+	}
+	assert(TestPkt::alive == 0);
+
+	cout << "TCP send ring test passed" << endl;
+
+	return 0;
+}
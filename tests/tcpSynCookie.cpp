@@ -0,0 +1,208 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <rte_eal.h>
+
+#include "headers.hpp"
+#include "mbuf.hpp"
+#include "pktParser.hpp"
+#include "stateMachine.hpp"
+#include "tcp.hpp"
+#include "tcpConCtlSimple.hpp"
+#include "tcpOptions.hpp"
+#include "tcpProtoJoke.hpp"
+#include "tcpSynCookie.hpp"
+
+using namespace std;
+
+using ProtoJoke = TcpProtoJoke<TcpConCtlSimple>;
+using ServerJoke = TCP::Server<ProtoJoke, TcpConCtlSimple>;
+using SM = StateMachine<TCP::Identifier, mbuf>;
+
+static constexpr uint32_t peerIP = 0x0a000001;
+static constexpr uint32_t localIP = 0x0a000002;
+static constexpr uint16_t peerPort = 40000;
+static constexpr uint16_t localPort = 80;
+
+static rte_mempool *mempool;
+
+// Build a segment of the peer, the SYN offers the window scale and maybe a timestamp
+mbuf *getPkt(uint32_t seq, uint32_t ack, bool syn, bool wscale, bool timestamp) {
+	mbuf *pkt = reinterpret_cast<mbuf *>(rte_pktmbuf_alloc(mempool));
+	uint8_t *data = reinterpret_cast<uint8_t *>(pkt->getData());
+	memset(data, 0, sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Tcp));
+
+	auto eth = reinterpret_cast<Headers::Ethernet *>(data);
+	eth->setEthertype(Headers::Ethernet::ETHERTYPE_IPv4);
+
+	auto ip = reinterpret_cast<Headers::IPv4 *>(eth->getPayload());
+	ip->setVersion();
+	ip->setIHL(5);
+
+	auto tcp = reinterpret_cast<Headers::Tcp *>(ip->getPayload());
+	uint8_t *opt = reinterpret_cast<uint8_t *>(tcp->getPayload());
+	uint8_t optionsLen = 0;
+	if (syn) {
+		optionsLen += TcpOptions::writeMss(opt, 1460);
+		if (wscale) {
+			optionsLen += TcpOptions::writeWscale(opt + optionsLen, 7);
+		}
+	}
+	if (timestamp) {
+		optionsLen += TcpOptions::writeTimestamp(opt + optionsLen, 1, 0);
+	}
+
+	ip->ttl = 64;
+	ip->setProtoTCP();
+	ip->setSrcIP(peerIP);
+	ip->setDstIP(localIP);
+	ip->setPayloadLength(sizeof(Headers::Tcp) + optionsLen);
+
+	tcp->setSrcPort(peerPort);
+	tcp->setDstPort(localPort);
+	tcp->setOffset((sizeof(Headers::Tcp) + optionsLen) / 4);
+	tcp->setSeq(seq);
+	tcp->setAck(ack);
+	tcp->setWindow(0xffff);
+	if (syn) {
+		tcp->setSynFlag();
+	} else {
+		tcp->setAckFlag();
+	}
+
+	pkt->setDataLen(sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Tcp) +
+		optionsLen);
+	return pkt;
+}
+
+// Run one packet through the server, the packets it sends are returned
+std::vector<mbuf *> runPkt(SM &sm, mbuf *pkt) {
+	mbuf **pkts = reinterpret_cast<mbuf **>(malloc(sizeof(mbuf *)));
+	pkts[0] = pkt;
+	BufArray<mbuf> pktsBA(pkts, 1);
+	sm.runPktBatch(pktsBA);
+
+	std::vector<mbuf *> sent(pktsBA.getSendCount());
+	pktsBA.getSendBufs(sent.data());
+	std::vector<mbuf *> freeBufs(pktsBA.getFreeCount());
+	pktsBA.getFreeBufs(freeBufs.data());
+	for (auto p : freeBufs) {
+		p->release();
+	}
+	return sent;
+}
+
+/* The cookie handshake of a peer offering the window scale
+ *
+ * Without a timestamp, the window scale does not survive the cookie. The SYN
+ * ACK must not offer it then, or the peer would scale, and we would not.
+ */
+void testCookieWscale(bool timestamp) {
+	SM sm;
+	sm.registerGetPktCB(
+		[]() { return reinterpret_cast<mbuf *>(rte_pktmbuf_alloc(mempool)); });
+	sm.registerEndStateID(TCP::States::END);
+	sm.registerStartStateID(TCP::States::syn_ack, ServerJoke::factory);
+	sm.registerPreAcceptFunction(ServerJoke::preAccept);
+	sm.registerFunction(TCP::States::syn_ack, ServerJoke::runSynAck);
+	sm.registerFunction(TCP::States::est, ServerJoke::runEst);
+	sm.registerFunction(TCP::States::fin, ServerJoke::runFin);
+	sm.registerFunction(TCP::States::ack_fin, ServerJoke::runAckFin);
+
+	uint32_t isn = 1000;
+	std::vector<mbuf *> sent = runPkt(sm, getPkt(isn, 0, true, true, timestamp));
+	assert(sent.size() == 1);
+	assert(sm.getStateTableSize() == 0);
+
+	PktParser::Result res;
+	assert(PktParser::parse(sent[0], res));
+	auto tcp = PktParser::getTcp(sent[0]);
+	assert(tcp->getSynFlag() && tcp->getAckFlag());
+	TcpOptions::Parsed options;
+	TcpOptions::parse(tcp, options);
+	assert(options.hasWscale == timestamp);
+	assert(options.hasTimestamp == timestamp);
+	uint32_t cookie = tcp->getSeq();
+	uint32_t tsVal = options.tsVal;
+	sent[0]->release();
+
+	// The ACK returning the cookie creates the connection
+	mbuf *ack = getPkt(isn + 1, cookie + 1, false, false, timestamp);
+	if (timestamp) {
+		auto ackTcp = reinterpret_cast<Headers::Tcp *>(
+			reinterpret_cast<uint8_t *>(ack->getData()) + sizeof(Headers::Ethernet) +
+			sizeof(Headers::IPv4));
+		TcpOptions::writeTimestamp(reinterpret_cast<uint8_t *>(ackTcp->getPayload()), 2, tsVal);
+	}
+	for (auto p : runPkt(sm, ack)) {
+		p->release();
+	}
+	assert(sm.getStateTableSize() == 1);
+}
+
+int main(int argc, char **argv) {
+	int ret = rte_eal_init(argc, argv);
+	if (ret < 0) {
+		cout << "FATAL: cannot init EAL" << endl;
+		return 1;
+	}
+
+	mempool = rte_pktmbuf_pool_create(
+		"tcpSynCookie pool", 1023, 0, 0, 2048 + RTE_PKTMBUF_HEADROOM, rte_socket_id());
+	assert(mempool != nullptr);
+
+	auto now = std::chrono::steady_clock::now();
+	uint32_t isn = 0xfffffffe;
+	uint16_t mss;
+	bool sack;
+
+	// The cookie holds the MSS rounded down to the table, and the SACK flag
+	uint32_t cookie =
+		TcpSynCookie::make(peerIP, localIP, peerPort, localPort, isn, 1450, true, now);
+	assert(TcpSynCookie::check(peerIP, localIP, peerPort, localPort, isn, cookie, mss, sack, now));
+	assert(mss == 1440);
+	assert(sack);
+
+	cookie = TcpSynCookie::make(peerIP, localIP, peerPort, localPort, isn, 100, false, now);
+	assert(TcpSynCookie::check(peerIP, localIP, peerPort, localPort, isn, cookie, mss, sack, now));
+	assert(mss == 536);
+	assert(!sack);
+
+	cookie = TcpSynCookie::make(peerIP, localIP, peerPort, localPort, isn, 9000, true, now);
+
+	// Another connection, or a tampered cookie, are rejected
+	assert(!TcpSynCookie::check(
+		peerIP + 1, localIP, peerPort, localPort, isn, cookie, mss, sack, now));
+	assert(!TcpSynCookie::check(
+		peerIP, localIP, peerPort + 1, localPort, isn, cookie, mss, sack, now));
+	assert(!TcpSynCookie::check(
+		peerIP, localIP, peerPort, localPort, isn + 1, cookie, mss, sack, now));
+	assert(!TcpSynCookie::check(
+		peerIP, localIP, peerPort, localPort, isn, cookie ^ (1 << 24), mss, sack, now));
+	assert(!TcpSynCookie::check(
+		peerIP, localIP, peerPort, localPort, isn, cookie ^ 1, mss, sack, now));
+
+	// The cookie is valid for maxAge ticks of 64 seconds
+	auto later = now + std::chrono::seconds(64 * TcpSynCookie::maxAge);
+	assert(TcpSynCookie::check(
+		peerIP, localIP, peerPort, localPort, isn, cookie, mss, sack, later));
+	assert(mss == 1460);
+	later += std::chrono::seconds(64);
+	assert(!TcpSynCookie::check(
+		peerIP, localIP, peerPort, localPort, isn, cookie, mss, sack, later));
+
+	// Cookies from the future are not accepted either
+	assert(!TcpSynCookie::check(peerIP, localIP, peerPort, localPort, isn, cookie, mss, sack,
+		now - std::chrono::seconds(64)));
+
+	testCookieWscale(true);
+	testCookieWscale(false);
+
+	cout << "TCP SYN cookie test passed" << endl;
+
+	return 0;
+}
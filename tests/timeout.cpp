@@ -126,6 +126,35 @@ void fun2(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
 	*(reinterpret_cast<uint32_t *>(pktIn->getData())) = 24;
 }
 
+uint32_t timeoutPkts = 0;
+
+// A timeout without a packet sends one of its own
+void timeoutSend(SM::State &state, SM::FunIface &fi) {
+	(void)state;
+	cout << "timeoutSend() sending a packet" << endl;
+	*(reinterpret_cast<uint32_t *>(fi.getPkt()->getData())) = 42;
+	timeoutPkts++;
+	fi.transition(3);
+}
+
+// The packet holds the timeout in milliseconds
+void funDelay(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
+	(void)state;
+	uint32_t delay = *(reinterpret_cast<uint32_t *>(pktIn->getData()));
+	fi.setTimeout(std::chrono::milliseconds(delay), timeoutSend);
+}
+
+// The packet holds the timeout in microseconds, 0 is a deadline passed already
+void funPrecise(SM::State &state, SamplePacket *pktIn, SM::FunIface &fi) {
+	(void)state;
+	uint32_t delay = *(reinterpret_cast<uint32_t *>(pktIn->getData()));
+	if (delay == 0) {
+		fi.setTimeout(std::chrono::steady_clock::now() - std::chrono::seconds(1), timeoutSend);
+	} else {
+		fi.setTimeout(std::chrono::microseconds(delay), timeoutSend);
+	}
+}
+
 int main(int argc, char **argv) {
 	(void)argc;
 	(void)argv;
@@ -180,6 +209,64 @@ int main(int argc, char **argv) {
 		// Check if the timeout funtion was used
 		assert(timeoutFunctionUsed);
 
+		// The nearest timeout runs first, even if a later one was set before
+		SM smDelay;
+		smDelay.registerStartStateID(1, nullptr);
+		smDelay.registerEndStateID(3);
+		smDelay.registerFunction(1, funDelay);
+		smDelay.registerGetPktCB(getPkt);
+
+		SamplePacket **delayArray = reinterpret_cast<SamplePacket **>(malloc(sizeof(void *) * 2));
+		delayArray[0] = getPkt();
+		delayArray[1] = getPkt();
+		*(reinterpret_cast<uint32_t *>(delayArray[0]->getData())) = 1000;
+		*(reinterpret_cast<uint32_t *>(delayArray[1]->getData())) = 50;
+		BufArray<SamplePacket> delayPkts(delayArray, 2);
+		smDelay.runPktBatch(delayPkts);
+		assert(smDelay.getStateTableSize() == 2);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(150));
+
+		// Timeouts run with an empty batch, and send packets through getPkt()
+		SamplePacket **emptyArray = reinterpret_cast<SamplePacket **>(malloc(sizeof(void *)));
+		BufArray<SamplePacket> emptyPkts(emptyArray, 0);
+		smDelay.runPktBatch(emptyPkts);
+		assert(timeoutPkts == 1);
+		assert(smDelay.getStateTableSize() == 1);
+		assert(emptyPkts.getTotalCount() == 1);
+		assert(emptyPkts.getSendCount() == 1);
+		assert(*(reinterpret_cast<uint32_t *>(emptyPkts[0]->getData())) == 42);
+
+		// Timeouts of other precisions, or deadlines, are rounded up to milliseconds
+		SM smPrecise;
+		smPrecise.registerStartStateID(1, nullptr);
+		smPrecise.registerEndStateID(3);
+		smPrecise.registerFunction(1, funPrecise);
+		smPrecise.registerGetPktCB(getPkt);
+
+		SamplePacket **preciseArray =
+			reinterpret_cast<SamplePacket **>(malloc(sizeof(void *) * 2));
+		preciseArray[0] = getPkt();
+		preciseArray[1] = getPkt();
+		*(reinterpret_cast<uint32_t *>(preciseArray[0]->getData())) = 50500;
+		*(reinterpret_cast<uint32_t *>(preciseArray[1]->getData())) = 0;
+		BufArray<SamplePacket> precisePkts(preciseArray, 2);
+		smPrecise.runPktBatch(precisePkts);
+
+		// The deadline passed already, the timeout runs with the next batch
+		SamplePacket **dueArray = reinterpret_cast<SamplePacket **>(malloc(sizeof(void *)));
+		BufArray<SamplePacket> duePkts(dueArray, 0);
+		smPrecise.runPktBatch(duePkts);
+		assert(timeoutPkts == 2);
+		assert(smPrecise.getStateTableSize() == 1);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		SamplePacket **laterArray = reinterpret_cast<SamplePacket **>(malloc(sizeof(void *)));
+		BufArray<SamplePacket> laterPkts(laterArray, 0);
+		smPrecise.runPktBatch(laterPkts);
+		assert(timeoutPkts == 3);
+		assert(smPrecise.getStateTableSize() == 0);
+
 	} catch (exception *e) {
 		// Just catch whatever fails there may be
 		cout << endl << "FATAL:" << endl;
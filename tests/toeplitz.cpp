@@ -0,0 +1,132 @@
+#include <arpa/inet.h>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "IPv4_5TupleRssIdent.hpp"
+#include "headers.hpp"
+#include "samplePacket.hpp"
+#include "toeplitz.hpp"
+
+using namespace std;
+
+// Verification vectors from the Microsoft RSS specification (default key)
+struct TestVector {
+	const char *dstIP;
+	uint16_t dstPort;
+	const char *srcIP;
+	uint16_t srcPort;
+	uint32_t hashIPv4Only;
+	uint32_t hashIPv4TcpUdp;
+};
+
+static const TestVector vectors[] = {
+	{"161.142.100.80", 1766, "66.9.149.187", 2794, 0x323e8fc2, 0x51ccc178},
+	{"65.69.140.83", 4739, "199.92.111.2", 14230, 0xd718262a, 0xc626b0ea},
+	{"12.22.207.184", 38024, "24.19.198.95", 12898, 0xd2d0a5de, 0x5c2b394a},
+	{"209.142.163.6", 2217, "38.27.205.30", 48228, 0x82989176, 0xafc7327f},
+	{"202.188.127.2", 1303, "153.39.163.191", 44251, 0x5d1809c5, 0x10e828a2},
+};
+
+// Build a UDP packet for the given 5-tuple (network byte order)
+SamplePacket *getPkt(uint32_t srcIP, uint32_t dstIP, uint16_t srcPort, uint16_t dstPort) {
+	uint16_t dataLen = sizeof(Headers::Ethernet) + sizeof(Headers::IPv4) + sizeof(Headers::Udp);
+	void *data = malloc(dataLen);
+	memset(data, 0, dataLen);
+
+	auto ether = reinterpret_cast<Headers::Ethernet *>(data);
+	auto ip = reinterpret_cast<Headers::IPv4 *>(ether->getPayload());
+	ip->setVersion();
+	ip->setIHL(5);
+	auto udp = reinterpret_cast<Headers::Udp *>(ip->getPayload());
+
+	ether->setEthertype(0x0800);
+	ip->proto = Headers::IPv4::PROTO_UDP;
+	ip->srcIP = srcIP;
+	ip->dstIP = dstIP;
+	udp->srcPort = srcPort;
+	udp->dstPort = dstPort;
+
+	return new SamplePacket(data, dataLen);
+}
+
+int main(int argc, char **argv) {
+	(void)argc;
+	(void)argv;
+
+	using Ident = IPv4_5TupleRssIdent<SamplePacket>;
+
+	for (auto &v : vectors) {
+		uint32_t srcIP, dstIP;
+		assert(inet_pton(AF_INET, v.srcIP, &srcIP) == 1);
+		assert(inet_pton(AF_INET, v.dstIP, &dstIP) == 1);
+		uint16_t srcPort = htons(v.srcPort);
+		uint16_t dstPort = htons(v.dstPort);
+
+		// IPv4 only, using the generic function
+		uint8_t input[8];
+		memcpy(input, &srcIP, 4);
+		memcpy(input + 4, &dstIP, 4);
+		uint32_t hashIP = Toeplitz::hash(input, sizeof(input));
+
+		// IPv4 + ports, using the table driven function
+		uint32_t hashTuple = Toeplitz::hashIPv4(srcIP, dstIP, srcPort, dstPort);
+
+		cout << v.srcIP << " -> " << v.dstIP << ": " << hex << hashIP << " " << hashTuple
+			 << dec << endl;
+		assert(hashIP == v.hashIPv4Only);
+		assert(hashTuple == v.hashIPv4TcpUdp);
+
+		// Inbound packets without a NIC hash have to end up with the same hash,
+		// as the ConnectionID created by hand (e.g. for StateMachine::addState())
+		SamplePacket *pkt = getPkt(srcIP, dstIP, srcPort, dstPort);
+		Ident::ConnectionID fromPkt = Ident::identify(pkt);
+		Ident::ConnectionID fromTuple(
+			srcIP, dstIP, srcPort, dstPort, Headers::IPv4::PROTO_UDP);
+		assert(fromPkt.rssHash == v.hashIPv4TcpUdp);
+		assert(fromPkt == fromTuple);
+		assert(Ident::Hasher()(fromPkt) == Ident::Hasher()(fromTuple));
+		delete pkt;
+	}
+
+	// The connections of one queue (round robin RETA of 8 queues) share the low
+	// bits of the hash, they still have to spread over the buckets
+	{
+		const uint32_t numBuckets = 4096;
+		std::vector<bool> used(numBuckets, false);
+		uint32_t numIDs = 0;
+		uint32_t numUsed = 0;
+		for (uint32_t i = 0; numIDs < numBuckets; i++) {
+			Ident::ConnectionID id(htonl(0x0a000000 + (i >> 16)), htonl(0x0a010001),
+				htons(i & 0xffff), htons(80), Headers::IPv4::PROTO_TCP);
+			if ((id.rssHash & 7) != 0) {
+				continue;
+			}
+			numIDs++;
+			uint64_t bucket = Ident::Hasher()(id) & (numBuckets - 1);
+			if (!used[bucket]) {
+				used[bucket] = true;
+				numUsed++;
+			}
+		}
+
+		// As many IDs as buckets leave about 1/e of them empty
+		cout << "Buckets used by one queue: " << numUsed << " of " << numBuckets << endl;
+		assert(numUsed > numBuckets / 2);
+	}
+
+	// Changing the key has to change the hash
+	{
+		uint8_t key[Toeplitz::keyLen];
+		memcpy(key, Toeplitz::getKey(), sizeof(key));
+		key[0] ^= 0xff;
+		uint32_t before = Toeplitz::hashIPv4(1, 2, 3, 4);
+		Toeplitz::setKey(key);
+		assert(before != Toeplitz::hashIPv4(1, 2, 3, 4));
+	}
+
+	cout << "Toeplitz test passed" << endl;
+
+	return 0;
+}